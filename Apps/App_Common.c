@@ -10,7 +10,6 @@
  *-------------------------------------------------------------------------*/
 #include <stdint.h>
 #include <stdbool.h>
-#include <stdio.h>
 #include <string.h>
 #include <HostApp.h>
 #include <system/platform.h>
@@ -19,6 +18,7 @@
 #include <sensors/Temperature.h>
 #include <sensors/Potentiometer.h>
 #include <sensors/LightSensor.h>
+#include <sensors/FixedPoint.h>
 #include <system/mstimer.h>
 #include <drv/Glyph/lcd.h>
 #include "Apps.h"
@@ -27,17 +27,52 @@
     #error "APP_MAX_RECEIVED_DATA must be defined in platform.h"
 #endif
 
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+/* Received data is kept in blocks taken from one pool, each CID chains its
+ * own so one connection can use all of it or several can share it. */
+#define APP_RX_BLOCK_SIZE       32
+#define APP_RX_NUM_BLOCKS       (APP_MAX_RECEIVED_DATA / APP_RX_BLOCK_SIZE)
+#define APP_RX_NO_BLOCK         0xFF
+/* Most blocks one CID may hold while another holds some too, so a
+ * connection that leaves its data unread still leaves the rest of the pool
+ * to the others.  On its own a CID may use the whole pool. */
+#ifndef APP_RX_CID_MAX_BLOCKS
+    #define APP_RX_CID_MAX_BLOCKS   (APP_RX_NUM_BLOCKS - 1)
+#endif
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    uint8_t head;               /* block read from, APP_RX_NO_BLOCK if none */
+    uint8_t tail;               /* block written to */
+    uint8_t headIndex;          /* next byte to read in head */
+    uint8_t tailIndex;          /* next byte to write in tail */
+    uint8_t blocks;             /* blocks in the chain */
+    uint16_t count;             /* bytes waiting to be read */
+    uint16_t dropped;           /* bytes that did not fit since the flush */
+} App_RxRing_t;
+
 /*-------------------------------------------------------------------------*
  * Globals:
  *-------------------------------------------------------------------------*/
-uint8_t G_received[APP_MAX_RECEIVED_DATA + 1];
-unsigned int G_receivedCount = 0;
+uint32_t G_writtenCount = 0;     // bytes written to the module since boot
+static uint8_t G_rxPool[APP_RX_NUM_BLOCKS][APP_RX_BLOCK_SIZE];
+static uint8_t G_rxNext[APP_RX_NUM_BLOCKS]; /* next block in a chain */
+static uint8_t G_rxFree = APP_RX_NO_BLOCK;  /* chain of unused blocks */
+static uint8_t G_rxUsed = 0;                /* blocks out of the pool */
+static App_RxRing_t G_rxRings[ATLIBGS_MAX_CIDS];
+static bool G_rxReady = false;              /* pool set up */
 
 /*---------------------------------------------------------------------------*
  * Routine:  App_Write
  *---------------------------------------------------------------------------*
  * Description:
  *      ATCmdLib callback to write a string of characters to the module.
+ *      As many bytes as the transmit FIFO has room for go in each call
+ *      to the driver.
  * Inputs:
  *      const uint8_t *txData -- string of bytes
  *      uint32_t dataLength -- Number of bytes to transfer
@@ -47,22 +82,26 @@ unsigned int G_receivedCount = 0;
 void App_Write(const void *txData, uint16_t dataLength)
 {
     const uint8_t *tx = (uint8_t *)txData;
+    uint16_t sent;
+
+    G_writtenCount += dataLength;
 #ifdef ATLIBGS_INTERFACE_SPI
-    while (dataLength--) {
+    while (dataLength) {
         /* Keep trying to send this data until it goes */
-        while (!GainSpan_SPI_SendByte(*tx)) {
-            /* Process any incoming data as well */
-            GainSpan_SPI_Update(GAINSPAN_SPI_CHANNEL);
-        }
+        sent = GainSpan_SPI_SendData(tx, dataLength);
+        tx += sent;
+        dataLength -= sent;
 
-        tx++;
+        /* Process any incoming data as well */
+        if (dataLength)
+            GainSpan_SPI_Update(GAINSPAN_SPI_CHANNEL);
     }
 #else
-    while (dataLength--) {
+    while (dataLength) {
         /* Keep trying to send this data until it goes */
-        while (!GainSpan_UART_SendByte(*tx)) {
-        }
-        tx++;
+        sent = GainSpan_UART_SendData(tx, dataLength);
+        tx += sent;
+        dataLength -= sent;
     }
 #endif
 }
@@ -72,7 +111,9 @@ void App_Write(const void *txData, uint16_t dataLength)
  *---------------------------------------------------------------------------*
  * Description:
  *      ATCmdLib callback to read a string of characters from the module.
- *      This routine can block if needed until the data arrives.
+ *      This routine can block if needed until the data arrives.  As many
+ *      bytes as are waiting come out of the receive FIFO in each call to
+ *      the driver.
  * Inputs:
  *      uint8_t *rxData -- Pointer to a place to store a string of bytes
  *      uint16_t dataLength -- Number of bytes to transfer
@@ -82,16 +123,22 @@ void App_Write(const void *txData, uint16_t dataLength)
  *---------------------------------------------------------------------------*/
 bool App_Read(uint8_t *rxData, uint16_t dataLength, uint8_t blockFlag)
 {
-#ifdef ATLIBGS_INTERFACE_SPI
     bool got_data = false;
+    uint16_t got;
 
     /* Keep getting data if we have a number of bytes to fetch */
     while (dataLength) {
-        /* Try to get a byte */
-        if (GainSpan_SPI_ReceiveByte(GAINSPAN_SPI_CHANNEL, rxData)) {
-            /* Got a byte, move up to the next position */
-            rxData++;
-            dataLength--;
+        /* Try to get the bytes */
+#ifdef ATLIBGS_INTERFACE_SPI
+        got = GainSpan_SPI_ReceiveData(GAINSPAN_SPI_CHANNEL, rxData,
+                dataLength);
+#else
+        got = GainSpan_UART_ReceiveData(rxData, dataLength);
+#endif
+        if (got) {
+            /* Got some, move up to the next position */
+            rxData += got;
+            dataLength -= got;
             got_data = true;
         } else {
             /* Did not get a byte, are we block?  If not, stop here */
@@ -101,25 +148,45 @@ bool App_Read(uint8_t *rxData, uint16_t dataLength, uint8_t blockFlag)
     }
 
     return got_data;
-#else
-    bool got_data = false;
+}
 
-    /* Keep getting data if we have a number of bytes to fetch */
-    while (dataLength) {
-        /* Try to get a byte */
-        if (GainSpan_UART_ReceiveByte(rxData)) {
-            /* Got a byte, move up to the next position */
-            rxData++;
-            dataLength--;
-            got_data = true;
-        } else {
-            /* Did not get a byte, are we block?  If not, stop here */
-            if (!blockFlag)
-            break;
-        }
-    }
+/*---------------------------------------------------------------------------*
+ * Routine:  App_ReadSpan
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      ATCmdLib callback to look at the received bytes waiting in the
+ *      module's receive FIFO without taking them out.  Does not block.
+ * Inputs:
+ *      const uint8_t **rxSpan -- Returned pointer to the first byte
+ * Outputs:
+ *      uint16_t -- Number of contiguous bytes at *rxSpan, 0 if none
+ *---------------------------------------------------------------------------*/
+uint16_t App_ReadSpan(const uint8_t **rxSpan)
+{
+#ifdef ATLIBGS_INTERFACE_SPI
+    return GainSpan_SPI_ReceiveSpan(GAINSPAN_SPI_CHANNEL, rxSpan);
+#else
+    return GainSpan_UART_ReceiveSpan(rxSpan);
+#endif
+}
 
-    return got_data;
+/*---------------------------------------------------------------------------*
+ * Routine:  App_ReadConsume
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      ATCmdLib callback to take bytes returned by App_ReadSpan out of the
+ *      module's receive FIFO.
+ * Inputs:
+ *      uint16_t dataLength -- Number of bytes, no more than the span
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void App_ReadConsume(uint16_t dataLength)
+{
+#ifdef ATLIBGS_INTERFACE_SPI
+    GainSpan_SPI_ReceiveConsume(dataLength);
+#else
+    GainSpan_UART_ReceiveConsume(dataLength);
 #endif
 }
 
@@ -143,7 +210,7 @@ int16_t App_RSSIReading(bool updateLCD)
     if (AtLibGs_IsNodeAssociated()) {
         if (AtLibGs_GetRssi() == ATLIBGS_MSG_ID_OK) {
             if (AtLibGs_ParseRssiResponse(&rssi)) {
-                sprintf(line, "RSSI: %d", rssi);
+                Fixed_FormatLabel(line, "RSSI: ", rssi, 0, "");
                 DisplayLCD(LCD_LINE5, (const uint8_t *)line);
                 rssiFound = 1;
             }
@@ -172,16 +239,16 @@ void App_TemperatureReadingUpdate(char * G_temp_int, bool updateLCD)
     char lcd_buffer[20];
 
     // Temperature sensor reading
-    int16_t temp;
-    temp = Temperature_Get();
+    int16_t tenths;
+    tenths = Fixed_TempTenthsC((TempQ7_t)Temperature_Get());
     // Get the temperature and show it on the LCD
-    G_temp_int[0] = (int16_t)temp / 16;
-    G_temp_int[1] = (int16_t)((temp & 0x000F) * 10) / 16;
+    G_temp_int[0] = tenths / 10;
+    G_temp_int[1] = (tenths < 0) ? -(tenths % 10) : tenths % 10;
 
     if(updateLCD)
     {
     // Display the contents of lcd_buffer onto the debug LCD 
-    sprintf((char *)lcd_buffer, "TEMP: %d.%d C", G_temp_int[0], G_temp_int[1]);
+    Fixed_FormatLabel(lcd_buffer, "TEMP: ", tenths, 1, " C");
     DisplayLCD(LCD_LINE3, (const uint8_t *)lcd_buffer);
     }
 }
@@ -202,14 +269,14 @@ void App_PotentiometerUpdate(int16_t * G_adc_int, bool updateLCD)
     char lcd_buffer[20];
 
     // Potentiometer sensor reading
-    int32_t percent;
-    percent = Potentiometer_Get();
+    PerMille_t percent;
+    percent = (PerMille_t)Potentiometer_Get();
     G_adc_int[0] = (int16_t)(percent / 10);
     G_adc_int[1] = (int16_t)(percent % 10);
 
     if(updateLCD)
     {
-    sprintf((char *)lcd_buffer, " POT: %d.%d %%", G_adc_int[0], G_adc_int[1]);
+    Fixed_FormatLabel(lcd_buffer, " POT: ", percent, 1, " %");
     /* Display the contents of lcd_buffer onto the debug LCD */
     DisplayLCD(LCD_LINE4, (const uint8_t *)lcd_buffer);
     }
@@ -236,7 +303,7 @@ void App_LightSensorReadingUpdate(char * G_light_int, bool updateLCD)
     if(updateLCD)
     {
       // Display the contents of lcd_buffer onto the debug LCD 
-      sprintf((char *)lcd_buffer, "Light: %d ", *G_light_int);
+      Fixed_FormatLabel(lcd_buffer, "Light: ", *(int16_t *)G_light_int, 0, " ");
       DisplayLCD(LCD_LINE5, (const uint8_t *)lcd_buffer);
     }
 }
@@ -246,7 +313,8 @@ void App_LightSensorReadingUpdate(char * G_light_int, bool updateLCD)
  * Routine:  App_PrepareIncomingData
  *---------------------------------------------------------------------------*
  * Description:
- *      ATCmdLib callback to reset the incoming data state.
+ *      ATCmdLib callback to reset the incoming data state.  Drops the
+ *      data of every connection and returns all blocks to the pool.
  * Inputs:
  *      void
  * Outputs:
@@ -254,8 +322,21 @@ void App_LightSensorReadingUpdate(char * G_light_int, bool updateLCD)
  *---------------------------------------------------------------------------*/
 void App_PrepareIncomingData(void)
 {
-    G_receivedCount = 0;
-    G_received[0] = '\0';
+    uint8_t i;
+
+    for (i = 0; i < APP_RX_NUM_BLOCKS; i++)
+        G_rxNext[i] = i + 1;
+    G_rxNext[APP_RX_NUM_BLOCKS - 1] = APP_RX_NO_BLOCK;
+    G_rxFree = 0;
+    G_rxUsed = 0;
+
+    for (i = 0; i < ATLIBGS_MAX_CIDS; i++) {
+        G_rxRings[i].head = APP_RX_NO_BLOCK;
+        G_rxRings[i].blocks = 0;
+        G_rxRings[i].count = 0;
+        G_rxRings[i].dropped = 0;
+    }
+    G_rxReady = true;
 }
 
 /*---------------------------------------------------------------------------*
@@ -263,18 +344,246 @@ void App_PrepareIncomingData(void)
  *---------------------------------------------------------------------------*
  * Description:
  *      ATCmdLib callback that is called when a byte has come in for a
- *      specific connection.
+ *      specific connection.  The byte is dropped and counted if the
+ *      connection has no room left.
  * Inputs:
+ *      uint8_t cid -- Connection the byte is for
  *      uint8_t rxData -- Byte received
  * Outputs:
  *      void
  *---------------------------------------------------------------------------*/
-void App_ProcessIncomingData(uint8_t rxData)
+void App_ProcessIncomingData(uint8_t cid, uint8_t rxData)
+{
+    App_ProcessIncomingSpan(cid, &rxData, 1);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_ProcessIncomingSpan
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      ATCmdLib data handler that is given received bytes for a specific
+ *      connection straight out of the receive FIFO.  They are copied a
+ *      block at a time into the connection's chain.  Whatever does not fit,
+ *      because the pool is used up or the connection already holds
+ *      APP_RX_CID_MAX_BLOCKS while another holds some too, is dropped and
+ *      counted for App_IncomingDropped.  App_IncomingRoom keeps that from
+ *      happening to chunks of the receive FIFO.
+ * Inputs:
+ *      uint8_t cid -- Connection the bytes are for
+ *      const uint8_t *rxData -- Bytes received
+ *      uint16_t dataLength -- Number of bytes
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void App_ProcessIncomingSpan(
+        uint8_t cid,
+        const uint8_t *rxData,
+        uint16_t dataLength)
+{
+    App_RxRing_t *p_ring;
+    uint8_t block;
+    uint16_t n;
+
+    if (cid >= ATLIBGS_MAX_CIDS)
+        return;
+    /* The pool is set up on the first byte after power up */
+    if (!G_rxReady)
+        App_PrepareIncomingData();
+
+    p_ring = &G_rxRings[cid];
+    while (dataLength) {
+        if ((p_ring->head == APP_RX_NO_BLOCK)
+                || (p_ring->tailIndex == APP_RX_BLOCK_SIZE)) {
+            /* Chain another block to the end */
+            block = G_rxFree;
+            if ((block == APP_RX_NO_BLOCK)
+                    || ((p_ring->blocks >= APP_RX_CID_MAX_BLOCKS)
+                    && (G_rxUsed > p_ring->blocks))) {
+                if (dataLength > 0xFFFF - p_ring->dropped)
+                    p_ring->dropped = 0xFFFF;
+                else
+                    p_ring->dropped += dataLength;
+                return;
+            }
+            G_rxFree = G_rxNext[block];
+            G_rxNext[block] = APP_RX_NO_BLOCK;
+            G_rxUsed++;
+            if (p_ring->head == APP_RX_NO_BLOCK) {
+                p_ring->head = block;
+                p_ring->headIndex = 0;
+            } else {
+                G_rxNext[p_ring->tail] = block;
+            }
+            p_ring->tail = block;
+            p_ring->tailIndex = 0;
+            p_ring->blocks++;
+        }
+
+        /* Fill the rest of the tail block */
+        n = APP_RX_BLOCK_SIZE - p_ring->tailIndex;
+        if (n > dataLength)
+            n = dataLength;
+        memcpy(&G_rxPool[p_ring->tail][p_ring->tailIndex], rxData, n);
+        p_ring->tailIndex += n;
+        p_ring->count += n;
+        rxData += n;
+        dataLength -= n;
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_IncomingCount
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Tell how many received bytes of a connection are waiting.
+ * Inputs:
+ *      uint8_t cid -- Connection
+ * Outputs:
+ *      uint16_t -- Number of bytes App_ReadIncomingData can return
+ *---------------------------------------------------------------------------*/
+uint16_t App_IncomingCount(uint8_t cid)
 {
-    if (G_receivedCount < APP_MAX_RECEIVED_DATA) {
-        G_received[G_receivedCount++] = rxData;
-        G_received[G_receivedCount] = '\0';
+    if (cid >= ATLIBGS_MAX_CIDS)
+        return 0;
+
+    return G_rxRings[cid].count;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_IncomingRoom
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      ATCmdLib callback to tell how many more bytes of a connection
+ *      App_ProcessIncomingSpan can keep.  What does not fit waits in the
+ *      receive FIFO until the connection's bytes are read, so a frame
+ *      larger than the pool gets through as long as it is read while it
+ *      comes in.  A connection with nothing waiting and no room, because
+ *      the others hold the pool, is not held back; its bytes are dropped
+ *      as before.
+ * Inputs:
+ *      uint8_t cid -- Connection
+ * Outputs:
+ *      uint16_t -- Number of bytes, 0xFFFF if it is not to be held back
+ *---------------------------------------------------------------------------*/
+uint16_t App_IncomingRoom(uint8_t cid)
+{
+    App_RxRing_t *p_ring;
+    uint8_t blocks;
+    uint16_t room;
+
+    if (cid >= ATLIBGS_MAX_CIDS)
+        return 0xFFFF;
+
+    p_ring = &G_rxRings[cid];
+    blocks = APP_RX_NUM_BLOCKS - G_rxUsed;
+    if (G_rxUsed > p_ring->blocks) {
+        /* Another connection holds blocks, keep to the cap */
+        if (p_ring->blocks >= APP_RX_CID_MAX_BLOCKS)
+            blocks = 0;
+        else if (blocks > APP_RX_CID_MAX_BLOCKS - p_ring->blocks)
+            blocks = APP_RX_CID_MAX_BLOCKS - p_ring->blocks;
     }
+    room = (uint16_t)blocks * APP_RX_BLOCK_SIZE;
+    if (p_ring->head != APP_RX_NO_BLOCK)
+        room += APP_RX_BLOCK_SIZE - p_ring->tailIndex;
+
+    /* Reading this connection would free nothing, so do not wait for it */
+    if ((room < 2) && (!p_ring->count))
+        return 0xFFFF;
+
+    return room;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_IncomingDropped
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Tell how many received bytes of a connection have been dropped
+ *      since its data was last flushed.  Anything but 0 means what is
+ *      waiting is not all that came in.
+ * Inputs:
+ *      uint8_t cid -- Connection
+ * Outputs:
+ *      uint16_t -- Number of bytes dropped, 0xFFFF if that many or more
+ *---------------------------------------------------------------------------*/
+uint16_t App_IncomingDropped(uint8_t cid)
+{
+    if (cid >= ATLIBGS_MAX_CIDS)
+        return 0;
+
+    return G_rxRings[cid].dropped;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_ReadIncomingData
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Take received bytes of a connection in the order they came in.
+ *      Blocks that have been read return to the pool.
+ * Inputs:
+ *      uint8_t cid -- Connection
+ *      void *rxData -- Buffer for the bytes, or 0 to drop them
+ *      uint16_t dataLength -- Most bytes to take
+ * Outputs:
+ *      uint16_t -- Number of bytes taken
+ *---------------------------------------------------------------------------*/
+uint16_t App_ReadIncomingData(uint8_t cid, void *rxData, uint16_t dataLength)
+{
+    App_RxRing_t *p_ring;
+    uint8_t *rx = (uint8_t *)rxData;
+    uint8_t block;
+    uint16_t len = 0;
+    uint8_t n;
+
+    if (cid >= ATLIBGS_MAX_CIDS)
+        return 0;
+
+    p_ring = &G_rxRings[cid];
+    while ((len < dataLength) && (p_ring->count)) {
+        /* Bytes left in the head block */
+        if (p_ring->head == p_ring->tail)
+            n = p_ring->tailIndex - p_ring->headIndex;
+        else
+            n = APP_RX_BLOCK_SIZE - p_ring->headIndex;
+        if (n > dataLength - len)
+            n = dataLength - len;
+        if (rx)
+            memcpy(&rx[len], &G_rxPool[p_ring->head][p_ring->headIndex], n);
+        p_ring->headIndex += n;
+        p_ring->count -= n;
+        len += n;
+
+        if ((p_ring->headIndex == APP_RX_BLOCK_SIZE) || (!p_ring->count)) {
+            /* Done with the head block, back to the pool */
+            block = p_ring->head;
+            p_ring->head = G_rxNext[block];
+            p_ring->headIndex = 0;
+            G_rxNext[block] = G_rxFree;
+            G_rxFree = block;
+            p_ring->blocks--;
+            G_rxUsed--;
+        }
+    }
+
+    return len;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_FlushIncomingData
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Drop the received bytes of one connection, leaving the others,
+ *      and start counting its dropped bytes over.
+ * Inputs:
+ *      uint8_t cid -- Connection
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void App_FlushIncomingData(uint8_t cid)
+{
+    App_ReadIncomingData(cid, 0, 0xFFFF);
+    if (cid < ATLIBGS_MAX_CIDS)
+        G_rxRings[cid].dropped = 0;
 }
 
 /*---------------------------------------------------------------------------*
@@ -34,17 +34,23 @@
 *****************************************************************************/
 #include <stdint.h>
 #include <stdbool.h>
-#include <stdio.h>
 #include <string.h>
 #include <drv/Glyph/lcd.h>
 #include <system/mstimer.h>
 #include "led.h"
+#include "Apps.h"
 #include "NVSettings.h"
+#include "Datasources.h"
 #include <sensors/Temperature.h>
 #include <sensors/Potentiometer.h>
+#include <sensors/FixedPoint.h>
 #include <exosite/exosite_hal.h>
 #include <exosite/exosite_meta.h>
 #include <exosite/exosite.h>
+#include <exosite/exosite_queue.h>
+#include <exosite/exosite_backoff.h>
+#include <exosite/exosite_clock.h>
+#include <exosite/exosite_report.h>
 #include <inc/common.h>
 
 // Globals:
@@ -53,12 +59,68 @@ NVSettings_t GNV_Setting;
 // local defines
 #define ExositeAppVersion                   "   v1.04   "
 #define SHOW_VERSION
-#define WRITE_INTERVAL 5
-#define EXO_BUFFER_SIZE 200
-char exo_buffer[EXO_BUFFER_SIZE];
+#define SAMPLE_INTERVAL 1000     // ms between sensor samples
+#define WRITE_INTERVAL 60000     // ms between uploads of the samples
+#define LONGPOLL_MIN_TIMEOUT 1000
+#define COMMAND_READ_INTERVAL 1000 // ms between reads if the server can't hold them
+#define ACTIVATE_BASE_MS 3000    // first retry of a failed activation
+#define ACTIVATE_CAP_MS 300000   // the portal is checked at least this often
+#define DRAIN_BATCH 60           // queued samples sent per upload
+#define SAMPLE_RING_SIZE 64      // a power of two, holds a minute of samples
+#define TIME_POLL_INTERVAL 600000 // ms between reads of the module's SNTP time
+#define ASYNC_POLL_INTERVAL 10   // ms between steps of a request in flight
+#define REPORT_MIN_MS 10000     // ms between points of a changing datasource
+#define REPORT_HEARTBEAT_MS 600000 // ms after which a steady datasource is sent
+#ifdef HOST_APP_TCP_DEBUG
+#define DEBUG_CONTENT_MAX 32     // "&ect=..&jit=.." after the readings
+#else
+#define DEBUG_CONTENT_MAX 0
+#endif
+// samples taken since the last upload, sample seq is at seq % SAMPLE_RING_SIZE
+typedef struct {
+  uint32_t time;                 // MSTimerGet() when taken
+  int16_t temp;                  // tenths of a degree C
+  int16_t adc;                   // tenths of a percent
+  uint8_t report;                // bit per sample alias whose point is sent
+} Sample;
+// the sample aliases are the first rows of DATASOURCES
+enum { SAMPLE_TEMP = DS_TEMP, SAMPLE_ADC = DS_ADC, NUM_SAMPLE_ALIASES };
+// only points that changed past their deadband, or are due a heartbeat,
+// are sent, an entry per OUT datasource whose alias is set at startup
+enum { REPORT_PING = DS_PING, NUM_REPORTS };
+exosite_report reports[NUM_REPORTS] = {
+  {0, REPORT_ABSOLUTE, 5, REPORT_MIN_MS, REPORT_HEARTBEAT_MS},  // 0.5 C
+  {0, REPORT_PERCENT, 2, REPORT_MIN_MS, REPORT_HEARTBEAT_MS},   // 2 %
+  {0, REPORT_HEARTBEAT, 0, 0, REPORT_HEARTBEAT_MS},
+};
+Sample samples[SAMPLE_RING_SIZE];
+uint16_t sample_seq = 0;         // seq of the next sample
+uint16_t sample_count = 0;
+uint32_t lastSample = 0;
+uint32_t sampleLateMax = 0;      // worst ms a sample came after its time
+bool sampled = false;
+bool uploading = false;
+// Exosite_Record reads a batch twice, to count it and to send it, so the
+// stamps of a batch are taken against one reading of the clock
+typedef struct {
+  uint32_t now;                  // MSTimerGet() when the batch was taken
+  uint32_t wall;                 // unix time at now, 0 if the clock isn't set
+} StampRef;
+typedef struct {
+  StampRef ref;
+  uint16_t first;                // seq of the first sample in the upload
+  uint16_t count;
+} SampleBatch;
+typedef struct {
+  StampRef ref;
+  exosite_queue_record record;   // last record read from the queue
+  uint16_t index;                // its queue index, 0xffff for none
+  uint16_t count;
+  uint16_t read;                 // records read into the request
+} QueueBatch;
 char ping = 0;
-int16_t G_adc_int[2] = { 0, 0 };
-char G_temp_int[2] = { 0, 0 };
+PerMille_t G_adc_permille = 0;
+int16_t G_temp_tenths = 0;        // tenths of a degree C
 
 // external defines
 
@@ -82,15 +144,11 @@ void TemperatureReading(void)
 {
   char lcd_buffer[20];
 
-  // Temperature sensor reading
-  int16_t temp;
-  temp = Temperature_Get()>>3;
-  // Get the temperature and show it on the LCD
-  G_temp_int[0] = (int16_t)temp / 16 - 2;
-  G_temp_int[1] = (int16_t)((temp & 0x000F) * 10) / 16;
+  // Temperature sensor reading, it reads 2 C over the air around the board
+  G_temp_tenths = Fixed_TempTenthsC((TempQ7_t)Temperature_Get()) - 20;
 
   /* Display the contents of lcd_buffer onto the debug LCD */
-  sprintf((char *)lcd_buffer, "TEMP: %d.%d C", G_temp_int[0], G_temp_int[1]);
+  Datasource_FormatLabel(lcd_buffer, DS_TEMP, G_temp_tenths);
   DisplayLCD(LCD_LINE3, (const uint8_t *)lcd_buffer);
 }
 
@@ -110,18 +168,85 @@ void PotentiometerReading(void)
 {
   char lcd_buffer[20];
 
-  // Temperature sensor reading
-  int32_t percent;
-  percent = Potentiometer_Get();
-  G_adc_int[0] = (int16_t)(percent / 10);
-  G_adc_int[1] = (int16_t)(percent % 10);
+  // Potentiometer reading
+  G_adc_permille = (PerMille_t)Potentiometer_Get();
 
-  sprintf((char *)lcd_buffer, " POT: %d.%d ", G_adc_int[0], G_adc_int[1]);
+  Datasource_FormatLabel(lcd_buffer, DS_ADC, G_adc_permille);
   /* Display the contents of lcd_buffer onto the debug LCD */
   DisplayLCD(LCD_LINE4, (const uint8_t *)lcd_buffer);
 }
 
 
+/*****************************************************************************
+*
+*  SampleStampRef
+*
+*  \param  ref - reference to fill in
+*
+*  \return None
+*
+*  \brief  Reads the clock once for the stamps of a batch
+*
+*****************************************************************************/
+void SampleStampRef(StampRef *ref)
+{
+  ref->now = MSTimerGet();
+  ref->wall = exosite_clock_valid() ? exosite_clock_at(ref->now) : 0;
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  SampleTimestamp
+*
+*  \param  time - MSTimerGet() when the sample was taken
+*          ref - clock reading of the batch
+*
+*  \return Timestamp for Exosite_Record
+*
+*  \brief  Stamps a sample with the wall clock. Until the clock is set the
+*          stamp is relative to the upload, seconds before now as a
+*          negative number.
+*
+*****************************************************************************/
+int32_t SampleTimestamp(uint32_t time, const StampRef *ref)
+{
+  uint32_t age = (ref->now - time) / 1000;
+
+  if (0 != ref->wall)
+    return (int32_t)(ref->wall - age);
+
+  return (0 == age) ? -1 : -(int32_t)age;
+}
+
+
+/*****************************************************************************
+*
+*  QueuedTimestamp
+*
+*  \param  time - timestamp of a queued record
+*          ref - clock reading of the batch
+*
+*  \return Timestamp for Exosite_Record
+*
+*  \brief  Queued records carry the wall clock time, or seconds since boot
+*          if the clock wasn't set yet. Those from before a reboot have no
+*          usable time and are stamped as just taken.
+*
+*****************************************************************************/
+int32_t QueuedTimestamp(uint32_t time, const StampRef *ref)
+{
+  if (EXOSITE_CLOCK_EPOCH_MIN <= time)
+    return (int32_t)time;
+  if (time > ref->now / 1000)
+    return SampleTimestamp(ref->now, ref);
+
+  return SampleTimestamp(time * 1000, ref);
+}
+
+
 /*****************************************************************************
 *
 *  RSSIReading
@@ -142,7 +267,7 @@ void RSSIReading(void)
   if (AtLibGs_IsNodeAssociated()) {
     if (AtLibGs_GetRssi() == ATLIBGS_MSG_ID_OK) {
       if (AtLibGs_ParseRssiResponse(&rssi)) {
-        sprintf(line, "RSSI: %d", rssi);
+        Fixed_FormatLabel(line, "RSSI: ", rssi, 0, "");
         DisplayLCD(LCD_LINE5, (const uint8_t *)line);
         rssiFound = 1;
       }
@@ -226,45 +351,422 @@ show_status(void)
 
 /*****************************************************************************
 *
-*  ReportReadings
+*  FormatReadings
 *
-*  \param  None
+*  \param  content - buffer to put the url-encoded readings into
 *
-*  \return None
+*  \return Length of the readings
 *
-*  \brief  Reports the sensor and customization values to Exosite cloud
+*  \brief  Formats the customization values for Exosite cloud, the sensor
+*          samples go up with Exosite_Record
 *
 *****************************************************************************/
-void ReportReadings(void)
+int FormatReadings(char *content)
 {
-  static char content[256];
+  int32_t values[NUM_DATASOURCES];
+  int len;
 
+  values[DS_PING] = ping;
+  len = Datasource_Encode(content, values, 1 << DS_PING);
 #ifdef HOST_APP_TCP_DEBUG
   if (updateError) 
   {
-    sprintf(content, "temp=%d.%d&adc1=%d.%d&ping=%d&ect=%d\r\n",
-                     G_temp_int[0],G_temp_int[1], G_adc_int[0], G_adc_int[1],
-                     ping,parsererror);
+    len += Fixed_FormatLabel(&content[len], "&ect=", parsererror, 0, "");
     updateError = 0;
-  } else {
-    sprintf(content, "temp=%d.%d&adc1=%d.%d&ping=%d\r\n",
-                     G_temp_int[0],G_temp_int[1], G_adc_int[0], G_adc_int[1],
-                     ping);
   }
-#else
-  sprintf(content, "temp=%d.%d&adc1=%d.%d&ping=%d\r\n",
-                   G_temp_int[0],G_temp_int[1], G_adc_int[0], G_adc_int[1],
-                   ping);
+  len += Fixed_FormatLabel(&content[len], "&jit=", sampleLateMax, 0, "");
 #endif
   ping++;
   if (ping >= 100)
     ping = 0;
+
+  return len;
+}
+
+
+/*****************************************************************************
+*
+*  ApplyLedCtrl
+*
+*  \param  value - led_ctrl value read from Exosite cloud; len - its length
+*
+*  \return None
+*
+*  \brief  Turns the LEDs off on "0" and on on "1"
+*
+*****************************************************************************/
+void ApplyLedCtrl(const char *value, uint8_t len)
+{
+  if (len < 1)
+    return;
+  if ('0' == value[0])
+    led_all_off();
+  else if ('1' == value[0])
+    led_all_on();
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  CloudCommandsDone
+*
+*  \param  ctx - unused; result - 1 if the LED command changed
+*
+*  \return None
+*
+*  \brief  Completes the long poll started by WaitCloudCommands
+*
+*****************************************************************************/
+void CloudCommandsDone(void *ctx, int result)
+{
+  if (result) {
+    DisplayLCD(LCD_LINE8, "     OK    ");
+    Datasource_ApplyCommands();
+  }
+  else if (EXO_STATUS_OK != Exosite_StatusCode())
+    show_status();
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  WaitCloudCommands
+*
+*  \param  timeout - ms the server may hold the request
+*
+*  \return None
+*
+*  \brief  Starts a long poll of Exosite cloud for a change to the LED
+*          command. The main loop drives it with Exosite_Poll and keeps
+*          sampling meanwhile.
+*
+*****************************************************************************/
+void WaitCloudCommands(uint32_t timeout)
+{
+  static ExositeLongPoll poll;
+
+  if (timeout < LONGPOLL_MIN_TIMEOUT)
+    timeout = LONGPOLL_MIN_TIMEOUT;
+  poll.timeout = timeout;
+
+  DisplayLCD(LCD_LINE6, "  Exosite  ");
+  DisplayLCD(LCD_LINE7, "    Read   ");
+  if (!Exosite_ReadLongPollStart(&G_commands[CMD_DS_LED_CTRL], &poll,
+                                 CloudCommandsDone, NULL))
+    show_status();
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  QueueReadings
+*
+*  \param  time - MSTimerGet() when the readings were taken
+*          content - url-encoded readings; len - length of the readings
+*
+*  \return None
+*
+*  \brief  Saves readings that could not be sent in the EEPROM queue
+*
+*****************************************************************************/
+void QueueReadings(uint32_t time, const char *content, int len)
+{
+  // unix time once the clock is set, seconds since boot before that
+  if (exosite_clock_valid())
+    exosite_queue_push(exosite_clock_at(time), content, len);
+  else
+    exosite_queue_push(time / 1000, content, len);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  QueueSample
+*
+*  \param  sample - sample with points worth sending
+*
+*  \return None
+*
+*  \brief  Saves the points of a sample that left the ring in the queue
+*
+*****************************************************************************/
+void QueueSample(const Sample *sample)
+{
+  char content[DS_PAYLOAD_MAX + 1];
+  int32_t values[NUM_SAMPLE_ALIASES];
+  int len;
+
+  values[SAMPLE_TEMP] = sample->temp;
+  values[SAMPLE_ADC] = sample->adc;
+  len = Datasource_Encode(content, values, sample->report);
+  QueueReadings(sample->time, content, len);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  SampleReadings
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Takes a sample of temperature and potentiometer once every
+*          SAMPLE_INTERVAL. Also runs from the HAL idle hook so sampling
+*          goes on while a request waits on the server. When the ring is
+*          full the oldest sample moves to the EEPROM queue, or during an
+*          upload the new one does.
+*
+*****************************************************************************/
+void SampleReadings(void)
+{
+  Sample sample;
+  Sample *oldest;
+  uint8_t alias;
+
+  if (sampled && MSTimerDelta(lastSample) < SAMPLE_INTERVAL)
+    return;
+  if (sampled && MSTimerDelta(lastSample) - SAMPLE_INTERVAL > sampleLateMax)
+    sampleLateMax = MSTimerDelta(lastSample) - SAMPLE_INTERVAL;
+  lastSample = MSTimerGet();
+  sampled = true;
+
+  TemperatureReading();
+  PotentiometerReading();
+
+  sample.time = lastSample;
+  sample.temp = G_temp_tenths;
+  sample.adc = G_adc_permille;
+  sample.report = 0;
+  if (exosite_report_due(&reports[SAMPLE_TEMP], sample.temp, sample.time))
+    sample.report |= 1 << SAMPLE_TEMP;
+  if (exosite_report_due(&reports[SAMPLE_ADC], sample.adc, sample.time))
+    sample.report |= 1 << SAMPLE_ADC;
+
+  if (SAMPLE_RING_SIZE == sample_count && uploading)
+  {
+    // the ring holds the batch going out and the head of the queue may be
+    // going out too, so the new sample goes behind the queue instead. With
+    // no room there it is dropped and its points are due again.
+    if (0 == sample.report)
+      return;
+    if (QUEUE_SLOTS > exosite_queue_depth())
+    {
+      QueueSample(&sample);
+      return;
+    }
+    for (alias = 0; alias < NUM_SAMPLE_ALIASES; alias++)
+    {
+      if (sample.report & (1 << alias))
+        exosite_report_reset(&reports[alias]);
+    }
+    return;
+  }
+
+  if (SAMPLE_RING_SIZE == sample_count)
+  {
+    // samples with nothing worth sending are dropped
+    oldest = &samples[(uint16_t)(sample_seq - sample_count) % SAMPLE_RING_SIZE];
+    if (0 != oldest->report)
+      QueueSample(oldest);
+    sample_count--;
+  }
+
+  samples[sample_seq % SAMPLE_RING_SIZE] = sample;
+  sample_seq++;
+  sample_count++;
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  RingSampleSource
+*
+*  \param  ctx - SampleBatch being uploaded; index - sample in the batch
+*          alias - sample datasource; timestamp, value - the point
+*
+*  \return 0 past the end of the batch, 1 otherwise
+*
+*  \brief  Feeds Exosite_Record from the sample ring, skipping points held
+*          back by the deadbands. SampleReadings leaves the batch in place
+*          while it is uploaded.
+*
+*****************************************************************************/
+unsigned char RingSampleSource(void *ctx, unsigned short index,
+                               unsigned char alias, int32_t *timestamp,
+                               char *value)
+{
+  SampleBatch *batch = (SampleBatch *)ctx;
+  uint16_t seq = batch->first + index;
+  Sample *sample = &samples[seq % SAMPLE_RING_SIZE];
+
+  if (index >= batch->count)
+    return 0;
+  if (!(sample->report & (1 << alias)))
+    return 1;
+
+  *timestamp = SampleTimestamp(sample->time, &batch->ref);
+  Datasource_Format(value, (DatasourceId)alias,
+                    SAMPLE_TEMP == alias ? sample->temp : sample->adc);
+
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+*  QueueSampleSource
+*
+*  \param  ctx - QueueBatch being uploaded; index - sample in the batch
+*          alias - sample datasource; timestamp, value - the point
+*
+*  \return 0 past the end of the batch or at a torn record, 1 otherwise
+*
+*  \brief  Feeds Exosite_Record from the EEPROM queue, picking the value of
+*          the alias out of the url-encoded record. Counts the records read
+*          so only those are removed once sent.
+*
+*****************************************************************************/
+unsigned char QueueSampleSource(void *ctx, unsigned short index,
+                                unsigned char alias, int32_t *timestamp,
+                                char *value)
+{
+  QueueBatch *batch = (QueueBatch *)ctx;
+  const char *name = G_datasourceNames[alias];
+  int name_len = strlen(name);
+  int pos = 0;
+  int len = 0;
+
+  if (index >= batch->count)
+    return 0;
+  if (batch->index != index)
+  {
+    if (!exosite_queue_peek(index, &batch->record))
+      return 0;
+    batch->index = index;
+    if (batch->read <= index)
+      batch->read = index + 1;
+  }
+
+  // look for "name=" at the start or after a '&'
+  while (pos + name_len < batch->record.len)
+  {
+    if (0 == strncmp(&batch->record.data[pos], name, name_len)
+        && '=' == batch->record.data[pos + name_len])
+      break;
+    while (pos < batch->record.len && '&' != batch->record.data[pos])
+      pos++;
+    pos++;
+  }
+  if (pos + name_len >= batch->record.len)
+    return 1;
+
+  pos += name_len + 1;
+  while (pos < batch->record.len && '&' != batch->record.data[pos]
+         && '\r' != batch->record.data[pos]
+         && EXOSITE_RECORD_VALUE_SIZE - 1 > len)
+    value[len++] = batch->record.data[pos++];
+  value[len] = 0;
+  *timestamp = QueuedTimestamp(batch->record.timestamp, &batch->ref);
+
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+*  DrainQueuedReadings
+*
+*  \param  None
+*
+*  \return 1 if the queue was drained, 0 if samples are still waiting
+*
+*  \brief  Sends a batch of queued readings, oldest first, in one request
+*          and removes them once the cloud accepted them
+*
+*****************************************************************************/
+int DrainQueuedReadings(void)
+{
+  static QueueBatch batch;       // a queue record is too big for the stack
+  uint32_t start = MSTimerGet();
+
+  SampleStampRef(&batch.ref);
+  batch.index = 0xffff;
+  batch.read = 0;
+  batch.count = exosite_queue_depth();
+  if (batch.count > DRAIN_BATCH)
+    batch.count = DRAIN_BATCH;
+
   DisplayLCD(LCD_LINE6, "  Exosite  ");
-  DisplayLCD(LCD_LINE7, "   Write   ");
-  if (Exosite_Write(content, strlen(content)))
+  DisplayLCD(LCD_LINE7, "   Drain   ");
+  if (!Exosite_Record(G_datasourceNames, NUM_SAMPLE_ALIASES, QueueSampleSource,
+                      &batch))
   {
-    DisplayLCD(LCD_LINE8, "     OK    ");
+    show_status();
+    return 0;
   }
+  // a torn record ends the batch early, and dropping one at the head
+  // moves the rest up, so only what went out is removed
+  exosite_queue_pop(batch.read, MSTimerDelta(start));
+  DisplayLCD(LCD_LINE8, "     OK    ");
+
+  return 0 == exosite_queue_depth();
+}
+
+
+/*****************************************************************************
+*
+*  UploadReadings
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Uploads the queued readings and then the samples in the ring,
+*          each batch in a single request. A batch with no point past its
+*          deadband sends nothing.
+*
+*****************************************************************************/
+void UploadReadings(void)
+{
+  SampleBatch batch;
+
+  uploading = true;
+
+  // keep samples in order behind the ones still waiting
+  if (0 == exosite_queue_depth() || DrainQueuedReadings())
+  {
+    SampleStampRef(&batch.ref);
+    batch.first = sample_seq - sample_count;
+    batch.count = sample_count;
+
+    DisplayLCD(LCD_LINE6, "  Exosite  ");
+    DisplayLCD(LCD_LINE7, "   Record  ");
+    if (Exosite_Record(G_datasourceNames, NUM_SAMPLE_ALIASES, RingSampleSource,
+                       &batch))
+    {
+      // samples taken during the upload stay for the next one
+      if (sample_count > (uint16_t)(sample_seq - batch.first - batch.count))
+        sample_count = sample_seq - batch.first - batch.count;
+      DisplayLCD(LCD_LINE8, "     OK    ");
+    }
+    else
+      show_status();
+  }
+
+  uploading = false;
 
   return;
 }
@@ -272,26 +774,32 @@ void ReportReadings(void)
 
 /*****************************************************************************
 *
-*  ReadCloudCommands
+*  ReportAndReadCommands
 *
 *  \param  None
 *
 *  \return None
 *
-*  \brief  Reads the commands from Exosite cloud
+*  \brief  Reports the customization values and reads the commands back
+*          from Exosite cloud in a single request, once per heartbeat
 *
 *****************************************************************************/
-void ReadCloudCommands(void)
+void ReportAndReadCommands(void)
 {
-  char * pbuf = exo_buffer;
+  static char content[DS_PAYLOAD_MAX + 1 + DEBUG_CONTENT_MAX];
+  int len;
+
+  // the long poll keeps the commands current, only the heartbeat needs
+  // this request
+  if (!exosite_report_due(&reports[REPORT_PING], ping, MSTimerGet()))
+    return;
+  len = FormatReadings(content);
+
   DisplayLCD(LCD_LINE6, "  Exosite  ");
-  DisplayLCD(LCD_LINE7, "    Read   ");
-  if (Exosite_Read("led_ctrl", pbuf, EXO_BUFFER_SIZE)) {
+  DisplayLCD(LCD_LINE7, " Write+Read");
+  if (Exosite_ReadWrite(content, len, G_commands, NUM_COMMANDS)) {
     DisplayLCD(LCD_LINE8, "     OK    ");
-    if (!strncmp(pbuf, "0", 1)) 
-      led_all_off();
-    else if (!strncmp(pbuf, "1", 1)) 
-      led_all_on();
+    Datasource_ApplyCommands();
   }
   else show_status();
   MSTimerDelay(500);
@@ -318,6 +826,8 @@ checkWiFiConnected(int reinit)
 
   if (!status)
   {
+    // any kept-alive cloud connection died with the association
+    Exosite_Disconnect();
     if (reinit)
     {
       WIFI_init(1);
@@ -346,9 +856,11 @@ checkWiFiConnected(int reinit)
 void App_Exosite(void)
 {
   int loop_time = 1000;
-  unsigned char loopCount = 0;
+  uint32_t lastReport = 0;
+  bool reported = false;
   int wifi_init = 0;
   int badcik = 1;
+  exosite_backoff activation;
   static const uint8_t geoCert[] = { 0x30, 0x82, 0x03, 0x54, 0x30, 0x82, 0x02, 0x3c, 0xa0, 0x03,
                                      0x02, 0x01, 0x02, 0x02, 0x03, 0x02, 0x34, 0x56, 0x30, 0x0d,
                                      0x06, 0x09, 0x2a, 0x86, 0x48, 0x86, 0xf7, 0x0d, 0x01, 0x01,
@@ -436,7 +948,11 @@ void App_Exosite(void)
                                      0x75, 0xe8, 0xd5, 0xd0, 0xdc, 0x4f, 0x34, 0xed, 0xc2, 0x05,
                                      0x66, 0x80, 0xa1, 0xcb, 0xe6, 0x33};
 
+  uint8_t i;
   bool isTimeSync = false;
+  bool isSNTPEnabled = false;
+  bool timePolled = false;
+  uint32_t lastTimePoll = 0;
 
   // wait 1 sec for LCD messages display
   MSTimerDelay(1000);
@@ -446,6 +962,22 @@ void App_Exosite(void)
   DisplayLCD(LCD_LINE2, (const uint8_t *)ExositeAppVersion);
 #endif
 
+  // sampling can start before the module is set up, what the ring can't
+  // hold is queued
+  exosite_queue_init();
+  for (i = 0; i < NUM_REPORTS; i++)
+    reports[i].alias = G_datasourceNames[i];
+  // never opens, it only spaces out the retries
+  exosite_backoff_init(&activation, ACTIVATE_BASE_MS, ACTIVATE_CAP_MS, 255);
+  exoHAL_SetIdleHook(SampleReadings);
+  // and while a module command like AT+WA or AT+WPAPSK takes seconds,
+  // the first of which are in the WIFI_init below
+  AtLibGs_SetIdleHook(SampleReadings);
+  // socket data goes into the connection chains a span at a time, and
+  // waits in the FIFO while a chain is full until it is read
+  AtLibGs_SetDataHandler(App_ProcessIncomingSpan);
+  AtLibGs_SetDataRoom(App_IncomingRoom);
+
   // must initialize one time for mac address prepare..
   WIFI_init(1);
   if (!Exosite_Init("renesas", "rl78g14", IF_WIFI, 0))
@@ -464,50 +996,102 @@ void App_Exosite(void)
 
   while (1)
   {
+    // a request in flight owns the module, step it along and keep
+    // sampling at the full rate until it is done
+    if (Exosite_Poll())
+    {
+      SampleReadings();
+      MSTimerDelay(ASYNC_POLL_INTERVAL);
+      continue;
+    }
+
     if (!checkWiFiConnected(wifi_init))
     {
       wifi_init = 0;
+
+      // keep sampling while offline, what the ring can't hold is queued
+      SampleReadings();
     }
     else
     {
-      if(!isTimeSync)
+      // the module keeps SNTP time once it is on the network, reading it
+      // now and then keeps the local clock's drift and error in check
+      if (!isSNTPEnabled)
+      {
+        isSNTPEnabled = (0 == Exosite_EnableSNTP(NULL, EXOSITE_SNTP_PERIOD));
+      }
+      else if (!timePolled || MSTimerDelta(lastTimePoll) >= TIME_POLL_INTERVAL)
+      {
+        if (0 == Exosite_PollTime())
+        {
+          lastTimePoll = MSTimerGet();
+          timePolled = true;
+        }
+      }
+
+      // until SNTP answers, the module's clock is set from the first
+      // response's Date, the standalone time request is only made if
+      // requests are failing
+      if(!isTimeSync && !timePolled && (exosite_clock_valid()
+                         || EXO_STATUS_BAD_TCP == Exosite_StatusCode()))
       {
         if(Exosite_SyncTime() == 0)
           isTimeSync = true;
       }
       
-      UpdateReadings();
+      SampleReadings();
 
       int code = Exosite_StatusCode();
-      if (code == EXO_STATUS_OK)
+      // a failed request doesn't stop the loop, the reconnect policy in
+      // the library decides when the server is tried again
+      if (code == EXO_STATUS_OK || (code == EXO_STATUS_BAD_TCP && 0 == badcik))
       {
         badcik = 0;
         wifi_init = 1;
 
-        ReadCloudCommands();
-
-        if (loopCount++ >= WRITE_INTERVAL) 
+        if (!reported || MSTimerDelta(lastReport) >= WRITE_INTERVAL) 
         {
-          // POST the Sensor and templature values
-          ReportReadings();
-          loopCount = 0;
+          // record the minute of samples, then POST the ping and get the
+          // commands back with the same request
+          UploadReadings();
+          ReportAndReadCommands();
+          lastReport = MSTimerGet();
+          reported = true;
         }
-        loop_time = 500; //delay 0.5 seconds before next turn..
-      }
-      else if (1 == badcik || EXO_STATUS_BAD_CIK == code || EXO_STATUS_NOAUTH == code)
-      {
-        DisplayLCD(LCD_LINE6, "  Exosite  ");
-        DisplayLCD(LCD_LINE7, " Connecting");
-        DisplayLCD(LCD_LINE8, "           ");
-
-        if (!Exosite_Activate())
+        else
         {
-          badcik = 1;
-          loop_time = 3000; // delay 3 seconds
+          // the server holds this request until a command changes or the
+          // next upload is due, sampling goes on in the loop above
+          WaitCloudCommands(WRITE_INTERVAL - MSTimerDelta(lastReport));
         }
+        // long polling paces the loop, only back off after a failure. A
+        // HAL without response headers gets its reads answered at once,
+        // those are paced here.
+        if (EXO_STATUS_OK != Exosite_StatusCode())
+          loop_time = 500;
         else
+          loop_time = exoHAL_KeepsHeaders() ? 0 : COMMAND_READ_INTERVAL;
+      }
+      else if (1 == badcik || EXO_STATUS_BAD_CIK == code || EXO_STATUS_NOAUTH == code)
+      {
+        // back off while the device isn't enabled in the portal
+        loop_time = 500;
+        if (exosite_backoff_allow(&activation))
         {
-          DisplayLCD(LCD_LINE7, " Connected ");
+          DisplayLCD(LCD_LINE6, "  Exosite  ");
+          DisplayLCD(LCD_LINE7, " Connecting");
+          DisplayLCD(LCD_LINE8, "           ");
+
+          if (!Exosite_Activate())
+          {
+            badcik = 1;
+            exosite_backoff_failure(&activation);
+          }
+          else
+          {
+            exosite_backoff_success(&activation);
+            DisplayLCD(LCD_LINE7, " Connected ");
+          }
         }
       }
       show_status();
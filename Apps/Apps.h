@@ -22,8 +22,7 @@
 /*-------------------------------------------------------------------------*
  * Globals:
  *-------------------------------------------------------------------------*/
-extern uint8_t G_received[APP_MAX_RECEIVED_DATA + 1];
-extern unsigned int G_receivedCount;
+extern uint32_t G_writtenCount;
 extern NVSettings_t G_nvsettings;
 extern uint8_t cid;
 extern char G_command[ATLIBGS_TX_CMD_MAX_SIZE];
@@ -44,8 +43,19 @@ void App_Menu(void);
 
 void App_Write(const void *txData, uint16_t dataLength);
 bool App_Read(uint8_t *rxData, uint16_t dataLength, uint8_t blockFlag);
+uint16_t App_ReadSpan(const uint8_t **rxSpan);
+void App_ReadConsume(uint16_t dataLength);
 void App_PrepareIncomingData(void);
-void App_ProcessIncomingData(uint8_t rxData);
+void App_ProcessIncomingData(uint8_t cid, uint8_t rxData);
+void App_ProcessIncomingSpan(
+        uint8_t cid,
+        const uint8_t *rxData,
+        uint16_t dataLength);
+uint16_t App_IncomingCount(uint8_t cid);
+uint16_t App_IncomingRoom(uint8_t cid);
+uint16_t App_IncomingDropped(uint8_t cid);
+uint16_t App_ReadIncomingData(uint8_t cid, void *rxData, uint16_t dataLength);
+void App_FlushIncomingData(uint8_t cid);
 void App_PotentiometerUpdate(int16_t * G_adc_int, bool updateLCD);
 void App_TemperatureReadingUpdate(char * G_temp_int, bool updateLCD);
 void App_LightSensorReadingUpdate(char * G_light_int, bool updateLCD);
@@ -0,0 +1,203 @@
+/*-------------------------------------------------------------------------*
+ * File:  Datasources.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Tables generated from DATASOURCES, the url-encoder of the readings
+ *     and the dispatch of the values sent to the board.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <string.h>
+#include <sensors/FixedPoint.h>
+#include "Datasources.h"
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+typedef struct {
+    const char *key;                /* name followed by '=' */
+    uint8_t keyLen;
+    uint8_t format;                 /* DatasourceFormat */
+    uint8_t dir;                    /* DatasourceDir */
+    DatasourceHandler handler;      /* 0 for OUT rows */
+    const char *label;              /* LCD text before the reading */
+    const char *unit;               /* LCD text after it */
+} Datasource_t;
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+#define DS_ROW(id, name, format, dir, handler, label, unit) \
+    { name "=", sizeof(name), DS_FORMAT_##format, DS_DIR_##dir, \
+      DS_HANDLER_##dir(handler), label, unit },
+#define DS_HANDLER_OUT(handler)     0
+#define DS_HANDLER_CMD(handler)     handler
+#define DS_HANDLER_POST(handler)    handler
+static const Datasource_t datasources[NUM_DATASOURCES] = {
+    DATASOURCES(DS_ROW)
+};
+
+#define DS_NAME(id, name, format, dir, handler, label, unit)    name,
+const char * const G_datasourceNames[NUM_DATASOURCES] = {
+    DATASOURCES(DS_NAME)
+};
+
+/* All commands are fetched in the same request, each into its own buffer */
+static char commandValues[NUM_COMMANDS][DS_TEXT_MAX + 1];
+
+#define DS_COMMAND(id, name, format, dir, handler, label, unit) \
+    DS_COMMAND_##dir(id, name)
+#define DS_COMMAND_OUT(id, name)
+#define DS_COMMAND_CMD(id, name) \
+    { name, commandValues[CMD_##id], DS_TEXT_MAX + 1, 0 },
+#define DS_COMMAND_POST(id, name)
+ExositeKeyValue G_commands[NUM_COMMANDS] = {
+    DATASOURCES(DS_COMMAND)
+};
+
+#define DS_CMD_HANDLER(id, name, format, dir, handler, label, unit) \
+    DS_CMD_HANDLER_##dir(handler)
+#define DS_CMD_HANDLER_OUT(handler)
+#define DS_CMD_HANDLER_CMD(handler)                 handler,
+#define DS_CMD_HANDLER_POST(handler)
+static const DatasourceHandler commandHandlers[NUM_COMMANDS] = {
+    DATASOURCES(DS_CMD_HANDLER)
+};
+
+
+/*****************************************************************************
+*
+*  Datasource_Format
+*
+*  \param  text - buffer of at least DS_TENTHS_MAX + 1 characters
+*          id - datasource of the value; value - the reading
+*
+*  \return Length of the text
+*
+*  \brief  Formats a reading the way its datasource is reported
+*
+*****************************************************************************/
+uint8_t Datasource_Format(char *text, DatasourceId id, int32_t value)
+{
+    switch (datasources[id].format) {
+        case DS_FORMAT_INT:
+            return Fixed_Format(text, value, 0);
+        case DS_FORMAT_TENTHS:
+            return Fixed_Format(text, value, 1);
+        default:
+            text[0] = 0;
+            return 0;
+    }
+}
+
+
+/*****************************************************************************
+*
+*  Datasource_FormatLabel
+*
+*  \param  text - buffer for the label, the reading and the unit
+*          id - datasource of the value; value - the reading
+*
+*  \return Length of the text
+*
+*  \brief  Formats a reading for its LCD line, "TEMP: 23.5 C"
+*
+*****************************************************************************/
+uint8_t Datasource_FormatLabel(char *text, DatasourceId id, int32_t value)
+{
+    const Datasource_t *ds = &datasources[id];
+
+    return Fixed_FormatLabel(text, ds->label, value,
+                             DS_FORMAT_TENTHS == ds->format, ds->unit);
+}
+
+
+/*****************************************************************************
+*
+*  Datasource_Encode
+*
+*  \param  content - buffer of at least DS_PAYLOAD_MAX + 1 characters
+*          values - reading of each datasource, indexed by id
+*          mask - bit per datasource to encode
+*
+*  \return Length of the content
+*
+*  \brief  Url-encodes the OUT datasources in mask as "name=value&..."
+*
+*****************************************************************************/
+uint16_t Datasource_Encode(char *content, const int32_t *values, uint16_t mask)
+{
+    const Datasource_t *ds;
+    uint16_t len = 0;
+    uint8_t id;
+
+    for (id = 0; id < NUM_DATASOURCES; id++) {
+        ds = &datasources[id];
+        if (DS_DIR_OUT != ds->dir || !(mask & (1U << id)))
+            continue;
+        if (0 < len)
+            content[len++] = '&';
+        memcpy(&content[len], ds->key, ds->keyLen);
+        len += ds->keyLen;
+        len += Datasource_Format(&content[len], (DatasourceId)id, values[id]);
+    }
+    content[len] = 0;
+
+    return len;
+}
+
+
+/*****************************************************************************
+*
+*  Datasource_ApplyCommands
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Hands each command read into G_commands to its handler
+*
+*****************************************************************************/
+void Datasource_ApplyCommands(void)
+{
+    uint8_t i;
+
+    for (i = 0; i < NUM_COMMANDS; i++) {
+        if (0 < G_commands[i].len)
+            commandHandlers[i](G_commands[i].value, G_commands[i].len);
+    }
+}
+
+
+/*****************************************************************************
+*
+*  Datasource_ApplyPost
+*
+*  \param  tag - GSLink tag posted; value, len - its value
+*
+*  \return 1 if the tag is a POST datasource, 0 otherwise
+*
+*  \brief  Hands a value posted by a GSLink client to its handler
+*
+*****************************************************************************/
+uint8_t Datasource_ApplyPost(const char *tag, const char *value, uint8_t len)
+{
+    const Datasource_t *ds;
+    uint8_t id;
+
+    for (id = 0; id < NUM_DATASOURCES; id++) {
+        ds = &datasources[id];
+        if (DS_DIR_POST == ds->dir
+            && 0 == strncmp(ds->key, tag, ds->keyLen - 1)
+            && 0 == tag[ds->keyLen - 1]) {
+            ds->handler(value, len);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,112 @@
+/*-------------------------------------------------------------------------*
+ * File:  Datasources.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Every value the board reports or accepts, described once in the
+ *     DATASOURCES table. The names, the url-encoder, the buffer sizes,
+ *     the LCD lines and the dispatch of inbound values are all generated
+ *     from it.
+ *-------------------------------------------------------------------------*/
+#ifndef DATASOURCES_H_
+#define DATASOURCES_H_
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <exosite/exosite.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+/* Most characters a value takes in each format */
+#define DS_INT_MAX          11      /* "-2147483648" */
+#define DS_TENTHS_MAX       12      /* "-214748364.8" */
+#define DS_TEXT_MAX         20      /* an inbound value, as long as an SSID */
+
+/*
+ * X(id, name, format, dir, handler, label, unit)
+ *   name    - Exosite alias of OUT and CMD rows, GSLink tag of POST rows
+ *   format  - INT or TENTHS for readings, TEXT for inbound values
+ *   dir     - OUT is reported to Exosite, CMD is read back from Exosite,
+ *             POST is received from a GSLink client
+ *   handler - takes an inbound value, NONE for OUT rows
+ *   label, unit - text around the reading on the LCD, "" if not shown
+ * The samples uploaded with Exosite_Record must be the first rows.
+ */
+#define DATASOURCES(X) \
+    X(DS_TEMP,      "temp",     TENTHS, OUT,  NONE,         "TEMP: ", " C") \
+    X(DS_ADC,       "adc1",     TENTHS, OUT,  NONE,         " POT: ", " ")  \
+    X(DS_PING,      "ping",     INT,    OUT,  NONE,         "", "")         \
+    X(DS_LED_CTRL,  "led_ctrl", TEXT,   CMD,  ApplyLedCtrl, "", "")         \
+    X(DS_LEDS,      "leds",     TEXT,   POST, AtLib_GSLinkSetLeds, "", "")  \
+    X(DS_SSID,      "ssid",     TEXT,   POST, AtLib_GSLinkSetSSID, "", "")  \
+    X(DS_CHANNEL,   "chanl",    TEXT,   POST, AtLib_GSLinkSetChannel, "", "")
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+#define DS_ID(id, name, format, dir, handler, label, unit)   id,
+typedef enum {
+    DATASOURCES(DS_ID)
+    NUM_DATASOURCES
+} DatasourceId;
+
+/* Commands get their own index into G_commands */
+#define DS_CMD_ID(id, name, format, dir, handler, label, unit) \
+    DS_CMD_ID_##dir(id)
+#define DS_CMD_ID_OUT(id)
+#define DS_CMD_ID_CMD(id)                           CMD_##id,
+#define DS_CMD_ID_POST(id)
+enum {
+    DATASOURCES(DS_CMD_ID)
+    NUM_COMMANDS
+};
+
+/* Longest url-encoded payload of all OUT rows, "name=value&..." */
+#define DS_PAYLOAD(id, name, format, dir, handler, label, unit) \
+    + DS_PAYLOAD_##dir(sizeof(name) + DS_##format##_MAX + 1)
+#define DS_PAYLOAD_OUT(len)                         (len)
+#define DS_PAYLOAD_CMD(len)                         0
+#define DS_PAYLOAD_POST(len)                        0
+enum {
+    DS_PAYLOAD_MAX = 0 DATASOURCES(DS_PAYLOAD) - 1
+};
+
+typedef enum {
+    DS_FORMAT_INT,
+    DS_FORMAT_TENTHS,
+    DS_FORMAT_TEXT
+} DatasourceFormat;
+
+typedef enum {
+    DS_DIR_OUT,
+    DS_DIR_CMD,
+    DS_DIR_POST
+} DatasourceDir;
+
+typedef void (*DatasourceHandler)(const char *value, uint8_t len);
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+#define DS_PROTO(id, name, format, dir, handler, label, unit) \
+    DS_PROTO_##dir(handler)
+#define DS_PROTO_OUT(handler)
+#define DS_PROTO_CMD(handler)   void handler(const char *value, uint8_t len);
+#define DS_PROTO_POST(handler)  void handler(const char *value, uint8_t len);
+DATASOURCES(DS_PROTO)
+
+extern const char * const G_datasourceNames[NUM_DATASOURCES];
+extern ExositeKeyValue G_commands[NUM_COMMANDS];
+
+uint8_t Datasource_Format(char *text, DatasourceId id, int32_t value);
+uint8_t Datasource_FormatLabel(char *text, DatasourceId id, int32_t value);
+uint16_t Datasource_Encode(char *content, const int32_t *values, uint16_t mask);
+void Datasource_ApplyCommands(void);
+uint8_t Datasource_ApplyPost(const char *tag, const char *value, uint8_t len);
+
+#endif // DATASOURCES_H_
+/*-------------------------------------------------------------------------*
+ * End of File:  Datasources.h
+ *-------------------------------------------------------------------------*/
@@ -17,6 +17,7 @@
 #include <system/mstimer.h>
 #include <system/eeprom.h>
 #include <system/platform.h>
+#include <sensors/FixedPoint.h>
 #include "NVSettings.h"
 
 // global defines
@@ -26,6 +27,14 @@ extern NVSettings_t GNV_Setting;
 
 // local defines
 
+// local functions
+static void WIFI_CommandDone(ATLIBGS_MSG_ID_E msgId, void *ctx);
+static ATLIBGS_MSG_ID_E WIFI_CommandWait(
+        bool started,
+        uint8_t line,
+        const char *label,
+        ATLIBGS_MSG_ID_E *rxMsgId);
+
 
 /*---------------------------------------------------------------------------*
  * Routine:  WIFI_init
@@ -105,7 +114,11 @@ ATLIBGS_MSG_ID_E WIFI_init(int16_t showMessage)
     {
       do {
         DisplayLCD(LCD_LINE8, " Setting PSK");
-        rxMsgId = AtLibGs_CalcNStorePSK(GNV_Setting.webprov.ssid, GNV_Setting.webprov.password);
+        // takes seconds, the sensors are sampled while the module works
+        rxMsgId = ATLIBGS_MSG_ID_NONE;
+        WIFI_CommandWait(AtLibGs_CalcNStorePSKStart(GNV_Setting.webprov.ssid,
+            GNV_Setting.webprov.password, WIFI_CommandDone, &rxMsgId),
+            LCD_LINE8, " PSK ", &rxMsgId);
       } while (ATLIBGS_MSG_ID_OK != rxMsgId); 
       DisplayLCD(LCD_LINE8, " PSK Set");
     }
@@ -233,7 +246,9 @@ ATLIBGS_MSG_ID_E WIFI_Associate(void)
   else
   {
     DisplayLCD(LCD_LINE8, (const uint8_t *)GNV_Setting.webprov.ssid);
-    rxMsgId = AtLibGs_Assoc(GNV_Setting.webprov.ssid,NULL,HOST_APP_AP_CHANNEL);
+    WIFI_CommandWait(AtLibGs_AssocStart(GNV_Setting.webprov.ssid, NULL,
+        HOST_APP_AP_CHANNEL, WIFI_CommandDone, &rxMsgId),
+        LCD_LINE7, " Connect ", &rxMsgId);
   }
   if (ATLIBGS_MSG_ID_OK != rxMsgId) {
     /* Association error - we can retry */
@@ -254,4 +269,62 @@ ATLIBGS_MSG_ID_E WIFI_Associate(void)
   return rxMsgId;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  WIFI_CommandDone
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Stores the result of a queued module command.
+ * Inputs:
+ *      ATLIBGS_MSG_ID_E msgId -- result of the command
+ *      void *ctx -- ATLIBGS_MSG_ID_E to store it in
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void WIFI_CommandDone(ATLIBGS_MSG_ID_E msgId, void *ctx)
+{
+  *(ATLIBGS_MSG_ID_E *)ctx = msgId;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  WIFI_CommandWait
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Polls the queued command until WIFI_CommandDone stores its result,
+ *      showing the seconds it has taken so far. The idle hook set with
+ *      AtLibGs_SetIdleHook runs in between.
+ * Inputs:
+ *      bool started -- what the start routine returned
+ *      uint8_t line -- LCD line to show the time on
+ *      const char *label -- shown before the time
+ *      ATLIBGS_MSG_ID_E *rxMsgId -- set to NONE before the command started
+ * Outputs:
+ *      ATLIBGS_MSG_ID_E
+ *---------------------------------------------------------------------------*/
+static ATLIBGS_MSG_ID_E WIFI_CommandWait(
+        bool started,
+        uint8_t line,
+        const char *label,
+        ATLIBGS_MSG_ID_E *rxMsgId)
+{
+  char text[20];
+  uint32_t start = MSTimerGet();
+  uint32_t shown = 0xFFFFFFFF;
+
+  // the start routine refuses while other commands are queued
+  if (!started)
+    *rxMsgId = ATLIBGS_MSG_ID_ERROR;
+
+  while (ATLIBGS_MSG_ID_NONE == *rxMsgId)
+  {
+    AtLibGs_CommandPoll();
+    if (MSTimerDelta(start) / 1000 != shown)
+    {
+      shown = MSTimerDelta(start) / 1000;
+      Fixed_FormatLabel(text, label, shown, 0, "s");
+      DisplayLCD(line, (const uint8_t *)text);
+    }
+  }
+
+  return *rxMsgId;
+}
 
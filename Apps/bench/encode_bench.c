@@ -0,0 +1,282 @@
+/*-------------------------------------------------------------------------*
+ * File:  encode_bench.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Times Datasource_Encode on a host against the sprintf code that
+ *     SampleReadings used before, on the same temp/adc1 readings, and
+ *     checks that both write the same text.  Built and run from the top
+ *     of the tree:
+ *
+ *       cc -O2 -I. -o encode_bench Apps/bench/encode_bench.c \
+ *          Apps/Datasources.c sensors/FixedPoint.c
+ *       ./encode_bench -n 1000000
+ *
+ *     With -DBENCH_SIZE=1 or -DBENCH_SIZE=2 the program encodes a single
+ *     reading, by Datasource_Encode or by sprintf, and nothing else, so
+ *     that the code each pulls in can be compared:
+ *
+ *       cc -Os -static -DBENCH_SIZE=1 -I. -o encode_size1 \
+ *          Apps/bench/encode_bench.c Apps/Datasources.c sensors/FixedPoint.c
+ *       cc -Os -static -DBENCH_SIZE=2 -I. -o encode_size2 \
+ *          Apps/bench/encode_bench.c Apps/Datasources.c sensors/FixedPoint.c
+ *       size encode_size1 encode_size2
+ *
+ *     The start-up code of a static glibc links vfprintf already, so the
+ *     difference leaves out the formatter itself.  Its size is that of
+ *     vfprintf-internal.o in libc.a, which a board saves only once
+ *     nothing else calls sprintf.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()          __rdtsc()
+#else
+#define BENCH_CYCLES()          0
+#endif
+#include <Apps/Datasources.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define BENCH_ITERATIONS        1000000
+#define BENCH_VALUES            256     /* readings cycled through */
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+static int32_t G_values[BENCH_VALUES][NUM_DATASOURCES];
+static volatile uint16_t G_sink;
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+static void FormatTenths(char *text, int16_t tenths);
+static uint16_t EncodeSprintf(char *content, const int32_t *values,
+        uint16_t mask);
+static uint16_t EncodeTable(char *content, const int32_t *values,
+        uint16_t mask);
+static void BenchRun(const char *name,
+        uint16_t (*encode)(char *, const int32_t *, uint16_t),
+        uint32_t count);
+static double BenchNowNS(void);
+
+/* Handlers of the inbound rows, not called here */
+void ApplyLedCtrl(const char *value, uint8_t len) { (void)value; (void)len; }
+void AtLib_GSLinkSetLeds(const char *value, uint8_t len)
+        { (void)value; (void)len; }
+void AtLib_GSLinkSetSSID(const char *value, uint8_t len)
+        { (void)value; (void)len; }
+void AtLib_GSLinkSetChannel(const char *value, uint8_t len)
+        { (void)value; (void)len; }
+
+/*---------------------------------------------------------------------------*
+ * Routine:  FormatTenths
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      The formatter App_Exosite.c had before Datasources.c, "12.3".
+ * Inputs:
+ *      char *text -- Buffer for the value
+ *      int16_t tenths -- Value in tenths
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void FormatTenths(char *text, int16_t tenths)
+{
+    if (tenths < 0) {
+        *text++ = '-';
+        tenths = -tenths;
+    }
+    sprintf(text, "%d.%d", tenths / 10, tenths % 10);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  EncodeSprintf
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      The temp and adc1 encoding of SampleReadings before
+ *      Datasource_Encode.
+ * Inputs:
+ *      char *content -- Buffer for the payload
+ *      const int32_t *values -- Readings, indexed by datasource
+ *      uint16_t mask -- Bit per datasource to encode
+ * Outputs:
+ *      uint16_t -- Length of the content
+ *---------------------------------------------------------------------------*/
+static uint16_t EncodeSprintf(char *content, const int32_t *values,
+        uint16_t mask)
+{
+    uint16_t len = 0;
+
+    content[0] = 0;
+    if (mask & (1 << DS_TEMP)) {
+        len = sprintf(content, "%s=", G_datasourceNames[DS_TEMP]);
+        FormatTenths(&content[len], (int16_t)values[DS_TEMP]);
+        len = strlen(content);
+    }
+    if (mask & (1 << DS_ADC)) {
+        len += sprintf(&content[len], "%s%s=", 0 < len ? "&" : "",
+                G_datasourceNames[DS_ADC]);
+        FormatTenths(&content[len], (int16_t)values[DS_ADC]);
+    }
+
+    return strlen(content);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  EncodeTable
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Datasource_Encode, called through the same pointer as
+ *      EncodeSprintf.
+ * Inputs:
+ *      char *content -- Buffer for the payload
+ *      const int32_t *values -- Readings, indexed by datasource
+ *      uint16_t mask -- Bit per datasource to encode
+ * Outputs:
+ *      uint16_t -- Length of the content
+ *---------------------------------------------------------------------------*/
+static uint16_t EncodeTable(char *content, const int32_t *values,
+        uint16_t mask)
+{
+    return Datasource_Encode(content, values, mask);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchRun
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Encodes the readings count times and prints the time and cycles
+ *      each encode took.
+ * Inputs:
+ *      const char *name -- Printed
+ *      encode -- Way of encoding
+ *      uint32_t count -- Encodes to time
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void BenchRun(const char *name,
+        uint16_t (*encode)(char *, const int32_t *, uint16_t),
+        uint32_t count)
+{
+    char content[DS_PAYLOAD_MAX + 1];
+    uint16_t mask = (1 << DS_TEMP) | (1 << DS_ADC);
+    uint64_t cycles;
+    double start;
+    uint32_t i;
+
+    start = BenchNowNS();
+    cycles = BENCH_CYCLES();
+    for (i = 0; i < count; i++)
+        G_sink += encode(content, G_values[i % BENCH_VALUES], mask);
+    cycles = BENCH_CYCLES() - cycles;
+    printf("%-8s %10.1f %10.1f\n", name, (BenchNowNS() - start) / count,
+            (double)cycles / count);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchNowNS
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Monotonic time in ns.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      double -- Time in ns
+ *---------------------------------------------------------------------------*/
+static double BenchNowNS(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Checks the two encoders agree over the readings, then times them.
+ * Inputs:
+ *      -n encodes to time
+ * Outputs:
+ *      int -- 0 if the encoders agree, 1 otherwise
+ *---------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    char expect[DS_PAYLOAD_MAX + 1];
+    char got[DS_PAYLOAD_MAX + 1];
+    uint32_t count = BENCH_ITERATIONS;
+    uint16_t mask;
+    int opt;
+    int i;
+
+#if BENCH_SIZE
+    int32_t values[NUM_DATASOURCES] = { 0 };
+
+    (void)expect;
+    (void)count;
+    (void)mask;
+    (void)opt;
+    (void)i;
+    (void)BenchRun;
+    (void)EncodeTable;
+    (void)EncodeSprintf;
+    values[DS_TEMP] = (1 < argc) ? atoi(argv[1]) : 235;
+    values[DS_ADC] = (2 < argc) ? atoi(argv[2]) : 500;
+#if 1 == BENCH_SIZE
+    Datasource_Encode(got, values, (1 << DS_TEMP) | (1 << DS_ADC));
+#else
+    EncodeSprintf(got, values, (1 << DS_TEMP) | (1 << DS_ADC));
+#endif
+    // write rather than puts, so only the encoder brings in stdio
+    write(1, got, strlen(got));
+
+    return 0;
+#else
+    while (-1 != (opt = getopt(argc, argv, "n:"))) {
+        if ('n' == opt) {
+            count = strtoul(optarg, NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-n encodes]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Temperatures around the board and the whole potentiometer range
+    srand(1);
+    for (i = 0; i < BENCH_VALUES; i++) {
+        G_values[i][DS_TEMP] = rand() % 600 - 100;
+        G_values[i][DS_ADC] = rand() % 1001;
+    }
+
+    for (i = 0; i < BENCH_VALUES * 4; i++) {
+        mask = (uint16_t)((i / BENCH_VALUES) & 3) << DS_TEMP;
+        EncodeSprintf(expect, G_values[i % BENCH_VALUES], mask);
+        Datasource_Encode(got, G_values[i % BENCH_VALUES], mask);
+        if (0 != strcmp(expect, got)) {
+            printf("mismatch: \"%s\" encoded \"%s\"\n", expect, got);
+            return 1;
+        }
+    }
+
+    printf("%-8s %10s %10s\n", "encode", "ns", "cycles");
+    BenchRun("sprintf", EncodeSprintf, count);
+    BenchRun("table", EncodeTable, count);
+
+    return 0;
+#endif
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  encode_bench.c
+ *-------------------------------------------------------------------------*/
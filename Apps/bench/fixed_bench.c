@@ -0,0 +1,284 @@
+/*-------------------------------------------------------------------------*
+ * File:  fixed_bench.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Times the formatters of sensors/FixedPoint.c on a host against the
+ *     sprintf and float code they replaced, in ns and in cycles:
+ *       tenths -- a value in tenths, Fixed_Format against "%.1f"
+ *       temp C -- the LCD temperature of App_Exosite.c, from the Q7
+ *                 reading, against "TEMP: %d.%d C"
+ *       temp F -- the temperature of main.c, against the float
+ *                 conversion and "TEMP: %.1fF"
+ *     Built and run from the top of the tree:
+ *
+ *       cc -O2 -I. -o fixed_bench Apps/bench/fixed_bench.c \
+ *          sensors/FixedPoint.c
+ *       ./fixed_bench -n 1000000
+ *
+ *     With -DBENCH_SIZE=1 or -DBENCH_SIZE=2 the program formats one
+ *     reading each way, with FixedPoint.c or with the old code, and
+ *     nothing else, so that the code each pulls in can be compared:
+ *
+ *       cc -Os -static -DBENCH_SIZE=1 -I. -o fixed_size1 \
+ *          Apps/bench/fixed_bench.c sensors/FixedPoint.c
+ *       cc -Os -static -DBENCH_SIZE=2 -I. -o fixed_size2 \
+ *          Apps/bench/fixed_bench.c sensors/FixedPoint.c
+ *       size fixed_size1 fixed_size2
+ *
+ *     The start-up code of a static glibc links vfprintf already, so the
+ *     difference leaves out the formatter and its float conversion,
+ *     vfprintf-internal.o and printf_fp.o in libc.a.  Nor does a host
+ *     need the float emulation the RL78 links for the old temp F code.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_CYCLES()          __rdtsc()
+#else
+#define BENCH_CYCLES()          0
+#endif
+#include <sensors/FixedPoint.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define BENCH_ITERATIONS        1000000
+#define BENCH_VALUES            256     /* readings cycled through */
+#define BENCH_TEXT_MAX          24
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+/* Formats a reading, a Q7 temperature or a value in tenths */
+typedef uint8_t (*BenchFormat)(char *text, int16_t reading);
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+static int16_t G_tenths[BENCH_VALUES];
+static TempQ7_t G_temps[BENCH_VALUES];
+static volatile uint16_t G_sink;
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+static uint8_t TenthsFixed(char *text, int16_t tenths);
+static uint8_t TenthsSprintf(char *text, int16_t tenths);
+static uint8_t TempCFixed(char *text, int16_t temp);
+static uint8_t TempCSprintf(char *text, int16_t temp);
+static uint8_t TempFFixed(char *text, int16_t temp);
+static uint8_t TempFFloat(char *text, int16_t temp);
+static void BenchRun(const char *name, BenchFormat format,
+        const int16_t *readings, uint32_t count);
+static double BenchNowNS(void);
+
+/*---------------------------------------------------------------------------*
+ * Routine:  TenthsFixed, TenthsSprintf
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      A value in tenths as "12.3".
+ * Inputs:
+ *      char *text -- Buffer for the text
+ *      int16_t tenths -- Value in tenths
+ * Outputs:
+ *      uint8_t -- Number of characters written
+ *---------------------------------------------------------------------------*/
+static uint8_t TenthsFixed(char *text, int16_t tenths)
+{
+    return Fixed_Format(text, tenths, 1);
+}
+
+static uint8_t TenthsSprintf(char *text, int16_t tenths)
+{
+    return (uint8_t)sprintf(text, "%.1f", tenths / 10.0f);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  TempCFixed, TempCSprintf
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      The LCD temperature of App_Exosite.c, "TEMP: 23.5 C", now and as
+ *      it was.
+ * Inputs:
+ *      char *text -- Buffer for the text
+ *      int16_t temp -- ADT7420 reading in 1/128 degree C
+ * Outputs:
+ *      uint8_t -- Number of characters written
+ *---------------------------------------------------------------------------*/
+static uint8_t TempCFixed(char *text, int16_t temp)
+{
+    return Fixed_FormatLabel(text, "TEMP: ", Fixed_TempTenthsC(temp) - 20,
+            1, " C");
+}
+
+static uint8_t TempCSprintf(char *text, int16_t temp)
+{
+    // The register was read in 1/16 degree then
+    temp >>= 3;
+
+    return (uint8_t)sprintf(text, "TEMP: %d.%d C", temp / 16 - 2,
+            ((temp & 0x000F) * 10) / 16);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  TempFFixed, TempFFloat
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      The temperature of main.c, "TEMP: 74.3F", now and as it was.
+ * Inputs:
+ *      char *text -- Buffer for the text
+ *      int16_t temp -- ADT7420 reading in 1/128 degree C
+ * Outputs:
+ *      uint8_t -- Number of characters written
+ *---------------------------------------------------------------------------*/
+static uint8_t TempFFixed(char *text, int16_t temp)
+{
+    return Fixed_FormatLabel(text, "TEMP: ", Fixed_TempTenthsF(temp) - 100,
+            1, "F");
+}
+
+static uint8_t TempFFloat(char *text, int16_t temp)
+{
+    float ftemp = temp;
+    float gTemp_F = ((ftemp / 5) * 9) / 128 + 22;
+
+    return (uint8_t)sprintf(text, "TEMP: %.1fF", gTemp_F);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchRun
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Formats the readings count times and prints the time and cycles
+ *      each took.
+ * Inputs:
+ *      const char *name -- Printed
+ *      BenchFormat format -- Way of formatting
+ *      const int16_t *readings -- BENCH_VALUES readings to cycle through
+ *      uint32_t count -- Readings to format
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void BenchRun(const char *name, BenchFormat format,
+        const int16_t *readings, uint32_t count)
+{
+    char text[BENCH_TEXT_MAX];
+    uint64_t cycles;
+    double start;
+    uint32_t i;
+
+    start = BenchNowNS();
+    cycles = BENCH_CYCLES();
+    for (i = 0; i < count; i++)
+        G_sink += format(text, readings[i % BENCH_VALUES]);
+    cycles = BENCH_CYCLES() - cycles;
+    printf("%-16s %10.1f %10.1f  %s\n", name, (BenchNowNS() - start) / count,
+            (double)cycles / count, text);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchNowNS
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Monotonic time in ns.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      double -- Time in ns
+ *---------------------------------------------------------------------------*/
+static double BenchNowNS(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Times each formatter against the code it replaced.
+ * Inputs:
+ *      -n readings to format each way
+ * Outputs:
+ *      int -- 0
+ *---------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    uint32_t count = BENCH_ITERATIONS;
+    int opt;
+    int i;
+
+#if BENCH_SIZE
+    char text[BENCH_TEXT_MAX * 3];
+    int16_t reading = (1 < argc) ? atoi(argv[1]) : 3008;
+    uint8_t len;
+
+    (void)count;
+    (void)opt;
+    (void)i;
+    (void)G_tenths;
+    (void)G_temps;
+    (void)BenchRun;
+#if 1 == BENCH_SIZE
+    (void)TenthsSprintf;
+    (void)TempCSprintf;
+    (void)TempFFloat;
+    len = TenthsFixed(text, reading);
+    len += TempCFixed(&text[len], reading);
+    len += TempFFixed(&text[len], reading);
+#else
+    (void)TenthsFixed;
+    (void)TempCFixed;
+    (void)TempFFixed;
+    len = TenthsSprintf(text, reading);
+    len += TempCSprintf(&text[len], reading);
+    len += TempFFloat(&text[len], reading);
+#endif
+    // write rather than puts, so only the formatters bring in stdio
+    write(1, text, len);
+
+    return 0;
+#else
+    while (-1 != (opt = getopt(argc, argv, "n:"))) {
+        if ('n' == opt) {
+            count = strtoul(optarg, NULL, 0);
+        } else {
+            fprintf(stderr, "usage: %s [-n readings]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Values across the potentiometer, 10 C to 40 C on the sensor
+    srand(1);
+    for (i = 0; i < BENCH_VALUES; i++) {
+        G_tenths[i] = rand() % 1001;
+        G_temps[i] = (TempQ7_t)(1280 + rand() % 3841);
+    }
+
+    printf("%-16s %10s %10s  %s\n", "format", "ns", "cycles", "last");
+    BenchRun("tenths sprintf", TenthsSprintf, G_tenths, count);
+    BenchRun("tenths fixed", TenthsFixed, G_tenths, count);
+    BenchRun("temp C sprintf", TempCSprintf, G_temps, count);
+    BenchRun("temp C fixed", TempCFixed, G_temps, count);
+    BenchRun("temp F float", TempFFloat, G_temps, count);
+    BenchRun("temp F fixed", TempFFixed, G_temps, count);
+
+    return 0;
+#endif
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  fixed_bench.c
+ *-------------------------------------------------------------------------*/
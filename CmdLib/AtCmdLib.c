@@ -21,6 +21,8 @@
 //#include <system/console.h>
 #include <system/mstimer.h>
 #include <system/platform.h>
+#include <Apps/Datasources.h>
+#include <sensors/FixedPoint.h>
 
 /*-------------------------------------------------------------------------*
  * Constants:
@@ -43,15 +45,52 @@ const char  str_rootTag[16]= "renesas_tla";
 /* Receive buffer to save async and response message from S2w App Node */
 char MRBuffer[ATLIBGS_RX_CMD_MAX_SIZE];
 uint16_t MRBufferIndex = 0;
+/* Start of the line being received, earlier lines are already checked */
+static uint16_t MRLineStart = 0;
 
 /* Flag to indicate whether S2w Node is currently associated or not */
 static uint8_t nodeAssociationFlag = false;
 static uint8_t nodeResetFlag = false; /* Flag to indicate whether S2w Node has rebooted after initialisation  */
 
+/* Commands waiting for the module, the head one is sent or being sent */
+typedef struct {
+    const char *text;
+    ATLIBGS_COMMAND_MATCH match;
+    uint32_t timeout;               /* ms without a byte from the module */
+    ATLIBGS_COMMAND_DONE done;
+    void *ctx;
+} ATLIBGS_COMMAND_T;
+static ATLIBGS_COMMAND_T commandQueue[ATLIBGS_COMMAND_QUEUE_SIZE];
+static uint8_t commandHead = 0;
+static uint8_t commandCount = 0;
+static bool commandSent = false;
+static uint32_t commandLastRx;
+static void (*commandIdleHook)(void) = 0;
+
+/* Takes received connection data straight out of the receive FIFO */
+static ATLIBGS_DATA_HANDLER dataHandler = 0;
+/* and tells how much more it can take, 0 if it takes everything */
+static ATLIBGS_DATA_ROOM dataRoom = 0;
+/* Data is held back for room only while AtLibGs_ReceiveDataHandle waits
+ * for it, command responses behind it must still get through */
+static bool dataHold = false;
+
+/* Receive machine, fed a byte or a chunk at a time */
+static ATLIBGS_RX_STATE_E receive_state = ATLIBGS_RX_STATE_START;
+static uint16_t specialDataLen = 0;
+static uint8_t specialDataLenCharCount = 0;
+static ATLIBGS_MSG_ID_E specialDataEndMsg;  /* message at the end of it */
+static uint8_t rxDataCid = ATLIBGS_INVALID_CID; /* data goes to its buffer */
+/* Chunks shorter than this are left to grow while bytes come in */
+#define ATLIBGS_RX_CHUNK_MIN    16
+
 /*-------------------------------------------------------------------------*
  * Function Prototypes:
  *-------------------------------------------------------------------------*/
 void AtLibGs_FlushRxBuffer(void);
+static bool AtLibGs_IsCommandResponse(ATLIBGS_MSG_ID_E msgId);
+static uint8_t AtLibGs_CidFromChar(uint8_t c);
+static bool AtLibGs_ReceiveChunk(ATLIBGS_MSG_ID_E *rxMsgId);
 
 /*---------------------------<AT command list >--------------------------------------------------------------------------
  _________________________________________________________________________________________________________________________
@@ -514,6 +553,39 @@ ATLIBGS_MSG_ID_E AtLibGs_CalcNStorePSK(char *pSsid, char *pPsk)
     return AtLibGs_CommandSendString(cmd);
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_CalcNStorePSKStart
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Queue AT+WPAPSK=<SSID>,<PassPhrase> like AtLibGs_CalcNStorePSK,
+ *      without waiting the seconds the module takes to compute the key.
+ *      Drive it with AtLibGs_CommandPoll.
+ * Inputs:
+ *      char *pSsid -- SSID (1 to 32 characters)
+ *      char *pPsk -- Pass phrase (8 to 63 characters)
+ *      ATLIBGS_COMMAND_DONE done -- Called with OK or the error
+ *      void *ctx -- Passed to done
+ * Outputs:
+ *      bool -- true if queued, false while other commands are queued
+ *---------------------------------------------------------------------------*/
+bool AtLibGs_CalcNStorePSKStart(
+        char *pSsid,
+        char *pPsk,
+        ATLIBGS_COMMAND_DONE done,
+        void *ctx)
+{
+    /* The text is sent later, it can't be on the stack */
+    static char cmd[110];
+
+    /* The last one may still be waiting to be sent */
+    if (AtLibGs_CommandBusy())
+        return false;
+    sprintf(cmd, "AT+WPAPSK=%s,%s\r\n", pSsid, pPsk);
+
+    return AtLibGs_CommandQueue(cmd, AtLibGs_IsCommandResponse,
+            ATLIB_RESPONSE_HANDLE_TIMEOUT, done, ctx);
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  AtLibGs_WlanConnStat
  *---------------------------------------------------------------------------*
@@ -586,6 +658,47 @@ ATLIBGS_MSG_ID_E AtLibGs_Assoc(char *pSsid, char *pBssid, uint8_t channel)
     return AtLibGs_CommandSendString(cmd);
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_AssocStart
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Queue AT+WA=<SSID>[[,<BSSID>][,<Ch>]] like AtLibGs_Assoc, without
+ *      waiting for the scan and association.  Events the module reports
+ *      meanwhile do not end it, only OK or an error.  Drive it with
+ *      AtLibGs_CommandPoll.
+ * Inputs:
+ *      char *pSsid -- SSID to connect to (1 to 32 characters)
+ *      char *pBssid -- Ad-hoc network id, or 0 for none
+ *      char channel -- Channel of network, 0 for any
+ *      ATLIBGS_COMMAND_DONE done -- Called with OK or the error
+ *      void *ctx -- Passed to done
+ * Outputs:
+ *      bool -- true if queued, false while other commands are queued
+ *---------------------------------------------------------------------------*/
+bool AtLibGs_AssocStart(
+        char *pSsid,
+        char *pBssid,
+        uint8_t channel,
+        ATLIBGS_COMMAND_DONE done,
+        void *ctx)
+{
+    /* The text is sent later, it can't be on the stack */
+    static char cmd[100];
+
+    /* The last one may still be waiting to be sent */
+    if (AtLibGs_CommandBusy())
+        return false;
+    if (channel) {
+        sprintf(cmd, "AT+WA=%s,%s," _F8_ "\r\n", pSsid, (pBssid) ? pBssid : "",
+                channel);
+    } else {
+        sprintf(cmd, "AT+WA=%s\r\n", pSsid);
+    }
+
+    return AtLibGs_CommandQueue(cmd, AtLibGs_IsCommandResponse,
+            ATLIB_RESPONSE_HANDLE_TIMEOUT, done, ctx);
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  AtLibGs_TCPClientStart
  *---------------------------------------------------------------------------*
@@ -1500,6 +1613,8 @@ ATLIBGS_MSG_ID_E AtLibGs_EnableAutoConnect(uint8_t mode)
  *---------------------------------------------------------------------------*/
 void AtLibGs_SwitchFromAutoToCmd(void)
 {
+    AtLibGs_CommandDrain();
+
     App_Write("+++", 3);
     App_DelayMS(1000);
     App_Write("\r\n", 2);
@@ -1859,6 +1974,28 @@ uint8_t AtLibGs_ParseUDPClientCid(void)
     return cid;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_ParseDisconnect
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Parses a DISCONNECT <id> message for the connection that closed.
+ *      Use after ATLIBGS_MSG_ID_DISCONNECT is returned.
+ * Inputs:
+ *    void
+ * Outputs:
+ *      uint8_t -- Closed connection id or ATLIBGS_INVALID_CID.
+ *---------------------------------------------------------------------------*/
+uint8_t AtLibGs_ParseDisconnect(void)
+{
+    char *result;
+
+    result = strstr((const char *)MRBuffer, "DISCONNECT ");
+    if (result == NULL)
+        return ATLIBGS_INVALID_CID;
+
+    return AtLibGs_CidFromChar(result[11]);
+}
+
 /*---------------------------------------------------------------------------*
  * TODO: Routine:  AtLibGs_ParseWlanConnStat
  *---------------------------------------------------------------------------*
@@ -2021,37 +2158,238 @@ uint8_t AtLibGs_ParseRssiResponse(int16_t *pRssi)
 }
 
 /*---------------------------------------------------------------------------*
- * TODO: Routine:  AtLibGs_ParseDNSLookupResponse
+ * Routine:  AtLibGs_ParseDNSLookupResponse
  *---------------------------------------------------------------------------*
  * Description:
- *      Parses the last line returned after doing a AtLibGs_DNSLookup()
- *      command.  If connected, parses the TCP server connection id.
- *      Otherwise, no connection is returned.
+ *      Parses the response returned after doing a AtLibGs_DNSLookup()
+ *      command, "IP:a.b.c.d".
  * Inputs:
- *      int16_t *pConnId -- Returned connection id (if any)
+ *      char *ipAddr -- Returned dotted address, at least 16 bytes
  * Outputs:
- *      uint8_t -- Returns 1 if connected, else 0.
+ *      uint8_t -- Returns 1 if an address was found, else 0.
  *---------------------------------------------------------------------------*/
 uint8_t AtLibGs_ParseDNSLookupResponse(char *ipAddr)
 {
     char *pSubStr = NULL;
+    uint8_t len = 0;
 
     pSubStr = strstr((const char *)MRBuffer, "IP:");
     if (pSubStr) {
-        strcpy(ipAddr, (pSubStr + 3));
-
-        return 1; /* Success */
+        /* Copy just the address, the rest of the response follows it */
+        pSubStr += 3;
+        while ((len < 15) && (((*pSubStr >= '0') && (*pSubStr <= '9'))
+                || (*pSubStr == '.')))
+            ipAddr[len++] = *pSubStr++;
+        ipAddr[len] = 0;
+
+        return (len > 0); /* Success */
     } else {
         return 0; /* Failed  */
     }
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_CommandQueue
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Queue a raw command for AtLibGs_CommandPoll to send once the ones
+ *      before it are done.  The response is collected into MRBuffer, so
+ *      the done callback can use the parse routines before the next
+ *      command is sent.  The callback must not send commands itself.
+ * Inputs:
+ *      const char *aString -- String to send, kept until done is called
+ *      ATLIBGS_COMMAND_MATCH match -- Accepts the message that ends the
+ *          command, 0 for the first one
+ *      uint32_t timeout -- ms to wait without hearing from the module
+ *      ATLIBGS_COMMAND_DONE done -- Called with the message, or 0
+ *      void *ctx -- Passed to done
+ * Outputs:
+ *      bool -- true if queued, false if the queue is full
+ *---------------------------------------------------------------------------*/
+bool AtLibGs_CommandQueue(
+        const char *aString,
+        ATLIBGS_COMMAND_MATCH match,
+        uint32_t timeout,
+        ATLIBGS_COMMAND_DONE done,
+        void *ctx)
+{
+    ATLIBGS_COMMAND_T *p_cmd;
+
+    if (ATLIBGS_COMMAND_QUEUE_SIZE == commandCount)
+        return false;
+
+    p_cmd = &commandQueue[(commandHead + commandCount)
+            % ATLIBGS_COMMAND_QUEUE_SIZE];
+    p_cmd->text = aString;
+    p_cmd->match = match;
+    p_cmd->timeout = timeout;
+    p_cmd->done = done;
+    p_cmd->ctx = ctx;
+    commandCount++;
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_CommandPoll
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Step the head of the command queue along without blocking: send it
+ *      if it has not been sent, feed whatever the module has sent since
+ *      through AtLibGs_ProcessRxChunk and call its done callback once
+ *      it matches or times out.  Call it from the main loop.  Calls the
+ *      idle hook while the command is still waiting.
+ * Inputs:
+ *    void
+ * Outputs:
+ *    void
+ *---------------------------------------------------------------------------*/
+void AtLibGs_CommandPoll(void)
+{
+    ATLIBGS_COMMAND_T *p_cmd;
+    ATLIBGS_COMMAND_DONE done;
+    void *ctx;
+    ATLIBGS_MSG_ID_E msgId = ATLIBGS_MSG_ID_NONE;
+
+    if (!commandCount)
+        return;
+
+    p_cmd = &commandQueue[commandHead];
+    if (!commandSent) {
+#ifdef ATLIBGS_DEBUG_ENABLE
+        ConsolePrintf(">%s\n", p_cmd->text);
+#endif
+        App_Write(p_cmd->text, strlen(p_cmd->text));
+        commandSent = true;
+        commandLastRx = MSTimerGet();
+    }
+
+    while (AtLibGs_ReceiveChunk(&msgId)) {
+        commandLastRx = MSTimerGet();
+        if ((msgId != ATLIBGS_MSG_ID_NONE) && (!p_cmd->match
+                || p_cmd->match(msgId)))
+            break;
+        msgId = ATLIBGS_MSG_ID_NONE;
+    }
+    if ((msgId == ATLIBGS_MSG_ID_NONE)
+            && (MSTimerDelta(commandLastRx) >= p_cmd->timeout))
+        msgId = ATLIBGS_MSG_ID_RESPONSE_TIMEOUT;
+
+    if (msgId == ATLIBGS_MSG_ID_NONE) {
+        if (commandIdleHook)
+            commandIdleHook();
+        return;
+    }
+
+    /* Off the queue first, the callback may queue the next command */
+    done = p_cmd->done;
+    ctx = p_cmd->ctx;
+    commandHead = (commandHead + 1) % ATLIBGS_COMMAND_QUEUE_SIZE;
+    commandCount--;
+    commandSent = false;
+    if (done)
+        done(msgId, ctx);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_CommandBusy
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Tell if any queued command is not done yet.
+ * Inputs:
+ *    void
+ * Outputs:
+ *      bool -- true while commands are queued
+ *---------------------------------------------------------------------------*/
+bool AtLibGs_CommandBusy(void)
+{
+    return (commandCount != 0);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_CommandDrain
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Poll until every queued command is done.  The routines that talk
+ *      to the module directly call this first so they do not read a
+ *      queued command's response or write in the middle of it.
+ * Inputs:
+ *    void
+ * Outputs:
+ *    void
+ *---------------------------------------------------------------------------*/
+void AtLibGs_CommandDrain(void)
+{
+    while (commandCount)
+        AtLibGs_CommandPoll();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_SetIdleHook
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set a routine to call while a command waits on the module, like
+ *      sampling the sensors or updating the LCD.  It must not send
+ *      commands to the module.
+ * Inputs:
+ *      void (*hook)(void) -- Routine to call, 0 for none
+ * Outputs:
+ *    void
+ *---------------------------------------------------------------------------*/
+void AtLibGs_SetIdleHook(void (*hook)(void))
+{
+    commandIdleHook = hook;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_CommandStore
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Done callback that stores the message where ctx points.
+ * Inputs:
+ *      ATLIBGS_MSG_ID_E msgId -- Message that ended the command
+ *      void *ctx -- ATLIBGS_MSG_ID_E to store it in
+ * Outputs:
+ *    void
+ *---------------------------------------------------------------------------*/
+static void AtLibGs_CommandStore(ATLIBGS_MSG_ID_E msgId, void *ctx)
+{
+    *(ATLIBGS_MSG_ID_E *)ctx = msgId;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_IsCommandResponse
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Matcher for commands that end with OK or an error, skipping the
+ *      events the module sends on its own in the meantime.
+ * Inputs:
+ *      ATLIBGS_MSG_ID_E msgId -- Message received
+ * Outputs:
+ *      bool -- true if it ends the command
+ *---------------------------------------------------------------------------*/
+static bool AtLibGs_IsCommandResponse(ATLIBGS_MSG_ID_E msgId)
+{
+    switch (msgId) {
+        case ATLIBGS_MSG_ID_OK:
+        case ATLIBGS_MSG_ID_INVALID_INPUT:
+        case ATLIBGS_MSG_ID_ERROR:
+        case ATLIBGS_MSG_ID_ERROR_IP_CONFIG_FAIL:
+        case ATLIBGS_MSG_ID_ERROR_SOCKET_FAIL:
+        case ATLIBGS_MSG_ID_APP_RESET:
+            return true;
+        default:
+            return false;
+    }
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  AtLibGs_CommandSendString
  *---------------------------------------------------------------------------*
  * Description:
  *      Sends a raw command to the module and waits for a response.  If
- *      data is returned, it is collected into MRBuffer.
+ *      data is returned, it is collected into MRBuffer.  The command goes
+ *      through the queue, after any commands already in it.
  * Inputs:
  *      char *aString -- String to send
  * Outputs:
@@ -2059,15 +2397,18 @@ uint8_t AtLibGs_ParseDNSLookupResponse(char *ipAddr)
  *---------------------------------------------------------------------------*/
 ATLIBGS_MSG_ID_E AtLibGs_CommandSendString(char *aString)
 {
-#ifdef ATLIBGS_DEBUG_ENABLE
-    ConsolePrintf(">%s\n", aString);
-#endif
+    ATLIBGS_MSG_ID_E rxMsgId = ATLIBGS_MSG_ID_NONE;
 
-    /* Now send the command to S2w App node */
-    App_Write((char *)aString, strlen(aString));
+    /* Make room behind the commands already queued */
+    while (!AtLibGs_CommandQueue(aString, 0, ATLIB_RESPONSE_HANDLE_TIMEOUT,
+            AtLibGs_CommandStore, &rxMsgId))
+        AtLibGs_CommandPoll();
 
     /* Wait for the response while collecting data into the MRBuffer */
-    return AtLibGs_ResponseHandle();
+    while (rxMsgId == ATLIBGS_MSG_ID_NONE)
+        AtLibGs_CommandPoll();
+
+    return rxMsgId;
 }
 
 /*---------------------------------------------------------------------------*
@@ -2083,6 +2424,8 @@ ATLIBGS_MSG_ID_E AtLibGs_CommandSendString(char *aString)
  *---------------------------------------------------------------------------*/
 void AtLibGs_DataSend(const void *pTxData, uint16_t dataLen)
 {
+    AtLibGs_CommandDrain();
+
     App_Write(pTxData, dataLen);
 }
 
@@ -2114,6 +2457,8 @@ ATLIBGS_MSG_ID_E AtLibGs_SendTCPData(
     char cmd[20];
     ATLIBGS_MSG_ID_E rxMsgId;
 
+    AtLibGs_CommandDrain();
+
     if (cid == ATLIBGS_INVALID_CID)
         return ATLIBGS_MSG_ID_ERROR_SOCKET_FAIL;
 
@@ -2182,6 +2527,8 @@ ATLIBGS_MSG_ID_E AtLibGs_SendUDPData(
     char cmd[30];
     ATLIBGS_MSG_ID_E rxMsgId;
 
+    AtLibGs_CommandDrain();
+
     if (ATLIBGS_INVALID_CID != cid) {
         /* Construct the data start indication message */
         if (ATLIBGS_CON_UDP_SERVER == conType) {
@@ -2245,6 +2592,8 @@ void AtLibGs_BulkDataTransfer(uint8_t cid, const void *pData, uint16_t dataLen)
     char digits[5];
     char cmd[20];
 
+    AtLibGs_CommandDrain();
+
     /* Construct the bulk data start indication message  */
     AtLibGs_ConvertNumberTo4DigitASCII(dataLen, digits);
     sprintf(cmd, "%c%c" _F8_ "%s", ATLIBGS_ESC_CHAR, 'Z', cid, digits);
@@ -2260,12 +2609,59 @@ void AtLibGs_BulkDataTransfer(uint8_t cid, const void *pData, uint16_t dataLen)
     App_Write(pData, dataLen);
 }
 
+/* Lines the module ends a command or reports an event with, keyed on the
+ * start of the line. Entries sharing a start are listed most specific
+ * first, so "ERROR: SOCKET FAILURE" is found before "ERROR". */
+#define ATLIBGS_EOF_CLEAR_ASSOC     0x01    /* node is no longer associated */
+#define ATLIBGS_EOF_SET_RESET       0x02    /* node has rebooted */
+#define ATLIBGS_EOF_SERVER_CONNECT  0x04    /* only "CONNECT <sid> <cid> <ip> <port>" */
+typedef struct {
+    const char *text;
+    uint8_t len;
+    uint8_t flags;
+    ATLIBGS_MSG_ID_E msgId;
+} ATLIBGS_EOF_MESSAGE;
+#define ATLIBGS_EOF(text, flags, msgId)     { text, sizeof(text) - 1, flags, msgId }
+static const ATLIBGS_EOF_MESSAGE G_eofMessages[] = {
+    ATLIBGS_EOF("OK", 0, ATLIBGS_MSG_ID_OK),
+    ATLIBGS_EOF("Out of StandBy-Alarm", 0, ATLIBGS_MSG_ID_OUT_OF_STBY_ALARM),
+    ATLIBGS_EOF("Out of StandBy-Timer", 0, ATLIBGS_MSG_ID_OUT_OF_STBY_TIMER),
+    ATLIBGS_EOF("Out of Deep Sleep", 0, ATLIBGS_MSG_ID_OUT_OF_DEEP_SLEEP),
+    ATLIBGS_EOF("ERROR: IP CONFIG FAIL", 0, ATLIBGS_MSG_ID_ERROR_IP_CONFIG_FAIL),
+    ATLIBGS_EOF("ERROR: SOCKET FAILURE", 0, ATLIBGS_MSG_ID_ERROR_SOCKET_FAIL),
+    ATLIBGS_EOF("ERROR", 0, ATLIBGS_MSG_ID_ERROR),
+    ATLIBGS_EOF("INVALID INPUT", 0, ATLIBGS_MSG_ID_INVALID_INPUT),
+    ATLIBGS_EOF("DISASSOCIATED", ATLIBGS_EOF_CLEAR_ASSOC,
+        ATLIBGS_MSG_ID_DISASSOCIATION_EVENT),
+    ATLIBGS_EOF("DISCONNECT", 0, ATLIBGS_MSG_ID_DISCONNECT),
+    ATLIBGS_EOF("Disassociation Event", ATLIBGS_EOF_CLEAR_ASSOC,
+        ATLIBGS_MSG_ID_DISASSOCIATION_EVENT),
+    ATLIBGS_EOF("APP Reset-APP SW Reset",
+        ATLIBGS_EOF_CLEAR_ASSOC | ATLIBGS_EOF_SET_RESET,
+        ATLIBGS_MSG_ID_APP_RESET),
+    /* Echoed back AT command, if echo is enabled */
+    ATLIBGS_EOF("AT+", 0, ATLIBGS_MSG_ID_NONE),
+    ATLIBGS_EOF("UnExpected Warm Boot",
+        ATLIBGS_EOF_CLEAR_ASSOC | ATLIBGS_EOF_SET_RESET,
+        ATLIBGS_MSG_ID_UNEXPECTED_WARM_BOOT),
+    ATLIBGS_EOF("Serial2WiFi APP",
+        ATLIBGS_EOF_CLEAR_ASSOC | ATLIBGS_EOF_SET_RESET,
+        ATLIBGS_MSG_ID_WELCOME_MSG),
+    ATLIBGS_EOF("CONNECT ", ATLIBGS_EOF_SERVER_CONNECT,
+        ATLIBGS_MSG_ID_TCP_SERVER_CONNECT),
+};
+#define ATLIBGS_NUM_EOF_MESSAGES \
+    (sizeof(G_eofMessages) / sizeof(G_eofMessages[0]))
+
 /*---------------------------------------------------------------------------*
  * Routine:  AtLibGs_checkEOFMessage
  *---------------------------------------------------------------------------*
  * Description:
  *      This functions is used to check the completion of Commands
- *      This function will be called after receiving each line.
+ *      This function will be called after receiving each line. The line
+ *      is looked up by its start in G_eofMessages, leading spaces and
+ *      control characters are skipped, so it is read once whatever is
+ *      already in MRBuffer.
  * Inputs:
  *      const char *pBuffer -- Line of data to check
  * Outputs:
@@ -2274,72 +2670,43 @@ void AtLibGs_BulkDataTransfer(uint8_t cid, const void *pData, uint16_t dataLen)
  *---------------------------------------------------------------------------*/
 ATLIBGS_MSG_ID_E AtLibGs_checkEOFMessage(const char *pBuffer)
 {
-    const char *p;
+    const ATLIBGS_EOF_MESSAGE *p_msg;
+    const char *p = pBuffer;
+    uint8_t i;
     uint8_t numSpaces;
 
-    if ((strstr((const char *)pBuffer, "OK") != NULL)) {
-        return ATLIBGS_MSG_ID_OK;
-    } else if ((strstr((const char *)pBuffer, "ERROR") != NULL)) {
-        return ATLIBGS_MSG_ID_ERROR;
-    } else if ((strstr((const char *)pBuffer, "INVALID INPUT") != NULL)) {
-        return ATLIBGS_MSG_ID_INVALID_INPUT;
-    } else if ((strstr((const char *)pBuffer, "DISASSOCIATED") != NULL)) {
-        /* Reset the local flags */
-        AtLibGs_ClearNodeAssociationFlag();
-        return ATLIBGS_MSG_ID_DISASSOCIATION_EVENT;
-    } else if ((strstr((const char *)pBuffer, "ERROR: IP CONFIG FAIL") != NULL)) {
-        return ATLIBGS_MSG_ID_ERROR_IP_CONFIG_FAIL;
-    } else if (strstr((const char *)pBuffer, "ERROR: SOCKET FAILURE") != NULL) {
-        /* Reset the local flags */
-        return ATLIBGS_MSG_ID_ERROR_SOCKET_FAIL;
-    } else if ((strstr((const char *)pBuffer, "APP Reset-APP SW Reset"))
-            != NULL) {
-        /* Reset the local flags */
-        AtLibGs_ClearNodeAssociationFlag();
-        AtLibGs_SetNodeResetFlag();
-        return ATLIBGS_MSG_ID_APP_RESET;
-    } else if ((strstr((const char *)pBuffer, "DISCONNECT")) != NULL) {
-        /* Reset the local flags */
-        return ATLIBGS_MSG_ID_DISCONNECT;
-    } else if ((strstr((const char *)pBuffer, "Disassociation Event")) != NULL) {
-        /* reset the association flag */
-        AtLibGs_ClearNodeAssociationFlag();
-        return ATLIBGS_MSG_ID_DISASSOCIATION_EVENT;
-    } else if ((strstr((const char *)pBuffer, "Out of StandBy-Alarm")) != NULL) {
-        return ATLIBGS_MSG_ID_OUT_OF_STBY_ALARM;
-    } else if ((strstr((const char *)pBuffer, "Out of StandBy-Timer")) != NULL) {
-        return ATLIBGS_MSG_ID_OUT_OF_STBY_TIMER;
-    } else if ((strstr((const char *)pBuffer, "UnExpected Warm Boot")) != NULL) {
-        /* Reset the local flags */
-        AtLibGs_ClearNodeAssociationFlag();
-        AtLibGs_SetNodeResetFlag();
-        return ATLIBGS_MSG_ID_UNEXPECTED_WARM_BOOT;
-    } else if ((strstr((const char *)pBuffer, "Out of Deep Sleep")) != NULL) {
-        return ATLIBGS_MSG_ID_OUT_OF_DEEP_SLEEP;
-    } else if ((strstr((const char *)pBuffer, "Serial2WiFi APP")) != NULL) {
-        /* Reset the local flags */
-        AtLibGs_ClearNodeAssociationFlag();
-        AtLibGs_SetNodeResetFlag();
-        return ATLIBGS_MSG_ID_WELCOME_MSG;
-    } else if ((pBuffer[0] == 'A') && (pBuffer[1] == 'T')
-            && (pBuffer[2] == '+')) {
-        /* Handle the echoed back AT Command, if Echo is enabled.  "AT+" . */
+    while (('\0' != *p) && ((uint8_t)*p <= ' '))
+        p++;
+
+    for (i = 0; i < ATLIBGS_NUM_EOF_MESSAGES; i++) {
+        p_msg = &G_eofMessages[i];
+        if ((p_msg->text[0] == p[0])
+                && (0 == strncmp(p, p_msg->text, p_msg->len)))
+            break;
+    }
+    if (ATLIBGS_NUM_EOF_MESSAGES == i)
         return ATLIBGS_MSG_ID_NONE;
-    } else if (strstr((const char *)pBuffer, "CONNECT ") != NULL) {
+
+    if (p_msg->flags & ATLIBGS_EOF_SERVER_CONNECT) {
         /* Determine if this CONNECT line is of the type CONNECT <server id> <cid> <ip> <port> */
         /* by counting spaces in between the words.  A standard CONNECT <cid> is not the same */
-        p = pBuffer;
         numSpaces = 0;
         while ((*p) && (*p != '\n')) {
             if (*p == ' ')
                 numSpaces++;
-            if (numSpaces >= 4)
-                return ATLIBGS_MSG_ID_TCP_SERVER_CONNECT;
             p++;
         }
+        if (numSpaces < 4)
+            return ATLIBGS_MSG_ID_NONE;
+    }
+    if (p_msg->flags & ATLIBGS_EOF_CLEAR_ASSOC) {
+        /* Reset the local flags */
+        AtLibGs_ClearNodeAssociationFlag();
     }
+    if (p_msg->flags & ATLIBGS_EOF_SET_RESET)
+        AtLibGs_SetNodeResetFlag();
 
-    return ATLIBGS_MSG_ID_NONE;
+    return p_msg->msgId;
 }
 
 /*---------------------------------------------------------------------------*
@@ -2353,14 +2720,18 @@ ATLIBGS_MSG_ID_E AtLibGs_checkEOFMessage(const char *pBuffer)
  * Outputs:
  *      ATLIBGS_MSG_ID_E -- error code.  ATLIBGS_MSG_ID_OK if data is
  *          received.  ATLIBGS_MSG_ID_RESPONSE_TIMEOUT if timeout occurred.
+ *          ATLIBGS_MSG_ID_DATA_RX_FULL if data was taken in until there
+ *          was no room for more, the rest of it follows in a later call.
  *---------------------------------------------------------------------------*/
 ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataHandle(uint32_t timeout)
 {
-    uint8_t rxData;
     uint32_t start = MSTimerGet();
     ATLIBGS_MSG_ID_E rxMsgId;
 
-    /* Read one byte at a time - Use non-blocking call */
+    AtLibGs_CommandDrain();
+
+    /* Process what has come in a chunk at a time - Use non-blocking call */
+    dataHold = true;
     while (1) {
         /* Has it taken too much time? */
         if (MSTimerDelta(start) >= timeout) {
@@ -2370,14 +2741,14 @@ ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataHandle(uint32_t timeout)
         }
 
         /* See if there is any data to process */
-        if (App_Read(&rxData, 1, 0)) {
-            /* Process this byte */
-            rxMsgId = AtLibGs_ReceiveDataProcess(rxData);
+        if (AtLibGs_ReceiveChunk(&rxMsgId)) {
             if (rxMsgId != ATLIBGS_MSG_ID_NONE)
                 break;
         }
     }
 
+    dataHold = false;
+
     return rxMsgId;
 }
 
@@ -2395,18 +2766,20 @@ ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataHandle(uint32_t timeout)
  *---------------------------------------------------------------------------*/
 ATLIBGS_MSG_ID_E AtLibGs_WaitForUDPMessage(uint32_t timeout)
 {
-    uint8_t rxData;
+    ATLIBGS_MSG_ID_E rxMsgId;
     uint32_t start = MSTimerGet();
 
+    AtLibGs_CommandDrain();
+
     /* wait until message received */
     while (1) {
-        /* Read one byte at a time - Use non-blocking call */
-        while (App_Read(&rxData, 1, 0)) {
+        /* Process what has come in - Use non-blocking call */
+        while (AtLibGs_ReceiveChunk(&rxMsgId)) {
             /* Restart the timeout */
             start = MSTimerGet();
 
-            /* Process the received data */
-            if (AtLibGs_ReceiveDataProcess(rxData) == ATLIBGS_MSG_ID_DATA_RX) {
+            /* Check the processed data */
+            if (rxMsgId == ATLIBGS_MSG_ID_DATA_RX) {
                 return ATLIBGS_MSG_ID_OK;
             }
         }
@@ -2436,23 +2809,23 @@ ATLIBGS_MSG_ID_E AtLibGs_WaitForTCPConnection(
         uint32_t timeout)
 {
     ATLIBGS_MSG_ID_E rxMsgId;
-    uint8_t rxData;
     uint32_t start = MSTimerGet();
     char *p;
     char *tokens[6];
     uint16_t numTokens;
 
+    AtLibGs_CommandDrain();
+
     /* wait until message received or timeout*/
     while (1) {
         if ((MSTimerDelta(start) >= timeout) && (timeout))
             return ATLIBGS_MSG_ID_RESPONSE_TIMEOUT;
 
-        while (App_Read(&rxData, 1, 0)) {
+        while (AtLibGs_ReceiveChunk(&rxMsgId)) {
             /* If we got data, reset the timeout */
             start = MSTimerGet();
 
-            /* Process the received data */
-            rxMsgId = AtLibGs_ReceiveDataProcess(rxData);
+            /* Check the processed data */
             if (rxMsgId == ATLIBGS_MSG_ID_TCP_SERVER_CONNECT) {
                 // Now parse out the TCP connection information
                 p = strstr(MRBuffer, "CONNECT");
@@ -2488,20 +2861,20 @@ ATLIBGS_MSG_ID_E AtLibGs_WaitForTCPConnection(
 ATLIBGS_MSG_ID_E AtLibGs_WaitForTCPMessage(uint32_t timeout)
 {
     ATLIBGS_MSG_ID_E rxMsgId;
-    uint8_t rxData;
     uint32_t start = MSTimerGet();
 
+    AtLibGs_CommandDrain();
+
     /* wait until message received or timeout*/
     while (1) {
         if ((MSTimerDelta(start) >= timeout) && (timeout))
             return ATLIBGS_MSG_ID_RESPONSE_TIMEOUT;
 
-        while (App_Read(&rxData, 1, 0)) {
+        while (AtLibGs_ReceiveChunk(&rxMsgId)) {
             /* If we got data, reset the timeout */
             start = MSTimerGet();
 
-            /* Process the received data */
-            rxMsgId = AtLibGs_ReceiveDataProcess(rxData);
+            /* Check the processed data */
             if (rxMsgId == ATLIBGS_MSG_ID_DATA_RX)
                 return rxMsgId;
         }
@@ -2524,20 +2897,20 @@ ATLIBGS_MSG_ID_E AtLibGs_WaitForTCPMessage(uint32_t timeout)
 ATLIBGS_MSG_ID_E AtLibGs_WaitForHTTPMessage(uint32_t timeout)
 {
     ATLIBGS_MSG_ID_E rxMsgId;
-    uint8_t rxData;
     uint32_t start = MSTimerGet();
 
+    AtLibGs_CommandDrain();
+
     /* wait until message received or timeout*/
     while (1) {
         if ((MSTimerDelta(start) >= timeout) && (timeout))
             return ATLIBGS_MSG_ID_RESPONSE_TIMEOUT;
 
-        while (App_Read(&rxData, 1, 0)) {
+        while (AtLibGs_ReceiveChunk(&rxMsgId)) {
             /* If we got data, reset the timeout */
             start = MSTimerGet();
 
-            /* Process the received data */
-            rxMsgId = AtLibGs_ReceiveDataProcess(rxData);
+            /* Check the processed data */
             if (rxMsgId == ATLIBGS_MSG_ID_HTTP_RESPONSE_DATA_RX)
                 return rxMsgId;
         }
@@ -2679,6 +3052,212 @@ void AtLibGs_ParseHTTPData(
     }
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_CidFromChar
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Convert the CID character that starts a data sequence to its
+ *      number.
+ * Inputs:
+ *      uint8_t c -- '0' to '9' or 'a' to 'f'
+ * Outputs:
+ *      uint8_t -- CID, or ATLIBGS_INVALID_CID
+ *---------------------------------------------------------------------------*/
+static uint8_t AtLibGs_CidFromChar(uint8_t c)
+{
+    if ((c >= '0') && (c <= '9'))
+        return c - '0';
+    c = tolower(c);
+    if ((c >= 'a') && (c <= 'f'))
+        return c - 'a' + 10;
+
+    return ATLIBGS_INVALID_CID;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_SetDataHandler
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set the routine given the data received for a connection, in
+ *      spans that point straight into the receive FIFO.
+ * Inputs:
+ *      ATLIBGS_DATA_HANDLER handler -- Routine to call, 0 to hand each
+ *          byte to App_ProcessIncomingData
+ * Outputs:
+ *    void
+ *---------------------------------------------------------------------------*/
+void AtLibGs_SetDataHandler(ATLIBGS_DATA_HANDLER handler)
+{
+    dataHandler = handler;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_SetDataRoom
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Set the routine that tells how much more data of a connection can
+ *      be kept.  AtLibGs_ReceiveDataHandle leaves data there is no room
+ *      for in the receive FIFO; everywhere else, as while waiting for a
+ *      command's response, it is handed on whatever the room.
+ * Inputs:
+ *      ATLIBGS_DATA_ROOM room -- Routine to call, 0 to hand on all data
+ * Outputs:
+ *    void
+ *---------------------------------------------------------------------------*/
+void AtLibGs_SetDataRoom(ATLIBGS_DATA_ROOM room)
+{
+    dataRoom = room;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_DataRoom
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Tell how many bytes the receive machine may hand on before the
+ *      next check.
+ * Inputs:
+ *    void
+ * Outputs:
+ *      uint16_t -- Bytes, 0xFFFF outside the data of a sequence
+ *---------------------------------------------------------------------------*/
+static uint16_t AtLibGs_DataRoom(void)
+{
+    switch (receive_state) {
+        case ATLIBGS_RX_STATE_DATA_BODY:
+        case ATLIBGS_RX_STATE_DATA_BODY_ESCAPE:
+        case ATLIBGS_RX_STATE_SPECIAL_DATA_BODY:
+            if (dataRoom && dataHold)
+                return dataRoom(rxDataCid);
+            break;
+        default:
+            break;
+    }
+
+    return 0xFFFF;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_DataDeliver
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Hand received connection data to the data handler, or a byte at a
+ *      time to App_ProcessIncomingData if none is set.
+ * Inputs:
+ *      uint8_t cid -- Connection the data is for
+ *      const uint8_t *data -- Bytes received
+ *      uint16_t len -- Number of bytes
+ * Outputs:
+ *    void
+ *---------------------------------------------------------------------------*/
+static void AtLibGs_DataDeliver(uint8_t cid, const uint8_t *data, uint16_t len)
+{
+    if (dataHandler) {
+        dataHandler(cid, data, len);
+        return;
+    }
+    while (len--)
+        App_ProcessIncomingData(cid, *data++);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_SpecialDataStart
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Start on the data of an ESC H, ESC Z or ESC R sequence once its
+ *      length is known.
+ * Inputs:
+ *    void
+ * Outputs:
+ *      ATLIBGS_MSG_ID_E -- The sequence's message if it has no data
+ *---------------------------------------------------------------------------*/
+static ATLIBGS_MSG_ID_E AtLibGs_SpecialDataStart(void)
+{
+    if (specialDataLen) {
+        receive_state = ATLIBGS_RX_STATE_SPECIAL_DATA_BODY;
+        return ATLIBGS_MSG_ID_NONE;
+    }
+    receive_state = ATLIBGS_RX_STATE_START;
+
+    return specialDataEndMsg;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_ReceiveDataSpan
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      While the receive machine is in the data of a sequence, hand as
+ *      much of a chunk on as belongs to it and there is room for.  The
+ *      byte that ends the data, or an ESC in it, is left to
+ *      AtLibGs_ReceiveDataProcess.
+ * Inputs:
+ *      const uint8_t *rx -- Bytes received
+ *      uint16_t len -- Number of bytes
+ * Outputs:
+ *      uint16_t -- Number of bytes handed on, 0 if none
+ *---------------------------------------------------------------------------*/
+static uint16_t AtLibGs_ReceiveDataSpan(const uint8_t *rx, uint16_t len)
+{
+    const uint8_t *esc;
+    uint16_t room;
+    uint16_t n;
+
+    room = AtLibGs_DataRoom();
+    if (len > room)
+        len = room;
+    switch (receive_state) {
+        case ATLIBGS_RX_STATE_DATA_BODY:
+            esc = (const uint8_t *)memchr(rx, ATLIBGS_ESC_CHAR, len);
+            n = esc ? (esc - rx) : len;
+            break;
+        case ATLIBGS_RX_STATE_SPECIAL_DATA_BODY:
+            n = specialDataLen - 1;
+            if (n > len)
+                n = len;
+            specialDataLen -= n;
+            break;
+        default:
+            return 0;
+    }
+    if (n)
+        AtLibGs_DataDeliver(rxDataCid, rx, n);
+
+    return n;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_ReceiveChunk
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Feed the bytes waiting in the receive FIFO through the receive
+ *      machine where they are, up to the first message.  Does not block,
+ *      but a short chunk is given the chance to grow for as long as bytes
+ *      keep coming in, so each one processed is worth the call.
+ * Inputs:
+ *      ATLIBGS_MSG_ID_E *rxMsgId -- Returned message, or
+ *          ATLIBGS_MSG_ID_NONE
+ * Outputs:
+ *      bool -- true if any bytes were processed, else false
+ *---------------------------------------------------------------------------*/
+static bool AtLibGs_ReceiveChunk(ATLIBGS_MSG_ID_E *rxMsgId)
+{
+    const uint8_t *rx;
+    uint16_t rxLen;
+    uint16_t more;
+    uint16_t used;
+
+    *rxMsgId = ATLIBGS_MSG_ID_NONE;
+    rxLen = App_ReadSpan(&rx);
+    if (rxLen == 0)
+        return false;
+    while ((rxLen < ATLIBGS_RX_CHUNK_MIN) && ((more = App_ReadSpan(&rx)) > rxLen))
+        rxLen = more;
+
+    *rxMsgId = AtLibGs_ProcessRxChunk(rx, rxLen, &used);
+    App_ReadConsume(used);
+
+    return (used != 0) || (*rxMsgId != ATLIBGS_MSG_ID_NONE);
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  AtLibGs_ReceiveDataProcess
  *---------------------------------------------------------------------------*
@@ -2782,7 +3361,7 @@ void AtLib_GSLinkSendValue( int8_t *pTag, uint8_t cid, int32_t value)
 	#endif
 }
 extern int16_t		gAccData[3];
-extern float		gTemp, gTemp_F, gTemp_C;
+extern int16_t		gTemp_F;      // tenths of a degree F
 extern uint8_t      gTempMode;
 extern uint16_t		gAmbientLight;
 extern uint8_t		gSetLight_onoff;
@@ -2806,7 +3385,9 @@ void AtLib_GSLinkSendTempValue( int8_t *pTag, uint8_t cid)
         sprintf (&(dataBuf[0]),"%s%c%.1fF", pTag,':',gTemp_F);       
     }
 #endif
-    sprintf ((char *)&(dataBuf[0]),"%s%c%.1fF", (char *)pTag,':',gTemp_F);   
+    strcpy((char *)dataBuf, (char *)pTag);
+    strcat((char *)dataBuf, ":");
+    Fixed_FormatLabel((char *)&dataBuf[strlen((char *)dataBuf)], "", gTemp_F, 1, "F");
     command_length = strlen((char *)dataBuf);      /* Get command length */
     AtLib_ConvertNumberTo4DigitASCII(command_length, cDataLen);
      
@@ -2908,22 +3489,66 @@ void AtLib_GSLinkGetPostResp(uint8_t cid, uint8_t gslinkType, int32_t TimeOut, u
 
 #endif
 
-const char ledTag[5]="leds";
-const char ssidTag[5]="ssid";
-const char channelTag[5]="chanl";
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLib_GSLinkSetLeds
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Handles the "leds" value posted by a GSLink client.
+ * Inputs:
+ *      const char *value -- LED setting, '0' or '1'
+ *      uint8_t len -- Length of the value
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtLib_GSLinkSetLeds(const char *value, uint8_t len)
+{
+    if (len < 1)
+        return;
+    gSetLight_onoff = value[0] - 0x30;    // covert it from ascii format
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLib_GSLinkSetSSID
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Handles the "ssid" value posted by a GSLink client.
+ * Inputs:
+ *      const char *value -- SSID to save in the EEPROM
+ *      uint8_t len -- Length of the value
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtLib_GSLinkSetSSID(const char *value, uint8_t len)
+{
+    EEPROM_Write(8, (uint8_t*)value, len);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLib_GSLinkSetChannel
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Handles the "chanl" value posted by a GSLink client.
+ * Inputs:
+ *      const char *value -- Channel number to save in the EEPROM
+ *      uint8_t len -- Length of the value
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void AtLib_GSLinkSetChannel(const char *value, uint8_t len)
+{
+    EEPROM_Write(30, (uint8_t*)value, len);
+}
+
 int valueLen;
 ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataProcess(uint8_t rxData)
 {
     /* receive data handling state */
-    static ATLIBGS_RX_STATE_E receive_state = ATLIBGS_RX_STATE_START;
-    static uint16_t specialDataLen = 0;
     static uint8_t  rxCurrentCid=0, rxPOSTCid=0, escStatus=0, GetValue=0;
-    static uint8_t specialDataLenCharCount = 0, GSLinkType=0;
+    static uint8_t GSLinkType=0;
     
     static  char *pPostTag, PostTag[8], *pPostValue, PostValue[20]; 
+    static const uint8_t escChar = ATLIBGS_ESC_CHAR;
     
-    uint16_t datalencount;
-
     ATLIBGS_MSG_ID_E rxMsgId = ATLIBGS_MSG_ID_NONE;
 
 #ifdef ATLIBGS_DEBUG_ENABLE
@@ -2951,6 +3576,7 @@ ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataProcess(uint8_t rxData)
                 default:
                     /* Not start of ESC char, not start of any CR or NL */
                     MRBufferIndex = 0;
+                    MRLineStart = 0;
                     MRBuffer[MRBufferIndex] = rxData;
                     MRBufferIndex++;
                     receive_state = ATLIBGS_RX_STATE_CMD_RESP;
@@ -2966,12 +3592,15 @@ ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataProcess(uint8_t rxData)
                 /* terminate string with NULL for strstr() */
                 MRBufferIndex++;
                 MRBuffer[MRBufferIndex] = '\0';
-                rxMsgId = AtLibGs_checkEOFMessage(MRBuffer);
+                rxMsgId = AtLibGs_checkEOFMessage(&MRBuffer[MRLineStart]);
 
                 if (ATLIBGS_MSG_ID_NONE != rxMsgId) {
                     /* command echo or end of response detected */
                     /* Now reset the  state machine */
                     receive_state = ATLIBGS_RX_STATE_START;
+                } else {
+                    /* keep the line for the parsers, check only the next */
+                    MRLineStart = MRBufferIndex;
                 }
             } else if (ATLIBGS_ESC_CHAR == rxData) {
                 /* Defensive check - This should not happen */
@@ -3062,75 +3691,71 @@ ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataProcess(uint8_t rxData)
           break;
         
         case ATLIBGS_RX_STATE_DATA_HANDLE:
-            /* Store the CID */
-            App_ProcessIncomingData(rxData);
-
-            /* Keep receiving data till you get ESC E */
-            do {
-                App_Read(&rxData, 1, 1);
-
-                /* Is this char an ESC? */
-                while (rxData == ATLIBGS_ESC_CHAR) {
-                    /* What is the next character? */
-                    App_Read(&rxData, 1, 1);
-                    /* Is it an 'E'? */
-                    if (rxData == ATLIBGS_DATA_MODE_NORMAL_END_CHAR_E) {
-                        /* End of data detected */
-                        receive_state = ATLIBGS_RX_STATE_START;
-                        rxMsgId = ATLIBGS_MSG_ID_DATA_RX;
-                        return rxMsgId;
-                    }
-                    /* Go ahead and store the ESC character */
-                    App_ProcessIncomingData(ATLIBGS_ESC_CHAR);
-
-                    /* Repeat if the second charater was an ESC char */
-                }
-
-                /* Store whatever character we were left holding */
-                App_ProcessIncomingData(rxData);
-            } while (receive_state != ATLIBGS_RX_STATE_START);
+            /* The data is for this CID, it runs till ESC E */
+            rxDataCid = AtLibGs_CidFromChar(rxData);
+            receive_state = ATLIBGS_RX_STATE_DATA_BODY;
             break;
 
-        case ATLIBGS_RX_STATE_HTTP_RESPONSE_DATA_HANDLE:
-            /* Store the CID */
-            App_ProcessIncomingData(rxData);
+        case ATLIBGS_RX_STATE_DATA_BODY:
+            if (rxData == ATLIBGS_ESC_CHAR)
+                receive_state = ATLIBGS_RX_STATE_DATA_BODY_ESCAPE;
+            else
+                AtLibGs_DataDeliver(rxDataCid, &rxData, 1);
+            break;
 
-            /* Get HTTP response length */
-            specialDataLen = 0;
-            for (datalencount = 0; datalencount < 4; datalencount++) {
-                App_Read(&rxData, 1, 1);
-                specialDataLen = (specialDataLen * 10) + ((rxData) - '0');
+        case ATLIBGS_RX_STATE_DATA_BODY_ESCAPE:
+            /* Is it an 'E'? */
+            if (rxData == ATLIBGS_DATA_MODE_NORMAL_END_CHAR_E) {
+                /* End of data detected */
+                receive_state = ATLIBGS_RX_STATE_START;
+                rxMsgId = ATLIBGS_MSG_ID_DATA_RX;
+                break;
             }
+            /* Go ahead and store the ESC character */
+            AtLibGs_DataDeliver(rxDataCid, &escChar, 1);
 
-            /* Now read actual data */
-            while (specialDataLen--) {
-                App_Read(&rxData, 1, 1);
-                App_ProcessIncomingData(rxData);
+            /* Store the character after it unless it is another ESC */
+            if (rxData != ATLIBGS_ESC_CHAR) {
+                AtLibGs_DataDeliver(rxDataCid, &rxData, 1);
+                receive_state = ATLIBGS_RX_STATE_DATA_BODY;
             }
+            break;
+
+        case ATLIBGS_RX_STATE_HTTP_RESPONSE_DATA_HANDLE:
+            /* The data is for this CID */
+            rxDataCid = AtLibGs_CidFromChar(rxData);
 
-            receive_state = ATLIBGS_RX_STATE_START;
-            rxMsgId = ATLIBGS_MSG_ID_HTTP_RESPONSE_DATA_RX;
+            /* Get HTTP response length next */
+            specialDataLen = 0;
+            specialDataLenCharCount = 0;
+            specialDataEndMsg = ATLIBGS_MSG_ID_HTTP_RESPONSE_DATA_RX;
+            receive_state = ATLIBGS_RX_STATE_SPECIAL_DATA_LEN;
             break;
 
         case ATLIBGS_RX_STATE_BULK_DATA_HANDLE:
-            /* Store the CID */
-            App_ProcessIncomingData(rxData);
+            /* The data is for this CID */
+            rxDataCid = AtLibGs_CidFromChar(rxData);
 
-            /* Get HTTP response length */
+            /* Get bulk data length next */
             specialDataLen = 0;
-            for (datalencount = 0; datalencount < 4; datalencount++) {
-                /* Read one byte at a time - blocking call */
-                App_Read(&rxData, 1, 1);
-                specialDataLen = (specialDataLen * 10) + ((rxData) - '0');
-            }
+            specialDataLenCharCount = 0;
+            specialDataEndMsg = ATLIBGS_MSG_ID_NONE;
+            receive_state = ATLIBGS_RX_STATE_SPECIAL_DATA_LEN;
+            break;
 
-            /* Now read actual data */
-            while (specialDataLen--) {
-                /* Read one byte at a time */
-                App_Read(&rxData, 1, 1);
-                App_ProcessIncomingData(rxData);
+        case ATLIBGS_RX_STATE_SPECIAL_DATA_LEN:
+            /* Four digits of length */
+            specialDataLen = (specialDataLen * 10) + ((rxData) - '0');
+            if (++specialDataLenCharCount >= 4)
+                rxMsgId = AtLibGs_SpecialDataStart();
+            break;
+
+        case ATLIBGS_RX_STATE_SPECIAL_DATA_BODY:
+            AtLibGs_DataDeliver(rxDataCid, &rxData, 1);
+            if (--specialDataLen == 0) {
+                receive_state = ATLIBGS_RX_STATE_START;
+                rxMsgId = specialDataEndMsg;
             }
-            receive_state = ATLIBGS_RX_STATE_START;
             break;
 
           case ATLIBGS_RX_STATE_GLINK_DATA_LEN:                                   // 3.  GSLink data length                                             
@@ -3188,18 +3813,7 @@ ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataProcess(uint8_t rxData)
                    if(specialDataLen == 0)
                    {  
                      *pPostValue = NULL;                                 // Post: the end of the value string
-                     if(!strcmp(ledTag, PostTag))
-                     {
-                       gSetLight_onoff = PostValue[0] - 0x30;             // Get LED settting value, covert it from ascii format
-                     }
-                     else if(!strcmp(ssidTag, PostTag))
-                     {
-                         EEPROM_Write(8, (uint8_t*)PostValue, valueLen);  // write the SSID to eeprom
-                     }
-                     else if(!strcmp(channelTag, PostTag))
-                     {
-                         EEPROM_Write(30, (uint8_t*)PostValue, valueLen);  // write the channel number to eeprom
-                     }
+                     Datasource_ApplyPost(PostTag, PostValue, valueLen);  // hand it to the tag's handler
                      GetValue = 0;
                    }
                  }
@@ -3226,31 +3840,21 @@ ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataProcess(uint8_t rxData)
                 specialDataLenCharCount = 0;
             }
 
-            /* Now reset the buffer and state machine */
-            receive_state = ATLIBGS_RX_STATE_START;
-
-            do {
-                /* extracting the rx data length*/
-                /* Read one byte at a time */
-                /* Read one byte at a time - blocking call */
-                App_Read(&rxData, 1, 1);
+            /* Raw data has no CID, the application drops it */
+            rxDataCid = ATLIBGS_INVALID_CID;
+            specialDataEndMsg = ATLIBGS_MSG_ID_NONE;
+            receive_state = ATLIBGS_RX_STATE_RAW_DATA_LEN;
+            break;
 
-                if (rxData != ATLIBGS_DATA_MODE_RAW_INDICATION_CHAR_COL) {
-                    specialDataLen = (specialDataLen * 10) + ((rxData) - '0');
-                    specialDataLenCharCount++;
-                }
-            } while ((rxData != ATLIBGS_DATA_MODE_RAW_INDICATION_CHAR_COL)
-                    && (specialDataLenCharCount < 4));
-
-            /* Now read actual data */
-            while (specialDataLen) {
-                /* Read one byte at a time - blocking call */
-                App_Read(&rxData, 1, 1);
-                specialDataLen--;
-                App_ProcessIncomingData(rxData);
+        case ATLIBGS_RX_STATE_RAW_DATA_LEN:
+            /* extracting the rx data length*/
+            if (rxData != ATLIBGS_DATA_MODE_RAW_INDICATION_CHAR_COL) {
+                specialDataLen = (specialDataLen * 10) + ((rxData) - '0');
+                specialDataLenCharCount++;
             }
-
-            receive_state = ATLIBGS_RX_STATE_START;
+            if ((rxData == ATLIBGS_DATA_MODE_RAW_INDICATION_CHAR_COL)
+                    || (specialDataLenCharCount >= 4))
+                rxMsgId = AtLibGs_SpecialDataStart();
             break;
 
         default:
@@ -3275,32 +3879,18 @@ ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataProcess(uint8_t rxData)
 ATLIBGS_MSG_ID_E AtLibGs_ResponseHandle(void)
 {
     ATLIBGS_MSG_ID_E responseMsgId;
-    uint8_t rxData;
     uint32_t timeout = MSTimerGet();
-    uint8_t gotData = 0;
 
     /* Reset the message ID */
     responseMsgId = ATLIBGS_MSG_ID_NONE;
 
     /* Now process the response from S2w App node */
     while (ATLIBGS_MSG_ID_NONE == responseMsgId) {
-        gotData = 1;
-        /* Read one byte at a time - non-blocking call, block here */
-        timeout = MSTimerGet();
-        while (!App_Read(&rxData, 1, 0)) {
-            if (MSTimerDelta(timeout) >= ATLIB_RESPONSE_HANDLE_TIMEOUT) {
-                gotData = 0;
-                responseMsgId = ATLIBGS_MSG_ID_RESPONSE_TIMEOUT;
-                break;
-            }
-        }
-        if (gotData) {
-            /* Process the received data */
-            responseMsgId = AtLibGs_ReceiveDataProcess(rxData);
-            if (responseMsgId != ATLIBGS_MSG_ID_NONE) {
-                /* Message successfully received from S2w App node */
-                break;
-            }
+        /* Process whatever has come in - non-blocking call, block here */
+        if (AtLibGs_ReceiveChunk(&responseMsgId)) {
+            timeout = MSTimerGet();
+        } else if (MSTimerDelta(timeout) >= ATLIB_RESPONSE_HANDLE_TIMEOUT) {
+            responseMsgId = ATLIBGS_MSG_ID_RESPONSE_TIMEOUT;
         }
     }
 
@@ -3312,30 +3902,55 @@ ATLIBGS_MSG_ID_E AtLibGs_ResponseHandle(void)
  *---------------------------------------------------------------------------*
  * Description:
  *      Process a group of received bytes looking for a response message.
+ *      Connection data in it is handed on in one piece rather than a byte
+ *      at a time.  Processing stops after the first message, or at data
+ *      the data room routine has no room for, the rest of the bytes are
+ *      for the next call.
  * Inputs:
  *      const char *rxBuf -- Pointer to bytes
  *      uint16_t bufLen -- Number of bytes in receive buffer
+ *      uint16_t *usedLen -- Returned number of bytes processed, or 0
  * Outputs:
  *      ATLIBGS_MSG_ID_E -- error code
  *---------------------------------------------------------------------------*/
-ATLIBGS_MSG_ID_E AtLibGs_ProcessRxChunk(const void *rxBuf, uint16_t bufLen)
+ATLIBGS_MSG_ID_E AtLibGs_ProcessRxChunk(
+        const void *rxBuf,
+        uint16_t bufLen,
+        uint16_t *usedLen)
 {
     ATLIBGS_MSG_ID_E rxMsgId;
     const uint8_t *rx = (uint8_t *)rxBuf;
+    uint16_t used = 0;
+    uint16_t n;
 
     rxMsgId = ATLIBGS_MSG_ID_NONE;
 
     /* Parse the received data and check whether any valid message present in the chunk */
-    while (bufLen) {
+    while (used < bufLen) {
+        /* Leave data there is no room for where it is, an ESC and the
+         * byte after it may both be handed on */
+        if (AtLibGs_DataRoom() < 2) {
+            if (used)
+                rxMsgId = ATLIBGS_MSG_ID_DATA_RX_FULL;
+            break;
+        }
+
+        /* Hand on the data of a sequence in one go */
+        n = AtLibGs_ReceiveDataSpan(&rx[used], bufLen - used);
+        if (n) {
+            used += n;
+            continue;
+        }
+
         /* Process the received data */
-        rxMsgId = AtLibGs_ReceiveDataProcess(*rx);
+        rxMsgId = AtLibGs_ReceiveDataProcess(rx[used++]);
         if (rxMsgId != ATLIBGS_MSG_ID_NONE) {
             /* Message received from S2w App node */
             break;
         }
-        rx++;
-        bufLen--;
     }
+    if (usedLen)
+        *usedLen = used;
 
     return rxMsgId;
 }
@@ -3357,6 +3972,8 @@ void AtLibGs_FlushIncomingMessage(void)
     uint8_t rxData;
     uint32_t start;
 
+    AtLibGs_CommandDrain();
+
     /* Read one byte at a time - non-blocking call */
     start = MSTimerGet();
     while (MSTimerDelta(start) < 100) {
@@ -3503,6 +4120,7 @@ void AtLibGs_FlushRxBuffer(void)
     /* Reset the response receive buffer */
     /* TODO: What do we do here now? */
     MRBufferIndex = 0;
+    MRLineStart = 0;
     memset(MRBuffer, '\0', ATLIBGS_RX_CMD_MAX_SIZE);
 }
 
@@ -4270,6 +4888,8 @@ ATLIBGS_MSG_ID_E AtLibGs_HTTPConf(ATLIBGS_HTTPCLIENT_E param, char value[])
 {
     char cmd[30];
 
+    AtLibGs_CommandDrain();
+
     sprintf(cmd, "AT+HTTPCONF=" _F16_ ",", param);
     App_Write(cmd, strlen(cmd));
     App_Write(value, strlen(value));
@@ -4281,6 +4901,55 @@ ATLIBGS_MSG_ID_E AtLibGs_HTTPConf(ATLIBGS_HTTPCLIENT_E param, char value[])
     return AtLibGs_ResponseHandle();
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_HTTPConfName
+ *---------------------------------------------------------------------------*
+ * Description:
+ *    Configures a header of the HTTP client that has no parameter number
+ *    Sends the command:
+ *     AT+HTTPCONF=<Name>,<Value>
+ * Inputs:
+ *      Header name, char string
+ * Outputs:
+ *      ATLIBGS_MSG_ID_E -- error code
+ *---------------------------------------------------------------------------*/
+ATLIBGS_MSG_ID_E AtLibGs_HTTPConfName(const char *name, char value[])
+{
+    AtLibGs_CommandDrain();
+
+    App_Write("AT+HTTPCONF=", 12);
+    App_Write(name, strlen(name));
+    App_Write(",", 1);
+    App_Write(value, strlen(value));
+    App_Write("\r\n", 2);
+#ifdef ATLIBGS_DEBUG_ENABLE
+    ConsolePrintf(">AT+HTTPCONF=%s,%s\n", name, value);
+#endif
+    /* Wait for the response while collecting data into the MRBuffer */
+    return AtLibGs_ResponseHandle();
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_HTTPConfDelName
+ *---------------------------------------------------------------------------*
+ * Description:
+ *    Deletes a header configured with AtLibGs_HTTPConfName
+ *    Sends the command:
+ *     AT+HTTPCONFDEL=<Name>
+ * Inputs:
+ *      Header name
+ * Outputs:
+ *      ATLIBGS_MSG_ID_E -- error code
+ *---------------------------------------------------------------------------*/
+ATLIBGS_MSG_ID_E AtLibGs_HTTPConfDelName(const char *name)
+{
+    char cmd[40];
+
+    sprintf(cmd, "AT+HTTPCONFDEL=%s\r\n", name);
+
+    return AtLibGs_CommandSendString(cmd);
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  AtLibGs_HTTPConfDel
  *---------------------------------------------------------------------------*
@@ -4759,12 +5428,58 @@ ATLIBGS_MSG_ID_E AtLibGs_GetTime(void)
     rxMsgId = AtLibGs_CommandSendString("AT+GETTIME=?\r\n");
     if ((rxMsgId == ATLIBGS_MSG_ID_OK) && (AtLibGs_ParseIntoLines(MRBuffer,
             lines, 2) >= 1)) {
-        /* TODO: Parse the time! */
+        /* Call AtLibGs_ParseGetTimeResponse() for the time */
         //ConsolePrintf("Time: %s\r\n", lines[0]);
     }
     return rxMsgId;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_ParseGetTimeResponse
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Parses the response returned after doing a AtLibGs_GetTime()
+ *      command, "dd/mm/yyyy,HH:MM:SS,<ms since epoch>".
+ * Inputs:
+ *      uint32_t *pSeconds -- Returned seconds since 1970
+ *      uint16_t *pMilliseconds -- Returned milliseconds past the second
+ * Outputs:
+ *      uint8_t -- Returns 1 if the time was found, else 0.
+ *---------------------------------------------------------------------------*/
+uint8_t AtLibGs_ParseGetTimeResponse(uint32_t *pSeconds, uint16_t *pMilliseconds)
+{
+    char digits[14];
+    uint8_t numDigits = 0;
+    uint8_t i;
+    uint16_t index;
+    bool afterComma = false;
+
+    /* The lines may already be split with '\0', walk the whole buffer */
+    for (index = 0; index <= MRBufferIndex; index++) {
+        if ((afterComma) && (index < MRBufferIndex) && (MRBuffer[index] >= '0')
+                && (MRBuffer[index] <= '9') && (numDigits < sizeof(digits))) {
+            digits[numDigits++] = MRBuffer[index];
+            continue;
+        }
+        /* The field after the second comma is the only long number */
+        if (numDigits > 3)
+            break;
+        numDigits = 0;
+        afterComma = ((index < MRBufferIndex) && (MRBuffer[index] == ','));
+    }
+    if (numDigits <= 3)
+        return 0;
+
+    *pSeconds = 0;
+    for (i = 0; i < numDigits - 3; i++)
+        *pSeconds = *pSeconds * 10 + (digits[i] - '0');
+    *pMilliseconds = 0;
+    for (; i < numDigits; i++)
+        *pMilliseconds = *pMilliseconds * 10 + (digits[i] - '0');
+
+    return 1;
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  AtLibGs_SetGPIO
  *---------------------------------------------------------------------------*
@@ -5025,7 +5740,7 @@ ATLIBGS_MSG_ID_E AtLibGs_TraceRoute(
 }
 
 /*---------------------------------------------------------------------------*
- * TODO: Routine:  AtLibGs_SNTPsync
+ * Routine:  AtLibGs_SNTPsync
  *---------------------------------------------------------------------------*
  * Description:
  *      Sets adapter time using namer server
@@ -5033,6 +5748,7 @@ ATLIBGS_MSG_ID_E AtLibGs_TraceRoute(
  *     AT+NTIMESYNC= <Enable>,<Server IP>,<Timeout>,<Periodic>,[<frequency>]
  * Inputs:
  *      <Enable>,<Server IP>,<Timeout>,<Periodic>,[<frequency>]
+ *      <frequency> is in seconds
  * Outputs:
  *      ATLIBGS_MSG_ID_E -- error code
  *---------------------------------------------------------------------------*/
@@ -5043,7 +5759,7 @@ ATLIBGS_MSG_ID_E AtLibGs_SNTPsync(
         bool periodic,
         uint32_t frequency)
 {
-    char cmd[30];
+    char cmd[60];
 
     sprintf(cmd, "AT+NTIMESYNC=" _F8_ ",%s," _F8_ "," _F8_ "," _F32_ "\r\n",
             enable, ip, timeout, periodic, frequency);
@@ -5150,9 +5866,43 @@ ATLIBGS_MSG_ID_E AtLibGs_HTTPSend(
         char page[],
         uint16_t size,
         const void *txBuf)
+{
+    ATLIBGS_MSG_ID_E msg;
+
+    msg = AtLibGs_HTTPSendStart(cid, type, timeout, page, size);
+    if (msg == ATLIBGS_MSG_ID_OK) {
+        /* Now send the actual data */
+        AtLibGs_DataSend(txBuf, size);
+    }
+    return msg;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  AtLibGs_HTTPSendStart
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Starts a get/post on HTTP client connection. The content follows
+ *      with AtLibGs_DataSend, in as many pieces as needed, until size
+ *      bytes were sent.
+ *      Sends the command:
+ *          AT+HTTPSEND=<CID>,<Type>,<Timeout>,<Page>[,Size of the content]
+ * Inputs:
+ *      <CID>,<Type>,<Timeout>,<Page>[,Size of the content]
+ * Outputs:
+ *      ATLIBGS_MSG_ID_E -- error code
+ *---------------------------------------------------------------------------*/
+ATLIBGS_MSG_ID_E AtLibGs_HTTPSendStart(
+        uint8_t cid,
+        ATLIBGS_HTTPSEND_E type,
+        uint16_t timeout,
+        char page[],
+        uint16_t size)
 {
     char cmd[50];
     ATLIBGS_MSG_ID_E msg = ATLIBGS_MSG_ID_INVALID_INPUT;
+
+    AtLibGs_CommandDrain();
+
     if (ATLIBGS_INVALID_CID != cid) {
 #ifdef ATLIBGS_DEBUG_ENABLE
         ConsolePrintf(">AT+HTTPSEND=" _F8_ "," _F8_ "," _F16_ ",", cid, type,
@@ -5171,8 +5921,6 @@ ATLIBGS_MSG_ID_E AtLibGs_HTTPSend(
             sprintf(cmd, "%c%c" _F8_, ATLIBGS_ESC_CHAR, 'H', cid);
             /* Now send the data START indication message  to S2w node */
             App_Write(cmd, 3);
-            /* Now send the actual data */
-            AtLibGs_DataSend(txBuf, size);
         }
     }
     return msg;
@@ -5443,6 +6191,8 @@ ATLIBGS_MSG_ID_E AtLibGs_GetWebProvSettings(
     bool done;
     uint32_t start = MSTimerGet();
 
+    AtLibGs_CommandDrain();
+
     /* Example response (SPI style): */
     /*    SSID=FDIOutsideG */
     /*    CHNL=11 */
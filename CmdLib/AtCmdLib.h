@@ -19,6 +19,7 @@
 #define  ATLIBGS_GSLINK_DATA_LEN_STRING_SIZE       (4)  /* Number of octets representing the data lenght field in GSLink data transfer message */
 
 #define  ATLIBGS_INVALID_CID                    (0xFF) /* invalid CID */
+#define  ATLIBGS_MAX_CIDS                       (16)   /* CIDs 0 to f */
 
 #define ATLIBGS_BSSID_MAX_LENGTH    20
 #define ATLIBGS_SSID_MAX_LENGTH     32
@@ -52,6 +53,11 @@ typedef enum {
     ATLIBGS_RX_STATE_BULK_DATA_HANDLE,
     ATLIBGS_RX_STATE_HTTP_RESPONSE_DATA_HANDLE,
     ATLIBGS_RX_STATE_RAW_DATA_HANDLE,
+    ATLIBGS_RX_STATE_RAW_DATA_LEN,
+    ATLIBGS_RX_STATE_DATA_BODY,
+    ATLIBGS_RX_STATE_DATA_BODY_ESCAPE,
+    ATLIBGS_RX_STATE_SPECIAL_DATA_LEN,
+    ATLIBGS_RX_STATE_SPECIAL_DATA_BODY,
     
     ATLIBGS_RX_STATE_DATA_CID,
     ATLIBGS_RX_STATE_GLINK_DATA_LEN,
@@ -87,7 +93,8 @@ typedef enum {
     ATLIBGS_MSG_ID_HTTP_RESPONSE_DATA_RX,
     ATLIBGS_MSG_ID_MAX,
     ATLIBGS_MSG_ID_TCP_SERVER_CONNECT,
-    ATLIBGS_MSG_ID_GENERAL_MESSAGE
+    ATLIBGS_MSG_ID_GENERAL_MESSAGE,
+    ATLIBGS_MSG_ID_DATA_RX_FULL
 } ATLIBGS_MSG_ID_E;
 
 typedef enum {
@@ -606,6 +613,8 @@ ATLIBGS_MSG_ID_E AtLibGs_SSLOpen(uint8_t cid, char name[]);
 ATLIBGS_MSG_ID_E AtLibGs_SSLClose(uint8_t cid);
 ATLIBGS_MSG_ID_E AtLibGs_HTTPConf(ATLIBGS_HTTPCLIENT_E param, char value[]);
 ATLIBGS_MSG_ID_E AtLibGs_HTTPConfDel(ATLIBGS_HTTPCLIENT_E param);
+ATLIBGS_MSG_ID_E AtLibGs_HTTPConfName(const char *name, char value[]);
+ATLIBGS_MSG_ID_E AtLibGs_HTTPConfDelName(const char *name);
 ATLIBGS_MSG_ID_E AtLibGs_HTTPClose(uint8_t cid);
 ATLIBGS_MSG_ID_E AtLibGs_RawETHFrameConf(ATLIBGS_RAW_ETH_E enable);
 ATLIBGS_MSG_ID_E AtLibGs_BulkDataTrans(bool enable);
@@ -689,6 +698,12 @@ ATLIBGS_MSG_ID_E AtLibGs_HTTPSend(
         char page[],
         uint16_t size,
         const void *txBuf);
+ATLIBGS_MSG_ID_E AtLibGs_HTTPSendStart(
+        uint8_t cid,
+        ATLIBGS_HTTPSEND_E type,
+        uint16_t timeout,
+        char page[],
+        uint16_t size);
 ATLIBGS_MSG_ID_E AtLibGs_UnsolicitedTXRate(
         uint16_t frame,
         uint16_t seq,
@@ -723,6 +738,7 @@ ATLIBGS_MSG_ID_E AtLibGs_RFWaveTXStart(
         char ssid[]);
 
 uint8_t AtLibGs_ParseUDPClientCid(void);
+uint8_t AtLibGs_ParseDisconnect(void);
 uint8_t AtLibGs_ParseWlanConnStat(void);
 uint8_t AtLibGs_ParseNodeIPv4Address(ATLIBGS_IPv4 *ip);
 void AtLibGs_ParseIPv4Address(const char *line, ATLIBGS_IPv4 *ip);
@@ -731,6 +747,7 @@ uint8_t AtLibGs_ParseRssiResponse(int16_t *pRssi);
 uint8_t AtLibGs_ParseUDPServerStartResponse(uint8_t *pConnId);
 uint8_t AtLibGs_ParseTCPServerStartResponse(uint8_t *pConnId);
 uint8_t AtLibGs_ParseDNSLookupResponse(char *ipAddr);
+uint8_t AtLibGs_ParseGetTimeResponse(uint32_t *pSeconds, uint16_t *pMilliseconds);
 uint16_t AtLibGs_ParseIntoLines(char *text, char *pLines[], uint16_t maxLines);
 uint8_t AtLibGs_ParseIntoTokens(
         char *line,
@@ -740,6 +757,55 @@ uint8_t AtLibGs_ParseIntoTokens(
 ATLIBGS_SECURITYMODE_E AtLibGs_ParseSecurityMode(const char *string);
 void AtLibGs_ParseIPAddress(const char *string, ATLIBGS_IP *ip);
 
+/* Commands queued with AtLibGs_CommandQueue are sent one at a time by
+ * AtLibGs_CommandPoll. A command is complete when the matcher accepts a
+ * message read for it, NULL accepts the first one as
+ * AtLibGs_CommandSendString always did. Its text must stay valid until
+ * the done callback, which gets the message or
+ * ATLIBGS_MSG_ID_RESPONSE_TIMEOUT. */
+#define ATLIBGS_COMMAND_QUEUE_SIZE      4
+typedef bool (*ATLIBGS_COMMAND_MATCH)(ATLIBGS_MSG_ID_E msgId);
+typedef void (*ATLIBGS_COMMAND_DONE)(ATLIBGS_MSG_ID_E msgId, void *ctx);
+
+bool AtLibGs_CommandQueue(
+        const char *aString,
+        ATLIBGS_COMMAND_MATCH match,
+        uint32_t timeout,
+        ATLIBGS_COMMAND_DONE done,
+        void *ctx);
+void AtLibGs_CommandPoll(void);
+bool AtLibGs_CommandBusy(void);
+void AtLibGs_CommandDrain(void);
+void AtLibGs_SetIdleHook(void (*hook)(void));
+bool AtLibGs_CalcNStorePSKStart(
+        char *pSsid,
+        char *pPsk,
+        ATLIBGS_COMMAND_DONE done,
+        void *ctx);
+bool AtLibGs_AssocStart(
+        char *pSsid,
+        char *pBssid,
+        uint8_t channel,
+        ATLIBGS_COMMAND_DONE done,
+        void *ctx);
+
+/* Data received for a connection is handed to the data handler in spans
+ * that point straight into the receive FIFO, valid only for the call.
+ * Without one it goes to App_ProcessIncomingData a byte at a time. */
+typedef void (*ATLIBGS_DATA_HANDLER)(
+        uint8_t cid,
+        const uint8_t *data,
+        uint16_t len);
+void AtLibGs_SetDataHandler(ATLIBGS_DATA_HANDLER handler);
+
+/* Tells how many more bytes of a connection the data handler can keep.
+ * While it is fewer than 2 and data of that connection comes in,
+ * AtLibGs_ReceiveDataHandle leaves chunks in the receive FIFO, the module
+ * waits, and it returns ATLIBGS_MSG_ID_DATA_RX_FULL.  While waiting for a
+ * command's response the data is handed on as before. */
+typedef uint16_t (*ATLIBGS_DATA_ROOM)(uint8_t cid);
+void AtLibGs_SetDataRoom(ATLIBGS_DATA_ROOM room);
+
 ATLIBGS_MSG_ID_E AtLibGs_CommandSend(void);
 ATLIBGS_MSG_ID_E AtLibGs_CommandSendString(char *aString);
 void AtLibGs_DataSend(const void *pTxData, uint16_t dataLen);
@@ -760,7 +826,10 @@ ATLIBGS_MSG_ID_E AtLibGs_checkEOFMessage(const char *pBuffer);
 ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataHandle(uint32_t timeout);
 ATLIBGS_MSG_ID_E AtLibGs_ReceiveDataProcess(uint8_t rxData);
 ATLIBGS_MSG_ID_E AtLibGs_ResponseHandle(void);
-ATLIBGS_MSG_ID_E AtLibGs_ProcessRxChunk(const void *rxBuf, uint16_t bufLen);
+ATLIBGS_MSG_ID_E AtLibGs_ProcessRxChunk(
+        const void *rxBuf,
+        uint16_t bufLen,
+        uint16_t *usedLen);
 void AtLibGs_LinkCheck(void);
 void AtLibGs_FlushIncomingMessage(void);
 uint8_t AtLibGs_IsNodeResetDetected(void);
@@ -794,10 +863,12 @@ ATLIBGS_MSG_ID_E
 extern void AtLibGs_Init(void);
 
 // User supplied routines
-extern void App_ProcessIncomingData(uint8_t rxData);
+extern void App_ProcessIncomingData(uint8_t cid, uint8_t rxData);
 void App_DelayMS(uint32_t cnt);
 void App_Write(const void *txData, uint16_t dataLength);
 bool App_Read(uint8_t *rxData, uint16_t dataLength, uint8_t blockFlag);
+uint16_t App_ReadSpan(const uint8_t **rxSpan);
+void App_ReadConsume(uint16_t dataLength);
 ATLIBGS_MSG_ID_E AtLibGs_ConfigAntenna(uint8_t mode);
 uint8_t AtLibGs_ParseGetMacResponse(char *pMAC);
 #endif /* _GS_ATCMDLIB_H_ */
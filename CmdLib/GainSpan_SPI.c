@@ -354,6 +354,91 @@ bool GainSpan_SPI_ReceiveByte(uint8_t channel, uint8_t *aByte)
     return found;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  GainSpan_SPI_ReceiveData
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Get as many bytes out of the GainSpan_SPI receive FIFO buffer as
+ *      are waiting, up to a maximum.  Does not block.
+ * Inputs:
+ *      uint8_t channel -- SPI channel to update
+ *      uint8_t *aData -- Place to store the bytes
+ *      uint16_t aLen -- Maximum number of bytes
+ * Outputs:
+ *      uint16_t -- Number of bytes returned
+ *---------------------------------------------------------------------------*/
+uint16_t GainSpan_SPI_ReceiveData(uint8_t channel, uint8_t *aData, uint16_t aLen)
+{
+    uint16_t got = 0;
+    uint16_t n;
+
+    /* When looking for bytes, update the state */
+    GainSpan_SPI_Update(channel);
+
+    /* Copy out up to the end of the buffer, then from the start */
+    while ((got < aLen) && (G_GainSpan_SPI_RXIn != G_GainSpan_SPI_RXOut)) {
+        if (G_GainSpan_SPI_RXIn > G_GainSpan_SPI_RXOut)
+            n = G_GainSpan_SPI_RXIn - G_GainSpan_SPI_RXOut;
+        else
+            n = GAINSPAN_SPI_RX_BUFFER_SIZE - G_GainSpan_SPI_RXOut;
+        if (n > aLen - got)
+            n = aLen - got;
+        memcpy(&aData[got], &G_GainSpan_SPI_RXBuffer[G_GainSpan_SPI_RXOut], n);
+        got += n;
+        G_GainSpan_SPI_RXOut += n;
+        if (G_GainSpan_SPI_RXOut >= GAINSPAN_SPI_RX_BUFFER_SIZE)
+            G_GainSpan_SPI_RXOut = 0;
+    }
+
+    return got;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  GainSpan_SPI_ReceiveSpan
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Point at the bytes waiting in the GainSpan_SPI receive FIFO buffer
+ *      without taking them out.  Only the bytes up to the end of the
+ *      buffer are returned, the rest follow once these are consumed.
+ * Inputs:
+ *      uint8_t channel -- SPI channel to update
+ *      const uint8_t **aSpan -- Returned pointer to the first byte
+ * Outputs:
+ *      uint16_t -- Number of bytes at *aSpan, 0 if none
+ *---------------------------------------------------------------------------*/
+uint16_t GainSpan_SPI_ReceiveSpan(uint8_t channel, const uint8_t **aSpan)
+{
+    uint16_t in;
+
+    /* When looking for bytes, update the state */
+    GainSpan_SPI_Update(channel);
+
+    in = G_GainSpan_SPI_RXIn;
+    *aSpan = &G_GainSpan_SPI_RXBuffer[G_GainSpan_SPI_RXOut];
+    if (in >= G_GainSpan_SPI_RXOut)
+        return in - G_GainSpan_SPI_RXOut;
+
+    return GAINSPAN_SPI_RX_BUFFER_SIZE - G_GainSpan_SPI_RXOut;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  GainSpan_SPI_ReceiveConsume
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Take bytes returned by GainSpan_SPI_ReceiveSpan out of the receive
+ *      FIFO buffer, freeing their space.
+ * Inputs:
+ *      uint16_t aLen -- Number of bytes, no more than the span returned
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void GainSpan_SPI_ReceiveConsume(uint16_t aLen)
+{
+    G_GainSpan_SPI_RXOut += aLen;
+    if (G_GainSpan_SPI_RXOut >= GAINSPAN_SPI_RX_BUFFER_SIZE)
+        G_GainSpan_SPI_RXOut -= GAINSPAN_SPI_RX_BUFFER_SIZE;
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  GainSpan_SPI_SendByteLowLevel
  *---------------------------------------------------------------------------*
@@ -441,12 +526,44 @@ bool GainSpan_SPI_SendByte(uint8_t aByte)
     return placed;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  GainSpan_SPI_IsSpecialChar
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Determine if a byte has to be sent as an escape code.
+ * Inputs:
+ *      uint8_t aByte -- Byte to send
+ * Outputs:
+ *      bool -- true if the byte is one of the special characters
+ *---------------------------------------------------------------------------*/
+static bool GainSpan_SPI_IsSpecialChar(uint8_t aByte)
+{
+    /* All of them but one are at the top */
+    if ((aByte < GAINSPAN_SPI_CHAR_LINK_READY)
+            && (aByte != GAINSPAN_SPI_CHAR_INACTIVE_LINK))
+        return false;
+
+    switch (aByte) {
+        case GAINSPAN_SPI_CHAR_IDLE:
+        case GAINSPAN_SPI_CHAR_ESC:
+        case GAINSPAN_SPI_CHAR_FLOW_CONTROL_ON:
+        case GAINSPAN_SPI_CHAR_FLOW_CONTROL_OFF:
+        case GAINSPAN_SPI_CHAR_INACTIVE_LINK:
+        case GAINSPAN_SPI_CHAR_INACTIVE_LINK2:
+        case GAINSPAN_SPI_CHAR_LINK_READY:
+            return true;
+        default:
+            return false;
+    }
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  GainSpan_SPI_SendData
  *---------------------------------------------------------------------------*
  * Description:
  *      Send an array of data bytes out the transmit FIFO.  This routine
- *      does not block and returns the number of bytes sent.
+ *      does not block and returns the number of bytes sent.  Runs of
+ *      bytes that need no translation are copied in a block at a time.
  * Inputs:
  *      const uint8_t *aData -- data to send
  *      uint16_t aLen -- Number of bytes to send.
@@ -455,12 +572,38 @@ bool GainSpan_SPI_SendByte(uint8_t aByte)
  *---------------------------------------------------------------------------*/
 uint16_t GainSpan_SPI_SendData(const uint8_t *aData, uint16_t aLen)
 {
-    uint16_t i;
+    uint16_t i = 0;
+    uint16_t room;
+    uint16_t n;
+
+    while (i < aLen) {
+        /* How much room is there up to the end of the buffer? */
+        if (G_GainSpan_SPI_TXOut > G_GainSpan_SPI_TXIn) {
+            room = G_GainSpan_SPI_TXOut - G_GainSpan_SPI_TXIn - 1;
+        } else {
+            room = GAINSPAN_SPI_TX_BUFFER_SIZE - G_GainSpan_SPI_TXIn;
+            if (G_GainSpan_SPI_TXOut == 0)
+                room--;
+        }
 
-    /* Send each byte one at a time unless out of space */
-    for (i = 0; i < aLen; ++i) {
+        /* Copy in the bytes up to the next special one */
+        for (n = 0; (n < room) && (i + n < aLen); n++) {
+            if (GainSpan_SPI_IsSpecialChar(aData[i + n]))
+                break;
+        }
+        if (n) {
+            memcpy(G_GainSpan_SPI_TXBuffer + G_GainSpan_SPI_TXIn, &aData[i], n);
+            G_GainSpan_SPI_TXIn += n;
+            if (G_GainSpan_SPI_TXIn >= GAINSPAN_SPI_TX_BUFFER_SIZE)
+                G_GainSpan_SPI_TXIn = 0;
+            i += n;
+            continue;
+        }
+
+        /* A special byte, or no room left, one at a time unless out of space */
         if (!GainSpan_SPI_SendByte(aData[i]))
             break;
+        i++;
     }
 
     /* Return the number of bytes that did get into the transmit FIFO */
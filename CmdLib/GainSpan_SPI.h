@@ -36,6 +36,9 @@
 void GainSpan_SPI_Start(void);
 void GainSpan_SPI_Stop(void);
 bool GainSpan_SPI_ReceiveByte(uint8_t channel, uint8_t *aByte);
+uint16_t GainSpan_SPI_ReceiveData(uint8_t channel, uint8_t *aData, uint16_t aLen);
+uint16_t GainSpan_SPI_ReceiveSpan(uint8_t channel, const uint8_t **aSpan);
+void GainSpan_SPI_ReceiveConsume(uint16_t aLen);
 bool GainSpan_SPI_SendByte(uint8_t aByte);
 uint16_t GainSpan_SPI_SendData(const uint8_t *aData, uint16_t aLen);
 void GainSpan_SPI_SendDataBlock(uint8_t channel, const uint8_t *aData, uint16_t aLen);
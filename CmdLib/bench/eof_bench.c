@@ -0,0 +1,428 @@
+/*-------------------------------------------------------------------------*
+ * File:  eof_bench.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Times AtLibGs_checkEOFMessage on a host over the module output in
+ *     eof_corpus.txt.  The lines are put in a buffer the way the receive
+ *     state machine puts them in MRBuffer, and each is classified two
+ *     ways:
+ *       strstr -- the search of the whole buffer for each message the
+ *                 library did before the G_eofMessages table, kept here
+ *                 as BenchStrstrCheck
+ *       table  -- AtLibGs_checkEOFMessage on the newest line
+ *     The two must agree except where the older code took
+ *     "ERROR: IP CONFIG FAIL" and "ERROR: SOCKET FAILURE" for ERROR.
+ *     Built and run from the top of the tree:
+ *
+ *       cc -O2 -ICmdLib/bench -I. -IYRDKRL78G14 -o eof_bench \
+ *          CmdLib/bench/eof_bench.c CmdLib/AtCmdLib.c Apps/Datasources.c \
+ *          sensors/FixedPoint.c
+ *       ./eof_bench -f CmdLib/bench/eof_corpus.txt -n 100000
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include <system/platform.h>
+#include <CmdLib/AtCmdLib.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define BENCH_MAX_LINES         512
+#define BENCH_MAX_LINE          126     /* leaves room for the CR LF */
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+/* The corpus, each line with its CR LF */
+static char G_lines[BENCH_MAX_LINES][BENCH_MAX_LINE + 3];
+static uint16_t G_numLines;
+
+/* Stands in for MRBuffer */
+static char G_buffer[ATLIBGS_RX_CMD_MAX_SIZE];
+
+/* Referenced by the GSLink code in AtCmdLib.c */
+int16_t gAccData[3];
+int16_t gTemp_F;
+uint16_t gAmbientLight;
+uint8_t gSetLight_onoff;
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+static bool BenchLoad(const char *path);
+static ATLIBGS_MSG_ID_E BenchStrstrCheck(const char *pBuffer);
+static uint32_t BenchPass(bool table, bool compare);
+static void BenchRun(const char *name, bool table, uint32_t passes);
+static double BenchNow(void);
+static uint64_t BenchCycles(void);
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Check that both ways classify the corpus alike, then time them.
+ * Inputs:
+ *      -f corpus file, -n passes over it
+ * Outputs:
+ *      int -- 0 if the results agreed, else 1
+ *---------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    const char *path = "CmdLib/bench/eof_corpus.txt";
+    uint32_t passes = 100000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:n:")) != -1) {
+        if (opt == 'f') {
+            path = optarg;
+        } else if (opt == 'n') {
+            passes = atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-f corpus] [-n passes]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (!BenchLoad(path))
+        return 1;
+
+    if (BenchPass(true, true))
+        return 1;
+
+    printf("%u lines, %u passes\n", G_numLines, passes);
+    printf("%-8s %12s %12s\n", "check", "Mlines/s", "cycles/line");
+    BenchRun("strstr", false, passes);
+    BenchRun("table", true, passes);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchLoad
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Read the corpus, leaving out the lines starting with #, and end
+ *      each line with CR LF as the module does.
+ * Inputs:
+ *      const char *path -- Corpus file
+ * Outputs:
+ *      bool -- true if it was read
+ *---------------------------------------------------------------------------*/
+static bool BenchLoad(const char *path)
+{
+    char line[BENCH_MAX_LINE + 3];
+    FILE *fp;
+    size_t len;
+
+    fp = fopen(path, "r");
+    if (!fp) {
+        perror(path);
+        return false;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        len = strcspn(line, "\r\n");
+        if (line[0] == '#')
+            continue;
+        if ((len > BENCH_MAX_LINE) || (G_numLines == BENCH_MAX_LINES)) {
+            fprintf(stderr, "%s: lines of up to %d bytes, %d of them\n",
+                    path, BENCH_MAX_LINE, BENCH_MAX_LINES);
+            fclose(fp);
+            return false;
+        }
+        memcpy(G_lines[G_numLines], line, len);
+        strcpy(&G_lines[G_numLines][len], "\r\n");
+        G_numLines++;
+    }
+    fclose(fp);
+
+    return true;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchStrstrCheck
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      AtLibGs_checkEOFMessage as it was before the G_eofMessages table,
+ *      searching the whole of the buffer for each message in turn.
+ * Inputs:
+ *      const char *pBuffer -- Everything received since the response began
+ * Outputs:
+ *      ATLIBGS_MSG_ID_E -- Message found, ATLIBGS_MSG_ID_NONE if none
+ *---------------------------------------------------------------------------*/
+static ATLIBGS_MSG_ID_E BenchStrstrCheck(const char *pBuffer)
+{
+    const char *p;
+    uint8_t numSpaces;
+
+    if ((strstr((const char *)pBuffer, "OK") != NULL)) {
+        return ATLIBGS_MSG_ID_OK;
+    } else if ((strstr((const char *)pBuffer, "ERROR") != NULL)) {
+        return ATLIBGS_MSG_ID_ERROR;
+    } else if ((strstr((const char *)pBuffer, "INVALID INPUT") != NULL)) {
+        return ATLIBGS_MSG_ID_INVALID_INPUT;
+    } else if ((strstr((const char *)pBuffer, "DISASSOCIATED") != NULL)) {
+        AtLibGs_ClearNodeAssociationFlag();
+        return ATLIBGS_MSG_ID_DISASSOCIATION_EVENT;
+    } else if ((strstr((const char *)pBuffer, "ERROR: IP CONFIG FAIL") != NULL)) {
+        return ATLIBGS_MSG_ID_ERROR_IP_CONFIG_FAIL;
+    } else if (strstr((const char *)pBuffer, "ERROR: SOCKET FAILURE") != NULL) {
+        return ATLIBGS_MSG_ID_ERROR_SOCKET_FAIL;
+    } else if ((strstr((const char *)pBuffer, "APP Reset-APP SW Reset"))
+            != NULL) {
+        AtLibGs_ClearNodeAssociationFlag();
+        AtLibGs_SetNodeResetFlag();
+        return ATLIBGS_MSG_ID_APP_RESET;
+    } else if ((strstr((const char *)pBuffer, "DISCONNECT")) != NULL) {
+        return ATLIBGS_MSG_ID_DISCONNECT;
+    } else if ((strstr((const char *)pBuffer, "Disassociation Event")) != NULL) {
+        AtLibGs_ClearNodeAssociationFlag();
+        return ATLIBGS_MSG_ID_DISASSOCIATION_EVENT;
+    } else if ((strstr((const char *)pBuffer, "Out of StandBy-Alarm")) != NULL) {
+        return ATLIBGS_MSG_ID_OUT_OF_STBY_ALARM;
+    } else if ((strstr((const char *)pBuffer, "Out of StandBy-Timer")) != NULL) {
+        return ATLIBGS_MSG_ID_OUT_OF_STBY_TIMER;
+    } else if ((strstr((const char *)pBuffer, "UnExpected Warm Boot")) != NULL) {
+        AtLibGs_ClearNodeAssociationFlag();
+        AtLibGs_SetNodeResetFlag();
+        return ATLIBGS_MSG_ID_UNEXPECTED_WARM_BOOT;
+    } else if ((strstr((const char *)pBuffer, "Out of Deep Sleep")) != NULL) {
+        return ATLIBGS_MSG_ID_OUT_OF_DEEP_SLEEP;
+    } else if ((strstr((const char *)pBuffer, "Serial2WiFi APP")) != NULL) {
+        AtLibGs_ClearNodeAssociationFlag();
+        AtLibGs_SetNodeResetFlag();
+        return ATLIBGS_MSG_ID_WELCOME_MSG;
+    } else if ((pBuffer[0] == 'A') && (pBuffer[1] == 'T')
+            && (pBuffer[2] == '+')) {
+        return ATLIBGS_MSG_ID_NONE;
+    } else if (strstr((const char *)pBuffer, "CONNECT ") != NULL) {
+        p = pBuffer;
+        numSpaces = 0;
+        while ((*p) && (*p != '\n')) {
+            if (*p == ' ')
+                numSpaces++;
+            if (numSpaces >= 4)
+                return ATLIBGS_MSG_ID_TCP_SERVER_CONNECT;
+            p++;
+        }
+    }
+
+    return ATLIBGS_MSG_ID_NONE;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchPass
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Classify every line of the corpus once.  As in
+ *      AtLibGs_ReceiveDataProcess, empty lines before a response are
+ *      skipped, the lines of a response gather in the buffer, and a
+ *      message ends the response.  When comparing, the strstr result
+ *      is checked against the table's for each line.
+ * Inputs:
+ *      bool table -- true for AtLibGs_checkEOFMessage, false for strstr
+ *      bool compare -- true to compare the two and print what differs
+ * Outputs:
+ *      uint32_t -- Lines classified differently, other than the two
+ *                  ERROR variants
+ *---------------------------------------------------------------------------*/
+static uint32_t BenchPass(bool table, bool compare)
+{
+    ATLIBGS_MSG_ID_E msgId;
+    ATLIBGS_MSG_ID_E old;
+    uint16_t index = 0;
+    uint16_t lineStart = 0;
+    uint16_t len;
+    uint16_t i;
+    uint32_t differ = 0;
+
+    for (i = 0; i < G_numLines; i++) {
+        if ((index == 0) && (G_lines[i][0] == '\r'))
+            continue;
+        len = strlen(G_lines[i]);
+        if (index + len >= sizeof(G_buffer))
+            index = lineStart = 0;
+        memcpy(&G_buffer[index], G_lines[i], len + 1);
+        index += len;
+
+        if (table)
+            msgId = AtLibGs_checkEOFMessage(&G_buffer[lineStart]);
+        else
+            msgId = BenchStrstrCheck(G_buffer);
+
+        if (compare) {
+            old = BenchStrstrCheck(G_buffer);
+            if (old != msgId) {
+                printf("line %u: strstr %d, table %d: %s", i, old, msgId,
+                        G_lines[i]);
+                if ((old != ATLIBGS_MSG_ID_ERROR)
+                        || ((msgId != ATLIBGS_MSG_ID_ERROR_IP_CONFIG_FAIL)
+                        && (msgId != ATLIBGS_MSG_ID_ERROR_SOCKET_FAIL)))
+                    differ++;
+            }
+        }
+
+        if (msgId != ATLIBGS_MSG_ID_NONE)
+            index = 0;
+        lineStart = index;
+    }
+
+    return differ;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchRun
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Time a number of passes over the corpus one way.
+ * Inputs:
+ *      const char *name -- Printed with the results
+ *      bool table -- true for AtLibGs_checkEOFMessage, false for strstr
+ *      uint32_t passes -- Passes over the corpus
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void BenchRun(const char *name, bool table, uint32_t passes)
+{
+    double lines = (double)passes * G_numLines;
+    double start;
+    uint64_t cycles;
+    uint32_t n;
+
+    start = BenchNow();
+    cycles = BenchCycles();
+    for (n = 0; n < passes; n++)
+        BenchPass(table, false);
+    cycles = BenchCycles() - cycles;
+    start = BenchNow() - start;
+
+    printf("%-8s %12.1f %12.0f\n", name, lines / start / 1e6,
+            cycles / lines);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchNow, BenchCycles
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Monotonic time, and the time stamp counter where there is one.
+ *      Elsewhere the cycle count reads 0.
+ * Outputs:
+ *      double -- seconds; uint64_t -- cycles
+ *---------------------------------------------------------------------------*/
+static double BenchNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+static uint64_t BenchCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  MSTimerGet, MSTimerDelta, MSTimerDelay, App_DelayMS, App_Write,
+ *           App_Read, App_ReadSpan, App_ReadConsume, App_ProcessIncomingData
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      What else AtCmdLib.c links against, nothing is sent or received
+ *      in this bench.
+ *---------------------------------------------------------------------------*/
+uint32_t MSTimerGet(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+uint32_t MSTimerDelta(uint32_t start)
+{
+    return MSTimerGet() - start;
+}
+
+void MSTimerDelay(uint32_t ms)
+{
+    usleep(ms * 1000);
+}
+
+void App_DelayMS(uint32_t cnt)
+{
+    MSTimerDelay(cnt);
+}
+
+void App_Write(const void *txData, uint16_t dataLength)
+{
+    (void)txData;
+    (void)dataLength;
+}
+
+bool App_Read(uint8_t *rxData, uint16_t dataLength, uint8_t blockFlag)
+{
+    (void)rxData;
+    (void)dataLength;
+    (void)blockFlag;
+
+    return false;
+}
+
+uint16_t App_ReadSpan(const uint8_t **rxSpan)
+{
+    *rxSpan = 0;
+
+    return 0;
+}
+
+void App_ReadConsume(uint16_t dataLength)
+{
+    (void)dataLength;
+}
+
+void App_ProcessIncomingData(uint8_t cid, uint8_t rxData)
+{
+    (void)cid;
+    (void)rxData;
+}
+
+uint8_t EEPROM_Write(uint16_t offset, uint8_t *aData, uint16_t aSize)
+{
+    (void)offset;
+    (void)aData;
+    (void)aSize;
+
+    return 0;
+}
+
+void GS_UARTTransfer(uint8_t *aData, uint32_t aLen)
+{
+    (void)aData;
+    (void)aLen;
+}
+
+void ApplyLedCtrl(const char *value, uint8_t len)
+{
+    (void)value;
+    (void)len;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  eof_bench.c
+ *-------------------------------------------------------------------------*/
@@ -0,0 +1,458 @@
+/*-------------------------------------------------------------------------*
+ * File:  rx_bench.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Times the receive path of AtCmdLib on a host.  A simulated module
+ *     fills a receive FIFO like the one in GainSpan_SPI.c, a few bytes
+ *     per update, with ESC S and ESC Z data frames for four connections.
+ *     Three ways of taking them in are timed:
+ *       byte  -- App_Read and AtLibGs_ReceiveDataProcess a byte at a time,
+ *                the data goes to App_ProcessIncomingData
+ *       chunk -- AtLibGs_ReceiveDataHandle, which feeds what the FIFO
+ *                holds to AtLibGs_ProcessRxChunk, same destination
+ *       span  -- the same with a data handler set, which is given the
+ *                data in spans of the FIFO
+ *     Built and run from the top of the tree:
+ *
+ *       cc -O2 -ICmdLib/bench -I. -IYRDKRL78G14 -o rx_bench \
+ *          CmdLib/bench/rx_bench.c CmdLib/AtCmdLib.c Apps/Datasources.c \
+ *          sensors/FixedPoint.c
+ *       ./rx_bench -m 64 -s 512 -t 16
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <system/platform.h>
+#include <CmdLib/AtCmdLib.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define BENCH_FIFO_SIZE         GAINSPAN_SPI_RX_BUFFER_SIZE
+#define BENCH_MAX_PAYLOAD       1400    /* a TCP segment */
+#define BENCH_FRAMES            64      /* frames in the replayed stream */
+#define BENCH_CIDS              4       /* connections they are spread on */
+#define BENCH_STREAM_MAX        (BENCH_FRAMES * (BENCH_MAX_PAYLOAD * 2 + 8))
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+/* What the module sends, replayed from the start when it runs out */
+static uint8_t G_stream[BENCH_STREAM_MAX];
+static uint32_t G_streamLen;
+static uint32_t G_streamPos;
+static uint32_t G_streamData;       /* data bytes in one replay */
+static uint32_t G_streamSum;        /* and their sum */
+
+/* Receive FIFO, filled by BenchUpdate like GainSpan_SPI_Update does */
+static uint8_t G_fifo[BENCH_FIFO_SIZE];
+static uint16_t G_fifoIn;
+static uint16_t G_fifoOut;
+static uint16_t G_transfer = 16;    /* bytes the module returns per update */
+static uint32_t G_updates;
+
+/* Where the connections keep their data */
+static uint8_t G_sink[BENCH_CIDS][BENCH_MAX_PAYLOAD];
+static uint16_t G_sinkLen[BENCH_CIDS];
+static uint32_t G_received;
+static uint32_t G_receivedSum;
+static bool G_summing;            /* add up the first replay */
+
+/* Referenced by the GSLink code in AtCmdLib.c */
+int16_t gAccData[3];
+int16_t gTemp_F;
+uint16_t gAmbientLight;
+uint8_t gSetLight_onoff;
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+static void BenchBuildStream(uint16_t payload);
+static void BenchUpdate(void);
+static void BenchSpan(uint8_t cid, const uint8_t *data, uint16_t len);
+static void BenchRun(const char *name, bool chunked,
+        ATLIBGS_DATA_HANDLER handler, uint32_t bytes, bool summing);
+static double BenchNow(void);
+
+/*---------------------------------------------------------------------------*
+ * Routine:  main
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Check that each way delivers the stream intact, then time them.
+ * Inputs:
+ *      -m MB of data to receive, -s payload bytes per frame,
+ *      -t bytes per update
+ * Outputs:
+ *      int -- 0 if the data came through intact, else 1
+ *---------------------------------------------------------------------------*/
+int main(int argc, char *argv[])
+{
+    uint32_t megabytes = 64;
+    uint16_t payload = 512;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "m:s:t:")) != -1) {
+        if (opt == 'm') {
+            megabytes = atoi(optarg);
+        } else if (opt == 's') {
+            payload = atoi(optarg);
+        } else if (opt == 't') {
+            G_transfer = atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-m MB] [-s payload] [-t transfer]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if ((payload == 0) || (payload > BENCH_MAX_PAYLOAD) || (G_transfer == 0)
+            || (G_transfer >= BENCH_FIFO_SIZE)) {
+        fprintf(stderr, "payload 1 to %d, transfer 1 to %d bytes\n",
+                BENCH_MAX_PAYLOAD, BENCH_FIFO_SIZE - 1);
+        return 1;
+    }
+
+    BenchBuildStream(payload);
+
+    /* One replay summed each way, they must all get every byte */
+    BenchRun(0, false, 0, G_streamData, true);
+    if (G_receivedSum != G_streamSum)
+        return 1;
+    BenchRun(0, true, 0, G_streamData, true);
+    if (G_receivedSum != G_streamSum)
+        return 1;
+    BenchRun(0, true, BenchSpan, G_streamData, true);
+    if (G_receivedSum != G_streamSum)
+        return 1;
+
+    printf("payload %u bytes, %u bytes per update\n", payload, G_transfer);
+    printf("%-8s %10s %10s %12s\n", "path", "MB/s", "ns/byte", "updates/KB");
+    BenchRun("byte", false, 0, megabytes << 20, false);
+    BenchRun("chunk", true, 0, megabytes << 20, false);
+    BenchRun("span", true, BenchSpan, megabytes << 20, false);
+
+    return 0;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchBuildStream
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Build the frames the module sends, alternating ESC S and ESC Z
+ *      across the connections.  Payloads are random bytes, an ESC in an
+ *      ESC S frame is never followed by an E.
+ * Inputs:
+ *      uint16_t payload -- Data bytes per frame
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void BenchBuildStream(uint16_t payload)
+{
+    uint8_t *p = G_stream;
+    uint8_t c;
+    uint16_t i;
+    uint8_t frame;
+
+    srand(1);
+    for (frame = 0; frame < BENCH_FRAMES; frame++) {
+        *p++ = ATLIBGS_ESC_CHAR;
+        if (frame & 1) {
+            p += sprintf((char *)p, "%c%x%04u",
+                    ATLIBGS_DATA_MODE_BULK_START_CHAR_Z,
+                    frame % BENCH_CIDS, payload);
+        } else {
+            *p++ = ATLIBGS_DATA_MODE_NORMAL_START_CHAR_S;
+            *p++ = '0' + (frame % BENCH_CIDS);
+        }
+        for (i = 0; i < payload; i++) {
+            c = rand();
+            if (!(frame & 1) && (i > 0) && (p[-1] == ATLIBGS_ESC_CHAR)
+                    && (c == ATLIBGS_DATA_MODE_NORMAL_END_CHAR_E))
+                c++;
+            *p++ = c;
+            G_streamSum += c;
+        }
+        if (!(frame & 1)) {
+            *p++ = ATLIBGS_ESC_CHAR;
+            *p++ = ATLIBGS_DATA_MODE_NORMAL_END_CHAR_E;
+        }
+        G_streamData += payload;
+    }
+    G_streamLen = p - G_stream;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchUpdate
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Put the next bytes of the stream in the receive FIFO, as many as
+ *      one transfer returns and there is space for.
+ * Inputs:
+ *      void
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void BenchUpdate(void)
+{
+    uint16_t n = G_transfer;
+    uint16_t next;
+
+    G_updates++;
+    while (n--) {
+        next = G_fifoIn + 1;
+        if (next >= BENCH_FIFO_SIZE)
+            next = 0;
+        if (next == G_fifoOut)
+            break;
+        G_fifo[G_fifoIn] = G_stream[G_streamPos++];
+        if (G_streamPos >= G_streamLen)
+            G_streamPos = 0;
+        G_fifoIn = next;
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchSpan, App_ProcessIncomingData
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Copy received data into its connection's buffer, starting over
+ *      when it is full as if the application had read it.
+ * Inputs:
+ *      uint8_t cid -- Connection the data is for
+ *      const uint8_t *data, uint16_t len -- Bytes received
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void BenchSpan(uint8_t cid, const uint8_t *data, uint16_t len)
+{
+    uint16_t n;
+    uint16_t i;
+
+    if (cid >= BENCH_CIDS)
+        return;
+    if (G_summing) {
+        /* Only one replay, a chunk may run on into the next */
+        for (i = 0; (i < len) && (G_received + i < G_streamData); i++)
+            G_receivedSum += data[i];
+    }
+    G_received += len;
+    while (len) {
+        if (G_sinkLen[cid] == BENCH_MAX_PAYLOAD)
+            G_sinkLen[cid] = 0;
+        n = BENCH_MAX_PAYLOAD - G_sinkLen[cid];
+        if (n > len)
+            n = len;
+        memcpy(&G_sink[cid][G_sinkLen[cid]], data, n);
+        G_sinkLen[cid] += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void App_ProcessIncomingData(uint8_t cid, uint8_t rxData)
+{
+    if (cid >= BENCH_CIDS)
+        return;
+    if (G_summing && (G_received < G_streamData))
+        G_receivedSum += rxData;
+    G_received++;
+    if (G_sinkLen[cid] == BENCH_MAX_PAYLOAD)
+        G_sinkLen[cid] = 0;
+    G_sink[cid][G_sinkLen[cid]++] = rxData;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  App_Read, App_ReadSpan, App_ReadConsume
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      The SPI versions in App_Common.c over the simulated FIFO.  Each
+ *      look at the FIFO updates it first, as GainSpan_SPI_ReceiveData and
+ *      GainSpan_SPI_ReceiveSpan do.
+ *---------------------------------------------------------------------------*/
+bool App_Read(uint8_t *rxData, uint16_t dataLength, uint8_t blockFlag)
+{
+    bool got_data = false;
+    uint16_t got;
+    uint16_t n;
+
+    while (dataLength) {
+        BenchUpdate();
+        got = 0;
+        while ((got < dataLength) && (G_fifoIn != G_fifoOut)) {
+            if (G_fifoIn > G_fifoOut)
+                n = G_fifoIn - G_fifoOut;
+            else
+                n = BENCH_FIFO_SIZE - G_fifoOut;
+            if (n > dataLength - got)
+                n = dataLength - got;
+            memcpy(&rxData[got], &G_fifo[G_fifoOut], n);
+            got += n;
+            G_fifoOut += n;
+            if (G_fifoOut >= BENCH_FIFO_SIZE)
+                G_fifoOut = 0;
+        }
+        if (got) {
+            rxData += got;
+            dataLength -= got;
+            got_data = true;
+        } else {
+            if (!blockFlag)
+                break;
+        }
+    }
+
+    return got_data;
+}
+
+uint16_t App_ReadSpan(const uint8_t **rxSpan)
+{
+    uint16_t in;
+
+    BenchUpdate();
+    in = G_fifoIn;
+    *rxSpan = &G_fifo[G_fifoOut];
+    if (in >= G_fifoOut)
+        return in - G_fifoOut;
+
+    return BENCH_FIFO_SIZE - G_fifoOut;
+}
+
+void App_ReadConsume(uint16_t dataLength)
+{
+    G_fifoOut += dataLength;
+    if (G_fifoOut >= BENCH_FIFO_SIZE)
+        G_fifoOut -= BENCH_FIFO_SIZE;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchRun
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Feed the stream through the receive machine from the start until
+ *      the connections have the given number of bytes.
+ * Inputs:
+ *      const char *name -- Printed with the results, 0 to print nothing
+ *      bool chunked -- true to go through AtLibGs_ReceiveDataHandle
+ *      ATLIBGS_DATA_HANDLER handler -- Data handler, 0 for a byte at a time
+ *      uint32_t bytes -- Data bytes to receive
+ *      bool summing -- true to add up the bytes received
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+static void BenchRun(const char *name, bool chunked,
+        ATLIBGS_DATA_HANDLER handler, uint32_t bytes, bool summing)
+{
+    uint8_t rxData;
+    double start;
+    double ns;
+
+    G_streamPos = 0;
+    G_fifoIn = G_fifoOut = 0;
+    G_updates = 0;
+    G_received = 0;
+    G_receivedSum = 0;
+    G_summing = summing;
+    memset(G_sinkLen, 0, sizeof(G_sinkLen));
+    AtLibGs_SetDataHandler(handler);
+
+    start = BenchNow();
+    while (G_received < bytes) {
+        if (chunked)
+            AtLibGs_ReceiveDataHandle(1000);
+        else if (App_Read(&rxData, 1, 0))
+            AtLibGs_ReceiveDataProcess(rxData);
+    }
+    ns = (BenchNow() - start) * 1e9;
+
+    if (name) {
+        printf("%-8s %10.1f %10.2f %12.1f\n", name,
+                G_received / ns * 1e3, ns / G_received,
+                G_updates * 1024.0 / G_received);
+    }
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  BenchNow
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Monotonic time, MSTimerGet is too coarse.
+ * Outputs:
+ *      double -- seconds
+ *---------------------------------------------------------------------------*/
+static double BenchNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  MSTimerGet, MSTimerDelta, MSTimerDelay, App_DelayMS, App_Write
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      What else AtCmdLib.c links against, nothing is sent in this bench.
+ *---------------------------------------------------------------------------*/
+uint32_t MSTimerGet(void)
+{
+    struct timespec now;
+
+    /* As cheap to read as the board's millisecond counter */
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+uint32_t MSTimerDelta(uint32_t start)
+{
+    return MSTimerGet() - start;
+}
+
+void MSTimerDelay(uint32_t ms)
+{
+    usleep(ms * 1000);
+}
+
+void App_DelayMS(uint32_t cnt)
+{
+    MSTimerDelay(cnt);
+}
+
+void App_Write(const void *txData, uint16_t dataLength)
+{
+    (void)txData;
+    (void)dataLength;
+}
+
+uint8_t EEPROM_Write(uint16_t offset, uint8_t *aData, uint16_t aSize)
+{
+    (void)offset;
+    (void)aData;
+    (void)aSize;
+
+    return 0;
+}
+
+void GS_UARTTransfer(uint8_t *aData, uint32_t aLen)
+{
+    (void)aData;
+    (void)aLen;
+}
+
+void ApplyLedCtrl(const char *value, uint8_t len)
+{
+    (void)value;
+    (void)len;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  rx_bench.c
+ *-------------------------------------------------------------------------*/
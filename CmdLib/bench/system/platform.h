@@ -0,0 +1,44 @@
+/*-------------------------------------------------------------------------*
+ * File:  platform.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Host stand-in for YRDKRL78G14/system/platform.h with only what
+ *     AtCmdLib.c needs to build into rx_bench, and App_Common.c into
+ *     exosite/bench/hal_bench.  The GainSpan_UART calls are functions of
+ *     the bench rather than macros for the board's UART2.
+ *-------------------------------------------------------------------------*/
+#ifndef PLATFORM_H_
+#define PLATFORM_H_
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <inttypes.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+#define _F8_ "%d"
+#define _F16_ "%d"
+#define _F32_ "%" PRIu32
+
+#define APP_MAX_RECEIVED_DATA           (256)
+#define ATLIBGS_TX_CMD_MAX_SIZE         (256)
+#define ATLIBGS_RX_CMD_MAX_SIZE         (512)
+#define GAINSPAN_SPI_RX_BUFFER_SIZE     (256)
+#define GAINSPAN_SPI_TX_BUFFER_SIZE     (128)
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+uint8_t EEPROM_Write(uint16_t offset, uint8_t *aData, uint16_t aSize);
+uint32_t GainSpan_UART_SendData(const uint8_t *aData, uint32_t aLen);
+uint16_t GainSpan_UART_ReceiveData(uint8_t *aData, uint16_t aLen);
+uint16_t GainSpan_UART_ReceiveSpan(const uint8_t **aSpan);
+void GainSpan_UART_ReceiveConsume(uint16_t aLen);
+
+#endif // PLATFORM_H_
+/*-------------------------------------------------------------------------*
+ * End of File:  platform.h
+ *-------------------------------------------------------------------------*/
@@ -4,6 +4,7 @@
  * Description:
  *     FIFO driven UART2 driver for RL78.
  *-------------------------------------------------------------------------*/
+#include <string.h>
 #include <system/platform.h>
 #include "SAU.h"
 #include "UART2.h"
@@ -225,6 +226,104 @@ bool UART2_ReceiveByte(uint8_t *aByte)
     return found;
 }
 
+/*---------------------------------------------------------------------------*
+ * Routine:  UART2_ReceiveData
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Retrieve as many waiting bytes from the receive FIFO as there are,
+ *      up to a maximum.
+ * Inputs:
+ *      uint8_t *aData -- Place to store the received bytes
+ *      uint16_t aLen -- Maximum number of bytes
+ * Outputs:
+ *      uint16_t -- Number of bytes returned
+ *---------------------------------------------------------------------------*/
+uint16_t UART2_ReceiveData(uint8_t *aData, uint16_t aLen)
+{
+    uint16_t got = 0;
+    uint16_t n;
+    uint16_t in;
+
+    /* Disable interrupts while a check is made */
+    SRMK2 = 1U;
+    in = G_UART2_RXIn;
+    SRMK2 = 0U;
+
+    /* Copy out up to the end of the FIFO, then from the start */
+    while ((got < aLen) && (in != G_UART2_RXOut)) {
+        if (in > G_UART2_RXOut)
+            n = in - G_UART2_RXOut;
+        else
+            n = UART2_RX_BUFFER_SIZE - G_UART2_RXOut;
+        if (n > aLen - got)
+            n = aLen - got;
+        memcpy(&aData[got], &G_UART2_RXBuffer[G_UART2_RXOut], n);
+        got += n;
+
+        /* Free the space for the interrupt */
+        n += G_UART2_RXOut;
+        if (n >= UART2_RX_BUFFER_SIZE)
+            n = 0;
+        SRMK2 = 1U;
+        G_UART2_RXOut = n;
+        SRMK2 = 0U;
+    }
+
+    return got;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  UART2_ReceiveSpan
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Point at the bytes waiting in the receive FIFO without taking them
+ *      out.  Only the bytes up to the end of the FIFO are returned, the
+ *      rest follow once these are consumed.
+ * Inputs:
+ *      const uint8_t **aSpan -- Returned pointer to the first byte
+ * Outputs:
+ *      uint16_t -- Number of bytes at *aSpan, 0 if none
+ *---------------------------------------------------------------------------*/
+uint16_t UART2_ReceiveSpan(const uint8_t **aSpan)
+{
+    uint16_t in;
+
+    /* Disable interrupts while a check is made */
+    SRMK2 = 1U;
+    in = G_UART2_RXIn;
+    SRMK2 = 0U;
+
+    *aSpan = &G_UART2_RXBuffer[G_UART2_RXOut];
+    if (in >= G_UART2_RXOut)
+        return in - G_UART2_RXOut;
+
+    return UART2_RX_BUFFER_SIZE - G_UART2_RXOut;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  UART2_ReceiveConsume
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Take bytes returned by UART2_ReceiveSpan out of the receive FIFO,
+ *      freeing their space for the interrupt.
+ * Inputs:
+ *      uint16_t aLen -- Number of bytes, no more than the span returned
+ * Outputs:
+ *      void
+ *---------------------------------------------------------------------------*/
+void UART2_ReceiveConsume(uint16_t aLen)
+{
+    uint16_t out = G_UART2_RXOut + aLen;
+
+    if (out >= UART2_RX_BUFFER_SIZE)
+        out -= UART2_RX_BUFFER_SIZE;
+
+    /* Disable interrupts while the FIFO is changed */
+    SRMK2 = 1U;
+    G_UART2_RXOut = out;
+    SRMK2 = 0U;
+}
+
 /*---------------------------------------------------------------------------*
  * Routine:  UART2_SendByte
  *---------------------------------------------------------------------------*
@@ -19,6 +19,9 @@
 void UART2_Start(uint32_t baud);
 void UART2_Stop(void);
 bool UART2_ReceiveByte(uint8_t *aByte);
+uint16_t UART2_ReceiveData(uint8_t *aData, uint16_t aLen);
+uint16_t UART2_ReceiveSpan(const uint8_t **aSpan);
+void UART2_ReceiveConsume(uint16_t aLen);
 bool UART2_SendByte(uint8_t aByte);
 uint32_t UART2_SendData(const uint8_t *aData, uint32_t aLen);
 void UART2_SendDataBlock(const uint8_t *aData, uint32_t aLen);
@@ -17,6 +17,7 @@
 #include <system/Switch.h>
 #include <sensors\Potentiometer.h>
 #include <sensors\Temperature.h>
+#include <sensors\FixedPoint.h>
 //#include <Tests\Tests.h>
 #include <system\console.h>
 #include <drv\UART0.h>
@@ -90,7 +91,7 @@ typedef enum {
  *      int -- always 0.
  *---------------------------------------------------------------------------*/
 uint16_t gAmbientLight;
-float gTemp_F;
+int16_t gTemp_F;             // tenths of a degree F
 typedef union {
 	int16_t		temp;
 	uint8_t		T_tempValue[2];
@@ -105,7 +106,7 @@ extern void App_OverTheAirProgrammingPushMetheod(void);
 int  main(void)
 {
     AppMode_T AppMode; APP_STATE_E state=UPDATE_TEMPERATURE; 
-    char LCDString[30], temp_char[2]; uint16_t temp; float ftemp;
+    char LCDString[30]; uint16_t temp; uint8_t i, len;
   
     HardwareSetup();
 
@@ -247,21 +248,11 @@ int  main(void)
                 case UPDATE_TEMPERATURE:         
                 // Temperature sensor reading
                   temp = Temperature_Get();
-#if 0                 
-                   // Get the temperature and show it on the LCD
-                  temp_char[0] = (int16_t)temp / 16;
-                  temp_char[1] = (int16_t)((temp & 0x000F) * 10) / 16;
-#endif 
-                  temp_char[1] = (temp & 0xFF00)>>8;
-                  temp_char[0] = temp & 0xFF;
-                  
-                  ftemp = *(uint16_t *)temp_char;
-                  
-                  gTemp_F = ((ftemp/5)*9)/128 + 22;
+                  // The sensor reads 10F over the air around the board
+                  gTemp_F = Fixed_TempTenthsF((TempQ7_t)temp) - 100;
               
                   // Display the contents of lcd_buffer onto the debug LCD 
-                  //sprintf((char *)LCDString, "TEMP: %d.%d C", temp_char[0], temp_char[1]);
-                  sprintf((char *)LCDString, "TEMP: %.1fF", gTemp_F);
+                  Fixed_FormatLabel(LCDString, "TEMP: ", gTemp_F, 1, "F");
                   DisplayLCD(LCD_LINE6, (const uint8_t *)LCDString);  
                   state = UPDATE_LIGHT;
                 break;
@@ -270,7 +261,7 @@ int  main(void)
                  // Light sensor reading
                   gAmbientLight = LightSensor_Get();
                     // Display the contents of lcd_buffer onto the debug LCD 
-                  sprintf((char *)LCDString, "Light: %d ", gAmbientLight);
+                  Fixed_FormatLabel(LCDString, "Light: ", gAmbientLight, 0, " ");
                   DisplayLCD(LCD_LINE7, (const uint8_t *)LCDString);
                   state = UPDATE_ACCELEROMETER;
                 break;
@@ -278,7 +269,13 @@ int  main(void)
                 case UPDATE_ACCELEROMETER: 
                  // 3-axis accelerometer reading
                   Accelerometer_Get();
-                  sprintf((char *)LCDString, "x%2d y%2d z%2d", gAccData[0], gAccData[1], gAccData[2]);
+                  // "x%2d y%2d z%2d"
+                  for (i = 0, len = 0; i < 3; i++) {
+                      if (i)
+                          LCDString[len++] = ' ';
+                      LCDString[len++] = "xyz"[i];
+                      len += Fixed_FormatPadded(&LCDString[len], gAccData[i], 0, 2);
+                  }
                   DisplayLCD(LCD_LINE8, (const uint8_t *)LCDString); 
                   state = UPDATE_TEMPERATURE;
                 break;
@@ -59,22 +59,23 @@ uint8_t EEPROM_Write(uint16_t offset, uint8_t *aData, uint16_t aSize)
     r.iAddr = EEPROM_ADDR>>1;
     r.iSpeed = 100; /* kHz */
     
-    // Write Data in groups of size defined by EEPROM_BYTES_PER_WRITE
-    for(i=0; i<aSize; i+=EEPROM_BYTES_PER_WRITE) {
+    // Write Data in groups of size defined by EEPROM_BYTES_PER_WRITE,
+    // split at page boundaries since a write wraps around inside its page
+    for(i=0; i<aSize; i+=bytesToWrite) {
       
         // Data Address in the EEPROM to write to
-        writeData[0] = (uint8_t)(i + offset)<<8;
+        writeData[0] = (uint8_t)((i + offset) >> 8);
         writeData[1] = (uint8_t)(i + offset);
         
-        for(j=0; j<EEPROM_BYTES_PER_WRITE; j++) {
+        bytesToWrite = EEPROM_BYTES_PER_WRITE -
+                       ((i + offset) % EEPROM_BYTES_PER_WRITE);
+        if((aSize - i) < bytesToWrite)
+            bytesToWrite = aSize - i;
+        
+        for(j=0; j<bytesToWrite; j++) {
             writeData[2+j] = aData[i+j];
         }
         
-        if((aSize - i) < EEPROM_BYTES_PER_WRITE)
-            bytesToWrite = aSize - i;
-        else
-            bytesToWrite = EEPROM_BYTES_PER_WRITE;
-        
         r.iWriteData = writeData;
         r.iWriteLength = 2+bytesToWrite;
         r.iReadData = 0;
@@ -108,7 +109,7 @@ void EEPROM_WriteStr(uint16_t addr, char *pdata)
     I2C_Request r;
     uint16_t len = 2;
 
-    send[0] = addr & 0xFF00;
+    send[0] = (uint8_t)(addr >> 8);
     send[1] = addr & 0x00FF;
 
     while (*pdata != '\0')
@@ -151,7 +152,7 @@ int16_t EEPROM_Seq_Read(uint16_t addr,uint8_t *pdata, uint16_t r_lenth)
     I2C_Request r;
     int16_t result = 0;
 
-    target_address[0] = addr & 0xFF00;
+    target_address[0] = (uint8_t)(addr >> 8);
     target_address[1] = addr & 0x00FF;     
 
     r.iAddr = EEPROM_ADDR >> 1;
@@ -187,7 +188,7 @@ uint8_t EEPROM_Read(uint16_t offset, uint8_t *aData, uint16_t aSize)
     uint32_t timeout = MSTimerGet();
     I2C_Request r;
 
-    writeData[0] = (uint8_t)offset<<8;
+    writeData[0] = (uint8_t)(offset >> 8);
     writeData[1] = (uint8_t)offset;
     
     r.iAddr = EEPROM_ADDR>>1;
@@ -227,21 +228,22 @@ uint8_t EEPROM_Erase(uint16_t offset, uint16_t aSize)
     r.iAddr = EEPROM_ADDR>>1;
     r.iSpeed = 100; /* kHz */
     
-    // Write Data in groups of size defined by EEPROM_BYTES_PER_WRITE
-    for(i=0; i<aSize; i+=EEPROM_BYTES_PER_WRITE) {
+    for(j=0; j<EEPROM_BYTES_PER_WRITE; j++) {
+        writeData[2+j] = 0x00;
+    }
+    
+    // Write zeros in groups of size defined by EEPROM_BYTES_PER_WRITE,
+    // split at page boundaries as in EEPROM_Write
+    for(i=0; i<aSize; i+=bytesToWrite) {
       
         // Data Address in the EEPROM to write to
-        writeData[0] = (uint8_t)(i + offset)<<8;
+        writeData[0] = (uint8_t)((i + offset) >> 8);
         writeData[1] = (uint8_t)(i + offset);
         
-        for(j=0; j<EEPROM_BYTES_PER_WRITE; j++) {
-            writeData[2+j] = 0x00;
-        }
-        
-        if((aSize - i) < EEPROM_BYTES_PER_WRITE)
+        bytesToWrite = EEPROM_BYTES_PER_WRITE -
+                       ((i + offset) % EEPROM_BYTES_PER_WRITE);
+        if((aSize - i) < bytesToWrite)
             bytesToWrite = aSize - i;
-        else
-            bytesToWrite = EEPROM_BYTES_PER_WRITE;
         
         r.iWriteData = writeData;
         r.iWriteLength = 2+bytesToWrite;
@@ -52,6 +52,9 @@
 #define GainSpan_UART_SendByte(aByte)         UART2_SendByte(aByte)
 #define GainSpan_UART_SendData(aData, aLen)   UART2_SendData(aData, aLen)
 #define GainSpan_UART_ReceiveByte(aByte)      UART2_ReceiveByte(aByte)
+#define GainSpan_UART_ReceiveData(aData, aLen) UART2_ReceiveData(aData, aLen)
+#define GainSpan_UART_ReceiveSpan(aSpan)      UART2_ReceiveSpan(aSpan)
+#define GainSpan_UART_ReceiveConsume(aLen)    UART2_ReceiveConsume(aLen)
 #define GainSpan_UART_IsTransmitEmpty()       UART2_IsTransmitEmpty()
 
 #define NV_Open                               EEPROM_Open
@@ -0,0 +1,15 @@
+/*-------------------------------------------------------------------------*
+ * File:  HostApp.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Host stand-in for YRDKRL78G14/HostApp.h for hal_bench.  It leaves
+ *     out ATLIBGS_INTERFACE_SPI, so App_Common.c talks to the module
+ *     through the GainSpan_UART calls the bench simulates.
+ *-------------------------------------------------------------------------*/
+#ifndef HOST_APP_H_
+#define HOST_APP_H_
+
+#endif // HOST_APP_H_
+/*-------------------------------------------------------------------------*
+ * End of File:  HostApp.h
+ *-------------------------------------------------------------------------*/
@@ -0,0 +1,34 @@
+/*-------------------------------------------------------------------------*
+ * File:  apps.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Host stand-in for the apps/apps.h exosite_hal.c includes, with only
+ *     the receive calls of Apps/App_Common.c it uses.  The board's
+ *     Apps/Apps.h also declares the application's cid, which would clash
+ *     with the one exosite_hal.c keeps to itself.
+ *-------------------------------------------------------------------------*/
+#ifndef APPS_H_
+#define APPS_H_
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+
+/*-------------------------------------------------------------------------*
+ * Globals:
+ *-------------------------------------------------------------------------*/
+extern uint32_t G_writtenCount;
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+uint16_t App_IncomingCount(uint8_t cid);
+uint16_t App_IncomingDropped(uint8_t cid);
+uint16_t App_ReadIncomingData(uint8_t cid, void *rxData, uint16_t dataLength);
+void App_FlushIncomingData(uint8_t cid);
+
+#endif // APPS_H_
+/*-------------------------------------------------------------------------*
+ * End of File:  apps.h
+ *-------------------------------------------------------------------------*/
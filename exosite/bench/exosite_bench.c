@@ -0,0 +1,611 @@
+/*****************************************************************************
+*
+*  exosite_bench.c - Times the Exosite client against a local server.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+/*
+ * Runs Exosite_Activate, Exosite_Write and Exosite_Read against
+ * mock_onep.py through exosite_hal_posix.c, and prints for each the
+ * p50/p99 latency, the requests and connections it took, the data frames
+ * and the bytes it sent. Built and run from the top of the tree:
+ *
+ *   cc -I. -o exosite_bench exosite/bench/exosite_bench.c \
+ *      $(ls exosite/exosite*.c | grep -v exosite_hal.c)
+ *   python3 exosite/bench/mock_onep.py --port 8080 &
+ *   EXOSITE_FRAME_MS=20 ./exosite_bench -p 8080 -n 200
+ *
+ * The write/line and read/line rows send the same requests the way
+ * sendLine did before requests were built in one buffer, a frame per
+ * header line. Each frame is an ESC S / ESC E handshake with the module
+ * on the board; EXOSITE_FRAME_MS has the host HAL wait that long per
+ * frame to stand in for it.
+ *
+ * Add -DEXOSITE_HAL_OPENSSL -lssl -lcrypto, --tls to the mock and
+ * EXOSITE_CA_FILE to time the TLS connection as well.
+ *
+ * -l seconds follows an alias the mock changes for that long, first with
+ * Exosite_ReadLongPoll and then with an Exosite_Read every second, as
+ * App_Exosite did. The mock sets the alias to the time of the change:
+ *
+ *   python3 exosite/bench/mock_onep.py --port 8080 --tick tick:20000 &
+ *   ./exosite_bench -p 8080 -n 0 -l 300
+ *
+ * For each it prints the changes seen, how long after the change they
+ * were seen, the requests made, and the requests a minute that found no
+ * change, which are what it costs to sit idle.
+ */
+#include <exosite/exosite.h>
+#include <exosite/exosite_hal.h>
+#include <exosite/exosite_meta.h>
+#include <exosite/exosite_http.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// local defines
+#define BENCH_ITERATIONS 100
+#define BENCH_PORT 8080
+#define BENCH_CIK "0123456789abcdef0123456789abcdef01234567"
+#define BENCH_TICK_ALIAS "tick"
+#define BENCH_POLL_TIMEOUT 30000        // ms the server may hold a long poll
+#define BENCH_READ_PERIOD 1000          // ms between reads of poll/1s
+#define BENCH_MAX_CHANGES 1000
+
+// what one operation took
+typedef struct
+{
+  double ms;
+  unsigned long requests;       // sent, retries included
+  unsigned long connects;       // connections opened
+  unsigned long commands;       // socket calls, see exoHAL_GetStats
+  unsigned long frames;         // data frames, each a module handshake
+  unsigned long bytes;          // bytes sent
+} bench_sample;
+
+typedef int (*bench_op)(int i);
+
+// reads the tick alias into value, 1 if a request was made and answered
+typedef int (*bench_follow)(ExositeKeyValue *kv, ExositeLongPoll *poll);
+
+// local functions
+static int op_activate(int i);
+static int op_write(int i);
+static int op_read(int i);
+static int op_write_lines(int i);
+static int op_read_lines(int i);
+static void line_send(const char *text);
+static int line_response(void);
+static void bench_run(const char *name, bench_op op, int count);
+static int follow_longpoll(ExositeKeyValue *kv, ExositeLongPoll *poll);
+static int follow_read(ExositeKeyValue *kv, ExositeLongPoll *poll);
+static void bench_follow_run(const char *name, bench_follow follow,
+                             int seconds);
+static int compare_ms(const void *a, const void *b);
+static double now_ms(void);
+static double wall_ms(void);
+
+static bench_sample *samples;
+static long line_sock = -1;             // connection of the /line ops
+static unsigned long line_frames;       // frames they sent
+static unsigned long line_requests;
+static unsigned long line_connects;
+
+
+/*****************************************************************************
+*
+*  main
+*
+*  \param  -n iterations of each operation; -p port of the server;
+*          -l seconds to follow the tick alias for
+*
+*  \return 0 if every operation succeeded; 1 otherwise
+*
+*  \brief  Points the client at the local server and times each operation
+*
+*****************************************************************************/
+int
+main(int argc, char *argv[])
+{
+  unsigned char server[META_SERVER_SIZE] = {0, 0, 0, 0, 0, 0};
+  int count = BENCH_ITERATIONS;
+  int port = BENCH_PORT;
+  int follow = 0;
+  int opt;
+
+  while (-1 != (opt = getopt(argc, argv, "n:p:l:")))
+  {
+    if ('n' == opt)
+      count = atoi(optarg);
+    else if ('p' == opt)
+      port = atoi(optarg);
+    else if ('l' == opt)
+      follow = atoi(optarg);
+    else
+    {
+      fprintf(stderr, "usage: %s [-n iterations] [-p port] [-l seconds]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+
+  setenv("EXOSITE_SERVER", "127.0.0.1", 0);
+  setenv("EXOSITE_UUID", "001DC9000001", 0);
+  setenv("EXOSITE_NV_FILE", "exosite_bench.bin", 0);
+
+  if (!Exosite_Init("renesas", "rl78g14", IF_WIFI, 1))
+  {
+    fprintf(stderr, "Exosite_Init failed, status %d\n", Exosite_StatusCode());
+    return 1;
+  }
+  server[4] = (unsigned char)(port >> 8);
+  server[5] = (unsigned char)port;
+  exosite_meta_write(server, META_SERVER_SIZE, META_SERVER);
+  Exosite_SetCIK(BENCH_CIK);
+
+  samples = malloc((count > BENCH_MAX_CHANGES ? count : BENCH_MAX_CHANGES)
+                   * sizeof(bench_sample));
+  if (NULL == samples)
+    return 1;
+
+  if (0 < follow)
+  {
+    printf("%-10s %7s %9s %9s %9s %8s %10s\n", "follow", "changes",
+           "p50 ms", "p99 ms", "max ms", "requests", "idle/min");
+    bench_follow_run("longpoll", follow_longpoll, follow);
+    bench_follow_run("poll/1s", follow_read, follow);
+    printf("\n");
+  }
+
+  printf("%-10s %5s %5s %9s %9s %9s %8s %8s %9s %8s\n", "op", "ok", "fail",
+         "p50 ms", "p99 ms", "max ms", "req/op", "conn/op", "frames/op",
+         "bytes/op");
+  bench_run("activate", op_activate, count);
+  Exosite_SetCIK(BENCH_CIK);
+  bench_run("write", op_write, count);
+  bench_run("read", op_read, count);
+
+  // the host HAL drives one socket, the client gives up its own
+  Exosite_Disconnect();
+  bench_run("write/line", op_write_lines, count);
+  bench_run("read/line", op_read_lines, count);
+  if (-1 != line_sock)
+    exoHAL_SocketClose(line_sock);
+
+  free(samples);
+
+  return 0;
+}
+
+
+/*****************************************************************************
+*
+*  op_activate, op_write, op_read
+*
+*  \param  i - iteration, varies the value written
+*
+*  \return 1 on success; 0 otherwise
+*
+*  \brief  The operations timed
+*
+*****************************************************************************/
+static int
+op_activate(int i)
+{
+  (void)i;
+
+  return Exosite_Activate();
+}
+
+static int
+op_write(int i)
+{
+  char content[32];
+
+  sprintf(content, "temp=%d.%d&ping=%d", 20 + i % 10, i % 10, i);
+
+  return Exosite_Write(content, strlen(content));
+}
+
+static int
+op_read(int i)
+{
+  char value[16];
+
+  (void)i;
+
+  return 0 < Exosite_Read("ping", value, sizeof(value));
+}
+
+
+/*****************************************************************************
+*
+*  op_write_lines, op_read_lines
+*
+*  \param  i - iteration, varies the value written
+*
+*  \return 1 on success; 0 otherwise
+*
+*  \brief  The write and read requests sent as sendLine sent them, a
+*          frame for each line and one for the body
+*
+*****************************************************************************/
+static int
+op_write_lines(int i)
+{
+  char content[32];
+  char length[32];
+
+  sprintf(content, "temp=%d.%d&ping=%d", 20 + i % 10, i % 10, i);
+  sprintf(length, "Content-Length: %d\r\n\r\n", (int)strlen(content));
+
+  line_send("POST /onep:v1/stack/alias HTTP/1.1\r\n");
+  line_send("Host: m2.exosite.com\r\n");
+  line_send("X-Exosite-CIK: " BENCH_CIK "\r\n");
+  line_send("Content-Type: application/x-www-form-urlencoded; "
+            "charset=utf-8\r\n");
+  line_send(length);
+  line_send(content);
+
+  return 204 == line_response();
+}
+
+static int
+op_read_lines(int i)
+{
+  (void)i;
+
+  line_send("GET /onep:v1/stack/alias?ping HTTP/1.1\r\n");
+  line_send("Host: m2.exosite.com\r\n");
+  line_send("X-Exosite-CIK: " BENCH_CIK "\r\n");
+  line_send("Accept: application/x-www-form-urlencoded; "
+            "charset=utf-8\r\n\r\n");
+
+  return 200 == line_response();
+}
+
+
+/*****************************************************************************
+*
+*  line_send
+*
+*  \param  text - one line of the request
+*
+*  \return None
+*
+*  \brief  Sends a line in a frame of its own, connecting first if the
+*          last response closed the connection
+*
+*****************************************************************************/
+static void
+line_send(const char *text)
+{
+  unsigned char server[META_SERVER_SIZE];
+
+  if (-1 == line_sock)
+  {
+    exosite_meta_read(server, META_SERVER_SIZE, META_SERVER);
+    line_connects++;
+    line_sock = exoHAL_SocketOpenTCP(server);
+    if (-1 != line_sock && 0 > exoHAL_ServerConnect(line_sock))
+    {
+      exoHAL_SocketClose(line_sock);
+      line_sock = -1;
+    }
+    if (-1 == line_sock)
+      return;
+  }
+  line_frames++;
+  exoHAL_SocketSend(line_sock, (char *)text, strlen(text));
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  line_response
+*
+*  \param  None
+*
+*  \return http status, 0 if no complete response came
+*
+*  \brief  Reads the response to the lines, keeping the connection open
+*          unless the server closes it
+*
+*****************************************************************************/
+static int
+line_response(void)
+{
+  exosite_http_parser parser;
+  char buf[64];
+  unsigned char len;
+
+  if (-1 == line_sock)
+    return 0;
+  line_requests++;
+
+  exosite_http_init(&parser, NULL, NULL);
+  while (!exosite_http_done(&parser))
+  {
+    len = exoHAL_SocketRecv(line_sock, buf, sizeof(buf));
+    if (0 == len)
+    {
+      exosite_http_finish(&parser);
+      break;
+    }
+    exosite_http_parse(&parser, buf, len);
+  }
+  if (HTTP_DONE != parser.state || parser.close)
+  {
+    exoHAL_SocketClose(line_sock);
+    line_sock = -1;
+    return 0;
+  }
+
+  return parser.status;
+}
+
+
+/*****************************************************************************
+*
+*  bench_run
+*
+*  \param  name - printed; op - operation to time; count - times to run it
+*
+*  \return None
+*
+*  \brief  Runs the operation count times and prints one line of results
+*
+*****************************************************************************/
+static void
+bench_run(const char *name, bench_op op, int count)
+{
+  ExositeConnStats before, after;
+  unsigned long commands, bytes, frames, lreqs, lconns;
+  double requests = 0, connects = 0, sent = 0, framed = 0;
+  int i, ok = 0;
+
+  for (i = 0; i < count; i++)
+  {
+    bench_sample *s = &samples[i];
+    double start;
+
+    Exosite_GetConnStats(&before);
+    exoHAL_GetStats(&commands, &bytes);
+    frames = line_frames;
+    lreqs = line_requests;
+    lconns = line_connects;
+    start = now_ms();
+    ok += (0 != op(i));
+    s->ms = now_ms() - start;
+    Exosite_GetConnStats(&after);
+    exoHAL_GetStats(&s->commands, &s->bytes);
+
+    s->commands -= commands;
+    s->bytes -= bytes;
+    s->frames = (unsigned short)(after.send_frames - before.send_frames)
+                + line_frames - frames;
+    s->connects = after.reuse_misses - before.reuse_misses
+                  + line_connects - lconns;
+    s->requests = after.reuse_misses - before.reuse_misses
+                  + after.reuse_hits - before.reuse_hits
+                  + line_requests - lreqs;
+    requests += s->requests;
+    connects += s->connects;
+    sent += s->bytes;
+    framed += s->frames;
+  }
+  if (0 == count)
+    return;
+
+  qsort(samples, count, sizeof(bench_sample), compare_ms);
+  printf("%-10s %5d %5d %9.3f %9.3f %9.3f %8.2f %8.2f %9.2f %8.1f\n", name,
+         ok, count - ok, samples[count / 2].ms,
+         samples[(count * 99) / 100].ms, samples[count - 1].ms,
+         requests / count, connects / count, framed / count, sent / count);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  follow_longpoll, follow_read
+*
+*  \param  kv - the tick alias and a buffer for its value
+*          poll - long poll state, kept between calls
+*
+*  \return 1 if the server answered; 0 otherwise
+*
+*  \brief  The two ways of following an alias: a long poll the server
+*          holds until the value changes, or a read every
+*          BENCH_READ_PERIOD ms
+*
+*****************************************************************************/
+static int
+follow_longpoll(ExositeKeyValue *kv, ExositeLongPoll *poll)
+{
+  Exosite_ReadLongPoll(kv, poll);
+
+  return EXO_STATUS_OK == Exosite_StatusCode();
+}
+
+static int
+follow_read(ExositeKeyValue *kv, ExositeLongPoll *poll)
+{
+  int len;
+
+  (void)poll;
+
+  usleep(BENCH_READ_PERIOD * 1000);
+  len = Exosite_Read((char *)kv->alias, kv->value, kv->size - 1);
+  kv->len = 0 < len ? len : 0;
+  kv->value[kv->len] = 0;
+
+  return 0 <= len;
+}
+
+
+/*****************************************************************************
+*
+*  bench_follow_run
+*
+*  \param  name - printed; follow - way to read the alias; seconds - to
+*          follow it for
+*
+*  \return None
+*
+*  \brief  Reads the tick alias for the given time and prints how long
+*          its changes took to arrive and the requests it cost
+*
+*****************************************************************************/
+static void
+bench_follow_run(const char *name, bench_follow follow, int seconds)
+{
+  ExositeConnStats before, after;
+  ExositeLongPoll poll;
+  ExositeKeyValue kv;
+  char value[24];
+  char last[24] = "";
+  double end = now_ms() + seconds * 1000.0;
+  unsigned long requests, idle = 0;
+  int changes = 0;
+  int first = 1;
+
+  kv.alias = BENCH_TICK_ALIAS;
+  kv.value = value;
+  kv.size = sizeof(value);
+  poll.timeout = BENCH_POLL_TIMEOUT;
+  poll.since[0] = 0;
+
+  Exosite_GetConnStats(&before);
+  while (now_ms() < end)
+  {
+    value[0] = 0;
+    if (!follow(&kv, &poll))
+      continue;
+    if (0 == value[0] || 0 == strcmp(value, last))
+    {
+      idle++;
+      continue;
+    }
+    // the value held when the run started is not a change
+    if (!first && changes < BENCH_MAX_CHANGES)
+      samples[changes++].ms = wall_ms() - atof(value);
+    first = 0;
+    strcpy(last, value);
+  }
+  Exosite_GetConnStats(&after);
+  requests = (uint16_t)(after.reuse_hits - before.reuse_hits)
+             + (uint16_t)(after.reuse_misses - before.reuse_misses);
+
+  if (0 == changes)
+  {
+    printf("%-10s %7d %9s %9s %9s %8lu %10.1f\n", name, 0, "-", "-", "-",
+           requests, idle * 60.0 / seconds);
+    return;
+  }
+  qsort(samples, changes, sizeof(bench_sample), compare_ms);
+  printf("%-10s %7d %9.1f %9.1f %9.1f %8lu %10.1f\n", name, changes,
+         samples[changes / 2].ms, samples[(changes * 99) / 100].ms,
+         samples[changes - 1].ms, requests, idle * 60.0 / seconds);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  compare_ms
+*
+*  \param  a, b - samples
+*
+*  \return <0, 0, >0 as a took less, as long or longer than b
+*
+*  \brief  Orders samples by latency for qsort
+*
+*****************************************************************************/
+static int
+compare_ms(const void *a, const void *b)
+{
+  double da = ((const bench_sample *)a)->ms;
+  double db = ((const bench_sample *)b)->ms;
+
+  return (da > db) - (da < db);
+}
+
+
+/*****************************************************************************
+*
+*  now_ms
+*
+*  \param  None
+*
+*  \return Monotonic time in ms, with a fraction
+*
+*  \brief  exoHAL_MSTimerGet is too coarse for requests to a local server
+*
+*****************************************************************************/
+static double
+now_ms(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+
+/*****************************************************************************
+*
+*  wall_ms
+*
+*  \param  None
+*
+*  \return Time since 1970 in ms, with a fraction
+*
+*  \brief  Compared with the time the mock put in the tick alias
+*
+*****************************************************************************/
+static double
+wall_ms(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_REALTIME, &now);
+
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
@@ -0,0 +1,879 @@
+/*****************************************************************************
+*
+*  hal_bench.c - Counts the module traffic of the board HAL's backends.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+/*
+ * Runs Exosite_Write and Exosite_Read through the board HAL,
+ * exosite_hal.c, with AtCmdLib.c and the receive pool of App_Common.c,
+ * against a simulated GS1011 behind the GainSpan_UART calls. The module
+ * answers the AT commands, takes ESC S frames as a TCP connection and
+ * ESC H content as its HTTP client, and serves the aliases from memory.
+ * For each operation it prints the bytes written to the module and read
+ * from it, the AT commands and the data frames it took. Built and run
+ * from the top of the tree, once for each backend:
+ *
+ *   SRC="exosite/bench/hal_bench.c exosite/exosite_hal.c \
+ *        $(ls exosite/exosite*.c | grep -v exosite_hal) \
+ *        CmdLib/AtCmdLib.c Apps/App_Common.c Apps/Datasources.c \
+ *        sensors/FixedPoint.c"
+ *   INC="-Iexosite/bench -ICmdLib/bench -I. -IYRDKRL78G14"
+ *   cc $INC -o hal_tcp $SRC
+ *   cc $INC -DEXOSITE_HAL_HTTPCLIENT -o hal_http $SRC
+ *   ./hal_tcp -n 100; ./hal_http -n 100
+ *
+ * The TCP backend sends the whole request in one ESC S frame and gets the
+ * whole response back, headers included. The HTTP client backend sets
+ * the headers that changed with AT+HTTPCONF, sends AT+HTTPSEND and the
+ * content, and gets the status and content back in ESC H frames. -f
+ * splits those frames to check the response is put back together.
+ *
+ * The read/long row reads an alias of -s bytes, 240 unless given. Its
+ * response is an ESC S frame of about 430 bytes on the TCP backend, more
+ * than the 256 byte receive pool holds, so it only gets through if
+ * socket_recv hands it out while it comes in.
+ *
+ * Exits 1 if an operation fails or a read does not return the value
+ * written last.
+ */
+#include <exosite/exosite.h>
+#include <exosite/exosite_hal.h>
+#include <exosite/exosite_meta.h>
+#include <CmdLib/AtCmdLib.h>
+#include <Apps/Apps.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// local defines
+#define BENCH_ITERATIONS 100
+#define BENCH_CIK "0123456789abcdef0123456789abcdef01234567"
+#define BENCH_EEPROM_SIZE 0x0800
+#define BENCH_OUT_SIZE 4096             // module output not yet read
+#define BENCH_LINE_SIZE 256
+#define BENCH_REQUEST_SIZE 1024
+#define BENCH_FRAME_SIZE 1400           // content of an ESC H frame
+#define BENCH_ALIASES 8
+#define BENCH_VALUE_SIZE 256
+#define BENCH_ESC 0x1B
+#define BENCH_NOTE_SIZE 240             // value of the alias read/long reads
+#define BENCH_NOTE_MAX 250              // longest Exosite_Write can send
+
+// what the module is taking in
+enum bench_states {MOD_COMMAND, MOD_ESCAPE, MOD_TCP_CID, MOD_TCP_DATA,
+                   MOD_TCP_ESCAPE, MOD_HTTP_CID, MOD_HTTP_DATA};
+
+// what one operation took
+typedef struct
+{
+  double ms;
+  unsigned long written;        // bytes to the module
+  unsigned long read;           // bytes from the module
+  unsigned long commands;       // AT commands
+  unsigned long frames;         // ESC S and ESC H data frames
+} bench_sample;
+
+typedef int (*bench_op)(int i);
+
+// local functions
+static int op_write(int i);
+static int op_read(int i);
+static int op_read_note(int i);
+static void bench_run(const char *name, bench_op op, int count);
+static void module_take(unsigned char c);
+static void module_command(void);
+static void module_tcp(void);
+static void module_http(void);
+static int module_serve(int post, const char *page, const char *content,
+                        char *body);
+static void module_reply(const void *data, unsigned short len);
+static int compare_ms(const void *a, const void *b);
+static double now_ms(void);
+
+static bench_sample *samples;
+static int last_ping = -1;              // value written last
+static int failures;
+static int note_size = BENCH_NOTE_SIZE;
+
+// the simulated module
+static struct
+{
+  unsigned char state;                  // bench_states
+  char line[BENCH_LINE_SIZE];           // AT command being taken in
+  unsigned short line_len;
+  char request[BENCH_REQUEST_SIZE];     // TCP request being taken in
+  unsigned short request_len;
+  char page[BENCH_LINE_SIZE];           // of AT+HTTPSEND
+  int post;
+  unsigned short size;                  // content of AT+HTTPSEND
+  char content[BENCH_REQUEST_SIZE];
+  unsigned short content_len;
+  unsigned char out[BENCH_OUT_SIZE];    // sent to the host
+  unsigned short out_len;
+  unsigned short out_pos;
+  unsigned long commands;
+  unsigned long frames;
+  unsigned long read;                   // bytes the host took
+  unsigned short frame_size;            // of the ESC H frames
+  char alias[BENCH_ALIASES][BENCH_VALUE_SIZE];
+  char value[BENCH_ALIASES][BENCH_VALUE_SIZE];
+  int verbose;
+} module;
+
+static unsigned char eeprom[BENCH_EEPROM_SIZE];
+
+// referenced by the GSLink code in AtCmdLib.c
+int16_t gAccData[3];
+int16_t gTemp_F;
+uint16_t gAmbientLight;
+uint8_t gSetLight_onoff;
+
+
+/*****************************************************************************
+*
+*  main
+*
+*  \param  -n iterations of each operation; -f content bytes per ESC H
+*          frame; -s bytes of the value read/long reads; -v to print the
+*          module commands
+*
+*  \return 0 if every operation succeeded; 1 otherwise
+*
+*  \brief  Points the client at the simulated module and counts what each
+*          operation takes
+*
+*****************************************************************************/
+int
+main(int argc, char *argv[])
+{
+  unsigned char server[META_SERVER_SIZE] = {10, 0, 0, 1, 0, 80};
+  char note[BENCH_NOTE_MAX + 6];
+  int count = BENCH_ITERATIONS;
+  int opt;
+
+  module.frame_size = BENCH_FRAME_SIZE;
+  while (-1 != (opt = getopt(argc, argv, "n:f:s:v")))
+  {
+    if ('n' == opt)
+      count = atoi(optarg);
+    else if ('f' == opt)
+      module.frame_size = (unsigned short)atoi(optarg);
+    else if ('s' == opt)
+      note_size = atoi(optarg);
+    else if ('v' == opt)
+      module.verbose = 1;
+    else
+    {
+      fprintf(stderr, "usage: %s [-n iterations] [-f frame size] "
+              "[-s value size] [-v]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (0 == module.frame_size || 9999 < module.frame_size)
+    module.frame_size = BENCH_FRAME_SIZE;
+  if (1 > note_size || BENCH_NOTE_MAX < note_size)
+    note_size = BENCH_NOTE_SIZE;
+
+  // as App_Exosite sets up the receive pool
+  AtLibGs_SetDataHandler(App_ProcessIncomingSpan);
+  AtLibGs_SetDataRoom(App_IncomingRoom);
+  if (!Exosite_Init("renesas", "rl78g14", IF_WIFI, 1))
+  {
+    fprintf(stderr, "Exosite_Init failed, status %d\n", Exosite_StatusCode());
+    return 1;
+  }
+  exosite_meta_write(server, META_SERVER_SIZE, META_SERVER);
+  Exosite_SetCIK(BENCH_CIK);
+
+  samples = malloc((0 < count ? count : 1) * sizeof(bench_sample));
+  if (NULL == samples)
+    return 1;
+
+#ifdef EXOSITE_HAL_HTTPCLIENT
+  printf("HTTP client backend, %u bytes per ESC H frame\n",
+         module.frame_size);
+#else
+  printf("TCP backend\n");
+#endif
+  printf("%-9s %5s %5s %9s %10s %10s %8s %9s\n", "op", "ok", "fail",
+         "p50 ms", "written/op", "read/op", "cmds/op", "frames/op");
+  bench_run("write", op_write, count);
+  bench_run("read", op_read, count);
+  strcpy(note, "note=");
+  memset(&note[5], 'n', note_size);
+  note[5 + note_size] = 0;
+  if (!Exosite_Write(note, strlen(note)))
+    failures++;
+  bench_run("read/long", op_read_note, count);
+  Exosite_Disconnect();
+
+  free(samples);
+
+  return (0 == failures) ? 0 : 1;
+}
+
+
+/*****************************************************************************
+*
+*  op_write, op_read, op_read_note
+*
+*  \param  i - iteration, varies the value written
+*
+*  \return 1 on success; 0 otherwise
+*
+*  \brief  The operations counted, the reads fail unless they get the
+*          values written last
+*
+*****************************************************************************/
+static int
+op_write(int i)
+{
+  char content[32];
+
+  sprintf(content, "temp=%d.%d&ping=%d", 20 + i % 10, i % 10, i);
+  if (!Exosite_Write(content, strlen(content)))
+    return 0;
+  last_ping = i;
+
+  return 1;
+}
+
+static int
+op_read(int i)
+{
+  char value[16];
+  int len;
+
+  (void)i;
+
+  len = Exosite_Read("ping", value, sizeof(value) - 1);
+  if (0 >= len)
+    return 0;
+  value[len] = 0;
+
+  return atoi(value) == last_ping;
+}
+
+static int
+op_read_note(int i)
+{
+  char value[BENCH_NOTE_MAX + 1];
+  int len;
+
+  (void)i;
+
+  len = Exosite_Read("note", value, sizeof(value) - 1);
+  if (note_size != len)
+    return 0;
+  while (0 < len && 'n' == value[len - 1])
+    len--;
+
+  return 0 == len;
+}
+
+
+/*****************************************************************************
+*
+*  bench_run
+*
+*  \param  name - printed; op - operation to count; count - times to run it
+*
+*  \return None
+*
+*  \brief  Runs the operation count times and prints one line of results
+*
+*****************************************************************************/
+static void
+bench_run(const char *name, bench_op op, int count)
+{
+  double written = 0, read = 0, commands = 0, frames = 0;
+  unsigned long before_written, before_read, before_commands, before_frames;
+  int i, ok = 0;
+
+  for (i = 0; i < count; i++)
+  {
+    bench_sample *s = &samples[i];
+    double start;
+
+    before_written = G_writtenCount;
+    before_read = module.read;
+    before_commands = module.commands;
+    before_frames = module.frames;
+    start = now_ms();
+    ok += (0 != op(i));
+    s->ms = now_ms() - start;
+    s->written = G_writtenCount - before_written;
+    s->read = module.read - before_read;
+    s->commands = module.commands - before_commands;
+    s->frames = module.frames - before_frames;
+    written += s->written;
+    read += s->read;
+    commands += s->commands;
+    frames += s->frames;
+  }
+  if (0 == count)
+    return;
+  failures += count - ok;
+
+  qsort(samples, count, sizeof(bench_sample), compare_ms);
+  printf("%-9s %5d %5d %9.3f %10.1f %10.1f %8.2f %9.2f\n", name, ok,
+         count - ok, samples[count / 2].ms, written / count, read / count,
+         commands / count, frames / count);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  module_take
+*
+*  \param  c - byte the host wrote
+*
+*  \return None
+*
+*  \brief  Takes in what the host writes, AT commands ended by CR, ESC S
+*          data frames ended by ESC E, and ESC H followed by the content
+*          AT+HTTPSEND announced
+*
+*****************************************************************************/
+static void
+module_take(unsigned char c)
+{
+  switch (module.state)
+  {
+    case MOD_COMMAND:
+      if (BENCH_ESC == c)
+        module.state = MOD_ESCAPE;
+      else if ('\r' == c)
+        module_command();
+      else if ('\n' != c && module.line_len < BENCH_LINE_SIZE - 1)
+        module.line[module.line_len++] = c;
+      break;
+    case MOD_ESCAPE:
+      if ('S' == c)
+        module.state = MOD_TCP_CID;
+      else if ('H' == c)
+        module.state = MOD_HTTP_CID;
+      else
+        module.state = MOD_COMMAND;
+      break;
+    case MOD_TCP_CID:
+      module.frames++;
+      module_reply("\x1bO", 2);
+      module.state = MOD_TCP_DATA;
+      break;
+    case MOD_TCP_DATA:
+      if (BENCH_ESC == c)
+        module.state = MOD_TCP_ESCAPE;
+      else if (module.request_len < BENCH_REQUEST_SIZE - 1)
+        module.request[module.request_len++] = c;
+      break;
+    case MOD_TCP_ESCAPE:
+      if ('E' == c)
+      {
+        module_reply("\x1bO", 2);
+        module_tcp();
+        module.state = MOD_COMMAND;
+        break;
+      }
+      if (module.request_len < BENCH_REQUEST_SIZE - 2)
+      {
+        module.request[module.request_len++] = BENCH_ESC;
+        module.request[module.request_len++] = c;
+      }
+      module.state = MOD_TCP_DATA;
+      break;
+    case MOD_HTTP_CID:
+      module.frames++;
+      module.content_len = 0;
+      module.state = MOD_HTTP_DATA;
+      if (0 == module.size)
+      {
+        module_http();
+        module.state = MOD_COMMAND;
+      }
+      break;
+    case MOD_HTTP_DATA:
+      if (module.content_len < BENCH_REQUEST_SIZE - 1)
+        module.content[module.content_len++] = c;
+      if (module.content_len == module.size)
+      {
+        module_http();
+        module.state = MOD_COMMAND;
+      }
+      break;
+  }
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  module_command
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Answers the AT command in module.line the way a GS1011 does,
+*          only AT+NCTCP, AT+HTTPOPEN, AT+NMAC and AT+HTTPSEND return
+*          anything besides OK
+*
+*****************************************************************************/
+static void
+module_command(void)
+{
+  char *p;
+
+  module.line[module.line_len] = 0;
+  module.line_len = 0;
+  if (0 == module.line[0])
+    return;
+  module.commands++;
+  if (module.verbose)
+    printf("  %s\n", module.line);
+
+  if (0 == strncmp(module.line, "AT+NCTCP=", 9))
+    module_reply("\r\nCONNECT 0\r\n\r\nOK\r\n", 19);
+  else if (0 == strncmp(module.line, "AT+HTTPOPEN=", 12))
+    module_reply("\r\n0\r\n\r\nOK\r\n", 11);
+  else if (0 == strncmp(module.line, "AT+NMAC=?", 9))
+    module_reply("\r\n00:1d:c9:01:99:99\r\n\r\nOK\r\n", 27);
+  else if (0 == strncmp(module.line, "AT+HTTPSEND=", 12))
+  {
+    // cid,type,timeout,page,size
+    p = strchr(module.line, ',');
+    module.post = (NULL != p && ATLIBGS_HTTPSEND_POST == atoi(p + 1));
+    p = (NULL != p) ? strchr(p + 1, ',') : NULL;
+    p = (NULL != p) ? strchr(p + 1, ',') : NULL;
+    if (NULL == p)
+    {
+      module_reply("\r\nERROR\r\n", 9);
+      return;
+    }
+    strcpy(module.page, p + 1);
+    p = strrchr(module.page, ',');
+    module.size = (unsigned short)atoi(p + 1);
+    *p = 0;
+    module_reply("\r\nOK\r\n", 6);
+  }
+  else
+    module_reply("\r\nOK\r\n", 6);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  module_tcp
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Answers the request in module.request once it has all come in,
+*          with the headers the One Platform sends, in an ESC S frame
+*
+*****************************************************************************/
+static void
+module_tcp(void)
+{
+  char body[BENCH_REQUEST_SIZE];
+  char response[BENCH_REQUEST_SIZE + 256];
+  char *end;
+  char *length;
+  char *page;
+  int content = 0;
+  int len;
+  int status;
+
+  module.request[module.request_len] = 0;
+  end = strstr(module.request, "\r\n\r\n");
+  if (NULL == end)
+    return;
+  end += 4;
+  length = strstr(module.request, "Content-Length: ");
+  if (NULL != length && length < end)
+    content = atoi(length + 16);
+  if (end - module.request + content > module.request_len)
+    return;
+
+  // "GET /page HTTP/1.1"
+  page = strchr(module.request, ' ') + 1;
+  *strchr(page, ' ') = 0;
+  end[content] = 0;
+  status = module_serve('P' == module.request[0], page, end, body);
+  module.request_len = 0;
+
+  len = sprintf(response, "\x1bS0HTTP/1.1 %d %s\r\n"
+                "Date: Sat, 17 Oct 2026 12:00:00 GMT\r\n"
+                "Server: nginx\r\n"
+                "Connection: keep-alive\r\n"
+                "Content-Length: %d\r\n"
+                "Content-Type: application/x-www-form-urlencoded; "
+                "charset=utf-8\r\n\r\n%s\x1b" "E",
+                status, 200 == status ? "OK" : "No Content",
+                (int)strlen(body), body);
+  module_reply(response, (unsigned short)len);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  module_http
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Answers the request AT+HTTPSEND announced as the module's HTTP
+*          client does, the status line and the content in ESC H frames of
+*          module.frame_size
+*
+*****************************************************************************/
+static void
+module_http(void)
+{
+  char body[BENCH_REQUEST_SIZE];
+  char response[BENCH_REQUEST_SIZE + 32];
+  char frame[16];
+  int status;
+  int len;
+  int i;
+  int n;
+
+  module.content[module.content_len] = 0;
+  status = module_serve(module.post, module.page, module.content, body);
+  len = sprintf(response, "%d %s\r\n%s", status,
+                200 == status ? "OK" : "No Content", body);
+  for (i = 0; i < len; i += n)
+  {
+    n = (len - i < module.frame_size) ? len - i : module.frame_size;
+    sprintf(frame, "\x1bH0%04d", n);
+    module_reply(frame, 7);
+    module_reply(&response[i], (unsigned short)n);
+  }
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  module_serve
+*
+*  \param  post - 1 for a POST; page - path and query; content - form sent;
+*          body - set to the form returned
+*
+*  \return HTTP status
+*
+*  \brief  The part of the One Platform the operations use, a POST to
+*          /onep:v1/stack/alias sets aliases, a GET returns those asked
+*          for after the ?
+*
+*****************************************************************************/
+static int
+module_serve(int post, const char *page, const char *content, char *body)
+{
+  char form[BENCH_REQUEST_SIZE];
+  char *pair;
+  char *value;
+  int i;
+
+  body[0] = 0;
+  if (0 != strncmp(page, "/onep:v1/stack/alias", 20))
+    return 404;
+
+  strcpy(form, post ? content : (NULL != strchr(page, '?')
+                                 ? strchr(page, '?') + 1 : ""));
+  for (pair = strtok(form, "&"); NULL != pair; pair = strtok(NULL, "&"))
+  {
+    value = strchr(pair, '=');
+    if (NULL != value)
+      *value++ = 0;
+    for (i = 0; i < BENCH_ALIASES && 0 != module.alias[i][0]; i++)
+    {
+      if (0 == strcmp(module.alias[i], pair))
+        break;
+    }
+    if (post && NULL != value && i < BENCH_ALIASES)
+    {
+      strncpy(module.alias[i], pair, BENCH_VALUE_SIZE - 1);
+      strncpy(module.value[i], value, BENCH_VALUE_SIZE - 1);
+    }
+    else if (!post && i < BENCH_ALIASES && 0 != module.alias[i][0])
+      sprintf(&body[strlen(body)], "%s%s=%s", body[0] ? "&" : "", pair,
+              module.value[i]);
+  }
+
+  return (post || 0 == body[0]) ? 204 : 200;
+}
+
+
+/*****************************************************************************
+*
+*  module_reply
+*
+*  \param  data - bytes the module sends; len - how many
+*
+*  \return None
+*
+*  \brief  Queues bytes for the host to read
+*
+*****************************************************************************/
+static void
+module_reply(const void *data, unsigned short len)
+{
+  if (module.out_pos == module.out_len)
+    module.out_pos = module.out_len = 0;
+  if (len > BENCH_OUT_SIZE - module.out_len)
+    len = BENCH_OUT_SIZE - module.out_len;
+  memcpy(&module.out[module.out_len], data, len);
+  module.out_len += len;
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  GainSpan_UART_SendData, GainSpan_UART_ReceiveData,
+*  GainSpan_UART_ReceiveSpan, GainSpan_UART_ReceiveConsume
+*
+*  \brief  The UART calls of App_Common.c, over the simulated module. It
+*          answers as soon as a command or frame is written.
+*
+*****************************************************************************/
+uint32_t
+GainSpan_UART_SendData(const uint8_t *aData, uint32_t aLen)
+{
+  uint32_t i;
+
+  for (i = 0; i < aLen; i++)
+    module_take(aData[i]);
+
+  return aLen;
+}
+
+uint16_t
+GainSpan_UART_ReceiveData(uint8_t *aData, uint16_t aLen)
+{
+  if (aLen > module.out_len - module.out_pos)
+    aLen = module.out_len - module.out_pos;
+  memcpy(aData, &module.out[module.out_pos], aLen);
+  module.out_pos += aLen;
+  module.read += aLen;
+
+  return aLen;
+}
+
+uint16_t
+GainSpan_UART_ReceiveSpan(const uint8_t **aSpan)
+{
+  *aSpan = &module.out[module.out_pos];
+
+  return module.out_len - module.out_pos;
+}
+
+void
+GainSpan_UART_ReceiveConsume(uint16_t aLen)
+{
+  module.out_pos += aLen;
+  module.read += aLen;
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  EEPROM_Write, EEPROM_Seq_Read, EEPROM_Erase
+*
+*  \brief  The EEPROM of the meta and the queue, kept in memory
+*
+*****************************************************************************/
+uint8_t
+EEPROM_Write(uint16_t offset, uint8_t *aData, uint16_t aSize)
+{
+  if (offset + aSize <= BENCH_EEPROM_SIZE)
+    memcpy(&eeprom[offset], aData, aSize);
+
+  return 0;
+}
+
+int16_t
+EEPROM_Seq_Read(uint16_t addr, uint8_t *pdata, uint16_t r_lenth)
+{
+  if (addr + r_lenth <= BENCH_EEPROM_SIZE)
+    memcpy(pdata, &eeprom[addr], r_lenth);
+
+  return 0;
+}
+
+uint8_t
+EEPROM_Erase(uint16_t offset, uint16_t aSize)
+{
+  if (offset + aSize <= BENCH_EEPROM_SIZE)
+    memset(&eeprom[offset], 0, aSize);
+
+  return 0;
+}
+
+
+/*****************************************************************************
+*
+*  MSTimerGet, MSTimerDelta, MSTimerDelay, App_DelayMS
+*
+*  \brief  The board's millisecond timer
+*
+*****************************************************************************/
+uint32_t
+MSTimerGet(void)
+{
+  return (uint32_t)now_ms();
+}
+
+uint32_t
+MSTimerDelta(uint32_t start)
+{
+  return MSTimerGet() - start;
+}
+
+void
+MSTimerDelay(uint32_t ms)
+{
+  usleep(ms * 1000);
+}
+
+void
+App_DelayMS(uint32_t cnt)
+{
+  MSTimerDelay(cnt);
+}
+
+
+/*****************************************************************************
+*
+*  DisplayLCD, ApplyLedCtrl, GS_UARTTransfer, Temperature_Get,
+*  Potentiometer_Get, LightSensor_Get
+*
+*  \brief  What else App_Common.c, AtCmdLib.c and Datasources.c link
+*          against, not called here
+*
+*****************************************************************************/
+void
+DisplayLCD(uint8_t aLine, const uint8_t *aText)
+{
+  (void)aLine;
+  (void)aText;
+}
+
+void
+ApplyLedCtrl(const char *value, uint8_t len)
+{
+  (void)value;
+  (void)len;
+}
+
+void
+GS_UARTTransfer(uint8_t *aData, uint32_t aLen)
+{
+  (void)aData;
+  (void)aLen;
+}
+
+uint16_t
+Temperature_Get(void)
+{
+  return 0;
+}
+
+uint32_t
+Potentiometer_Get(void)
+{
+  return 0;
+}
+
+int16_t
+LightSensor_Get(void)
+{
+  return 0;
+}
+
+
+/*****************************************************************************
+*
+*  compare_ms
+*
+*  \param  a, b - samples
+*
+*  \return <0, 0, >0 as a took less, as long or longer than b
+*
+*  \brief  Orders samples by time for qsort
+*
+*****************************************************************************/
+static int
+compare_ms(const void *a, const void *b)
+{
+  double d = ((const bench_sample *)a)->ms - ((const bench_sample *)b)->ms;
+
+  return (d > 0) - (d < 0);
+}
+
+
+/*****************************************************************************
+*
+*  now_ms
+*
+*  \param  None
+*
+*  \return Monotonic time in ms
+*
+*  \brief  Times the operations
+*
+*****************************************************************************/
+static double
+now_ms(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec * 1000.0 + now.tv_nsec / 1e6;
+}
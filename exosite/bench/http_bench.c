@@ -0,0 +1,483 @@
+/*****************************************************************************
+*
+*  http_bench.c - Checks and times the HTTP response parser on a host.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+/*
+ * Feeds recorded One Platform responses to exosite_http_parse split in
+ * two at every offset, then a byte at a time, and checks each comes out
+ * the same as when fed whole. Then times the parser on the responses fed
+ * in RX_SIZE pieces, the way exoHAL_SocketRecv hands them over. Built and
+ * run from the top of the tree:
+ *
+ *   cc -O2 -I. -o http_bench exosite/bench/http_bench.c exosite/exosite_http.c
+ *   ./http_bench -m 16
+ *
+ * Exits 1 if any check fails.
+ */
+#include <exosite/exosite_http.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// local defines
+#define BENCH_MBYTES 16
+#define BENCH_RX_SIZE 50                // as RX_SIZE in exosite.c
+#define BENCH_BODY_SIZE 512
+
+// a recorded response and what the parser should make of it
+typedef struct
+{
+  const char *name;
+  const char *response;
+  int status;
+  unsigned char state;                  // HttpParseStates once fed, finished
+  const char *body;
+  const char *date;
+  unsigned char close;
+  unsigned short trailing;              // bytes left over for the next one
+} bench_response;
+
+// what the parser made of one feeding
+typedef struct
+{
+  int status;
+  unsigned char state;
+  unsigned char close;
+  unsigned short used;
+  unsigned short body_len;
+  char body[BENCH_BODY_SIZE];
+  char date[HTTP_DATE_SIZE];
+} bench_result;
+
+static const bench_response responses[] =
+{
+  {
+    "activate",
+    "HTTP/1.1 200 OK\r\n"
+    "Date: Tue, 18 Nov 2014 08:53:45 GMT\r\n"
+    "Server: nginx\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: 40\r\n"
+    "Content-Type: text/plain; charset=utf-8\r\n"
+    "\r\n"
+    "0123456789abcdef0123456789abcdef01234567",
+    200, HTTP_DONE, "0123456789abcdef0123456789abcdef01234567",
+    "Tue, 18 Nov 2014 08:53:45 GMT", 0, 0
+  },
+  {
+    "chunked",
+    "HTTP/1.1 200 OK\r\n"
+    "date: Tue, 18 Nov 2014 08:53:46 GMT\r\n"
+    "Transfer-Encoding: Chunked\r\n"
+    "\r\n"
+    "4\r\nping\r\n"
+    "6;ext=1\r\n=1&tem\r\n"
+    "A\r\np=21.5&led\r\n"
+    "2\r\n=0\r\n"
+    "0\r\n"
+    "X-Trailer: ignored\r\n"
+    "\r\n",
+    200, HTTP_DONE, "ping=1&temp=21.5&led=0",
+    "Tue, 18 Nov 2014 08:53:46 GMT", 0, 0
+  },
+  {
+    "continue",
+    "HTTP/1.1 100 Continue\r\n"
+    "\r\n"
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Length: 6\r\n"
+    "\r\n"
+    "ping=2",
+    200, HTTP_DONE, "ping=2", "", 0, 0
+  },
+  {
+    "no content",
+    "HTTP/1.1 204 No Content\r\n"
+    "Date: Tue, 18 Nov 2014 08:53:47 GMT\r\n"
+    "\r\n",
+    204, HTTP_DONE, "", "Tue, 18 Nov 2014 08:53:47 GMT", 0, 0
+  },
+  {
+    "keep-alive",
+    "HTTP/1.1 204 No Content\r\n"
+    "\r\n"
+    "HTTP/1.1 200 OK\r\n",
+    204, HTTP_DONE, "", "", 0, 17
+  },
+  {
+    "to close",
+    "HTTP/1.0 200 OK\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "ping=3",
+    200, HTTP_DONE, "ping=3", "", 1, 0
+  },
+  {
+    "unauthorized",
+    "HTTP/1.1 401 Unauthorized\r\n"
+    "Content-Length: 0\r\n"
+    "Connection: close\r\n"
+    "\r\n",
+    401, HTTP_DONE, "", "", 1, 0
+  },
+  {
+    "truncated",
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Length: 10\r\n"
+    "\r\n"
+    "ping=",
+    200, HTTP_ERROR, "ping=", "", 0, 0
+  },
+  {
+    "bad status",
+    "<html>\r\n",
+    0, HTTP_ERROR, "", "", 0, 0
+  },
+  {
+    "huge chunk",
+    "HTTP/1.1 200 OK\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "10000000000000004\r\nping\r\n0\r\n\r\n",
+    200, HTTP_ERROR, "", "", 0, 0
+  },
+  {
+    "huge length",
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Length: 18446744073709551622\r\n"
+    "\r\n"
+    "ping=4",
+    200, HTTP_ERROR, "", "", 0, 0
+  },
+};
+
+#define NUM_RESPONSES (sizeof(responses) / sizeof(responses[0]))
+
+// local functions
+static void collect(exosite_http_parser *parser, const char *data,
+                    unsigned short len);
+static void count(exosite_http_parser *parser, const char *data,
+                  unsigned short len);
+static void feed(const char *data, unsigned short len, unsigned short split,
+                 unsigned short step, bench_result *result);
+static int check(const bench_response *r, const bench_result *result,
+                 const char *how, unsigned short at);
+static int check_splits(const bench_response *r);
+static double bench_run(const bench_response *r, unsigned long total);
+static double now_ns(void);
+
+
+/*****************************************************************************
+*
+*  main
+*
+*  \param  -m megabytes fed to the parser for each timed response
+*
+*  \return 0 if every check passed; 1 otherwise
+*
+*  \brief  Checks the parser on every split of each response, then times it
+*
+*****************************************************************************/
+int
+main(int argc, char *argv[])
+{
+  unsigned long total = BENCH_MBYTES * 1024UL * 1024UL;
+  unsigned int i;
+  int failed = 0;
+  int opt;
+
+  while (-1 != (opt = getopt(argc, argv, "m:")))
+  {
+    if ('m' == opt)
+      total = strtoul(optarg, NULL, 10) * 1024UL * 1024UL;
+    else
+    {
+      fprintf(stderr, "usage: %s [-m megabytes]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  for (i = 0; i < NUM_RESPONSES; i++)
+    failed += check_splits(&responses[i]);
+  printf("%u responses checked at every split, %d failed\n",
+         (unsigned int)NUM_RESPONSES, failed);
+
+  printf("%-14s %6s %9s %9s\n", "response", "bytes", "ns/byte", "MB/s");
+  for (i = 0; i < NUM_RESPONSES; i++)
+  {
+    const bench_response *r = &responses[i];
+    double ns;
+
+    if (HTTP_DONE != r->state || 0 != r->trailing)
+      continue;
+    ns = bench_run(r, total);
+    printf("%-14s %6u %9.2f %9.1f\n", r->name,
+           (unsigned int)strlen(r->response), ns, 1000.0 / ns);
+  }
+
+  return 0 != failed;
+}
+
+
+/*****************************************************************************
+*
+*  collect, count
+*
+*  \param  parser - parser with a bench_result as ctx
+*          data - span of the body; len - size of span
+*
+*  \return None
+*
+*  \brief  Body callbacks: collect keeps the body to check, count only
+*          adds up its length so the timing is of the parser
+*
+*****************************************************************************/
+static void
+collect(exosite_http_parser *parser, const char *data, unsigned short len)
+{
+  bench_result *result = (bench_result *)parser->ctx;
+
+  if (BENCH_BODY_SIZE - 1 < result->body_len + len)
+    len = BENCH_BODY_SIZE - 1 - result->body_len;
+  memcpy(&result->body[result->body_len], data, len);
+  result->body_len += len;
+  result->body[result->body_len] = 0;
+
+  return;
+}
+
+static void
+count(exosite_http_parser *parser, const char *data, unsigned short len)
+{
+  (void)data;
+
+  *(unsigned long *)parser->ctx += len;
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  feed
+*
+*  \param  data, len - the response
+*          split - size of the first piece, the rest follows in pieces of
+*          step bytes; result - what the parser made of it
+*
+*  \return None
+*
+*  \brief  Feeds a response the way the socket might deliver it, offering
+*          each piece again until the parser takes no more of it, then
+*          ends it as a closed connection would
+*
+*****************************************************************************/
+static void
+feed(const char *data, unsigned short len, unsigned short split,
+     unsigned short step, bench_result *result)
+{
+  exosite_http_parser parser;
+  unsigned short at = 0;
+  unsigned short piece;
+  unsigned short used;
+
+  memset(result, 0, sizeof(bench_result));
+  exosite_http_init(&parser, collect, result);
+
+  piece = split;
+  while (at < len && !exosite_http_done(&parser))
+  {
+    if (piece > len - at)
+      piece = len - at;
+    used = exosite_http_parse(&parser, &data[at], piece);
+    at += used;
+    if (used < piece)
+      break;
+    piece = step;
+  }
+  if (!exosite_http_done(&parser))
+    exosite_http_finish(&parser);
+
+  result->status = parser.status;
+  result->state = parser.state;
+  result->close = parser.close;
+  result->used = at;
+  strcpy(result->date, parser.date);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  check
+*
+*  \param  r - the response fed; result - what the parser made of it
+*          how, at - how it was split, for the message
+*
+*  \return 0 if the result is as recorded; 1 otherwise
+*
+*  \brief  Compares one feeding with what it should have given
+*
+*****************************************************************************/
+static int
+check(const bench_response *r, const bench_result *result, const char *how,
+      unsigned short at)
+{
+  unsigned short len = (unsigned short)strlen(r->response);
+  const char *what = NULL;
+
+  if (r->status != result->status)
+    what = "status";
+  else if (r->state != result->state)
+    what = "state";
+  else if (0 != strcmp(r->body, result->body))
+    what = "body";
+  else if (0 != strcmp(r->date, result->date))
+    what = "date";
+  else if (r->close != result->close)
+    what = "close";
+  else if (HTTP_DONE == r->state && len - r->trailing != result->used)
+    what = "bytes used";
+
+  if (NULL == what)
+    return 0;
+
+  printf("%s: %s %u: wrong %s\n", r->name, how, at, what);
+
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+*  check_splits
+*
+*  \param  r - the response to check
+*
+*  \return 1 if any feeding of it came out wrong; 0 otherwise
+*
+*  \brief  Feeds the response whole, split in two at every offset and a
+*          byte at a time
+*
+*****************************************************************************/
+static int
+check_splits(const bench_response *r)
+{
+  unsigned short len = (unsigned short)strlen(r->response);
+  bench_result result;
+  unsigned short split;
+
+  feed(r->response, len, len, len, &result);
+  if (check(r, &result, "whole", len))
+    return 1;
+
+  for (split = 0; split <= len; split++)
+  {
+    feed(r->response, len, split, len, &result);
+    if (check(r, &result, "split at", split))
+      return 1;
+  }
+
+  feed(r->response, len, 1, 1, &result);
+
+  return check(r, &result, "byte by byte", 1);
+}
+
+
+/*****************************************************************************
+*
+*  bench_run
+*
+*  \param  r - the response to time; total - bytes to feed in all
+*
+*  \return ns per byte of response
+*
+*  \brief  Parses the response over and over in BENCH_RX_SIZE pieces
+*
+*****************************************************************************/
+static double
+bench_run(const bench_response *r, unsigned long total)
+{
+  unsigned short len = (unsigned short)strlen(r->response);
+  unsigned long body = 0;
+  unsigned long fed = 0;
+  exosite_http_parser parser;
+  unsigned short at, piece;
+  double start;
+
+  start = now_ns();
+  while (fed < total)
+  {
+    exosite_http_init(&parser, count, &body);
+    for (at = 0; at < len; at += piece)
+    {
+      piece = (BENCH_RX_SIZE < len - at) ? BENCH_RX_SIZE : len - at;
+      exosite_http_parse(&parser, &r->response[at], piece);
+    }
+    if (!exosite_http_done(&parser))
+      exosite_http_finish(&parser);
+    fed += len;
+  }
+
+  // keep the body count live so the callback is not optimized away
+  if (0 == body && 0 != strlen(r->body))
+    printf("%s: no body\n", r->name);
+
+  return (now_ns() - start) / fed;
+}
+
+
+/*****************************************************************************
+*
+*  now_ns
+*
+*  \param  None
+*
+*  \return Monotonic time in ns
+*
+*  \brief  Clock for the timing
+*
+*****************************************************************************/
+static double
+now_ns(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
@@ -0,0 +1,273 @@
+/*****************************************************************************
+*
+*  jitter_bench.c - Times a fixed rate sampling loop next to the client.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+/*
+ * Runs a loop that takes a sample every SAMPLE_MS, as App_Exosite does,
+ * while it makes an Exosite_ReadWrite every request period against a
+ * slow mock_onep.py. The request is made three ways: blocking, blocking
+ * with the sampling in the HAL idle hook, and started with
+ * Exosite_ReadWriteStart and carried out by Exosite_Poll. For each it
+ * prints how late the samples came. Built and run from the top of the
+ * tree:
+ *
+ *   cc -I. -o jitter_bench exosite/bench/jitter_bench.c \
+ *      $(ls exosite/exosite*.c | grep -v exosite_hal.c)
+ *   python3 exosite/bench/mock_onep.py --port 8080 --latency 400 --jitter 200 &
+ *   ./jitter_bench -p 8080 -t 20
+ */
+#include <exosite/exosite.h>
+#include <exosite/exosite_hal.h>
+#include <exosite/exosite_meta.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// local defines
+#define BENCH_PORT 8080
+#define BENCH_SECONDS 20
+#define BENCH_SAMPLE_MS 100             // as SAMPLE_INTERVAL in App_Exosite.c
+#define BENCH_REQUEST_MS 1000
+#define BENCH_MAX_SAMPLES 4096
+#define BENCH_CIK "0123456789abcdef0123456789abcdef01234567"
+
+typedef enum
+{
+  MODE_BLOCKING,
+  MODE_IDLE_HOOK,
+  MODE_ASYNC
+} bench_mode;
+
+// local functions
+static void sample(void);
+static void request_done(void *ctx, int result);
+static void bench_run(const char *name, bench_mode mode, int seconds);
+static int compare_late(const void *a, const void *b);
+
+static unsigned long next_sample;       // when the next sample is due
+static unsigned long late[BENCH_MAX_SAMPLES];
+static int samples;
+static int requests_ok;
+static char led_value[8];
+static ExositeKeyValue led = {"led", led_value, sizeof(led_value), 0};
+
+
+/*****************************************************************************
+*
+*  main
+*
+*  \param  -p port of the server; -t seconds to run each way
+*
+*  \return 0
+*
+*  \brief  Points the client at the local server and runs each way
+*
+*****************************************************************************/
+int
+main(int argc, char *argv[])
+{
+  unsigned char server[META_SERVER_SIZE] = {127, 0, 0, 1, 0, 0};
+  int seconds = BENCH_SECONDS;
+  int port = BENCH_PORT;
+  int opt;
+
+  while (-1 != (opt = getopt(argc, argv, "p:t:")))
+  {
+    if ('p' == opt)
+      port = atoi(optarg);
+    else if ('t' == opt)
+      seconds = atoi(optarg);
+    else
+    {
+      fprintf(stderr, "usage: %s [-p port] [-t seconds]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  setenv("EXOSITE_SERVER", "127.0.0.1", 0);
+  setenv("EXOSITE_UUID", "001DC9000001", 0);
+  setenv("EXOSITE_NV_FILE", "jitter_bench.bin", 0);
+
+  if (!Exosite_Init("renesas", "rl78g14", IF_WIFI, 1))
+  {
+    fprintf(stderr, "Exosite_Init failed, status %d\n", Exosite_StatusCode());
+    return 1;
+  }
+  server[4] = (unsigned char)(port >> 8);
+  server[5] = (unsigned char)port;
+  exosite_meta_write(server, META_SERVER_SIZE, META_SERVER);
+  Exosite_SetCIK(BENCH_CIK);
+
+  printf("%-10s %7s %7s %8s %8s %8s %7s\n", "client", "samples", "missed",
+         "p50 ms", "p99 ms", "max ms", "req ok");
+  bench_run("blocking", MODE_BLOCKING, seconds);
+  bench_run("idle hook", MODE_IDLE_HOOK, seconds);
+  bench_run("async", MODE_ASYNC, seconds);
+
+  Exosite_Disconnect();
+
+  return 0;
+}
+
+
+/*****************************************************************************
+*
+*  sample
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Takes the samples that are due and records how late each was.
+*          Samples a whole period late are not taken, they are missed, as
+*          a sample loop that catches up takes only the latest.
+*
+*****************************************************************************/
+static void
+sample(void)
+{
+  unsigned long now = exoHAL_MSTimerGet();
+
+  if ((long)(now - next_sample) < 0)
+    return;
+
+  if (BENCH_MAX_SAMPLES > samples)
+    late[samples++] = now - next_sample;
+  next_sample += BENCH_SAMPLE_MS;
+  while ((long)(now - next_sample) >= 0)
+    next_sample += BENCH_SAMPLE_MS;
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  request_done
+*
+*  \param  ctx - unused; result - Exosite_ReadWrite result
+*
+*  \return None
+*
+*  \brief  Counts the async requests that succeeded
+*
+*****************************************************************************/
+static void
+request_done(void *ctx, int result)
+{
+  (void)ctx;
+
+  requests_ok += (0 != result);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  bench_run
+*
+*  \param  name - printed; mode - how requests are made
+*          seconds - how long to run
+*
+*  \return None
+*
+*  \brief  Runs the sampling loop with a request every BENCH_REQUEST_MS
+*          and prints the lateness of the samples
+*
+*****************************************************************************/
+static void
+bench_run(const char *name, bench_mode mode, int seconds)
+{
+  unsigned long start = exoHAL_MSTimerGet();
+  unsigned long next_request = start;
+  unsigned long expected;
+
+  samples = 0;
+  requests_ok = 0;
+  next_sample = start;
+  exoHAL_SetIdleHook((MODE_IDLE_HOOK == mode) ? sample : NULL);
+
+  while (exoHAL_MSTimerGet() - start < (unsigned long)seconds * 1000)
+  {
+    sample();
+
+    if (MODE_ASYNC == mode)
+      Exosite_Poll();
+    if ((long)(exoHAL_MSTimerGet() - next_request) >= 0
+        && !(MODE_ASYNC == mode && Exosite_Poll()))
+    {
+      next_request += BENCH_REQUEST_MS;
+      if (MODE_ASYNC == mode)
+        Exosite_ReadWriteStart("ping=1", 6, &led, 1, request_done, NULL);
+      else
+        requests_ok += Exosite_ReadWrite("ping=1", 6, &led, 1);
+    }
+
+    exoHAL_MSDelay(1);
+  }
+  while (Exosite_Poll())
+    exoHAL_MSDelay(1);
+  exoHAL_SetIdleHook(NULL);
+
+  expected = (unsigned long)seconds * 1000 / BENCH_SAMPLE_MS;
+  qsort(late, samples, sizeof(late[0]), compare_late);
+  printf("%-10s %7d %7ld %8lu %8lu %8lu %7d\n", name, samples,
+         (long)expected - samples, late[samples / 2],
+         late[(samples * 99) / 100], late[samples - 1], requests_ok);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  compare_late
+*
+*  \param  a, b - lateness of two samples
+*
+*  \return <0, 0, >0 as a was less, as or more late than b
+*
+*  \brief  Orders samples by lateness for qsort
+*
+*****************************************************************************/
+static int
+compare_late(const void *a, const void *b)
+{
+  unsigned long la = *(const unsigned long *)a;
+  unsigned long lb = *(const unsigned long *)b;
+
+  return (la > lb) - (la < lb);
+}
+
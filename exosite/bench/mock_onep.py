@@ -0,0 +1,280 @@
+#!/usr/bin/env python3
+#
+#  mock_onep.py - Local stand-in for the Exosite One Platform API.
+#  Copyright (C) 2012 Exosite LLC
+#
+#  Redistribution and use in source and binary forms, with or without
+#  modification, are permitted under the terms of the LICENSE file.
+#
+"""Serves the calls the Exosite client makes, with faults to order.
+
+  POST /provision/activate     40 character CIK, or --activate status
+  POST /onep:v1/stack/alias    stores the form values, 204
+  GET  /onep:v1/stack/alias?a  the stored values of the aliases, 200/204
+  GET  /ip                     the server's time, used for its Date header
+
+A read with Request-Timeout is a long poll. It is held until one of the
+aliases changes after If-Modified-Since, or has a value if there is no
+If-Modified-Since, or for the timeout, which ends it with 304. A 200 carries the Last-Modified of the
+newest alias read. Modified times are whole seconds, as in the headers,
+and each change gets a later second than the one before. So a change in
+the same second as the last read is not lost, though under fast changes
+the times run ahead of the clock.
+
+--tick ALIAS:MS sets ALIAS to the time in ms since 1970, every MS ms on
+average. A client can then tell how long a change took to reach it.
+
+Connections are kept alive, as the real server does. Faults are picked
+per request with --seed so a run can be repeated.
+
+  python3 mock_onep.py --port 8080 --latency 20 --reset 0.05 --chunked
+  python3 mock_onep.py --port 8080 --tick tick:5000
+"""
+
+import argparse
+import random
+import socket
+import socketserver
+import ssl
+import sys
+import threading
+import time
+from email.utils import formatdate, parsedate_to_datetime
+from urllib.parse import parse_qsl, unquote_plus, urlencode
+
+STATUS_TEXT = {200: 'OK', 204: 'No Content', 304: 'Not Modified',
+               400: 'Bad Request', 401: 'Unauthorized', 404: 'Not Found',
+               409: 'Conflict'}
+
+
+class Store(object):
+    """Datasource values and counters, shared by the connections."""
+
+    def __init__(self, args):
+        self.args = args
+        self.lock = threading.Lock()
+        self.changed = threading.Condition(self.lock)
+        self.values = {}
+        self.modified = {}
+        self.last_modified = 0
+        self.rng = random.Random(args.seed)
+        self.requests = 0
+        self.connections = 0
+
+    def roll(self, rate):
+        with self.lock:
+            return self.rng.random() < rate
+
+    def update(self, pairs):
+        """Stores values and wakes the long polls. Call with lock held."""
+        self.last_modified = max(int(time.time()), self.last_modified + 1)
+        for alias, value in pairs:
+            self.values[alias] = value
+            self.modified[alias] = self.last_modified
+        self.changed.notify_all()
+
+    def tick(self, alias, ms):
+        """Sets alias to the time now, every ms on average."""
+        rng = random.Random(self.args.seed)
+        while True:
+            time.sleep(ms * rng.uniform(0.5, 1.5) / 1000.0)
+            with self.lock:
+                self.update([(alias, str(int(time.time() * 1000)))])
+
+
+class Handler(socketserver.StreamRequestHandler):
+    """One kept-alive connection, any number of requests."""
+
+    def handle(self):
+        store = self.server.store
+        args = store.args
+        with store.lock:
+            store.connections += 1
+        served = 0
+
+        while True:
+            request = self.read_request()
+            if request is None:
+                return
+            method, target, headers, body = request
+            with store.lock:
+                store.requests += 1
+
+            if args.latency or args.jitter:
+                time.sleep((args.latency + random.uniform(0, args.jitter))
+                           / 1000.0)
+            if store.roll(args.reset):
+                # as if the server or a NAT dropped the connection
+                self.log('reset', method, target)
+                self.reset()
+                return
+
+            status, reply = self.route(method, target, headers, body)
+            served += 1
+            close = args.close_after and served >= args.close_after
+            self.log(status, method, target)
+            self.send(status, reply, close)
+            if close:
+                return
+
+    def read_request(self):
+        line = self.rfile.readline(4096)
+        if not line:
+            return None
+        try:
+            method, target, _ = line.decode('latin-1').split(' ', 2)
+        except ValueError:
+            return None
+        headers = {}
+        while True:
+            line = self.rfile.readline(4096)
+            if line in (b'\r\n', b'\n', b''):
+                break
+            name, _, value = line.decode('latin-1').partition(':')
+            headers[name.strip().lower()] = value.strip()
+        length = int(headers.get('content-length', '0'))
+        body = self.rfile.read(length) if length else b''
+        return method, target, headers, body.decode('latin-1')
+
+    def route(self, method, target, headers, body):
+        store = self.server.store
+        args = store.args
+        path, _, query = target.partition('?')
+
+        if '/ip' == path and 'GET' == method:
+            return 200, str(int(time.time()))
+        if '/provision/activate' == path and 'POST' == method:
+            if 200 != args.activate:
+                return args.activate, ''
+            return 200, ''.join(store.rng.choice('0123456789abcdef')
+                                for _ in range(40))
+        if '/onep:v1/stack/alias' != path:
+            return 404, ''
+
+        if store.roll(args.unauthorized) or 'x-exosite-cik' not in headers:
+            return 401, ''
+        if 'POST' == method:
+            with store.lock:
+                store.update(parse_qsl(body, keep_blank_values=True))
+            return 204, ''
+        aliases = [unquote_plus(a) for a in query.split('&') if a]
+        since = self.since(headers) or 0
+        with store.lock:
+            if 'request-timeout' in headers:
+                # a long poll, held until an alias changes after since
+                timeout = int(headers['request-timeout']) / 1000.0
+                end = time.time() + timeout
+                while max([store.modified.get(a, 0) for a in aliases]
+                          + [0]) <= since:
+                    left = end - time.time()
+                    if left <= 0:
+                        return 304, ''
+                    store.changed.wait(left)
+            found = [(a, store.values[a]) for a in aliases
+                     if a in store.values]
+            modified = max([store.modified.get(a, 0) for a in aliases]
+                           + [0])
+        if not found:
+            return 204, ''
+        return 200, (urlencode(found), modified)
+
+    @staticmethod
+    def since(headers):
+        try:
+            return parsedate_to_datetime(
+                headers['if-modified-since']).timestamp()
+        except (KeyError, TypeError, ValueError):
+            return None
+
+    def send(self, status, reply, close):
+        args = self.server.store.args
+        if isinstance(reply, tuple):
+            reply, modified = reply
+        else:
+            modified = 0
+        data = reply.encode('latin-1')
+        head = ['HTTP/1.1 %d %s' % (status, STATUS_TEXT.get(status, '')),
+                'Date: ' + formatdate(usegmt=True),
+                'Content-Type: application/x-www-form-urlencoded; '
+                'charset=utf-8']
+        if modified:
+            head.append('Last-Modified: ' + formatdate(modified, usegmt=True))
+        if close:
+            head.append('Connection: close')
+        if args.chunked and data:
+            head.append('Transfer-Encoding: chunked')
+            # split the body so the client has to join chunks
+            chunks = [data[i:i + args.chunk_size]
+                      for i in range(0, len(data), args.chunk_size)]
+            data = b''.join(b'%x\r\n%s\r\n' % (len(c), c) for c in chunks)
+            data += b'0\r\n\r\n'
+        else:
+            head.append('Content-Length: %d' % len(data))
+        self.wfile.write(('\r\n'.join(head) + '\r\n\r\n').encode('latin-1')
+                         + data)
+        self.wfile.flush()
+
+    def reset(self):
+        # SO_LINGER of 0 makes close send RST rather than FIN
+        sock = self.request
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_LINGER,
+                        b'\x01\x00\x00\x00\x00\x00\x00\x00')
+        sock.close()
+
+    def log(self, status, method, target):
+        if self.server.store.args.verbose:
+            sys.stderr.write('%s %s %s\n' % (status, method, target))
+
+
+class Server(socketserver.ThreadingTCPServer):
+    allow_reuse_address = True
+    daemon_threads = True
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--port', type=int, default=8080)
+    parser.add_argument('--tls', nargs=2, metavar=('CERT', 'KEY'),
+                        help='serve HTTPS with this PEM certificate and key')
+    parser.add_argument('--latency', type=float, default=0,
+                        help='ms added before each reply')
+    parser.add_argument('--jitter', type=float, default=0,
+                        help='up to this many ms more, picked at random')
+    parser.add_argument('--reset', type=float, default=0,
+                        help='share of requests answered with a TCP reset')
+    parser.add_argument('--unauthorized', type=float, default=0,
+                        help='share of alias requests answered with 401')
+    parser.add_argument('--activate', type=int, default=200,
+                        choices=(200, 404, 409),
+                        help='status of /provision/activate')
+    parser.add_argument('--chunked', action='store_true',
+                        help='send bodies with Transfer-Encoding: chunked')
+    parser.add_argument('--chunk-size', type=int, default=4)
+    parser.add_argument('--close-after', type=int, default=0,
+                        help='close a connection after this many requests')
+    parser.add_argument('--tick', metavar='ALIAS:MS',
+                        help='set ALIAS to the time in ms every MS ms')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--verbose', action='store_true')
+    args = parser.parse_args()
+
+    server = Server(('127.0.0.1', args.port), Handler)
+    server.store = Store(args)
+    if args.tls:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(args.tls[0], args.tls[1])
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+    if args.tick:
+        alias, _, ms = args.tick.partition(':')
+        threading.Thread(target=server.store.tick, args=(alias, int(ms)),
+                         daemon=True).start()
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    sys.stderr.write('%d requests on %d connections\n'
+                     % (server.store.requests, server.store.connections))
+
+
+if '__main__' == __name__:
+    main()
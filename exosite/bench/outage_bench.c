@@ -0,0 +1,226 @@
+/*****************************************************************************
+*
+*  outage_bench.c - Counts connect attempts through a server outage.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+/*
+ * Drives Exosite_Write from a loop the way the app does, first at a port
+ * nothing listens on, an outage, then at mock_onep.py, the server back.
+ * Prints the connect attempts made in each minute of the outage and how
+ * long the client took to get through once the server was back, for the
+ * reconnect policy and for retrying without one. Built and run from the
+ * top of the tree:
+ *
+ *   cc -I. -o outage_bench exosite/bench/outage_bench.c \
+ *      $(ls exosite/exosite*.c | grep -v exosite_hal.c)
+ *   python3 exosite/bench/mock_onep.py --port 8080 &
+ *   ./outage_bench -p 8080 -m 10 -s 20
+ *
+ * -s runs the outage that many times faster than real time: the policy
+ * delays and the loop period are divided by it and the times printed
+ * are scaled back. The 2 s of backoff a blocking connect sits out
+ * itself is not scaled, so at large -s the loop stalls more than a
+ * device would. The attempts are still paced by the policy.
+ */
+#include <exosite/exosite.h>
+#include <exosite/exosite_hal.h>
+#include <exosite/exosite_meta.h>
+#include <exosite/exosite_backoff.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// local defines
+#define BENCH_PORT 8080
+#define BENCH_DEAD_PORT 1               // nothing listens, connects are refused
+#define BENCH_MINUTES 10
+#define BENCH_SCALE 20
+#define BENCH_LOOP_MS 3000              // as the app retries activation
+#define BENCH_RECOVER_MS 600000         // give up on the server coming back
+#define BENCH_CIK "0123456789abcdef0123456789abcdef01234567"
+// as RECONNECT_* in exosite.c
+#define BENCH_BASE_MS 1000UL
+#define BENCH_CAP_MS 300000UL
+#define BENCH_OPEN_AFTER 5
+
+// local functions
+static void set_port(int port);
+static int bench_run(const char *name, uint32_t base_ms, uint32_t cap_ms,
+                     uint8_t open_after);
+
+static int live_port = BENCH_PORT;
+static int minutes = BENCH_MINUTES;
+static int scale = BENCH_SCALE;
+
+
+/*****************************************************************************
+*
+*  main
+*
+*  \param  -p port of the server; -m minutes of outage; -s time scale
+*
+*  \return 0 if the client got through once the server was back; 1 otherwise
+*
+*  \brief  Runs the outage with and without the reconnect policy
+*
+*****************************************************************************/
+int
+main(int argc, char *argv[])
+{
+  int failed = 0;
+  int opt;
+
+  while (-1 != (opt = getopt(argc, argv, "p:m:s:")))
+  {
+    if ('p' == opt)
+      live_port = atoi(optarg);
+    else if ('m' == opt)
+      minutes = atoi(optarg);
+    else if ('s' == opt)
+      scale = atoi(optarg);
+    else
+    {
+      fprintf(stderr, "usage: %s [-p port] [-m minutes] [-s scale]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (1 > scale)
+    scale = 1;
+
+  setenv("EXOSITE_SERVER", "127.0.0.1", 0);
+  setenv("EXOSITE_UUID", "001DC9000001", 0);
+  setenv("EXOSITE_NV_FILE", "outage_bench.bin", 0);
+
+  printf("%-10s %6s %9s %9s %7s %7s %7s %10s\n", "policy", "minute",
+         "attempts", "blocked", "opens", "halfs", "closes", "recover s");
+  // no delay and no circuit to speak of, every call tries the server
+  failed += bench_run("none", 0, 0, 255);
+  failed += bench_run("backoff", BENCH_BASE_MS, BENCH_CAP_MS,
+                      BENCH_OPEN_AFTER);
+
+  return 0 != failed;
+}
+
+
+/*****************************************************************************
+*
+*  set_port
+*
+*  \param  port - port of the server to connect to
+*
+*  \return None
+*
+*  \brief  Points the client at a port of the local host
+*
+*****************************************************************************/
+static void
+set_port(int port)
+{
+  unsigned char server[META_SERVER_SIZE] = {127, 0, 0, 1, 0, 0};
+
+  server[4] = (unsigned char)(port >> 8);
+  server[5] = (unsigned char)port;
+  exosite_meta_write(server, META_SERVER_SIZE, META_SERVER);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  bench_run
+*
+*  \param  name - printed; base_ms, cap_ms, open_after - the policy
+*
+*  \return 0 if the client got through once the server was back; 1 otherwise
+*
+*  \brief  Writes every loop period through the outage, printing the
+*          counters of each minute, then until the server answers
+*
+*****************************************************************************/
+static int
+bench_run(const char *name, uint32_t base_ms, uint32_t cap_ms,
+          uint8_t open_after)
+{
+  ExositeBackoffStats last, now;
+  unsigned long minute_start, back;
+  int minute = 0;
+  int ok = 0;
+
+  if (!Exosite_Init("renesas", "rl78g14", IF_WIFI, 1))
+  {
+    fprintf(stderr, "Exosite_Init failed, status %d\n", Exosite_StatusCode());
+    return 1;
+  }
+  Exosite_SetCIK(BENCH_CIK);
+  Exosite_SetReconnectPolicy(base_ms / scale, cap_ms / scale, open_after);
+  Exosite_Disconnect();
+  set_port(BENCH_DEAD_PORT);
+
+  Exosite_GetReconnectStats(&last);
+  minute_start = exoHAL_MSTimerGet();
+  while (minute < minutes)
+  {
+    Exosite_Write("ping=1", 6);
+    exoHAL_MSDelay(BENCH_LOOP_MS / scale);
+
+    if ((exoHAL_MSTimerGet() - minute_start) * scale < 60000)
+      continue;
+    minute_start += 60000 / scale;
+    minute++;
+    Exosite_GetReconnectStats(&now);
+    printf("%-10s %6d %9u %9u %7u %7u %7u\n", name, minute,
+           now.attempts - last.attempts, now.blocked - last.blocked,
+           now.opens - last.opens, now.half_opens - last.half_opens,
+           now.closes - last.closes);
+    last = now;
+  }
+
+  // the server is back, the loop goes on until a write gets through
+  set_port(live_port);
+  back = exoHAL_MSTimerGet();
+  while (!ok && (exoHAL_MSTimerGet() - back) * scale < BENCH_RECOVER_MS)
+  {
+    ok = Exosite_Write("ping=1", 6);
+    if (!ok)
+      exoHAL_MSDelay(BENCH_LOOP_MS / scale);
+  }
+  Exosite_GetReconnectStats(&now);
+  printf("%-10s %6s %9u %9u %7u %7u %7u %10.1f\n", name, "total",
+         now.attempts, now.blocked, now.opens, now.half_opens, now.closes,
+         ok ? (exoHAL_MSTimerGet() - back) * scale / 1000.0 : -1.0);
+  Exosite_Disconnect();
+
+  return !ok;
+}
+
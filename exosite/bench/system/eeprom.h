@@ -0,0 +1,11 @@
+/*-------------------------------------------------------------------------*
+ * File:  eeprom.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Host stand-in for the system/eeprom.h exosite_hal.c includes, the
+ *     board's header is YRDKRL78G14/system/EEPROM.h.
+ *-------------------------------------------------------------------------*/
+#include <YRDKRL78G14/system/EEPROM.h>
+/*-------------------------------------------------------------------------*
+ * End of File:  eeprom.h
+ *-------------------------------------------------------------------------*/
@@ -34,11 +34,13 @@
 *****************************************************************************/
 #include "exosite_hal.h"
 #include "exosite_meta.h"
+#include "exosite_http.h"
+#include "exosite_backoff.h"
+#include "exosite_clock.h"
 #include "exosite.h"
 
 #include <stdio.h>
 #include <string.h>
-#include <apps/apps.h>
 #include <exosite/exosite.h>
 #include <inc/common.h>
 
@@ -48,37 +50,114 @@
 #define RX_SIZE 50
 #define CIK_LENGTH 40
 #define MAC_LEN 6
+#define TX_SIZE 512   // request line, headers and a full 255 byte body
+#define KEY_SIZE 32   // longest alias matched in a read response
+#define POLL_HEADERS_SIZE 96    // Request-Timeout and If-Modified-Since lines
+#define POLL_RECV_MARGIN 3000   // ms to wait past the long poll timeout
+#define DNS_TTL 86400UL         // s a resolved server address is trusted
+#define DNS_RETRY 300UL         // s before a failed lookup is tried again
+#define DNS_MAX_CONNECT_FAILS 2 // failed connects before resolving early
+#define RECONNECT_BASE_MS 1000UL
+#define RECONNECT_CAP_MS 300000UL
+#define RECONNECT_OPEN_AFTER 5  // failed connects in a row that open the circuit
+#define CONNECT_WAIT_MAX 2000   // ms of backoff sat out inside a connect
+#define SNTP_ACCURACY_MS 50     // module clock against the SNTP server
+#define SNTP_SYNC_WAIT_MS 10000 // ms a module sync may take, as exoHAL_TimeSyncEnable asks
+#define DATE_ACCURACY_MS 1000   // clock set from a Date header's whole seconds
+#define ASYNC_RECV_TIMEOUT 3000 // ms of silence that ends an async response
 char exosite_provision_info[EXOSITE_LENGTH];
 
-enum lineTypes
+enum requestMethods
 {
-  CIK_LINE,
-  HOST_LINE,
-  CONTENT_LINE,
-  ACCEPT_LINE,
-  LENGTH_LINE,
-  GETDATA_LINE,
-  POSTDATA_LINE,
-  EMPTY_LINE
+  GET_REQUEST,
+  POST_REQUEST,
+  RPC_REQUEST
 };
 
+enum asyncStates
+{
+  ASYNC_IDLE,
+  ASYNC_CONNECT,      // waiting out the backoff, then opening the socket
+  ASYNC_SSL,          // socket open, SSL handshake next
+  ASYNC_RECV          // request sent, reading the response
+};
+
+enum asyncKinds
+{
+  ASYNC_READWRITE,
+  ASYNC_LONGPOLL
+};
+
+typedef struct
+{
+  char *buf;
+  unsigned char size;
+  unsigned char len;
+} BodyBuffer;
+
+typedef struct
+{
+  ExositeKeyValue *table;
+  unsigned char count;
+  unsigned char found;      // entries matched so far
+  unsigned char in_value;   // past the '=' of the current pair
+  unsigned char escape;     // digits of a %XX escape seen so far
+  unsigned char escaped;    // value of the first escape digit
+  unsigned char key_len;
+  char key[KEY_SIZE];
+  ExositeKeyValue *match;   // entry receiving the current value
+} FormDecoder;
+
+typedef struct
+{
+  const char * const *aliases;
+  unsigned char count;
+  ExositeRecordSource source;
+  void *ctx;
+  const char *cik;
+  unsigned char sending;    // 0 only counts the body, 1 sends it
+  unsigned char calls;      // record calls in the body
+  unsigned char mismatch;   // the body sent was not the one counted
+  unsigned long len;        // body bytes counted or sent
+} RecordWriter;
+
+typedef struct
+{
+  unsigned char matched;    // characters of STR_RPC_OK matched so far
+  unsigned char ok;         // calls the server reported ok
+} RpcResult;
+
 typedef struct
 {
-  char dayStr[3];
-  char monStr[4];
-  char yearStr[5];
-  char hourStr[3];
-  char minStr[3];
-  char secStr[3];
-} DateTime;
+  unsigned char state;      // asyncStates
+  unsigned char kind;       // asyncKinds, picks the result handed to done
+  unsigned char reused;     // sent on the kept-alive connection
+  unsigned char tries;      // connect attempts so far
+  long sock;                // socket being connected
+  unsigned long start;      // for conn_stats.request_ms
+  unsigned long commands;   // for conn_stats.request_cmds
+  unsigned long bytes;      // for conn_stats.request_bytes
+  unsigned long last_rx;    // when data last arrived
+  unsigned long timeout;    // ms of silence that end the response
+  ExositeLongPoll *poll;
+  ExositeAsyncDone done;
+  void *ctx;
+  FormDecoder form;
+  exosite_http_parser parser;
+} AsyncRequest;
 
 #define STR_CIK_HEADER "X-Exosite-CIK: "
 #define STR_CONTENT_LENGTH "Content-Length: "
-#define STR_GET_URL "GET /onep:v1/stack/alias?"
-#define STR_HTTP "  HTTP/1.1\r\n"
-#define STR_HOST "Host: m2.exosite.com\r\n"
+#define STR_ALIAS_URL "/onep:v1/stack/alias"
+#define STR_ACTIVATE_URL "/provision/activate"
+#define STR_RPC_URL "/onep:v1/rpc/process"
+#define STR_HTTP " HTTP/1.1\r\n"
+#define STR_SERVER_NAME "m2.exosite.com"
+#define STR_HOST "Host: " STR_SERVER_NAME "\r\n"
 #define STR_ACCEPT "Accept: application/x-www-form-urlencoded; charset=utf-8\r\n"
 #define STR_CONTENT "Content-Type: application/x-www-form-urlencoded; charset=utf-8\r\n"
+#define STR_CONTENT_JSON "Content-Type: application/json; charset=utf-8\r\n"
+#define STR_RPC_OK "\"status\":\"ok\""
 #define STR_VENDOR "vendor="
 #define STR_MODEL "model="
 #define STR_SN "sn="
@@ -88,21 +167,75 @@ typedef struct
 static int info_assemble(const char * vendor, const char *model, const char *sn);
 static int init_UUID(unsigned char if_nbr);
 static void update_m2ip(void);
-static int get_http_status(long socket);
+static int read_response(long socket, exosite_http_parser *parser);
+static void collect_body(exosite_http_parser *parser, const char *data,
+                         unsigned short len);
+static void decode_form(exosite_http_parser *parser, const char *data,
+                        unsigned short len);
+static void decode_form_char(FormDecoder *form, char c);
 static long connect_to_exosite(char *);
+static long get_connection(unsigned char *reused);
+static int retry_on_stale(int http_status, unsigned char reused);
+static void request_stats(unsigned long commands, unsigned long bytes);
+static int send_request(exosite_http_parser *parser,
+                        void (*writer)(void *), void *ctx);
+static int alias_request(unsigned char method, const char *pbuf,
+                         unsigned char bufsize, ExositeKeyValue *table,
+                         unsigned char count, ExositeLongPoll *poll,
+                         int *found);
+static int alias_prepare(unsigned char method, const char *pbuf,
+                         unsigned char bufsize, ExositeKeyValue *table,
+                         unsigned char count, ExositeLongPoll *poll,
+                         FormDecoder *form);
+static int readwrite_result(int http_status);
+static int longpoll_result(int http_status, int found);
+static int poll_seen(ExositeLongPoll *poll, const ExositeKeyValue *kv,
+                     const exosite_http_parser *parser);
+static int client_busy(void);
+static int async_start(unsigned char kind, ExositeLongPoll *poll,
+                       ExositeAsyncDone done, void *ctx);
+static void async_connect(void);
+static void async_ssl(void);
+static void async_send(void);
+static void async_recv(void);
+static void async_complete(int http_status);
+static void sync_clock(exosite_http_parser *parser);
 static long connect_to_exosite_with_server_addr(char *, unsigned char *);
-static void sendLine(long socket, unsigned char LINE, const char * payload);
-static int parse_datetime(const char *, int strLen, DateTime *);
-static int month_to_num(const char *month);
+static int build_request(unsigned char method, const char *path,
+                         const char * const *query, unsigned char count,
+                         const char *cik, const char *headers,
+                         const char *body, unsigned short bodylen);
+static void request_append(const char *data, unsigned short len);
+static void request_flush(void);
+static void record_send(void *ctx);
+static void record_encode(RecordWriter *rec);
+static void record_string(RecordWriter *rec, const char *str);
+static void record_out(RecordWriter *rec, const char *data, unsigned short len);
+static void check_rpc(exosite_http_parser *parser, const char *data,
+                      unsigned short len);
 
 // global functions
 
 // externs
-extern char *itoa(int n, char *s, int b);
 
 // global variables
 static int status_code = 0;
 static int exosite_initialized = 0;
+static long exosite_sock = -1;
+static ExositeConnStats conn_stats;
+static unsigned char connect_fails = 0;
+static unsigned char cik_checked = 0;    // the CIK in meta was found to be hex
+static unsigned char dns_loaded = 0;
+static unsigned long dns_expiry = 0;
+static exosite_backoff reconnect;
+static char tx_buf[TX_SIZE];
+static unsigned short tx_len = 0;
+static AsyncRequest async = {ASYNC_IDLE};
+static unsigned char sntp_enabled = 0;
+static unsigned char module_time_sntp = 0; // the module clock was last set by SNTP
+static unsigned long sntp_start = 0;    // ms the module's syncs were started
+static unsigned long sntp_period_ms = 0;
+static unsigned long sntp_due = 0;      // ms by which its next sync is done
 
 /*****************************************************************************
 *
@@ -205,8 +338,11 @@ Exosite_Init(const char *vendor, const char *model, const unsigned char if_nbr,
 {
   char struuid[EXOSITE_SN_MAXLENGTH];
   unsigned char uuid_len = 0;
+  uint32_t seed = 0;
+  unsigned char i;
 
   exosite_meta_init(reset);          //always initialize Exosite meta structure
+  cik_checked = 0;
   uuid_len = exoHAL_ReadUUID(if_nbr, (unsigned char *)struuid);
 
   if (0 == uuid_len)
@@ -227,6 +363,13 @@ Exosite_Init(const char *vendor, const char *model, const unsigned char if_nbr,
 
   exosite_meta_write((unsigned char *)struuid, uuid_len, META_UUID);
 
+  // spread the reconnect jitter of the fleet by device
+  for (i = 0; i < uuid_len; i++)
+    seed = seed * 31 + (unsigned char)struuid[i];
+  exosite_backoff_seed(seed);
+  exosite_backoff_init(&reconnect, RECONNECT_BASE_MS, RECONNECT_CAP_MS,
+                       RECONNECT_OPEN_AFTER);
+
   // read UUID into 'sn'
   info_assemble(vendor, model, struuid);
 
@@ -254,107 +397,49 @@ Exosite_Init(const char *vendor, const char *model, const unsigned char if_nbr,
 int
 Exosite_Activate(void)
 {
-  int length;
-  char strLen[5];
   int newcik = 0;
   int http_status = 0;
-  char *cmp_ss = "Content-Length: 40";
-  char *cmp = cmp_ss;
+  char NCIK[CIK_LENGTH + 1];
+  BodyBuffer body = {NCIK, CIK_LENGTH + 1, 0}; // room to spot a long body
+  exosite_http_parser parser;
 
   if (!exosite_initialized) {
     status_code = EXO_STATUS_INIT;
     return newcik;
   }
-  update_m2ip();        //check our IP api to see if the old IP is advertising a new one
 
-  long sock = connect_to_exosite(EXOSITE_CA_NAME);
-  if (sock < 0) {
+  if (client_busy())
+    return newcik;
+
+  // body is the activation vendor, model and serial number
+  if (!build_request(POST_REQUEST, STR_ACTIVATE_URL, NULL, 0, NULL, NULL,
+                     exosite_provision_info, strlen(exosite_provision_info)))
+  {
+    status_code = EXO_STATUS_BAD_SIZE;
+    return newcik;
+  }
+
+  exosite_http_init(&parser, collect_body, &body);
+  http_status = send_request(&parser, NULL, NULL);
+  if (http_status < 0) {
     status_code = EXO_STATUS_BAD_TCP;
     return 0;
   }
 
-  // Get activation Serial Number
-  length = strlen(exosite_provision_info);
-  itoa(length, strLen, 10); //make a string for length
-
-  sendLine(sock, POSTDATA_LINE, "/provision/activate");
-  sendLine(sock, HOST_LINE, NULL);
-  sendLine(sock, CONTENT_LINE, NULL);
-  sendLine(sock, LENGTH_LINE, strLen);
-
-  exoHAL_SocketSend(sock, exosite_provision_info, length);
-
-  http_status = get_http_status(sock);
-
   if (200 == http_status)
   {
-    char strBuf[RX_SIZE];
-    unsigned char strLen, len;
-    unsigned char cik_len_valid = 0;
-    char *p;
-    unsigned char crlf = 0;
-    unsigned char ciklen = 0;
-    char NCIK[CIK_LENGTH + 1];
-
-    do
-    {
-      strLen = exoHAL_SocketRecv(sock, strBuf, RX_SIZE);
-      len = strLen;
-      p = strBuf;
-
-      // Find 4 consecutive \r or \n - should be: \r\n\r\n
-      while (0 < len && 4 > crlf)
-      {
-        if ('\r' == *p || '\n' == *p)
-        {
-          ++crlf;
-        }
-        else
-        {
-          crlf = 0;
-          
-          if(*cmp == *p)
-          {
-            // check the cik length from http response
-            cmp++;
-            if(cmp > cmp_ss + strlen(cmp_ss) - 1)
-              cik_len_valid = 1;
-          }
-          else
-            cmp = cmp_ss;
-        }
-        ++p;
-        --len;
-      }
-
-      // The body is the cik
-      if (0 < len && 4 == crlf && CIK_LENGTH > ciklen)
-      {
-        // TODO, be more robust - match Content-Length header value to CIK_LENGTH
-        unsigned char need, part;
-        if (!(cik_len_valid == 1)) // cik length != 40
-        {
-          status_code = EXO_STATUS_CONFLICT;
-          exoHAL_SocketClose(sock);
-          return newcik;
-        }
-        need = CIK_LENGTH - ciklen;
-        part = need < len ? need : len;
-        strncpy(NCIK + ciklen, p, part);
-        ciklen += part;
-      }
-    } while (RX_SIZE == strLen);
-
-    if (CIK_LENGTH == ciklen)
+    // The body is the cik, chunked or with a Content-Length
+    if (CIK_LENGTH != body.len
+        || (parser.has_length && CIK_LENGTH != parser.content_length))
     {
-      NCIK[40] = 0;
-      Exosite_SetCIK(NCIK);
-      newcik = 1;
+      status_code = EXO_STATUS_CONFLICT;
+      return newcik;
     }
+    NCIK[CIK_LENGTH] = 0;
+    Exosite_SetCIK(NCIK);
+    newcik = 1;
   }
 
-  exoHAL_SocketClose(sock);
-
   if (200 == http_status)
     status_code = EXO_STATUS_OK;
   if (404 == http_status)
@@ -387,6 +472,7 @@ Exosite_SetCIK(char * pCIK)
     return;
   }
   exosite_meta_write((unsigned char *)pCIK, CIK_LENGTH, META_CIK);
+  cik_checked = 0;
   status_code = EXO_STATUS_OK;
   return;
 }
@@ -413,7 +499,8 @@ Exosite_GetCIK(char * pCIK)
   exosite_meta_read((unsigned char *)tempCIK, CIK_LENGTH, META_CIK);
   tempCIK[CIK_LENGTH] = 0;
 
-  for (i = 0; i < CIK_LENGTH; i++)
+  // meta is only changed through us, so the CIK needs checking once
+  for (i = 0; !cik_checked && i < CIK_LENGTH; i++)
   {
     if (!(tempCIK[i] >= 'a' && tempCIK[i] <= 'f' || tempCIK[i] >= '0' && tempCIK[i] <= '9'))
     {
@@ -421,6 +508,7 @@ Exosite_GetCIK(char * pCIK)
       return 0;
     }
   }
+  cik_checked = 1;
 
   if (NULL != pCIK)
     memcpy(pCIK ,tempCIK ,CIK_LENGTH + 1);
@@ -447,26 +535,21 @@ Exosite_Write(char * pbuf, unsigned char bufsize)
   int success = 0;
   int http_status = 0;
   char bufCIK[41];
-  char strBuf[10];
+  exosite_http_parser parser;
 
   if (!exosite_initialized) {
     status_code = EXO_STATUS_INIT;
     return success;
   }
 
+  if (client_busy())
+    return success;
+
   if (!Exosite_GetCIK(bufCIK))
   {
     return success;
   }
 
-
-  long sock = connect_to_exosite(EXOSITE_CA_NAME);
-  if (sock < 0) {
-    status_code = EXO_STATUS_BAD_TCP;
-    return 0;
-  }
-
-
 // This is an example write POST...
 //  s.send('POST /onep:v1/stack/alias HTTP/1.1\r\n')
 //  s.send('Host: m2.exosite.com\r\n')
@@ -475,18 +558,19 @@ Exosite_Write(char * pbuf, unsigned char bufsize)
 //  s.send('Content-Length: 6\r\n\r\n')
 //  s.send('temp=2')
 
-  itoa((int)bufsize, strBuf, 10); //make a string for length
-
-  sendLine(sock, POSTDATA_LINE, "/onep:v1/stack/alias");
-  sendLine(sock, HOST_LINE, NULL);
-  sendLine(sock, CIK_LINE, bufCIK);
-  sendLine(sock, CONTENT_LINE, NULL);
-  sendLine(sock, LENGTH_LINE, strBuf);
-  exoHAL_SocketSend(sock, pbuf, bufsize);
-
-  http_status = get_http_status(sock);
+  if (!build_request(POST_REQUEST, STR_ALIAS_URL, NULL, 0, bufCIK, NULL,
+                     pbuf, bufsize))
+  {
+    status_code = EXO_STATUS_BAD_SIZE;
+    return success;
+  }
 
-  exoHAL_SocketClose(sock);
+  exosite_http_init(&parser, NULL, NULL);
+  http_status = send_request(&parser, NULL, NULL);
+  if (http_status < 0) {
+    status_code = EXO_STATUS_BAD_TCP;
+    return 0;
+  }
 
   if (401 == http_status)
   {
@@ -518,110 +602,53 @@ Exosite_Write(char * pbuf, unsigned char bufsize)
 int
 Exosite_Read(char * palias, char * pbuf, unsigned char buflen)
 {
-  int success = 0;
-  int http_status = 0;
-  char bufCIK[41];
-  unsigned char strLen, len, vlen;
-  char *p, *pcheck;
+  ExositeKeyValue kv;
 
-  if (!exosite_initialized) {
-    status_code = EXO_STATUS_INIT;
-    return success;
-  }
+  kv.alias = palias;
+  kv.value = pbuf;
+  kv.size = buflen;
 
-  if (!Exosite_GetCIK(bufCIK))
-  {
-    return success;
-  }
+  if (!Exosite_ReadMany(&kv, 1))
+    return 0;
 
+  return kv.len;
+}
 
-  long sock = connect_to_exosite(EXOSITE_CA_NAME);
-  if (sock < 0) {
-    status_code = EXO_STATUS_BAD_TCP;
-    return 0;
-  }
+
+/*****************************************************************************
+*
+* Exosite_ReadMany
+*
+*  \param  table - aliases to read, each with a buffer for its value
+*          count - number of entries in table
+*
+*  \return number of aliases found in the response
+*
+*  \brief  Reads several datasources from Exosite cloud in one request.
+*          Values are url-decoded into the table, len is 0 for aliases
+*          that were not returned. A value is 0 terminated when it leaves
+*          room for it.
+*
+*****************************************************************************/
+int
+Exosite_ReadMany(ExositeKeyValue *table, unsigned char count)
+{
+  int found = 0;
+  int http_status;
 
 // This is an example read GET
-//  s.send('GET /onep:v1/stack/alias?temp HTTP/1.1\r\n')
+//  s.send('GET /onep:v1/stack/alias?temp&led_ctrl HTTP/1.1\r\n')
 //  s.send('Host: m2.exosite.com\r\n')
 //  s.send('X-Exosite-CIK: 5046454a9a1666c3acfae63bc854ec1367167815\r\n')
 //  s.send('Accept: application/x-www-form-urlencoded; charset=utf-8\r\n\r\n')
+// and the response body is 'temp=2&led_ctrl=1'
 
-  sendLine(sock, GETDATA_LINE, palias);
-  sendLine(sock, HOST_LINE, NULL);
-  sendLine(sock, CIK_LINE, bufCIK);
-  sendLine(sock, ACCEPT_LINE, "\r\n");
-
-  pcheck = palias;
-  vlen = 0;
-
-  http_status = get_http_status(sock);
-  if (200 == http_status)
-  {
-    char strBuf[RX_SIZE];
-    unsigned char crlf = 0;
-
-    do
-    {
-      strLen = exoHAL_SocketRecv(sock, strBuf, RX_SIZE);
-      len = strLen;
-      p = strBuf;
-
-      // Find 4 consecutive \r or \n - should be: \r\n\r\n
-      while (0 < len && 4 > crlf)
-      {
-        if ('\r' == *p || '\n' == *p)
-        {
-          ++crlf;
-        }
-        else
-        {
-          crlf = 0;
-        }
-        ++p;
-        --len;
-      }
-
-      // The body is "<key>=<value>"
-      if (0 < len && 4 == crlf && buflen > vlen)
-      {
-        // Move past "<key>"
-        while (0 < len && 0 != *pcheck)
-        {
-          if (*pcheck == *p)
-          {
-            ++pcheck;
-          }
-          else
-          {
-            pcheck = palias;
-          }
-          ++p;
-          --len;
-        }
-
-        // Match '=',  we should now have '<key>='
-        if (0 < len && 0 == *pcheck && '=' == *p)
-        {
-          ++p;
-          --len;
-        }
-
-        // read in the rest of the body as the value
-        while (0 < len && buflen > vlen)
-        {
-          pbuf[vlen++] = *p++;
-          --len;
-        }
-      }
-    } while (RX_SIZE == strLen);
-  }
-
-  exoHAL_SocketClose(sock);
+  http_status = alias_request(GET_REQUEST, NULL, 0, table, count, NULL, &found);
 
   if (200 == http_status)
   {
     status_code = EXO_STATUS_OK;
+    return found;
   }
   if (204 == http_status)
   {
@@ -632,375 +659,1916 @@ Exosite_Read(char * palias, char * pbuf, unsigned char buflen)
     status_code = EXO_STATUS_NOAUTH;
   }
 
-  return vlen;
+  return 0;
 }
 
+
+/*****************************************************************************
+*
+* Exosite_ReadWrite
+*
+*  \param  pbuf - string buffer containing data to be sent
+*          bufsize - number of bytes to send
+*          table - aliases to read back, each with a buffer for its value
+*          count - number of entries in table
+*
+*  \return 1 success; 0 failure
+*
+*  \brief  Writes data to Exosite cloud and reads datasources back in the
+*          same request. The table is filled in as for Exosite_ReadMany.
+*
+*****************************************************************************/
 int
-Exosite_SyncTime()
+Exosite_ReadWrite(char * pbuf, unsigned char bufsize,
+                  ExositeKeyValue *table, unsigned char count)
 {
-  char day[11];
-  char time[9];
-  int http_status = 0;
-  int strLen;
-  char *testStr = "GET /ip HTTP/1.1\r\n";
-  unsigned char serverAddr[6] = {54, 183, 115, 21, 0, 80};
-  char strBuf[RX_SIZE];
-  DateTime datetime;
+  int found = 0;
+  int http_status;
 
-  if (!exosite_initialized)
-  {
-    return -1;
-  }
+// This is an example write POST with read back...
+//  s.send('POST /onep:v1/stack/alias?led_ctrl HTTP/1.1\r\n')
+//  s.send('Host: m2.exosite.com\r\n')
+//  s.send('X-Exosite-CIK: 5046454a9a1666c3acfae63bc854ec1367167815\r\n')
+//  s.send('Content-Type: application/x-www-form-urlencoded; charset=utf-8\r\n')
+//  s.send('Content-Length: 6\r\n\r\n')
+//  s.send('temp=2')
+// and the response body is 'led_ctrl=1'
 
-  long sock = connect_to_exosite_with_server_addr("", serverAddr);
-  if (sock < 0)
-  {
-    return -1;
-  }
+  http_status = alias_request(POST_REQUEST, pbuf, bufsize, table, count, NULL,
+                              &found);
+
+  return readwrite_result(http_status);
+}
 
-  exoHAL_SocketSend(sock, testStr, strlen(testStr));
-  sendLine(sock, HOST_LINE, NULL);
-  sendLine(sock, ACCEPT_LINE, "\r\n");
 
-  http_status = get_http_status(sock);
-  if (200 != http_status)
-     return -1;
+/*****************************************************************************
+*
+* Exosite_ReadWriteStart
+*
+*  \param  pbuf - string buffer containing data to be sent
+*          bufsize - number of bytes to send
+*          table - aliases to read back, kept until done is called
+*          count - number of entries in table
+*          done - called with the Exosite_ReadWrite result, or NULL
+*          ctx - passed to done
+*
+*  \return 1 if the request was started; 0 otherwise
+*
+*  \brief  Starts an Exosite_ReadWrite that Exosite_Poll carries out
+*          without blocking. pbuf is copied before this returns.
+*
+*****************************************************************************/
+int
+Exosite_ReadWriteStart(char * pbuf, unsigned char bufsize,
+                       ExositeKeyValue *table, unsigned char count,
+                       ExositeAsyncDone done, void *ctx)
+{
+  if (0 != alias_prepare(POST_REQUEST, pbuf, bufsize, table, count, NULL,
+                         &async.form))
+    return 0;
 
-  strLen = exoHAL_SocketRecv(sock, strBuf, RX_SIZE);
+  return async_start(ASYNC_READWRITE, NULL, done, ctx);
+}
 
-  exoHAL_SocketClose(sock);
 
-  if(strLen <= 0)
-    return -1;
-     
-  if(parse_datetime(strBuf, strLen, &datetime) < 0)
-    return -1;
+/*****************************************************************************
+*
+* Exosite_ReadLongPoll
+*
+*  \param  kv - alias to read with a buffer for its value
+*          poll - long poll timeout and the Last-Modified time of the value
+*                 seen last, since[0] = 0 before the first poll
+*
+*  \return 1 if a new value was read; 0 on timeout or failure
+*
+*  \brief  Reads a datasource from Exosite cloud, letting the server hold
+*          the request until the value changes or poll->timeout ms pass.
+*          A timeout ends with status EXO_STATUS_OK and 0 returned. If the
+*          HAL loses the response headers the read is answered at once,
+*          and returns 1 only if the value differs from the last one read;
+*          the caller then sets the pace.
+*
+*****************************************************************************/
+int
+Exosite_ReadLongPoll(ExositeKeyValue *kv, ExositeLongPoll *poll)
+{
+  int found = 0;
+  int http_status;
 
-  sprintf(day, "%s/%02d/%s", datetime.dayStr, month_to_num(datetime.monStr), datetime.yearStr);
-  sprintf(time, "%s:%s:%s", datetime.hourStr, datetime.minStr, datetime.secStr);
+// This is an example long poll GET
+//  s.send('GET /onep:v1/stack/alias?led_ctrl HTTP/1.1\r\n')
+//  s.send('Host: m2.exosite.com\r\n')
+//  s.send('X-Exosite-CIK: 5046454a9a1666c3acfae63bc854ec1367167815\r\n')
+//  s.send('Request-Timeout: 5000\r\n')
+//  s.send('If-Modified-Since: Tue, 18 Nov 2014 08:53:45 GMT\r\n')
+//  s.send('Accept: application/x-www-form-urlencoded; charset=utf-8\r\n\r\n')
+// and the response is 304 on timeout, or 200 with body 'led_ctrl=1'
 
-  if(AtLibGs_SetTime(day, time) != ATLIBGS_MSG_ID_OK)
-    return -1;
+  http_status = alias_request(GET_REQUEST, NULL, 0, kv, 1, poll, &found);
 
-  return 0;
+  return longpoll_result(http_status, found);
 }
 
+
 /*****************************************************************************
 *
-* update_m2ip
+* Exosite_ReadLongPollStart
 *
-*  \param  None
+*  \param  kv - alias to read, kept until done is called
+*          poll - long poll settings, kept until done is called
+*          done - called with the Exosite_ReadLongPoll result, or NULL
+*          ctx - passed to done
 *
-*  \return None
+*  \return 1 if the request was started; 0 otherwise
 *
-*  \brief  Checks /ip API to see if a new server IP address should be used
+*  \brief  Starts an Exosite_ReadLongPoll that Exosite_Poll carries out
+*          without blocking, so the application keeps running while the
+*          server holds the request
 *
 *****************************************************************************/
-static void
-update_m2ip(void)
+int
+Exosite_ReadLongPollStart(ExositeKeyValue *kv, ExositeLongPoll *poll,
+                          ExositeAsyncDone done, void *ctx)
 {
-  //TODO - stubbed out
-  return;
+  if (0 != alias_prepare(GET_REQUEST, NULL, 0, kv, 1, poll, &async.form))
+    return 0;
+
+  return async_start(ASYNC_LONGPOLL, poll, done, ctx);
 }
 
+
 /*****************************************************************************
 *
-* connect_to_exosite
+* Exosite_Poll
 *
 *  \param  None
 *
-*  \return success: socket handle; failure: -1;
+*  \return 1 while a started request is in progress; 0 when idle
 *
-*  \brief  Establishes a connection with Exosite API server
+*  \brief  Takes the request started by an Exosite_...Start call one step
+*          further. Each step is at most one short module command, waits
+*          for the backoff and the server are spread over the calls. The
+*          other Exosite calls fail with EXO_STATUS_BUSY until this
+*          returns 0.
 *
 *****************************************************************************/
-static long
-connect_to_exosite(char *caName)
+int
+Exosite_Poll(void)
 {
-  unsigned char connectRetries = 0;
-  unsigned char server[META_SERVER_SIZE];
-  long sock = -1;
-
-  exosite_meta_read(server, META_SERVER_SIZE, META_SERVER);
-
-  while (connectRetries++ <= EXOSITE_MAX_CONNECT_RETRY_COUNT) {
-
-    sock = exoHAL_SocketOpenTCP(server);
-
-    if (sock == -1)
-    {
-      continue;
-    }
-
-    if (exoHAL_ServerConnect(sock) < 0)  // Try to connect
-    {
-      // TODO - the typical reason the connect doesn't work is because
-      // something was wrong in the way the comms hardware was initialized (timing, bit
-      // error, etc...). There may be a graceful way to kick the hardware
-      // back into gear at the right state, but for now, we just
-      // return and let the caller retry us if they want
-      continue;
-    } else {
-      
-      if(caName != NULL && strlen(caName)!= 0)
-      {
-        if(exoHAL_ClientSSLOpen(sock, caName) < 0)
-        {
-          continue;
-        }
-      }
-      
-      connectRetries = 0;
+  switch (async.state)
+  {
+    case ASYNC_CONNECT:
+      async_connect();
+      break;
+    case ASYNC_SSL:
+      async_ssl();
+      break;
+    case ASYNC_RECV:
+      async_recv();
+      break;
+    default:
       break;
-    }
   }
 
-  // Success
-  return sock;
+  return ASYNC_IDLE != async.state;
 }
 
-static long
-connect_to_exosite_with_server_addr(char *caName,
-                                    unsigned char *server)
+
+/*****************************************************************************
+*
+* Exosite_Cancel
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Drops the request in progress without calling its done. The
+*          connection is closed as the response may be half read.
+*
+*****************************************************************************/
+void
+Exosite_Cancel(void)
 {
-  unsigned char connectRetries = 0;
-  //unsigned char server[META_SERVER_SIZE];
-  long sock = -1;
+  if (ASYNC_IDLE == async.state)
+    return;
 
-  //exosite_meta_read(server, META_SERVER_SIZE, META_SERVER);
+  if (ASYNC_SSL == async.state)
+  {
+    // the connect attempt never reports back, a half-open circuit would
+    // wait on it for good
+    exoHAL_SocketClose(async.sock);
+    exosite_backoff_failure(&reconnect);
+  }
+  else if (ASYNC_RECV == async.state)
+    Exosite_Disconnect();
+  async.state = ASYNC_IDLE;
 
-  while (connectRetries++ <= EXOSITE_MAX_CONNECT_RETRY_COUNT) {
+  return;
+}
 
-    sock = exoHAL_SocketOpenTCP(server);
 
-    if (sock == -1)
-    {
-      continue;
+/*****************************************************************************
+*
+* Exosite_Record
+*
+*  \param  aliases - datasource aliases to record to
+*          count - number of aliases
+*          source - called for the samples of each alias
+*          ctx - passed to source
+*
+*  \return 1 success; 0 failure
+*
+*  \brief  Uploads timestamped samples of several datasources in one
+*          JSON-RPC request. The body is streamed from source a frame at a
+*          time, it is never held in RAM as a whole.
+*
+*****************************************************************************/
+int
+Exosite_Record(const char * const *aliases, unsigned char count,
+               ExositeRecordSource source, void *ctx)
+{
+  int http_status;
+  char bufCIK[41];
+  RecordWriter rec;
+  RpcResult result = {0, 0};
+  exosite_http_parser parser;
+
+// This is an example record POST...
+//  s.send('POST /onep:v1/rpc/process HTTP/1.1\r\n')
+//  s.send('Host: m2.exosite.com\r\n')
+//  s.send('Content-Type: application/json; charset=utf-8\r\n')
+//  s.send('Content-Length: 159\r\n\r\n')
+//  s.send('{"auth":{"cik":"5046454a9a1666c3acfae63bc854ec1367167815"},"calls":[')
+//  s.send('{"id":0,"procedure":"record","arguments":[{"alias":"temp"},')
+//  s.send('[[-2,"25.1"],[-1,"25.3"]],{}]}]}')
+// and the response body is '[{"id":0,"status":"ok"}]'
+
+  if (!exosite_initialized) {
+    status_code = EXO_STATUS_INIT;
+    return 0;
+  }
+
+  if (client_busy())
+    return 0;
+
+  if (!Exosite_GetCIK(bufCIK))
+  {
+    return 0;
+  }
+
+  rec.aliases = aliases;
+  rec.count = count;
+  rec.source = source;
+  rec.ctx = ctx;
+  rec.cik = bufCIK;
+  rec.sending = 0;
+  rec.mismatch = 0;
+  record_encode(&rec);
+
+  if (0 == rec.calls)
+  {
+    status_code = EXO_STATUS_OK;
+    return 1;
+  }
+  if (0xffff < rec.len)
+  {
+    status_code = EXO_STATUS_BAD_SIZE;
+    return 0;
+  }
+
+  exosite_http_init(&parser, check_rpc, &result);
+  http_status = send_request(&parser, record_send, &rec);
+  if (http_status < 0) {
+    status_code = EXO_STATUS_BAD_TCP;
+    return 0;
+  }
+  if (rec.mismatch)
+  {
+    status_code = EXO_STATUS_BAD_SIZE;
+    return 0;
+  }
+
+  if (401 == http_status)
+  {
+    status_code = EXO_STATUS_NOAUTH;
+  }
+  if (200 == http_status && rec.calls == result.ok)
+  {
+    status_code = EXO_STATUS_OK;
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/*****************************************************************************
+*
+* alias_request
+*
+*  \param  method - GET_REQUEST to read, POST_REQUEST to write pbuf
+*          pbuf - data to write; bufsize - number of bytes to write
+*          table - aliases to read; count - number of entries in table
+*          poll - long poll settings, NULL for a plain request
+*          found - set to the number of aliases found in the response
+*
+*  \return http response code, -1 if the request could not be made
+*
+*  \brief  Sends a request to the alias API naming the table aliases in
+*          the query string and decodes the values in the response
+*
+*****************************************************************************/
+static int
+alias_request(unsigned char method, const char *pbuf, unsigned char bufsize,
+              ExositeKeyValue *table, unsigned char count,
+              ExositeLongPoll *poll, int *found)
+{
+  int http_status = 0;
+  FormDecoder form;
+  exosite_http_parser parser;
+
+  if (0 != alias_prepare(method, pbuf, bufsize, table, count, poll, &form))
+    return -1;
+
+  if (NULL != poll)
+    exoHAL_SetRecvTimeout(poll->timeout + POLL_RECV_MARGIN);
+
+  exosite_http_init(&parser, decode_form, &form);
+  http_status = send_request(&parser, NULL, NULL);
+
+  exoHAL_SetRecvTimeout(0);
+
+  if (http_status < 0) {
+    status_code = EXO_STATUS_BAD_TCP;
+    return -1;
+  }
+
+  if (NULL != poll && 200 == http_status && !poll_seen(poll, table, &parser))
+    form.found = 0;
+
+  *found = form.found;
+
+  return http_status;
+}
+
+/*****************************************************************************
+*
+* alias_prepare
+*
+*  \param  method, pbuf, bufsize, table, count, poll - as for alias_request
+*          form - set up to decode the response into table
+*
+*  \return 0 if the request is in tx_buf; -1 otherwise
+*
+*  \brief  Builds an alias API request
+*
+*****************************************************************************/
+static int
+alias_prepare(unsigned char method, const char *pbuf, unsigned char bufsize,
+              ExositeKeyValue *table, unsigned char count,
+              ExositeLongPoll *poll, FormDecoder *form)
+{
+  char bufCIK[41];
+  char headers[POLL_HEADERS_SIZE];
+  const char *aliases[EXOSITE_READ_MAXALIASES];
+  unsigned char i;
+
+  if (!exosite_initialized) {
+    status_code = EXO_STATUS_INIT;
+    return -1;
+  }
+
+  if (client_busy())
+    return -1;
+
+  if (!Exosite_GetCIK(bufCIK))
+  {
+    return -1;
+  }
+
+  if (EXOSITE_READ_MAXALIASES < count)
+  {
+    status_code = EXO_STATUS_BAD_SIZE;
+    return -1;
+  }
+
+  for (i = 0; i < count; i++)
+  {
+    aliases[i] = table[i].alias;
+    table[i].len = 0;
+    if (0 < table[i].size)
+      table[i].value[0] = 0;
+  }
+
+  headers[0] = 0;
+  // without Last-Modified the HAL can't follow the value, the read is
+  // answered at once and poll_seen tells whether it changed
+  if (NULL != poll && exoHAL_KeepsHeaders())
+  {
+    // the server holds the request until the value changes or timeout
+    sprintf(headers, "Request-Timeout: %lu\r\n", poll->timeout);
+    if (0 != poll->since[0])
+    {
+      strcat(headers, "If-Modified-Since: ");
+      strcat(headers, poll->since);
+      strcat(headers, STR_CRLF);
+    }
+  }
+
+  if (!build_request(method, STR_ALIAS_URL, aliases, count, bufCIK,
+                     headers, pbuf, bufsize))
+  {
+    status_code = EXO_STATUS_BAD_SIZE;
+    return -1;
+  }
+
+  memset(form, 0, sizeof(FormDecoder));
+  form->table = table;
+  form->count = count;
+
+  return 0;
+}
+
+/*****************************************************************************
+*
+* readwrite_result
+*
+*  \param  http_status - outcome of a write with read back
+*
+*  \return 1 success; 0 failure
+*
+*  \brief  Sets the status code for Exosite_ReadWrite
+*
+*****************************************************************************/
+static int
+readwrite_result(int http_status)
+{
+  if (200 == http_status || 204 == http_status)
+  {
+    status_code = EXO_STATUS_OK;
+    return 1;
+  }
+  if (401 == http_status)
+  {
+    status_code = EXO_STATUS_NOAUTH;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+*
+* longpoll_result
+*
+*  \param  http_status - outcome of a long poll; found - aliases decoded
+*
+*  \return 1 if a new value was read; 0 on timeout or failure
+*
+*  \brief  Sets the status code for Exosite_ReadLongPoll
+*
+*****************************************************************************/
+static int
+longpoll_result(int http_status, int found)
+{
+  if (200 == http_status)
+  {
+    status_code = EXO_STATUS_OK;
+    return found;
+  }
+  if (304 == http_status)
+  {
+    status_code = EXO_STATUS_OK;
+  }
+  if (401 == http_status)
+  {
+    status_code = EXO_STATUS_NOAUTH;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+*
+* poll_seen
+*
+*  \param  poll - long poll the value was read by; kv - the value read
+*          parser - the response it came in
+*
+*  \return 1 if the value is new to this poll; 0 if it was seen already
+*
+*  \brief  Keeps what the next poll of the value compares against, its
+*          Last-Modified time or, when the HAL loses the headers, a hash
+*          of the value itself
+*
+*****************************************************************************/
+static int
+poll_seen(ExositeLongPoll *poll, const ExositeKeyValue *kv,
+          const exosite_http_parser *parser)
+{
+  char since[EXOSITE_SINCE_SIZE];
+  unsigned long hash = 2166136261UL;
+  unsigned char i;
+
+  if (exoHAL_KeepsHeaders())
+  {
+    // next poll waits for a value newer than this one
+    strcpy(poll->since, 0 != parser->modified[0] ? parser->modified
+                                                  : parser->date);
+    return 1;
+  }
+
+  // FNV-1a, the value may be longer than since
+  for (i = 0; i < kv->len; i++)
+  {
+    hash ^= (unsigned char)kv->value[i];
+    hash *= 16777619UL;
+  }
+  sprintf(since, "#%08lx", hash);
+  if (0 == strcmp(since, poll->since))
+    return 0;
+  strcpy(poll->since, since);
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+* client_busy
+*
+*  \param  None
+*
+*  \return 1 if a started request owns tx_buf and the connection
+*
+*  \brief  Keeps the blocking calls out while Exosite_Poll has a request
+*
+*****************************************************************************/
+static int
+client_busy(void)
+{
+  if (ASYNC_IDLE == async.state)
+    return 0;
+
+  status_code = EXO_STATUS_BUSY;
+  return 1;
+}
+
+/*****************************************************************************
+*
+* async_start
+*
+*  \param  kind - asyncKinds; poll - long poll settings or NULL
+*          done, ctx - completion callback and its argument
+*
+*  \return 1
+*
+*  \brief  Hands the request built in tx_buf to Exosite_Poll
+*
+*****************************************************************************/
+static int
+async_start(unsigned char kind, ExositeLongPoll *poll,
+            ExositeAsyncDone done, void *ctx)
+{
+  async.kind = kind;
+  async.poll = poll;
+  async.done = done;
+  async.ctx = ctx;
+  async.tries = 0;
+  async.reused = 0;
+  async.start = exoHAL_MSTimerGet();
+  exoHAL_GetStats(&async.commands, &async.bytes);
+  async.timeout = ASYNC_RECV_TIMEOUT;
+  if (NULL != poll)
+    async.timeout = poll->timeout + POLL_RECV_MARGIN;
+  async.state = ASYNC_CONNECT;
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+* async_connect
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Uses the kept-alive connection, or makes one connect attempt
+*          once the reconnect backoff allows it. Waits that are too long
+*          to sit out fail the request, as connect_to_exosite does.
+*
+*****************************************************************************/
+static void
+async_connect(void)
+{
+  unsigned char server[META_SERVER_SIZE];
+  uint32_t wait;
+
+  if (exosite_sock >= 0)
+  {
+    if (exoHAL_SocketIsOpen(exosite_sock))
+    {
+      conn_stats.reuse_hits++;
+      async.reused = 1;
+      async_send();
+      return;
+    }
+    // server side close or DISCONNECT seen by the HAL
+    conn_stats.server_closes++;
+    Exosite_Disconnect();
+  }
+
+  wait = exosite_backoff_wait(&reconnect);
+  if (CONNECT_WAIT_MAX < wait)
+    reconnect.stats.blocked++;
+  else if (0 < wait)
+    return;
+  if (CONNECT_WAIT_MAX < wait || EXOSITE_MAX_CONNECT_RETRY_COUNT < async.tries
+      || !exosite_backoff_allow(&reconnect))
+  {
+    connect_fails++;
+    async_complete(-1);
+    return;
+  }
+
+  if (0 == async.tries++)
+  {
+    conn_stats.reuse_misses++;
+    update_m2ip();
+  }
+
+  exosite_meta_read(server, META_SERVER_SIZE, META_SERVER);
+  async.sock = exoHAL_SocketOpenTCP(server);
+  if (-1 == async.sock || exoHAL_ServerConnect(async.sock) < 0)
+  {
+    exosite_backoff_failure(&reconnect);
+    return;
+  }
+
+  async.state = ASYNC_SSL;
+
+  return;
+}
+
+/*****************************************************************************
+*
+* async_ssl
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Opens SSL on the new socket and sends the request over it
+*
+*****************************************************************************/
+static void
+async_ssl(void)
+{
+  if (exoHAL_ClientSSLOpen(async.sock, EXOSITE_CA_NAME) < 0)
+  {
+    exosite_backoff_failure(&reconnect);
+    async.state = ASYNC_CONNECT;
+    return;
+  }
+
+  exosite_backoff_success(&reconnect);
+  connect_fails = 0;
+  exosite_sock = async.sock;
+  async_send();
+
+  return;
+}
+
+/*****************************************************************************
+*
+* async_send
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Sends tx_buf over the connection and starts on the response
+*
+*****************************************************************************/
+static void
+async_send(void)
+{
+  exosite_http_init(&async.parser, decode_form, &async.form);
+  request_flush();
+  async.last_rx = exoHAL_MSTimerGet();
+  async.state = ASYNC_RECV;
+
+  return;
+}
+
+/*****************************************************************************
+*
+* async_recv
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Parses what the module has received so far. The response ends
+*          when it is complete, the server closes or it has been quiet for
+*          too long. A kept-alive connection that turns out to be stale
+*          gets one retry as in send_request.
+*
+*****************************************************************************/
+static void
+async_recv(void)
+{
+  char strBuf[RX_SIZE];
+  unsigned char strLen;
+  int http_status;
+
+  do
+  {
+    strLen = exoHAL_SocketRecvPoll(exosite_sock, strBuf, RX_SIZE);
+    if (0 < strLen)
+    {
+      async.last_rx = exoHAL_MSTimerGet();
+      exosite_http_parse(&async.parser, strBuf, strLen);
+    }
+  } while (0 < strLen && !exosite_http_done(&async.parser));
+
+  if (!exosite_http_done(&async.parser))
+  {
+    if (exoHAL_SocketIsOpen(exosite_sock)
+        && exoHAL_MSTimerGet() - async.last_rx < async.timeout)
+      return;
+    exosite_http_finish(&async.parser);
+  }
+
+  sync_clock(&async.parser);
+  http_status = async.parser.status;
+  if (retry_on_stale(http_status, async.reused))
+  {
+    async.reused = 0;
+    async.state = ASYNC_CONNECT;
+    return;
+  }
+
+  conn_stats.request_ms = exoHAL_MSTimerGet() - async.start;
+  request_stats(async.commands, async.bytes);
+
+  // without a complete response we can't tell where the next one starts
+  if (HTTP_DONE != async.parser.state || async.parser.close)
+    Exosite_Disconnect();
+  if (HTTP_DONE != async.parser.state)
+    http_status = 0;
+
+  async_complete(http_status);
+
+  return;
+}
+
+/*****************************************************************************
+*
+* async_complete
+*
+*  \param  http_status - http response code, -1 if there was no connection
+*
+*  \return None
+*
+*  \brief  Ends the request and reports it to its done callback
+*
+*****************************************************************************/
+static void
+async_complete(int http_status)
+{
+  int result;
+
+  if (http_status < 0)
+    status_code = EXO_STATUS_BAD_TCP;
+
+  if (NULL != async.poll && 200 == http_status
+      && !poll_seen(async.poll, async.form.table, &async.parser))
+    async.form.found = 0;
+
+  if (ASYNC_LONGPOLL == async.kind)
+    result = longpoll_result(http_status, async.form.found);
+  else
+    result = readwrite_result(http_status);
+
+  // idle first, done may start the next request
+  async.state = ASYNC_IDLE;
+  if (NULL != async.done)
+    async.done(async.ctx, result);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+* Exosite_SyncTime
+*
+*  \param  None
+*
+*  \return 0 success; -1 failure
+*
+*  \brief  Sets the module's clock from ours. Every response sets our clock
+*          from its Date header, so only when none has arrived yet is a
+*          plain http request made just for the time.
+*
+*****************************************************************************/
+int
+Exosite_SyncTime()
+{
+  char day[15];    // "dd/mm/yyyy", sized for any uint8_t/uint16_t fields
+  char time[12];   // "hh:mm:ss", likewise
+  int http_status = 0;
+  unsigned char serverAddr[META_SERVER_SIZE];
+  ExositeDateTime datetime;
+  exosite_http_parser parser;
+
+  if (!exosite_initialized || client_busy())
+  {
+    return -1;
+  }
+
+  if (!exosite_clock_valid())
+  {
+    // the HAL only drives one socket at a time, give up the kept-alive one
+    Exosite_Disconnect();
+
+    // plain http to the same server
+    update_m2ip();
+    exosite_meta_read(serverAddr, META_SERVER_SIZE, META_SERVER);
+    serverAddr[4] = 0;
+    serverAddr[5] = 80;
+
+    long sock = connect_to_exosite_with_server_addr("", serverAddr);
+    if (sock < 0)
+    {
+      return -1;
+    }
+
+    build_request(GET_REQUEST, "/ip", NULL, 0, NULL, NULL, NULL, 0);
+    conn_stats.send_frames++;
+    exoHAL_SocketSend(sock, tx_buf, tx_len);
+
+    exosite_http_init(&parser, NULL, NULL);
+    http_status = read_response(sock, &parser);
+
+    exoHAL_SocketClose(sock);
+
+    if (200 != http_status || !exosite_clock_valid())
+       return -1;
+  }
+
+  exosite_clock_split(exosite_clock_now(), &datetime);
+  sprintf(day, "%02d/%02d/%d", datetime.day, datetime.month, datetime.year);
+  sprintf(time, "%02d:%02d:%02d", datetime.hour, datetime.min, datetime.sec);
+
+  if (!exoHAL_SetTime(day, time))
+    return -1;
+
+  // the module keeps our coarser time until its next SNTP sync
+  module_time_sntp = 0;
+  if (sntp_enabled)
+  {
+    unsigned long now = exoHAL_MSTimerGet();
+
+    sntp_due = sntp_start + ((now - sntp_start) / sntp_period_ms + 1)
+               * sntp_period_ms + SNTP_SYNC_WAIT_MS;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+*
+* Exosite_EnableSNTP
+*
+*  \param  server - name of the SNTP server, EXOSITE_SNTP_SERVER if NULL
+*          period - seconds between the module's syncs
+*
+*  \return 0 success; -1 failure
+*
+*  \brief  Has the module keep its clock set by SNTP, to be read back with
+*          Exosite_PollTime
+*
+*****************************************************************************/
+int
+Exosite_EnableSNTP(char *server, unsigned long period)
+{
+  unsigned char ip[4];
+
+  if (client_busy())
+    return -1;
+
+  if (!exoHAL_ResolveServer(NULL != server ? server : EXOSITE_SNTP_SERVER, ip))
+    return -1;
+
+  if (!exoHAL_TimeSyncEnable(ip, period))
+    return -1;
+
+  // the first sync is made at once, until it is done the module has
+  // whatever time it had
+  sntp_enabled = (0 < period);
+  module_time_sntp = 0;
+  sntp_start = exoHAL_MSTimerGet();
+  sntp_period_ms = period * 1000;
+  sntp_due = sntp_start + SNTP_SYNC_WAIT_MS;
+
+  return 0;
+}
+
+/*****************************************************************************
+*
+* Exosite_PollTime
+*
+*  \param  None
+*
+*  \return 0 success; -1 if the module has no time yet
+*
+*  \brief  Feeds our clock from the module's SNTP time. The local timer
+*          keeps the clock between polls, so it need only run every few
+*          minutes for the drift to be learned and slewed out. Until an
+*          SNTP sync is due, the module's time came from Exosite_SyncTime
+*          and is given the accuracy of a Date header.
+*
+*****************************************************************************/
+int
+Exosite_PollTime(void)
+{
+  unsigned long seconds;
+  unsigned short ms;
+  unsigned long start = exoHAL_MSTimerGet();
+  unsigned long took;
+  unsigned short accuracy;
+
+  if (client_busy())
+    return -1;
+
+  if (!exoHAL_TimeGet(&seconds, &ms) || EXOSITE_CLOCK_EPOCH_MIN > seconds)
+    return -1;
+
+  if (sntp_enabled && !module_time_sntp && (long)(start - sntp_due) >= 0)
+    module_time_sntp = 1;
+  accuracy = module_time_sntp ? SNTP_ACCURACY_MS : DATE_ACCURACY_MS;
+
+  // the time was read somewhere during the command
+  took = exoHAL_MSTimerGet() - start;
+  if (took > 0xffffUL - accuracy)
+    return -1;
+  exosite_clock_sync(seconds, ms, accuracy + (unsigned short)(took / 2),
+                     start + took / 2);
+
+  return 0;
+}
+
+/*****************************************************************************
+*
+* Exosite_Disconnect
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Closes the kept-alive connection to the Exosite server, the next
+*          request opens a new one
+*
+*****************************************************************************/
+void
+Exosite_Disconnect(void)
+{
+  if (exosite_sock >= 0)
+    exoHAL_SocketClose(exosite_sock);
+  exosite_sock = -1;
+
+  return;
+}
+
+/*****************************************************************************
+*
+* Exosite_GetConnStats
+*
+*  \param  stats - structure to copy the connection counters into
+*
+*  \return None
+*
+*  \brief  Reports how often requests reused the kept-alive connection,
+*          how many data frames went to the module and how long the last
+*          request took, with the module commands and bytes it needed
+*
+*****************************************************************************/
+void
+Exosite_GetConnStats(ExositeConnStats *stats)
+{
+  memcpy(stats, &conn_stats, sizeof(ExositeConnStats));
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  Exosite_SetReconnectPolicy
+*
+*  \param  base_ms - longest wait after the first failed connect
+*          cap_ms - longest wait however many connects have failed
+*          open_after - failed connects in a row that open the circuit
+*
+*  \return None
+*
+*  \brief  Tunes the backoff shared by every connect to the server and
+*          resets it to closed. Exosite_Init sets the defaults, so call it
+*          after that.
+*
+*****************************************************************************/
+void
+Exosite_SetReconnectPolicy(uint32_t base_ms, uint32_t cap_ms,
+                           uint8_t open_after)
+{
+  exosite_backoff_init(&reconnect, base_ms, cap_ms, open_after);
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  Exosite_GetReconnectStats
+*
+*  \param  stats - structure to copy the reconnect counters into
+*
+*  \return ms before the next connect attempt is allowed
+*
+*  \brief  Reports connect attempts, failures, attempts refused during
+*          backoff and the circuit transitions
+*
+*****************************************************************************/
+uint32_t
+Exosite_GetReconnectStats(ExositeBackoffStats *stats)
+{
+  if (NULL != stats)
+    memcpy(stats, &reconnect.stats, sizeof(ExositeBackoffStats));
+
+  return exosite_backoff_wait(&reconnect);
+}
+
+/*****************************************************************************
+*
+* get_connection
+*
+*  \param  reused - set to 1 if the kept-alive connection is handed back
+*
+*  \return success: socket handle; failure: -1;
+*
+*  \brief  Returns the open connection to Exosite, or connects if there is
+*          none or the server has closed it
+*
+*****************************************************************************/
+static long
+get_connection(unsigned char *reused)
+{
+  *reused = 0;
+
+  if (exosite_sock >= 0)
+  {
+    if (exoHAL_SocketIsOpen(exosite_sock))
+    {
+      conn_stats.reuse_hits++;
+      *reused = 1;
+      return exosite_sock;
+    }
+    // server side close or DISCONNECT seen by the HAL
+    conn_stats.server_closes++;
+    Exosite_Disconnect();
+  }
+
+  conn_stats.reuse_misses++;
+  update_m2ip();
+  exosite_sock = connect_to_exosite(EXOSITE_CA_NAME);
+  if (exosite_sock >= 0 && !exoHAL_SocketIsOpen(exosite_sock))
+    exosite_sock = -1;
+
+  // the server may have moved, enough failures resolve its name early
+  if (exosite_sock < 0)
+    connect_fails++;
+  else
+    connect_fails = 0;
+
+  return exosite_sock;
+}
+
+/*****************************************************************************
+*
+* retry_on_stale
+*
+*  \param  http_status - status of the exchange, 0 on tcp failure
+*          reused - 1 if the exchange went out on a kept-alive connection
+*
+*  \return 1 if the request should be sent again on a new connection
+*
+*  \brief  Drops a connection that failed mid-exchange. A kept-alive socket
+*          may have been closed by the server while idle, so that case gets
+*          one transparent retry.
+*
+*****************************************************************************/
+static int
+retry_on_stale(int http_status, unsigned char reused)
+{
+  if (0 != http_status)
+    return 0;
+
+  Exosite_Disconnect();
+  if (!reused)
+    return 0;
+
+  conn_stats.reconnects++;
+  return 1;
+}
+
+/*****************************************************************************
+*
+* send_request
+*
+*  \param  parser - initialized parser for the response
+*          writer - streams the request out in place of tx_buf, or NULL
+*          ctx - passed to writer
+*
+*  \return http response code, 0 tcp failure or incomplete response,
+*          -1 no connection
+*
+*  \brief  Sends the request held in tx_buf over the kept-alive connection
+*          as one data frame and reads back the whole response. A writer
+*          is called again for each attempt.
+*
+*****************************************************************************/
+static int
+send_request(exosite_http_parser *parser, void (*writer)(void *), void *ctx)
+{
+  int http_status;
+  unsigned char reused;
+  unsigned long start = exoHAL_MSTimerGet();
+  unsigned long commands, bytes;
+
+  exoHAL_GetStats(&commands, &bytes);
+  do
+  {
+    if (get_connection(&reused) < 0)
+      return -1;
+
+    exosite_http_init(parser, parser->on_body, parser->ctx);
+    if (NULL != writer)
+      writer(ctx);
+    else
+      request_flush();
+
+    // a writer that could not send its request closes the connection
+    http_status = (exosite_sock < 0) ? 0 : read_response(exosite_sock, parser);
+  } while (retry_on_stale(http_status, reused));
+
+  conn_stats.request_ms = exoHAL_MSTimerGet() - start;
+  request_stats(commands, bytes);
+
+  // without a complete response we can't tell where the next one starts
+  if (HTTP_DONE != parser->state || parser->close)
+    Exosite_Disconnect();
+  if (HTTP_DONE != parser->state)
+    http_status = 0;
+
+  return http_status;
+}
+
+/*****************************************************************************
+*
+* request_stats
+*
+*  \param  commands, bytes - module counters read when the request started
+*
+*  \return None
+*
+*  \brief  Records the module commands and bytes the last request took
+*
+*****************************************************************************/
+static void
+request_stats(unsigned long commands, unsigned long bytes)
+{
+  unsigned long now_commands, now_bytes;
+
+  exoHAL_GetStats(&now_commands, &now_bytes);
+  conn_stats.request_cmds = now_commands - commands;
+  conn_stats.request_bytes = now_bytes - bytes;
+}
+
+/*****************************************************************************
+*
+* update_m2ip
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Resolves the server name again when the cached address in meta
+*          has expired or connecting to it keeps failing. A failed lookup
+*          keeps the old address and is retried after DNS_RETRY.
+*
+*****************************************************************************/
+static void
+update_m2ip(void)
+{
+  unsigned char server[META_SERVER_SIZE];
+  unsigned char expiry[META_DNS_EXPIRY_SIZE];
+  unsigned long now = exoHAL_MSTimerGet() / 1000;
+
+  if (!dns_loaded)
+  {
+    exosite_meta_read(expiry, META_DNS_EXPIRY_SIZE, META_DNS_EXPIRY);
+    dns_expiry = ((unsigned long)expiry[0] << 24) | ((unsigned long)expiry[1] << 16)
+                 | ((unsigned long)expiry[2] << 8) | expiry[3];
+    // an expiry set before a reboot is on another time base
+    if (dns_expiry > now + DNS_TTL)
+      dns_expiry = 0;
+    dns_loaded = 1;
+  }
+
+  if (now < dns_expiry && DNS_MAX_CONNECT_FAILS > connect_fails)
+    return;
+
+  conn_stats.dns_lookups++;
+  connect_fails = 0;
+  exosite_meta_read(server, META_SERVER_SIZE, META_SERVER);
+  if (exoHAL_ResolveServer(STR_SERVER_NAME, expiry))
+  {
+    dns_expiry = now + DNS_TTL;
+    if (0 != memcmp(server, expiry, 4))
+    {
+      memcpy(server, expiry, 4);
+      exosite_meta_write(server, META_SERVER_SIZE, META_SERVER);
+    }
+  }
+  else
+  {
+    conn_stats.dns_failures++;
+    // with no address at all, try again on the next connect
+    dns_expiry = (0 == server[0]) ? 0 : now + DNS_RETRY;
+  }
+
+  expiry[0] = (unsigned char)(dns_expiry >> 24);
+  expiry[1] = (unsigned char)(dns_expiry >> 16);
+  expiry[2] = (unsigned char)(dns_expiry >> 8);
+  expiry[3] = (unsigned char)dns_expiry;
+  exosite_meta_write(expiry, META_DNS_EXPIRY_SIZE, META_DNS_EXPIRY);
+
+  return;
+}
+
+/*****************************************************************************
+*
+* connect_to_exosite
+*
+*  \param  caName - certificate to open SSL with, NULL or "" for plain TCP
+*
+*  \return success: socket handle; failure: -1;
+*
+*  \brief  Establishes a connection with Exosite API server
+*
+*****************************************************************************/
+static long
+connect_to_exosite(char *caName)
+{
+  unsigned char server[META_SERVER_SIZE];
+
+  exosite_meta_read(server, META_SERVER_SIZE, META_SERVER);
+
+  return connect_to_exosite_with_server_addr(caName, server);
+}
+
+/*****************************************************************************
+*
+* connect_to_exosite_with_server_addr
+*
+*  \param  caName - certificate to open SSL with, NULL or "" for plain TCP
+*          server - 4 byte address and 2 byte port
+*
+*  \return success: socket handle; failure: -1;
+*
+*  \brief  Connects to the server, retrying with backoff. Every attempt
+*          goes through the shared reconnect policy, so while the circuit
+*          is open or a long backoff is pending this fails at once.
+*
+*****************************************************************************/
+static long
+connect_to_exosite_with_server_addr(char *caName,
+                                    unsigned char *server)
+{
+  unsigned char connectRetries = 0;
+  uint32_t wait;
+  long sock = -1;
+
+  while (connectRetries++ <= EXOSITE_MAX_CONNECT_RETRY_COUNT) {
+
+    // short waits are sat out here, longer ones are left to the caller
+    wait = exosite_backoff_wait(&reconnect);
+    if (CONNECT_WAIT_MAX < wait)
+    {
+      reconnect.stats.blocked++;
+      break;
+    }
+    if (0 < wait)
+      exoHAL_MSDelay((unsigned short)wait);
+    if (!exosite_backoff_allow(&reconnect))
+      break;
+
+    sock = exoHAL_SocketOpenTCP(server);
+
+    if (sock == -1)
+    {
+      exosite_backoff_failure(&reconnect);
+      continue;
+    }
+
+    if (exoHAL_ServerConnect(sock) < 0)  // Try to connect
+    {
+      // TODO - the typical reason the connect doesn't work is because
+      // something was wrong in the way the comms hardware was initialized (timing, bit
+      // error, etc...). There may be a graceful way to kick the hardware
+      // back into gear at the right state, but for now, we just
+      // return and let the caller retry us if they want
+      sock = -1;
+      exosite_backoff_failure(&reconnect);
+      continue;
+    } else {
+      
+      if(caName != NULL && strlen(caName)!= 0)
+      {
+        if(exoHAL_ClientSSLOpen(sock, caName) < 0)
+        {
+          sock = -1;
+          exosite_backoff_failure(&reconnect);
+          continue;
+        }
+      }
+      
+      exosite_backoff_success(&reconnect);
+      connectRetries = 0;
+      break;
+    }
+  }
+
+  // Success
+  return sock;
+}
+
+/*****************************************************************************
+*
+* read_response
+*
+*  \param  socket - socket handle; parser - initialized parser
+*
+*  \return http response code, 0 if no status line arrived
+*
+*  \brief  Feeds the response to the parser until it is complete, the
+*          server closes the connection or the module times out. The Date
+*          header feeds the clock.
+*
+*****************************************************************************/
+static int
+read_response(long socket, exosite_http_parser *parser)
+{
+  char strBuf[RX_SIZE];
+  unsigned char strLen;
+
+  while (!exosite_http_done(parser))
+  {
+    strLen = exoHAL_SocketRecv(socket, strBuf, RX_SIZE);
+    if (0 == strLen)
+    {
+      exosite_http_finish(parser);
+      break;
     }
+    exosite_http_parse(parser, strBuf, strLen);
+  }
+
+  sync_clock(parser);
+
+  return parser->status;
+}
+
+/*****************************************************************************
+*
+* sync_clock
+*
+*  \param  parser - parser of a response that has just ended
+*
+*  \return None
+*
+*  \brief  Any response will do to set the clock. The Date header has
+*          whole seconds so take the middle of the second.
+*
+*****************************************************************************/
+static void
+sync_clock(exosite_http_parser *parser)
+{
+  uint32_t epoch;
 
-    if (exoHAL_ServerConnect(sock) < 0)  // Try to connect
+  if (0 != parser->date[0] && exosite_clock_parse_http(parser->date, &epoch))
+    exosite_clock_sync(epoch, 500, DATE_ACCURACY_MS, exoHAL_MSTimerGet());
+
+  return;
+}
+
+/*****************************************************************************
+*
+* collect_body
+*
+*  \param  parser - parser with a BodyBuffer as ctx
+*          data - span of the response body; len - size of span
+*
+*  \return None
+*
+*  \brief  Copies the body of a 200 response into the BodyBuffer, dropping
+*          whatever does not fit
+*
+*****************************************************************************/
+static void
+collect_body(exosite_http_parser *parser, const char *data, unsigned short len)
+{
+  BodyBuffer *body = (BodyBuffer *)parser->ctx;
+
+  if (200 != parser->status)
+    return;
+
+  while (0 < len && body->size > body->len)
+  {
+    body->buf[body->len++] = *data++;
+    --len;
+  }
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+* decode_form
+*
+*  \param  parser - parser with a FormDecoder as ctx
+*          data - span of the response body; len - size of span
+*
+*  \return None
+*
+*  \brief  Decodes an application/x-www-form-urlencoded body of a 200
+*          response into the key/value table, one span at a time
+*
+*****************************************************************************/
+static void
+decode_form(exosite_http_parser *parser, const char *data, unsigned short len)
+{
+  FormDecoder *form = (FormDecoder *)parser->ctx;
+
+  if (200 != parser->status)
+    return;
+
+  while (0 < len--)
+    decode_form_char(form, *data++);
+
+  return;
+}
+
+/*****************************************************************************
+*
+* decode_form_char
+*
+*  \param  form - decoder state; c - next character of the body
+*
+*  \return None
+*
+*  \brief  Splits pairs on '&' and '=', undoes '+' and %XX escapes, and
+*          stores values of the aliases asked for
+*
+*****************************************************************************/
+static void
+decode_form_char(FormDecoder *form, char c)
+{
+  unsigned char i;
+  ExositeKeyValue *kv;
+
+  // a malformed escape is dropped, c is taken as it is so a '&' or '='
+  // still ends the pair
+  if (form->escape && 0 > exosite_http_hex_value(c))
+    form->escape = 0;
+
+  if (form->escape)
+  {
+    if (1 == form->escape++)
     {
-      // TODO - the typical reason the connect doesn't work is because
-      // something was wrong in the way the comms hardware was initialized (timing, bit
-      // error, etc...). There may be a graceful way to kick the hardware
-      // back into gear at the right state, but for now, we just
-      // return and let the caller retry us if they want
-      continue;
-    } else {
-      
-      if(caName != NULL && strlen(caName)!= 0)
+      form->escaped = exosite_http_hex_value(c);
+      return;
+    }
+    form->escape = 0;
+    c = (char)((form->escaped << 4) | exosite_http_hex_value(c));
+  }
+  else if ('%' == c)
+  {
+    form->escape = 1;
+    return;
+  }
+  else if ('&' == c)
+  {
+    form->in_value = 0;
+    form->key_len = 0;
+    form->match = NULL;
+    return;
+  }
+  else if ('=' == c && !form->in_value)
+  {
+    form->in_value = 1;
+    form->key[form->key_len < KEY_SIZE ? form->key_len : KEY_SIZE - 1] = 0;
+    for (i = 0; i < form->count && KEY_SIZE > form->key_len; i++)
+    {
+      if (0 == strcmp(form->key, form->table[i].alias))
       {
-        if(exoHAL_ClientSSLOpen(sock, caName) < 0)
-        {
-          continue;
-        }
+        form->match = &form->table[i];
+        form->found++;
+        break;
       }
-      
-      connectRetries = 0;
-      break;
     }
+    return;
   }
+  else if ('+' == c)
+    c = ' ';
 
-  // Success
-  return sock;
+  if (!form->in_value)
+  {
+    if (KEY_SIZE - 1 > form->key_len)
+      form->key[form->key_len] = c;
+    if (KEY_SIZE > form->key_len)
+      form->key_len++;
+    return;
+  }
+
+  kv = form->match;
+  if (NULL != kv && kv->size > kv->len)
+  {
+    kv->value[kv->len++] = c;
+    if (kv->size > kv->len)
+      kv->value[kv->len] = 0;
+  }
+
+  return;
 }
 
+
 /*****************************************************************************
 *
-* get_http_status
+*  build_request
 *
-*  \param  socket handle, pointer to expected HTTP response code
+*  \param  method - GET_REQUEST, POST_REQUEST or RPC_REQUEST for a JSON body
+*          path - request path
+*          query - query parameters, joined with '&'; count - how many
+*          cik - value for the X-Exosite-CIK header or NULL
+*          headers - extra header lines, each ending in CRLF, or NULL
+*          body - POST content, NULL if it is streamed after the headers
+*          bodylen - size of body in bytes
 *
-*  \return http response code, 0 tcp failure
+*  \return 1 if the request fits in tx_buf, 0 otherwise
 *
-*  \brief  Reads first 12 bytes of HTTP response and extracts the 3 byte code
+*  \brief  Assembles the request line, headers and body into tx_buf so the
+*          whole request goes to the module in a single data frame
 *
 *****************************************************************************/
 static int
-get_http_status(long socket)
+build_request(unsigned char method, const char *path,
+              const char * const *query, unsigned char count,
+              const char *cik, const char *headers,
+              const char *body, unsigned short bodylen)
 {
-  char rxBuf[12];
-  int rxLen = 0;
-  int code = 0;
+  char strLen[6];
+  unsigned char i;
 
-  rxLen = exoHAL_SocketRecv(socket, rxBuf, 12);
+  tx_len = 0;
 
-  if (12 == rxLen)
+  if (GET_REQUEST == method)
+    request_append("GET ", 4);
+  else
+    request_append("POST ", 5);
+  request_append(path, strlen(path));
+  for (i = 0; i < count; i++)
   {
-    // exampel '4','0','4' =>  404  (as number)
-    code = (((rxBuf[9] - 0x30) * 100) +
-            ((rxBuf[10] - 0x30) * 10) +
-            (rxBuf[11] - 0x30));
-    return code;
+    request_append(0 == i ? "?" : "&", 1);
+    request_append(query[i], strlen(query[i]));
   }
-  return 0;
+  request_append(STR_HTTP, strlen(STR_HTTP));
+  request_append(STR_HOST, strlen(STR_HOST));
+
+  if (NULL != cik)
+  {
+    request_append(STR_CIK_HEADER, strlen(STR_CIK_HEADER));
+    request_append(cik, strlen(cik));
+    request_append(STR_CRLF, 2);
+  }
+
+  if (NULL != headers)
+    request_append(headers, strlen(headers));
+
+  if (GET_REQUEST == method)
+  {
+    request_append(STR_ACCEPT, strlen(STR_ACCEPT));
+  }
+  else
+  {
+    sprintf(strLen, "%u", bodylen); //make a string for length
+    if (RPC_REQUEST == method)
+      request_append(STR_CONTENT_JSON, strlen(STR_CONTENT_JSON));
+    else
+      request_append(STR_CONTENT, strlen(STR_CONTENT));
+    request_append(STR_CONTENT_LENGTH, strlen(STR_CONTENT_LENGTH));
+    request_append(strLen, strlen(strLen));
+    request_append(STR_CRLF, 2);
+  }
+  request_append(STR_CRLF, 2);
+
+  if (NULL != body)
+    request_append(body, bodylen);
+
+  return TX_SIZE >= tx_len;
+}
+
+/*****************************************************************************
+*
+*  request_append
+*
+*  \param  data - bytes to add to the request; len - number of bytes
+*
+*  \return None
+*
+*  \brief  Appends to tx_buf. On overflow tx_len is left past TX_SIZE so
+*          build_request can report it.
+*
+*****************************************************************************/
+static void
+request_append(const char *data, unsigned short len)
+{
+  if (TX_SIZE < tx_len + len)
+  {
+    tx_len = TX_SIZE + 1;
+    return;
+  }
+
+  memcpy(&tx_buf[tx_len], data, len);
+  tx_len += len;
+
+  return;
 }
 
+/*****************************************************************************
+*
+*  request_flush
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Hands what is in tx_buf to the module as one data frame. tx_buf
+*          is left as is so the request can be sent again.
+*
+*****************************************************************************/
+static void
+request_flush(void)
+{
+  if (0 == tx_len)
+    return;
+
+  conn_stats.send_frames++;
+  exoHAL_SocketSend(exosite_sock, tx_buf, tx_len);
+
+  return;
+}
 
 /*****************************************************************************
 *
-*  sendLine
+*  record_send
 *
-*  \param  Which line type
+*  \param  ctx - RecordWriter of the request
 *
-*  \return socket handle
+*  \return None
 *
-*  \brief  Sends data out
+*  \brief  Sends the record request, flushing tx_buf whenever it fills.
+*          The body is counted first for the Content-Length header. If
+*          the source gave a different body the second time the server
+*          can't tell where it ends, so the connection is dropped.
 *
 *****************************************************************************/
 static void
-sendLine(long socket, unsigned char LINE, const char * payload)
+record_send(void *ctx)
 {
-  char strBuf[70];
-  unsigned char strLen;
+  RecordWriter *rec = (RecordWriter *)ctx;
+  unsigned long counted;
 
-  switch(LINE) {
-    case CIK_LINE:
-      strLen = strlen(STR_CIK_HEADER);
-      memcpy(strBuf,STR_CIK_HEADER,strLen);
-      memcpy(&strBuf[strLen],payload, strlen(payload));
-      strLen += strlen(payload);
-      memcpy(&strBuf[strLen],STR_CRLF, 2);
-      strLen += strlen(STR_CRLF);
-      break;
-    case HOST_LINE:
-      strLen = strlen(STR_HOST);
-      memcpy(strBuf,STR_HOST,strLen);
-      break;
-    case CONTENT_LINE:
-      strLen = strlen(STR_CONTENT);
-      memcpy(strBuf,STR_CONTENT,strLen);
-      break;
-    case ACCEPT_LINE:
-      strLen = strlen(STR_ACCEPT);
-      memcpy(strBuf,STR_ACCEPT,strLen);
-      memcpy(&strBuf[strLen],payload, strlen(payload));
-      strLen += strlen(payload);
-      break;
-    case LENGTH_LINE: // Content-Length: NN
-      strLen = strlen(STR_CONTENT_LENGTH);
-      memcpy(strBuf,STR_CONTENT_LENGTH,strLen);
-      memcpy(&strBuf[strLen],payload, strlen(payload));
-      strLen += strlen(payload);
-      memcpy(&strBuf[strLen],STR_CRLF, 2);
-      strLen += 2;
-      memcpy(&strBuf[strLen],STR_CRLF, 2);
-      strLen += 2;
-      break;
-    case GETDATA_LINE:
-      strLen = strlen(STR_GET_URL);
-      memcpy(strBuf,STR_GET_URL,strLen);
-      memcpy(&strBuf[strLen],payload, strlen(payload));
-      strLen += strlen(payload);
-      memcpy(&strBuf[strLen],STR_HTTP, strlen(STR_HTTP));
-      strLen += strlen(STR_HTTP);
-      break;
-    case POSTDATA_LINE:
-      strLen = strlen("POST ");
-      memcpy(strBuf,"POST ", strLen);
-      memcpy(&strBuf[strLen],payload, strlen(payload));
-      strLen += strlen(payload);
-      memcpy(&strBuf[strLen],STR_HTTP, strlen(STR_HTTP));
-      strLen += strlen(STR_HTTP);
-      break;
-    case EMPTY_LINE:
-      strLen = strlen(STR_CRLF);
-      memcpy(strBuf,STR_CRLF,strLen);
-      break;
-    default:
-      break;
+  rec->sending = 0;
+  record_encode(rec);
+  counted = rec->len;
+
+  build_request(RPC_REQUEST, STR_RPC_URL, NULL, 0, NULL, NULL, NULL,
+                (unsigned short)counted);
+
+  rec->sending = 1;
+  record_encode(rec);
+  request_flush();
+
+  rec->mismatch = (counted != rec->len);
+  if (rec->mismatch)
+    Exosite_Disconnect();
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  record_encode
+*
+*  \param  rec - request being counted or sent
+*
+*  \return None
+*
+*  \brief  Writes the JSON-RPC body, one record call per alias that has
+*          samples, pulling the samples from rec->source
+*
+*****************************************************************************/
+static void
+record_encode(RecordWriter *rec)
+{
+  char num[12];
+  char value[EXOSITE_RECORD_VALUE_SIZE];
+  int32_t timestamp;
+  unsigned short index;
+  unsigned char alias;
+  unsigned char points;
+
+  rec->len = 0;
+  rec->calls = 0;
+
+  record_out(rec, "{\"auth\":{\"cik\":\"", 16);
+  record_out(rec, rec->cik, CIK_LENGTH);
+  record_out(rec, "\"},\"calls\":[", 12);
+
+  for (alias = 0; alias < rec->count; alias++)
+  {
+    points = 0;
+    for (index = 0; ; index++)
+    {
+      value[0] = 0;
+      if (!rec->source(rec->ctx, index, alias, &timestamp, value))
+        break;
+      if (0 == value[0])
+        continue;
+
+      // the call is only opened once it has a sample
+      if (0 == points++)
+      {
+        if (0 < rec->calls)
+          record_out(rec, ",", 1);
+        sprintf(num, "%d", alias);
+        record_out(rec, "{\"id\":", 6);
+        record_out(rec, num, strlen(num));
+        record_out(rec, ",\"procedure\":\"record\",\"arguments\":[{\"alias\":\"", 45);
+        record_string(rec, rec->aliases[alias]);
+        record_out(rec, "\"},[", 4);
+        rec->calls++;
+      }
+      else
+        record_out(rec, ",", 1);
+
+      sprintf(num, "%ld", (long)timestamp);
+      record_out(rec, "[", 1);
+      record_out(rec, num, strlen(num));
+      record_out(rec, ",\"", 2);
+      record_string(rec, value);
+      record_out(rec, "\"]", 2);
+    }
+    if (0 < points)
+      record_out(rec, "],{}]}", 6);
   }
 
-  strBuf[strLen] = 0;
-  exoHAL_SocketSend(socket, strBuf, strLen);
+  record_out(rec, "]}", 2);
 
   return;
 }
 
-static int
-  parse_datetime(const char *strBuf,
-                 int strLen,
-                 DateTime *datetime)
-{
-  char copyStr[RX_SIZE];
-  char *token;
-  
-  memcpy(copyStr, strBuf, strLen);
-  
-  // use strtok to parse the string like " OK\r\nDate: Tue, 18 Nov 2014 08 53 45"
-  
-  if((token = strtok(copyStr, ",\r\n: ")) == NULL ||
-     strcmp(token, "OK") != 0)
-    return -1;
-  
-  if((token = strtok(NULL, ",\r\n: ")) == NULL ||
-     strcmp(token, "Date") != 0)
-    return -1;
-  
-  //Tue
-  if((token = strtok(NULL, ",\r\n: ")) == NULL ||
-     strlen(token) != 3)
-    return -1;
-  
-  //18
-  if((token = strtok(NULL, ",\r\n: ")) == NULL ||
-     strlen(token) != 2)
-       return -1;
-  
-  memcpy(datetime->dayStr, token, 3);
-  
-  //Nov
-  if((token = strtok(NULL, ",\r\n: ")) == NULL ||
-     strlen(token) != 3)
-       return -1;
-  
-  memcpy(datetime->monStr, token, 4);
-  
-  //2014
-  if((token = strtok(NULL, ",\r\n: ")) == NULL ||
-     strlen(token) != 4)
-       return -1;
-  
-  memcpy(datetime->yearStr, token, 5);
-  
-  //08
-  if((token = strtok(NULL, ",\r\n: ")) == NULL ||
-     strlen(token) != 2)
-       return -1;
-  
-  memcpy(datetime->hourStr, token, 3);
-  
-  //53
-  if((token = strtok(NULL, ",\r\n: ")) == NULL ||
-     strlen(token) != 2)
-       return -1;
-  
-  memcpy(datetime->minStr, token, 3);
-  
-  //45
-  if((token = strtok(NULL, ",\r\n: ")) == NULL ||
-     strlen(token) != 2)
-       return -1;
-  
-  memcpy(datetime->secStr, token, 3);
-  
-  return 0;
+/*****************************************************************************
+*
+*  record_string
+*
+*  \param  rec - request being counted or sent; str - text to write
+*
+*  \return None
+*
+*  \brief  Writes str as the inside of a JSON string, escaping quotes and
+*          backslashes and dropping control characters
+*
+*****************************************************************************/
+static void
+record_string(RecordWriter *rec, const char *str)
+{
+  unsigned short run;
+
+  while (0 != *str)
+  {
+    for (run = 0; 0 != str[run] && '"' != str[run] && '\\' != str[run]
+                  && ' ' <= str[run]; run++)
+      ;
+    record_out(rec, str, run);
+    str += run;
+
+    if ('"' == *str || '\\' == *str)
+    {
+      record_out(rec, "\\", 1);
+      record_out(rec, str++, 1);
+    }
+    else if (0 != *str)
+      str++;
+  }
+
+  return;
 }
 
-static int
-  month_to_num(const char *month)
+/*****************************************************************************
+*
+*  record_out
+*
+*  \param  rec - request being counted or sent
+*          data - bytes of the body; len - number of bytes
+*
+*  \return None
+*
+*  \brief  Counts the body bytes, or when sending adds them to tx_buf and
+*          sends a data frame each time it fills
+*
+*****************************************************************************/
+static void
+record_out(RecordWriter *rec, const char *data, unsigned short len)
 {
-  const char *monStr[12] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
-                            "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
- 
-  int i;
-  
-  for(i = 0; i < 12; ++i)
-    if(0 == strcmp(month, monStr[i]))
-      return i + 1;
+  unsigned short n;
 
-  return 0;
+  rec->len += len;
+  if (!rec->sending)
+    return;
+
+  while (0 < len)
+  {
+    n = TX_SIZE - tx_len;
+    if (n > len)
+      n = len;
+    memcpy(&tx_buf[tx_len], data, n);
+    tx_len += n;
+    data += n;
+    len -= n;
+
+    if (TX_SIZE == tx_len)
+    {
+      request_flush();
+      tx_len = 0;
+    }
+  }
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  check_rpc
+*
+*  \param  parser - parser with a RpcResult as ctx
+*          data - span of the response body; len - size of span
+*
+*  \return None
+*
+*  \brief  Counts the calls a JSON-RPC response reports as ok, ignoring
+*          white space between the tokens
+*
+*****************************************************************************/
+static void
+check_rpc(exosite_http_parser *parser, const char *data, unsigned short len)
+{
+  RpcResult *result = (RpcResult *)parser->ctx;
+  char c;
+
+  if (200 != parser->status)
+    return;
+
+  while (0 < len--)
+  {
+    c = *data++;
+    if (' ' == c || '\t' == c || '\r' == c || '\n' == c)
+      continue;
+
+    if (STR_RPC_OK[result->matched] != c)
+      result->matched = 0;
+    if (STR_RPC_OK[result->matched] == c)
+      result->matched++;
+    if (0 == STR_RPC_OK[result->matched])
+    {
+      result->ok++;
+      result->matched = 0;
+    }
+  }
+
+  return;
 }
 
 
 
+
@@ -37,6 +37,7 @@
 #define EXOSITE_H
 
 #include <stdint.h>
+#include "exosite_backoff.h"
 
 // defines
 enum UUIDInterfaceTypes
@@ -63,6 +64,8 @@ enum ExositeStatusCodes
     EXO_STATUS_CONFLICT,
     EXO_STATUS_BAD_CIK,
     EXO_STATUS_NOAUTH,
+    EXO_STATUS_BAD_SIZE,
+    EXO_STATUS_BUSY,
     EXO_STATUS_END
 };
 
@@ -72,16 +75,85 @@ enum ExositeStatusCodes
 #define EXOSITE_DEMO_UPDATE_INTERVAL            4000// ms
 #define EXOSITE_CA_NAME                         "GEO_CA"
 #define CIK_LENGTH                              40
+#define EXOSITE_READ_MAXALIASES                 8
+#define EXOSITE_SNTP_SERVER                     "pool.ntp.org"
+#define EXOSITE_SNTP_PERIOD                     3600// s between module syncs
+
+typedef struct
+{
+    const char *alias;        // datasource alias to read
+    char *value;              // buffer for the decoded value
+    unsigned char size;       // size of value buffer
+    unsigned char len;        // length of the value read
+} ExositeKeyValue;
+
+#define EXOSITE_SINCE_SIZE                      30
+
+typedef struct
+{
+    unsigned long timeout;              // ms the server may hold the request
+    char since[EXOSITE_SINCE_SIZE];     // Last-Modified of the last value read,
+                                        // or its hash, see exoHAL_KeepsHeaders
+} ExositeLongPoll;
+
+#define EXOSITE_RECORD_VALUE_SIZE               16
+
+/*
+ * Hands Exosite_Record the samples to upload. Called for sample index
+ * 0, 1, 2 ... of each alias in turn, twice per attempt, so it must give the
+ * same answer every time. Returns 0 past the last sample. Otherwise sets
+ * *timestamp (unix time, or a negative number of seconds before now) and
+ * copies the value as a 0 terminated string into value, leaving it empty
+ * when the sample has nothing for that alias.
+ */
+typedef unsigned char (*ExositeRecordSource)(void *ctx, unsigned short index,
+                                             unsigned char alias,
+                                             int32_t *timestamp, char *value);
+
+/*
+ * Called once an Exosite_...Start request has ended, with what the
+ * blocking call of the same name would have returned. Another request may
+ * be started from it.
+ */
+typedef void (*ExositeAsyncDone)(void *ctx, int result);
+
+typedef struct
+{
+    uint16_t reuse_hits;      // requests sent on the kept-alive connection
+    uint16_t reuse_misses;    // requests that had to open a new connection
+    uint16_t server_closes;   // kept-alive connections found closed by the server
+    uint16_t reconnects;      // requests resent after a kept-alive connection failed
+    uint16_t send_frames;     // ESC S / ESC E data frames handed to the module
+    uint16_t dns_lookups;     // times the server name was resolved
+    uint16_t dns_failures;    // lookups that failed, the cached address was kept
+    uint32_t request_ms;      // time taken by the last request, connect included
+    uint32_t request_cmds;    // module commands the last request took
+    uint32_t request_bytes;   // bytes the last request wrote to the module
+} ExositeConnStats;
 
 // functions for export
 extern int Exosite_Write(char * pbuf, unsigned char bufsize);
 extern int Exosite_Read(char * palias, char * pbuf, unsigned char buflen);
+extern int Exosite_ReadMany(ExositeKeyValue *table, unsigned char count);
+extern int Exosite_ReadLongPoll(ExositeKeyValue *kv, ExositeLongPoll *poll);
+extern int Exosite_ReadWrite(char * pbuf, unsigned char bufsize, ExositeKeyValue *table, unsigned char count);
+extern int Exosite_ReadWriteStart(char * pbuf, unsigned char bufsize, ExositeKeyValue *table, unsigned char count, ExositeAsyncDone done, void *ctx);
+extern int Exosite_ReadLongPollStart(ExositeKeyValue *kv, ExositeLongPoll *poll, ExositeAsyncDone done, void *ctx);
+extern int Exosite_Poll(void);
+extern void Exosite_Cancel(void);
+extern int Exosite_Record(const char * const *aliases, unsigned char count, ExositeRecordSource source, void *ctx);
 extern int Exosite_Init(const char *vendor, const char *model, const unsigned char if_nbr, int reset);
 extern int Exosite_Activate(void);
 extern int Exosite_SyncTime(void);
+extern int Exosite_EnableSNTP(char *server, unsigned long period);
+extern int Exosite_PollTime(void);
 extern void Exosite_SetCIK(char * pCIK);
 extern int Exosite_GetCIK(char * pCIK);
 extern int Exosite_StatusCode(void);
 extern int Exosite_GetResponse(void);
+extern void Exosite_Disconnect(void);
+extern void Exosite_GetConnStats(ExositeConnStats *stats);
+extern void Exosite_SetReconnectPolicy(uint32_t base_ms, uint32_t cap_ms, uint8_t open_after);
+extern uint32_t Exosite_GetReconnectStats(ExositeBackoffStats *stats);
 #endif
 
@@ -0,0 +1,243 @@
+/*****************************************************************************
+*
+*  exosite_backoff.c - Reconnect backoff and circuit breaker.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the   
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+#include "exosite_backoff.h"
+#include "exosite_hal.h"
+#include <string.h>
+
+// local defines
+#define BACKOFF_MAX_SHIFT         16
+
+// local functions
+static uint32_t backoff_random(void);
+
+// globals
+static uint32_t random_state = 1;
+
+/*****************************************************************************
+*
+*  exosite_backoff_init
+*
+*  \param  b - policy to set up
+*          base_ms - delay ceiling after the first failure
+*          cap_ms - largest delay ceiling
+*          open_after - failures in a row that open the circuit
+*
+*  \return None
+*
+*  \brief  Resets a reconnect policy to closed with no failures
+*
+*****************************************************************************/
+void
+exosite_backoff_init(exosite_backoff *b, uint32_t base_ms, uint32_t cap_ms,
+                     uint8_t open_after)
+{
+  memset(b, 0, sizeof(exosite_backoff));
+  b->base_ms = base_ms;
+  b->cap_ms = cap_ms;
+  b->open_after = open_after;
+  b->state = BACKOFF_CLOSED;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exosite_backoff_seed
+*
+*  \param  seed - something unique to the device, like its MAC address
+*
+*  \return None
+*
+*  \brief  Seeds the jitter so devices that lost the server together don't
+*          come back in step
+*
+*****************************************************************************/
+void
+exosite_backoff_seed(uint32_t seed)
+{
+  random_state = (0 == seed) ? 1 : seed;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exosite_backoff_allow
+*
+*  \param  b - policy
+*
+*  \return 1 if an attempt may be made now; 0 otherwise
+*
+*  \brief  Gates an attempt. Once the delay of an open circuit is over a
+*          single trial attempt goes through, half-open, and the rest are
+*          refused until it reports back.
+*
+*****************************************************************************/
+int
+exosite_backoff_allow(exosite_backoff *b)
+{
+  if (BACKOFF_HALF_OPEN == b->state || 0 < exosite_backoff_wait(b))
+  {
+    b->stats.blocked++;
+    return 0;
+  }
+
+  if (BACKOFF_OPEN == b->state)
+  {
+    b->state = BACKOFF_HALF_OPEN;
+    b->stats.half_opens++;
+  }
+  b->stats.attempts++;
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exosite_backoff_wait
+*
+*  \param  b - policy
+*
+*  \return ms left before the next attempt is allowed
+*
+*  \brief  Lets the caller sleep rather than poll exosite_backoff_allow
+*
+*****************************************************************************/
+uint32_t
+exosite_backoff_wait(exosite_backoff *b)
+{
+  uint32_t elapsed;
+
+  if (0 == b->fails)
+    return 0;
+
+  elapsed = exoHAL_MSTimerGet() - b->start;
+
+  return (elapsed >= b->delay) ? 0 : b->delay - elapsed;
+}
+
+/*****************************************************************************
+*
+*  exosite_backoff_success
+*
+*  \param  b - policy
+*
+*  \return None
+*
+*  \brief  Reports a successful attempt, closing the circuit
+*
+*****************************************************************************/
+void
+exosite_backoff_success(exosite_backoff *b)
+{
+  if (BACKOFF_HALF_OPEN == b->state)
+    b->stats.closes++;
+  b->state = BACKOFF_CLOSED;
+  b->fails = 0;
+  b->delay = 0;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exosite_backoff_failure
+*
+*  \param  b - policy
+*
+*  \return None
+*
+*  \brief  Reports a failed attempt. The next one waits a random time up to
+*          base_ms doubled for each failure in a row, no more than cap_ms
+*          (full jitter). A failed trial or open_after failures in a row
+*          open the circuit, which then waits between half and all of
+*          that ceiling.
+*
+*****************************************************************************/
+void
+exosite_backoff_failure(exosite_backoff *b)
+{
+  uint32_t ceiling = b->cap_ms;
+  unsigned char shift;
+
+  b->stats.failures++;
+  if (255 > b->fails)
+    b->fails++;
+
+  shift = b->fails - 1;
+  if (BACKOFF_MAX_SHIFT < shift)
+    shift = BACKOFF_MAX_SHIFT;
+  if (b->base_ms <= (b->cap_ms >> shift))
+    ceiling = b->base_ms << shift;
+
+  if (BACKOFF_HALF_OPEN == b->state
+      || (BACKOFF_CLOSED == b->state && b->fails >= b->open_after))
+  {
+    b->state = BACKOFF_OPEN;
+    b->stats.opens++;
+  }
+
+  // an open circuit cools off for at least half the ceiling before the
+  // trial, full jitter could let it through at once
+  if (BACKOFF_OPEN == b->state)
+    b->delay = ceiling / 2 + backoff_random() % (ceiling - ceiling / 2 + 1);
+  else
+    b->delay = backoff_random() % (ceiling + 1);
+  b->start = exoHAL_MSTimerGet();
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  backoff_random
+*
+*  \param  None
+*
+*  \return Next number of a xorshift generator
+*
+*  \brief  Cheap pseudo random numbers for the jitter
+*
+*****************************************************************************/
+static uint32_t
+backoff_random(void)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+
+  return random_state;
+}
+
@@ -0,0 +1,80 @@
+/*****************************************************************************
+*
+*  exosite_backoff.h - Reconnect backoff header
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+
+#ifndef EXOSITE_BACKOFF_H
+#define EXOSITE_BACKOFF_H
+
+#include <stdint.h>
+
+// defines
+typedef enum
+{
+    BACKOFF_CLOSED,                            // attempts allowed, spaced by the backoff delay
+    BACKOFF_OPEN,                              // too many failures, attempts fail fast
+    BACKOFF_HALF_OPEN                          // one trial attempt in flight
+} BackoffStates;
+
+typedef struct
+{
+    uint16_t attempts;        // attempts allowed through
+    uint16_t failures;        // attempts that failed
+    uint16_t blocked;         // attempts refused while waiting out a delay
+    uint16_t opens;           // closed or half-open -> open transitions
+    uint16_t half_opens;      // open -> half-open transitions
+    uint16_t closes;          // half-open -> closed transitions
+} ExositeBackoffStats;
+
+typedef struct
+{
+    uint32_t base_ms;                          // delay ceiling after the first failure
+    uint32_t cap_ms;                           // largest delay ceiling
+    uint8_t open_after;                        // failures in a row that open the circuit
+    uint8_t state;                             // BackoffStates
+    uint8_t fails;                             // failures in a row
+    uint32_t start;                            // exoHAL_MSTimerGet() of the last failure
+    uint32_t delay;                            // ms to wait after it
+    ExositeBackoffStats stats;
+} exosite_backoff;
+
+// functions for export
+extern void exosite_backoff_init(exosite_backoff *b, uint32_t base_ms, uint32_t cap_ms, uint8_t open_after);
+extern void exosite_backoff_seed(uint32_t seed);
+extern int exosite_backoff_allow(exosite_backoff *b);
+extern uint32_t exosite_backoff_wait(exosite_backoff *b);
+extern void exosite_backoff_success(exosite_backoff *b);
+extern void exosite_backoff_failure(exosite_backoff *b);
+
+#endif
+
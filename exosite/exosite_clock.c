@@ -0,0 +1,487 @@
+/*****************************************************************************
+*
+*  exosite_clock.c - Wall clock kept from server time.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the   
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+#include "exosite_clock.h"
+#include "exosite_hal.h"
+#include <string.h>
+
+// local defines
+#define CLOCK_STEP_MS             2000        // larger errors jump the clock
+#define CLOCK_SLEW_PPM            500         // smaller ones are slewed out at this rate
+#define CLOCK_DRIFT_FACTOR        20          // drift is measured over at least accuracy (ms) x 20 s
+#define CLOCK_MIN_DRIFT_S         60
+#define CLOCK_MAX_PPM             500
+#define CLOCK_MAX_AGE_S           1728000UL   // 20 days, the timer math holds ~24
+#define DAYS_TO_1970              719468UL    // days from 0000-03-01 to 1970-01-01
+
+// local functions
+static void anchor(uint32_t epoch, int32_t ms, uint16_t accuracy, uint32_t at);
+static void measure_drift(uint32_t epoch, uint16_t ms, uint16_t accuracy, uint32_t at);
+static void set_base(uint32_t epoch, uint16_t ms, uint16_t accuracy, uint32_t at);
+static int32_t elapsed_ms(uint32_t at);
+static const char *parse_number(const char *p, unsigned char digits, uint16_t *value);
+static uint32_t days_from_civil(uint16_t year, uint8_t month, uint8_t day);
+
+// globals
+static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+static unsigned char clock_valid = 0;
+static uint32_t ref_epoch;                    // whole seconds at the anchor
+static uint16_t ref_frac;                     // plus these ms
+static uint16_t ref_accuracy;                 // ms the anchor may be off by
+static uint32_t ref_at;                       // exoHAL_MSTimerGet() at the anchor
+static int32_t slew_ms = 0;                   // error still to take out after the anchor
+static int16_t drift_ppm = 0;                 // added to the timer rate
+static unsigned char drift_known = 0;
+static uint32_t base_epoch;                   // reference the drift is measured from
+static uint16_t base_frac;
+static uint16_t base_accuracy;
+static uint32_t base_at;
+static ExositeClockStats clock_stats;
+
+/*****************************************************************************
+*
+*  exosite_clock_sync
+*
+*  \param  epoch, ms - reference time, seconds since 1970 and ms
+*          accuracy - ms the reference may be off by
+*          at - exoHAL_MSTimerGet() when the reference was taken
+*
+*  \return None
+*
+*  \brief  Feeds the clock a reference time. The first one sets it and a
+*          large error steps it. A small error is slewed out so the clock
+*          never jumps under stamped samples, and references far enough
+*          apart correct the rate of the local timer.
+*
+*****************************************************************************/
+void
+exosite_clock_sync(uint32_t epoch, uint16_t ms, uint16_t accuracy, uint32_t at)
+{
+  int32_t reading;
+  int32_t err;
+
+  clock_stats.syncs++;
+  epoch += ms / 1000;
+  ms %= 1000;
+
+  if (!exosite_clock_valid()
+      || (epoch - ref_epoch > CLOCK_MAX_AGE_S && ref_epoch - epoch > CLOCK_MAX_AGE_S))
+  {
+    if (clock_valid)
+      clock_stats.steps++;
+    anchor(epoch, ms, accuracy, at);
+    set_base(epoch, ms, accuracy, at);
+    return;
+  }
+
+  // where our clock is against the reference, in ms since the anchor
+  reading = (int32_t)ref_frac + elapsed_ms(at);
+  err = reading - ((int32_t)(epoch - ref_epoch) * 1000 + ms);
+  clock_stats.last_error_ms = err;
+
+  if (CLOCK_STEP_MS < err || -CLOCK_STEP_MS > err)
+  {
+    clock_stats.steps++;
+    anchor(epoch, ms, accuracy, at);
+    set_base(epoch, ms, accuracy, at);
+    return;
+  }
+
+  // a coarser reference that agrees within its accuracy tells us nothing
+  if (accuracy > ref_accuracy && (int32_t)accuracy >= err && -(int32_t)accuracy <= err)
+    return;
+
+  measure_drift(epoch, ms, accuracy, at);
+
+  // carry on from our own reading and take the error out gradually
+  anchor(ref_epoch, reading, accuracy, at);
+  slew_ms = -err;
+  if (0 != err)
+    clock_stats.slews++;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exosite_clock_valid
+*
+*  \param  None
+*
+*  \return 1 if the clock has been set and is recent enough to trust
+*
+*  \brief  Tells whether timestamps from the clock can be used
+*
+*****************************************************************************/
+int
+exosite_clock_valid(void)
+{
+  if (!clock_valid)
+    return 0;
+
+  return (exoHAL_MSTimerGet() - ref_at) / 1000 < CLOCK_MAX_AGE_S;
+}
+
+/*****************************************************************************
+*
+*  exosite_clock_now
+*
+*  \param  None
+*
+*  \return Seconds since 1970, 0 if the clock is not set
+*
+*  \brief  Current wall clock time
+*
+*****************************************************************************/
+uint32_t
+exosite_clock_now(void)
+{
+  return exosite_clock_at(exoHAL_MSTimerGet());
+}
+
+/*****************************************************************************
+*
+*  exosite_clock_at
+*
+*  \param  at - an exoHAL_MSTimerGet() value, past or present
+*
+*  \return Seconds since 1970 at that moment, 0 if the clock is not set
+*
+*  \brief  Stamps a sample taken earlier by the local timer
+*
+*****************************************************************************/
+uint32_t
+exosite_clock_at(uint32_t at)
+{
+  int32_t ms;
+
+  if (!exosite_clock_valid())
+    return 0;
+
+  ms = (int32_t)ref_frac + elapsed_ms(at);
+  if (ms < 0)
+    return ref_epoch - (uint32_t)((999 - ms) / 1000);
+
+  return ref_epoch + (uint32_t)(ms / 1000);
+}
+
+/*****************************************************************************
+*
+*  exosite_clock_parse_http
+*
+*  \param  date - HTTP date, "Tue, 18 Nov 2014 08:53:45 GMT"
+*          epoch - set to seconds since 1970
+*
+*  \return 1 if the date was understood; 0 otherwise
+*
+*  \brief  Converts the Date header of a response
+*
+*****************************************************************************/
+int
+exosite_clock_parse_http(const char *date, uint32_t *epoch)
+{
+  uint16_t day, year, hour, min, sec;
+  uint8_t month;
+  const char *p = strchr(date, ',');
+
+  if (NULL == p)
+    return 0;
+  p++;
+  while (' ' == *p)
+    p++;
+
+  if (NULL == (p = parse_number(p, 2, &day)) || ' ' != *p++)
+    return 0;
+
+  for (month = 0; month < 12; month++)
+  {
+    if (0 == strncmp(p, &months[month * 3], 3))
+      break;
+  }
+  if (12 <= month || ' ' != p[3])
+    return 0;
+  p += 4;
+
+  if (NULL == (p = parse_number(p, 4, &year)) || ' ' != *p++
+      || NULL == (p = parse_number(p, 2, &hour)) || ':' != *p++
+      || NULL == (p = parse_number(p, 2, &min)) || ':' != *p++
+      || NULL == (p = parse_number(p, 2, &sec)))
+    return 0;
+
+  if (1970 > year || 0 == day || 31 < day || 23 < hour || 59 < min || 60 < sec)
+    return 0;
+
+  *epoch = days_from_civil(year, month + 1, (uint8_t)day) * 86400UL
+           + hour * 3600UL + min * 60UL + sec;
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exosite_clock_split
+*
+*  \param  epoch - seconds since 1970; dt - set to the calendar time
+*
+*  \return None
+*
+*  \brief  Breaks a time into UTC date and time of day
+*
+*****************************************************************************/
+void
+exosite_clock_split(uint32_t epoch, ExositeDateTime *dt)
+{
+  uint32_t days = epoch / 86400UL + DAYS_TO_1970;
+  uint32_t secs = epoch % 86400UL;
+  uint32_t era, doe, yoe, doy, mp;
+
+  // civil from days, with years starting in March
+  era = days / 146097UL;
+  doe = days - era * 146097UL;
+  yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  mp = (5 * doy + 2) / 153;
+
+  dt->day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+  dt->month = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+  dt->year = (uint16_t)(yoe + era * 400 + (dt->month <= 2));
+  dt->hour = (uint8_t)(secs / 3600);
+  dt->min = (uint8_t)(secs / 60 % 60);
+  dt->sec = (uint8_t)(secs % 60);
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exosite_clock_stats
+*
+*  \param  stats - structure to copy the clock counters into
+*
+*  \return None
+*
+*  \brief  Reports how often the clock was fed, stepped and its drift
+*
+*****************************************************************************/
+void
+exosite_clock_stats(ExositeClockStats *stats)
+{
+  memcpy(stats, &clock_stats, sizeof(ExositeClockStats));
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  anchor
+*
+*  \param  epoch - whole seconds; ms - added to them, may be negative or
+*          over 1000; accuracy, at - as for exosite_clock_sync
+*
+*  \return None
+*
+*  \brief  Restarts the clock from a time, with nothing left to slew
+*
+*****************************************************************************/
+static void
+anchor(uint32_t epoch, int32_t ms, uint16_t accuracy, uint32_t at)
+{
+  if (ms < 0)
+  {
+    epoch -= (uint32_t)((999 - ms) / 1000);
+    ms = 999 - (999 - ms) % 1000;
+  }
+  ref_epoch = epoch + (uint32_t)(ms / 1000);
+  ref_frac = (uint16_t)(ms % 1000);
+  ref_accuracy = accuracy;
+  ref_at = at;
+  slew_ms = 0;
+  clock_valid = 1;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  measure_drift
+*
+*  \param  epoch, ms, accuracy, at - as for exosite_clock_sync
+*
+*  \return None
+*
+*  \brief  Compares how far the reference and the local timer moved since
+*          the drift base. Once that is long enough for the references'
+*          accuracy not to matter it becomes the rate correction.
+*
+*****************************************************************************/
+static void
+measure_drift(uint32_t epoch, uint16_t ms, uint16_t accuracy, uint32_t at)
+{
+  uint32_t since = (at - base_at) / 1000;
+  uint16_t worst = (accuracy > base_accuracy) ? accuracy : base_accuracy;
+  int32_t moved;
+  int32_t ppm;
+
+  if (since >= CLOCK_MAX_AGE_S)
+  {
+    set_base(epoch, ms, accuracy, at);
+    return;
+  }
+  if (since < CLOCK_MIN_DRIFT_S || since < (uint32_t)worst * CLOCK_DRIFT_FACTOR)
+    return;
+
+  // ms gained by the reference over the timer, per s is ppm / 1000
+  moved = (int32_t)(epoch - base_epoch) * 1000 + ms - base_frac
+          - (int32_t)(at - base_at);
+  set_base(epoch, ms, accuracy, at);
+
+  // over 2 x CLOCK_MAX_PPM is the reference jumping, not the timer drifting
+  if ((int32_t)since < moved || -(int32_t)since > moved)
+    return;
+  ppm = moved * 1000 / (int32_t)since;
+
+  // average with what we had to ride out noise
+  if (drift_known)
+    ppm = (ppm + drift_ppm) / 2;
+  if (CLOCK_MAX_PPM < ppm)
+    ppm = CLOCK_MAX_PPM;
+  if (-CLOCK_MAX_PPM > ppm)
+    ppm = -CLOCK_MAX_PPM;
+  drift_ppm = (int16_t)ppm;
+  drift_known = 1;
+  clock_stats.drift_ppm = drift_ppm;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  set_base
+*
+*  \param  epoch, ms, accuracy, at - as for exosite_clock_sync
+*
+*  \return None
+*
+*  \brief  Starts measuring the drift from a reference time
+*
+*****************************************************************************/
+static void
+set_base(uint32_t epoch, uint16_t ms, uint16_t accuracy, uint32_t at)
+{
+  base_epoch = epoch;
+  base_frac = ms;
+  base_accuracy = accuracy;
+  base_at = at;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  elapsed_ms
+*
+*  \param  at - an exoHAL_MSTimerGet() value
+*
+*  \return ms from the anchor to at, corrected for drift and slew
+*
+*  \brief  Local timer difference scaled by the drift correction, plus as
+*          much of the pending slew as has been taken out by then
+*
+*****************************************************************************/
+static int32_t
+elapsed_ms(uint32_t at)
+{
+  int32_t ms = (int32_t)(at - ref_at);
+  int32_t slew;
+
+  ms += (ms / 1000) * drift_ppm / 1000;
+  if (0 < ms && 0 != slew_ms)
+  {
+    slew = (ms / 1000) * CLOCK_SLEW_PPM / 1000;
+    if (slew_ms > 0)
+      ms += (slew < slew_ms) ? slew : slew_ms;
+    else
+      ms -= (slew < -slew_ms) ? slew : -slew_ms;
+  }
+
+  return ms;
+}
+
+/*****************************************************************************
+*
+*  parse_number
+*
+*  \param  p - text; digits - most digits to take; value - the number
+*
+*  \return Text past the number, NULL if there was no digit
+*
+*  \brief  Reads a small decimal number
+*
+*****************************************************************************/
+static const char *
+parse_number(const char *p, unsigned char digits, uint16_t *value)
+{
+  const char *start = p;
+
+  *value = 0;
+  while (0 < digits-- && '0' <= *p && '9' >= *p)
+    *value = *value * 10 + (*p++ - '0');
+
+  return (p == start) ? NULL : p;
+}
+
+/*****************************************************************************
+*
+*  days_from_civil
+*
+*  \param  year - 1970 on; month - 1 - 12; day - 1 - 31
+*
+*  \return Days since 1970-01-01
+*
+*  \brief  Day count of a calendar date, with years starting in March so
+*          the leap day comes last
+*
+*****************************************************************************/
+static uint32_t
+days_from_civil(uint16_t year, uint8_t month, uint8_t day)
+{
+  uint32_t y = year - (month <= 2);
+  uint32_t era = y / 400;
+  uint32_t yoe = y - era * 400;
+  uint32_t doy = (153UL * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return era * 146097UL + doe - DAYS_TO_1970;
+}
+
@@ -0,0 +1,73 @@
+/*****************************************************************************
+*
+*  exosite_clock.h - Wall clock header
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+
+#ifndef EXOSITE_CLOCK_H
+#define EXOSITE_CLOCK_H
+
+#include <stdint.h>
+
+// defines
+#define EXOSITE_CLOCK_EPOCH_MIN   946684800UL // 2000-01-01, smaller times are seconds since boot
+
+typedef struct
+{
+    uint16_t year;
+    uint8_t month;                             // 1 - 12
+    uint8_t day;                               // 1 - 31
+    uint8_t hour;
+    uint8_t min;
+    uint8_t sec;
+} ExositeDateTime;
+
+typedef struct
+{
+    uint16_t syncs;           // times the clock was fed
+    uint16_t steps;           // times it was off by too much and jumped
+    uint16_t slews;           // times a small error was taken out gradually
+    int16_t drift_ppm;        // rate correction of the local timer
+    int32_t last_error_ms;    // clock minus reference at the last sync
+} ExositeClockStats;
+
+// functions for export
+extern void exosite_clock_sync(uint32_t epoch, uint16_t ms, uint16_t accuracy, uint32_t at);
+extern int exosite_clock_valid(void);
+extern uint32_t exosite_clock_now(void);
+extern uint32_t exosite_clock_at(uint32_t at);
+extern int exosite_clock_parse_http(const char *date, uint32_t *epoch);
+extern void exosite_clock_split(uint32_t epoch, ExositeDateTime *dt);
+extern void exosite_clock_stats(ExositeClockStats *stats);
+
+#endif
+
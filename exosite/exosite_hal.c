@@ -45,6 +45,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <HostApp.h>
 #include <system/platform.h>
@@ -55,12 +56,69 @@
 #include <apps/apps.h>
 
 // local variables
-#define GS_RECV_OFFSET 1
+#define EXOHAL_RECV_TIMEOUT 3000
+#define EXOHAL_IDLE_SLICE 100   // ms waited between calls to the idle hook
+#define EXOHAL_POLL_SLICE 2     // ms exoHAL_SocketRecvPoll reads the UART for
 static uint8_t cid = 0xff;
 char exometa[META_SIZE];
-static int exo_recv_index = -1; // first socket buffer byte was GainSpan command byte
+static unsigned long exo_recv_timeout = EXOHAL_RECV_TIMEOUT;
+static void (*exo_idle_hook)(void) = NULL;
+static unsigned long exo_commands = 0; // module commands issued for requests
+
+#ifdef EXOSITE_HAL_HTTPCLIENT
+#define EXOHAL_DATA_RX ATLIBGS_MSG_ID_HTTP_RESPONSE_DATA_RX
+#define HTTP_PAGE_SIZE 128      // request line, a read of several aliases
+#define HTTP_LINE_SIZE 72       // longest header line kept
+#define HTTP_HEAD_SIZE 64       // status line and Content-Length made up
+#define HTTP_OPEN_TIMEOUT 10    // s the module tries to connect for
+#define HTTP_FRAME_GAP 20       // ms without a frame that ends a response
+enum httpStates {HTTP_REQUEST_LINE, HTTP_HEADERS, HTTP_BODY};
+// headers passed on to the module, each is set once and only changed or
+// deleted when a request differs. Content-Length goes with AT+HTTPSEND,
+// the rest are left to the module's defaults.
+typedef struct {
+  const char *name;
+  signed char param;            // ATLIBGS_HTTPCLIENT_E, -1 to set by name
+} http_header;
+static const http_header http_headers[] = {
+  {"Host", ATLIBGS_HTTP_HE_HOST},
+  {"Content-Type", ATLIBGS_HTTP_HE_CON_TYPE},
+  {"If-Modified-Since", ATLIBGS_HTTP_HE_IF_MODIF_SIN},
+  {"X-Exosite-CIK", -1},
+  {"Accept", -1},
+  {"Request-Timeout", -1},
+};
+#define HTTP_NUM_HEADERS (sizeof(http_headers) / sizeof(http_headers[0]))
+static struct {
+  unsigned char state;          // httpStates, of the request being sent
+  char page[HTTP_PAGE_SIZE];    // request line, then the path from it
+  char line[HTTP_LINE_SIZE];    // header line being collected
+  unsigned char len;            // of page or line, whichever is collected
+  ATLIBGS_HTTPSEND_E type;
+  unsigned short body_left;     // content bytes still to pass on
+  unsigned short timeout;       // s the module waits for the response
+  unsigned char present;        // bit per http_headers entry in the request
+  unsigned long conf[HTTP_NUM_HEADERS]; // hash of the value set, 0 for none
+  char head[HTTP_HEAD_SIZE];    // made up start of the response
+  unsigned char head_len;
+  unsigned char head_index;
+} http;
+#else
+#define EXOHAL_DATA_RX ATLIBGS_MSG_ID_DATA_RX
+#endif
 
 // local functions
+static unsigned char socket_recv(long socket, char * buffer, unsigned char len,
+                                 unsigned long timeout, void (*hook)(void));
+#ifdef EXOSITE_HAL_HTTPCLIENT
+static long http_open(char *serverip, uint16_t port);
+static unsigned short http_send(char * buffer, unsigned short len);
+static int http_request_line(void);
+static int http_header_line(void);
+static int http_start(void);
+static int http_frame(ATLIBGS_MSG_ID_E rxMsgId);
+static unsigned long http_hash(const char *value);
+#endif
 
 // externs
 extern void DisplayLCD(uint8_t, const uint8_t *);
@@ -68,6 +126,7 @@ extern char *itoa(int n, char *s, int b);
 
 // global variables
 #define EXOMETA_ADDR 177
+#define EXOQUEUE_ADDR 0x0400    // page aligned, well clear of the meta block
 
 
 /*****************************************************************************
@@ -198,6 +257,51 @@ exoHAL_ReadMetaItem(unsigned char * buffer, unsigned char len, int offset)
 }
 
 
+/*****************************************************************************
+*
+*  exoHAL_WriteQueue
+*
+*  \param  buffer - data to store; len - size of data in bytes; offset -
+*          offset from the base of the queue region
+*
+*  \return None
+*
+*  \brief  Stores data in the EEPROM region set aside for the sample queue.
+*          Writes that start on a page boundary and stay within
+*          EXOSITE_HAL_PAGE_SIZE multiples never share a page with other
+*          data.
+*
+*****************************************************************************/
+void
+exoHAL_WriteQueue(unsigned char * buffer, unsigned char len, unsigned short offset)
+{
+  EEPROM_Write(EXOQUEUE_ADDR+offset,(uint8_t *)buffer,len);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_ReadQueue
+*
+*  \param  buffer - buffer to read into; len - number of bytes to read;
+*          offset - offset from the base of the queue region
+*
+*  \return None
+*
+*  \brief  Reads data from the EEPROM region set aside for the sample queue
+*
+*****************************************************************************/
+void
+exoHAL_ReadQueue(unsigned char * buffer, unsigned char len, unsigned short offset)
+{
+  EEPROM_Seq_Read(EXOQUEUE_ADDR+offset,(uint8_t *)buffer, len);
+
+  return;
+}
+
+
 /*****************************************************************************
 *
 *  exoHAL_SocketClose
@@ -214,9 +318,14 @@ exoHAL_SocketClose(long socket)
 {
   if(socket == (long)cid)
   {
+    exo_commands++;
+#ifdef EXOSITE_HAL_HTTPCLIENT
+    AtLibGs_HTTPClose(cid);
+#else
     AtLibGs_Close(cid);
+#endif
+    App_FlushIncomingData(cid);
     cid = 0xff;
-    exo_recv_index = -1;
   }
   return;
 }
@@ -275,12 +384,124 @@ exoHAL_SocketOpenTCP(unsigned char *server)
 
   port = server[4];
   port = (port << 8) + (uint16_t)server[5];
+#ifdef EXOSITE_HAL_HTTPCLIENT
+  return http_open(serverip, port);
+#else
+  exo_commands++;
   AtLibGs_TCPClientStart(serverip, port, &cid);
+#endif
 
   return (long)cid;
 }
 
 
+/*****************************************************************************
+*
+*  exoHAL_ResolveServer
+*
+*  \param  host - name of the server; ip - set to its 4 byte address
+*
+*  \return 1 if the name was resolved; 0 otherwise
+*
+*  \brief  Looks the server up with the module's DNS client
+*
+*****************************************************************************/
+int
+exoHAL_ResolveServer(char *host, unsigned char *ip)
+{
+  char ipstr[16];
+  char *part = ipstr;
+  unsigned short value;
+  unsigned char i;
+
+  if (ATLIBGS_MSG_ID_OK != AtLibGs_DNSLookup(host))
+    return 0;
+  if (!AtLibGs_ParseDNSLookupResponse(ipstr))
+    return 0;
+
+  for (i = 0; i < 4; i++)
+  {
+    if (*part < '0' || *part > '9')
+      return 0;
+    for (value = 0; *part >= '0' && *part <= '9' && value < 256; part++)
+      value = value * 10 + (*part - '0');
+    if (value > 255 || (i < 3 && '.' != *part++))
+      return 0;
+    ip[i] = (unsigned char)value;
+  }
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_TimeSyncEnable
+*
+*  \param  ip - 4 byte address of the SNTP server; period - seconds
+*          between syncs
+*
+*  \return 1 if the module took the command; 0 otherwise
+*
+*  \brief  Has the module keep its own clock set by SNTP
+*
+*****************************************************************************/
+int
+exoHAL_TimeSyncEnable(unsigned char *ip, unsigned long period)
+{
+  char ipstr[16];
+
+  sprintf(ipstr, "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  if (ATLIBGS_MSG_ID_OK != AtLibGs_SNTPsync(true, ipstr, 10, true, period))
+    return 0;
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_TimeGet
+*
+*  \param  seconds - set to seconds since 1970; ms - plus these ms
+*
+*  \return 1 if the module returned a time; 0 otherwise
+*
+*  \brief  Reads the module's clock
+*
+*****************************************************************************/
+int
+exoHAL_TimeGet(unsigned long *seconds, unsigned short *ms)
+{
+  uint32_t secs;
+  uint16_t msecs;
+
+  if (ATLIBGS_MSG_ID_OK != AtLibGs_GetTime())
+    return 0;
+  if (!AtLibGs_ParseGetTimeResponse(&secs, &msecs))
+    return 0;
+
+  *seconds = secs;
+  *ms = msecs;
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_SetTime
+*
+*  \param  day - "dd/mm/yyyy"; time - "hh:mm:ss", both UTC
+*
+*  \return 1 if the module took the time; 0 otherwise
+*
+*  \brief  Sets the module's clock
+*
+*****************************************************************************/
+int
+exoHAL_SetTime(char *day, char *time)
+{
+  return (ATLIBGS_MSG_ID_OK == AtLibGs_SetTime(day, time));
+}
+
 /*****************************************************************************
 *
 *  exoHAL_ServerConnect
@@ -295,7 +516,6 @@ exoHAL_SocketOpenTCP(unsigned char *server)
 long
 exoHAL_ServerConnect(long sock)
 {
-  //TODO - use DNS or check m2.exosite.com/ip to check for updates
   if( sock == (long)cid)
     return (long)cid;
   else
@@ -314,12 +534,31 @@ exoHAL_ServerConnect(long sock)
 *  \brief  Sends data out to the internet
 *
 *****************************************************************************/
-unsigned char
-exoHAL_SocketSend(long socket, char * buffer, unsigned char len)
+unsigned short
+exoHAL_SocketSend(long socket, char * buffer, unsigned short len)
 {
-  App_PrepareIncomingData();
   if(socket == (long)cid)
-    AtLibGs_SendTCPData(cid, (char *)buffer, len);
+  {
+    // drop anything left over from the previous response, the other
+    // connections keep theirs
+    App_FlushIncomingData(cid);
+#ifdef EXOSITE_HAL_HTTPCLIENT
+    http.head_len = 0;
+    http.head_index = 0;
+#endif
+#ifdef EXOSITE_HAL_HTTPCLIENT
+    if (http_send(buffer, len) != len)
+#else
+    exo_commands++;
+    if (AtLibGs_SendTCPData(cid, (char *)buffer, len) != ATLIBGS_MSG_ID_OK)
+#endif
+    {
+      // the module refused the data, usually because the server already
+      // closed the connection (DISCONNECT) while we were idle
+      exoHAL_SocketClose(socket);
+      len = 0;
+    }
+  }
   else
     len = 0;
 
@@ -342,35 +581,93 @@ exoHAL_SocketSend(long socket, char * buffer, unsigned char len)
 unsigned char
 exoHAL_SocketRecv(long socket, char * buffer, unsigned char len)
 {
-  if (socket == (long)cid)
-  {
-    int rec_len = 0, rxbufsize = 0;
-    ATLIBGS_MSG_ID_E rxMsgId = ATLIBGS_MSG_ID_NONE;
+  return socket_recv(socket, buffer, len, exo_recv_timeout, exo_idle_hook);
+}
 
-    if (exo_recv_index == -1) {
-      rxMsgId = AtLibGs_ReceiveDataHandle(3000);
-      if (ATLIBGS_MSG_ID_DATA_RX != rxMsgId || G_receivedCount <= GS_RECV_OFFSET)
-        return 0;
-      exo_recv_index = GS_RECV_OFFSET;
-    }
-    rxbufsize = G_receivedCount - exo_recv_index;
 
-    rec_len = len <= rxbufsize ? len : rxbufsize;
-    memcpy(buffer, &G_received[exo_recv_index], rec_len);
-    exo_recv_index += rec_len;
+/*****************************************************************************
+*
+*  exoHAL_SocketRecvPoll
+*
+*  \param  socket - socket handle; buffer - string buffer to put info we
+*          receive; len - size of buffer in bytes;
+*
+*  \return Number of bytes received, 0 if nothing has arrived yet
+*
+*  \brief  Receives data from the internet without waiting for it. Check
+*          exoHAL_SocketIsOpen to tell a closed connection from a quiet one.
+*
+*****************************************************************************/
+unsigned char
+exoHAL_SocketRecvPoll(long socket, char * buffer, unsigned char len)
+{
+  return socket_recv(socket, buffer, len, EXOHAL_POLL_SLICE, NULL);
+}
 
-    if(exo_recv_index == G_receivedCount) {
-      exo_recv_index = -1;
-    }
+/*****************************************************************************
+*
+*  exoHAL_SocketIsOpen
+*
+*  \param  socket - socket handle
+*
+*  \return 1 if the socket is still connected; 0 otherwise
+*
+*  \brief  Checks whether a previously opened socket can be reused
+*
+*****************************************************************************/
+int
+exoHAL_SocketIsOpen(long socket)
+{
+  return (cid != 0xff && socket == (long)cid);
+}
 
-    return rec_len;
-  }
+/*****************************************************************************
+*
+*  exoHAL_SetRecvTimeout
+*
+*  \param  timeout - milliseconds exoHAL_SocketRecv waits for data, 0 for
+*          the default
+*
+*  \return None
+*
+*  \brief  Lets a request that the server holds open wait longer than usual
+*
+*****************************************************************************/
+void
+exoHAL_SetRecvTimeout(unsigned long timeout)
+{
+  exo_recv_timeout = (0 == timeout) ? EXOHAL_RECV_TIMEOUT : timeout;
 
-  return 0;
+  return;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_SetIdleHook
+*
+*  \param  hook - function to call while waiting for data, NULL for none
+*
+*  \return None
+*
+*  \brief  Lets the application do periodic work, like sampling sensors,
+*          while exoHAL_SocketRecv waits on the server
+*
+*****************************************************************************/
+void
+exoHAL_SetIdleHook(void (*hook)(void))
+{
+  exo_idle_hook = hook;
+
+  return;
 }
 
 long exoHAL_ClientSSLOpen(long socket, char caName[])
 {
+#ifdef EXOSITE_HAL_HTTPCLIENT
+  // AT+HTTPOPEN already started SSL on port 443
+  return socket;
+#else
+  exo_commands++;
   if(AtLibGs_SSLOpen((uint8_t)socket, caName) !=  ATLIBGS_MSG_ID_OK)
   {
     exoHAL_SocketClose(socket);
@@ -378,6 +675,7 @@ long exoHAL_ClientSSLOpen(long socket, char caName[])
   }
   
   return socket;
+#endif
 }
 
 
@@ -400,3 +698,530 @@ exoHAL_MSDelay(unsigned short delay)
   return;
 }
 
+
+/*****************************************************************************
+*
+*  exoHAL_MSTimerGet
+*
+*  \param  None
+*
+*  \return Free running millisecond count
+*
+*  \brief  Reads the millisecond timer, used to time requests
+*
+*****************************************************************************/
+unsigned long
+exoHAL_MSTimerGet(void)
+{
+  return MSTimerGet();
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_GetStats
+*
+*  \param  commands - set to the module commands issued for requests;
+*          bytes - set to the bytes written to the module
+*
+*  \return None
+*
+*  \brief  Counts the module traffic since boot, a request's share is the
+*          difference between a read before and after it
+*
+*****************************************************************************/
+void
+exoHAL_GetStats(unsigned long *commands, unsigned long *bytes)
+{
+  *commands = exo_commands;
+  *bytes = G_writtenCount;
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_KeepsHeaders
+*
+*  \param  None
+*
+*  \return 1 if responses reach the parser with their headers; 0 otherwise
+*
+*  \brief  Tells whether Date and Last-Modified reach the parser. The
+*          module's HTTP client hands over the status and content only.
+*
+*****************************************************************************/
+int
+exoHAL_KeepsHeaders(void)
+{
+#ifdef EXOSITE_HAL_HTTPCLIENT
+  return 0;
+#else
+  return 1;
+#endif
+}
+
+
+/*****************************************************************************
+*
+*  socket_recv
+*
+*  \param  socket - socket handle; buffer - string buffer to put info we
+*          receive; len - size of buffer in bytes; timeout - ms to wait for
+*          a frame; hook - called while waiting, or NULL
+*
+*  \return Number of bytes received
+*
+*  \brief  Hands out the frame being read or waits for the next one. A
+*          frame larger than the receive pool is handed out as it comes
+*          in. If bytes of the connection were dropped the socket is closed
+*          and 0 returned, so the response ends short and fails.
+*
+*****************************************************************************/
+static unsigned char
+socket_recv(long socket, char * buffer, unsigned char len,
+            unsigned long timeout, void (*hook)(void))
+{
+  if (socket == (long)cid)
+  {
+    uint8_t closed;
+    ATLIBGS_MSG_ID_E rxMsgId = ATLIBGS_MSG_ID_NONE;
+
+    // part of the response did not fit in the receive pool, fail the
+    // request rather than hand on a response with a hole in it
+    if (0 != App_IncomingDropped(cid))
+    {
+      exoHAL_SocketClose(socket);
+      return 0;
+    }
+
+    if (0 == App_IncomingCount(cid)
+#ifdef EXOSITE_HAL_HTTPCLIENT
+        && http.head_index == http.head_len
+#endif
+       ) {
+      unsigned long start = MSTimerGet();
+      unsigned long wait;
+
+      // wait in slices so the application keeps running during long polls,
+      // the AT library picks up a partly received frame where it left off.
+      // Data for the other connections goes to their own buffers.
+      do
+      {
+        wait = timeout - MSTimerDelta(start);
+        if (NULL != hook && EXOHAL_IDLE_SLICE < wait)
+          wait = EXOHAL_IDLE_SLICE;
+        rxMsgId = AtLibGs_ReceiveDataHandle(wait);
+        if (0 < App_IncomingCount(cid))
+          break;
+        if (ATLIBGS_MSG_ID_DISCONNECT == rxMsgId)
+        {
+          closed = AtLibGs_ParseDisconnect();
+          if (ATLIBGS_INVALID_CID == closed || cid == closed)
+          {
+            // server closed the connection, the module has already freed
+            // the cid
+            cid = 0xff;
+            return 0;
+          }
+        }
+        else if (ATLIBGS_MSG_ID_RESPONSE_TIMEOUT != rxMsgId
+                 && ATLIBGS_MSG_ID_DATA_RX != rxMsgId
+                 && ATLIBGS_MSG_ID_DATA_RX_FULL != rxMsgId
+                 && ATLIBGS_MSG_ID_HTTP_RESPONSE_DATA_RX != rxMsgId)
+          return 0;
+        if (NULL != hook)
+          hook();
+      } while (MSTimerDelta(start) < timeout);
+      if (0 == App_IncomingCount(cid))
+        return 0;
+#ifdef EXOSITE_HAL_HTTPCLIENT
+      // the made up Content-Length would cover only what was kept
+      if (0 != http_frame(rxMsgId))
+      {
+        exoHAL_SocketClose(socket);
+        return 0;
+      }
+#endif
+    }
+#ifdef EXOSITE_HAL_HTTPCLIENT
+    if (http.head_index < http.head_len)
+    {
+      int rec_len = http.head_len - http.head_index;
+
+      if (rec_len > len)
+        rec_len = len;
+      memcpy(buffer, &http.head[http.head_index], rec_len);
+      http.head_index += rec_len;
+      return rec_len;
+    }
+#endif
+
+    return App_ReadIncomingData(cid, buffer, len);
+  }
+
+  return 0;
+}
+
+
+#ifdef EXOSITE_HAL_HTTPCLIENT
+/*****************************************************************************
+*
+*  http_open
+*
+*  \param  serverip - dotted address of the server; port - its port
+*
+*  \return -1: failure; Other: socket handle
+*
+*  \brief  Opens the module's HTTP client on the server, with SSL on 443
+*
+*****************************************************************************/
+static long
+http_open(char *serverip, uint16_t port)
+{
+  exo_commands++;
+  if (AtLibGs_HTTPOpen(serverip, port, 443 == port, EXOSITE_CA_NAME, "",
+                       HTTP_OPEN_TIMEOUT, &cid) != ATLIBGS_MSG_ID_OK)
+  {
+    cid = 0xff;
+    return -1;
+  }
+
+  // a new client starts with no headers of ours set
+  memset(http.conf, 0, sizeof(http.conf));
+  http.state = HTTP_REQUEST_LINE;
+  http.len = 0;
+  http.head_len = 0;
+  http.head_index = 0;
+
+  exo_commands++;
+  AtLibGs_HTTPConf(ATLIBGS_HTTP_HE_CONN, "keep-alive");
+
+  return (long)cid;
+}
+
+
+/*****************************************************************************
+*
+*  http_send
+*
+*  \param  buffer - part of the request text; len - its size in bytes
+*
+*  \return len if it was passed on; 0 on failure
+*
+*  \brief  Turns the request text exosite.c streams into the module's HTTP
+*          client commands. The headers are collected until the blank line,
+*          which sends AT+HTTPSEND, then the content goes out as it comes.
+*
+*****************************************************************************/
+static unsigned short
+http_send(char * buffer, unsigned short len)
+{
+  unsigned short i = 0;
+  unsigned short n;
+  char c;
+
+  while (i < len)
+  {
+    if (HTTP_BODY == http.state)
+    {
+      n = len - i;
+      if (n > http.body_left)
+        n = http.body_left;
+      AtLibGs_DataSend(&buffer[i], n);
+      i += n;
+      http.body_left -= n;
+      if (0 == http.body_left)
+        http.state = HTTP_REQUEST_LINE;
+      continue;
+    }
+
+    c = buffer[i++];
+    if ('\r' == c)
+      continue;
+    if ('\n' != c)
+    {
+      // count what doesn't fit so the line can be refused at its end
+      if (HTTP_REQUEST_LINE == http.state && http.len < HTTP_PAGE_SIZE)
+      {
+        if (http.len < HTTP_PAGE_SIZE - 1)
+          http.page[http.len] = c;
+        http.len++;
+      }
+      else if (HTTP_HEADERS == http.state && http.len < HTTP_LINE_SIZE)
+      {
+        if (http.len < HTTP_LINE_SIZE - 1)
+          http.line[http.len] = c;
+        http.len++;
+      }
+      continue;
+    }
+
+    if (HTTP_REQUEST_LINE == http.state)
+    {
+      if (0 != http_request_line())
+        return 0;
+    }
+    else if (0 != http_header_line())
+      return 0;
+    http.len = 0;
+  }
+
+  return len;
+}
+
+
+/*****************************************************************************
+*
+*  http_request_line
+*
+*  \param  None
+*
+*  \return 0 if the request line was taken; -1 otherwise
+*
+*  \brief  Keeps the method and path of "GET /path HTTP/1.1" in http
+*
+*****************************************************************************/
+static int
+http_request_line(void)
+{
+  char *path;
+  char *end;
+
+  if (http.len >= HTTP_PAGE_SIZE)
+    return -1;
+  http.page[http.len] = 0;
+
+  if (0 == strncmp(http.page, "GET ", 4))
+    http.type = ATLIBGS_HTTPSEND_GET;
+  else if (0 == strncmp(http.page, "POST ", 5))
+    http.type = ATLIBGS_HTTPSEND_POST;
+  else
+    return -1;
+
+  path = strchr(http.page, ' ') + 1;
+  end = strchr(path, ' ');
+  if (NULL != end)
+    *end = 0;
+  memmove(http.page, path, strlen(path) + 1);
+
+  http.state = HTTP_HEADERS;
+  http.body_left = 0;
+  http.present = 0;
+
+  return 0;
+}
+
+
+/*****************************************************************************
+*
+*  http_header_line
+*
+*  \param  None
+*
+*  \return 0 if the header was taken; -1 if the module refused it
+*
+*  \brief  Sets a header on the module if its value changed since the last
+*          request, the blank line after the headers starts the request
+*
+*****************************************************************************/
+static int
+http_header_line(void)
+{
+  char *value;
+  unsigned long hash;
+  unsigned char i;
+  ATLIBGS_MSG_ID_E rxMsgId;
+
+  if (0 == http.len)
+    return http_start();
+  if (http.len >= HTTP_LINE_SIZE)
+    return -1;
+  http.line[http.len] = 0;
+
+  value = strchr(http.line, ':');
+  if (NULL == value)
+    return 0;
+  *value++ = 0;
+  while (' ' == *value)
+    value++;
+
+  if (0 == strcmp(http.line, "Content-Length"))
+  {
+    http.body_left = (unsigned short)atoi(value);
+    return 0;
+  }
+
+  for (i = 0; i < HTTP_NUM_HEADERS; i++)
+  {
+    if (0 == strcmp(http.line, http_headers[i].name))
+      break;
+  }
+  if (HTTP_NUM_HEADERS == i)
+    return 0;
+
+  http.present |= 1 << i;
+  hash = http_hash(value);
+  if (hash == http.conf[i])
+    return 0;
+
+  exo_commands++;
+  if (0 <= http_headers[i].param)
+    rxMsgId = AtLibGs_HTTPConf((ATLIBGS_HTTPCLIENT_E)http_headers[i].param,
+                               value);
+  else
+    rxMsgId = AtLibGs_HTTPConfName(http_headers[i].name, value);
+  if (ATLIBGS_MSG_ID_OK != rxMsgId)
+  {
+    http.conf[i] = 0;
+    return -1;
+  }
+  http.conf[i] = hash;
+
+  return 0;
+}
+
+
+/*****************************************************************************
+*
+*  http_start
+*
+*  \param  None
+*
+*  \return 0 if the module took the request; -1 otherwise
+*
+*  \brief  Deletes the headers this request left out and sends AT+HTTPSEND
+*
+*****************************************************************************/
+static int
+http_start(void)
+{
+  unsigned char i;
+  unsigned short timeout;
+
+  for (i = 0; i < HTTP_NUM_HEADERS; i++)
+  {
+    if (0 == http.conf[i] || (http.present & (1 << i)))
+      continue;
+    exo_commands++;
+    if (0 <= http_headers[i].param)
+      AtLibGs_HTTPConfDel((ATLIBGS_HTTPCLIENT_E)http_headers[i].param);
+    else
+      AtLibGs_HTTPConfDelName(http_headers[i].name);
+    http.conf[i] = 0;
+  }
+
+  // the module gives up on the response when exoHAL_SocketRecv would
+  timeout = (unsigned short)((exo_recv_timeout + 999) / 1000);
+  exo_commands++;
+  if (AtLibGs_HTTPSendStart(cid, http.type, timeout, http.page,
+                            http.body_left) != ATLIBGS_MSG_ID_OK)
+    return -1;
+
+  http.state = (0 < http.body_left) ? HTTP_BODY : HTTP_REQUEST_LINE;
+
+  return 0;
+}
+
+
+/*****************************************************************************
+*
+*  http_frame
+*
+*  \param  rxMsgId - what ended the wait for the first frame
+*
+*  \return 0 if the response was taken; -1 if it didn't all fit
+*
+*  \brief  Makes the response in the connection's buffer look like what a
+*          server sends. The module hands over "200 OK\r\n" and the
+*          content in ESC H frames, the first starting with the status.
+*          None is marked as the last, so frames are taken until the
+*          module stays quiet for HTTP_FRAME_GAP. The status line is taken
+*          out and a status line and Content-Length are made up in its
+*          place, so the whole response must fit in the receive pool. Date
+*          and Last-Modified never reach us, see exoHAL_KeepsHeaders.
+*
+*****************************************************************************/
+static int
+http_frame(ATLIBGS_MSG_ID_E rxMsgId)
+{
+  int full = (ATLIBGS_MSG_ID_DATA_RX_FULL == rxMsgId);
+  char *status = &http.head[9];
+  int status_len = 0;
+  int content;
+  char c = 0;
+
+  // the frames after the first follow at once
+  do
+  {
+    content = App_IncomingCount(cid);
+    rxMsgId = AtLibGs_ReceiveDataHandle(HTTP_FRAME_GAP);
+    if (ATLIBGS_MSG_ID_DATA_RX_FULL == rxMsgId)
+      full = 1;
+  } while (App_IncomingCount(cid) != content);
+  if (full || 0 != App_IncomingDropped(cid))
+    return -1;
+
+  http.head_len = 0;
+  http.head_index = 0;
+  while (App_ReadIncomingData(cid, &c, 1))
+  {
+    if ('\n' == c)
+      break;
+    if (status_len < HTTP_HEAD_SIZE - 10)
+      status[status_len++] = c;
+  }
+  if ('\n' != c || (5 <= status_len && 0 == strncmp(status, "HTTP/", 5)))
+  {
+    // not the short form, hand on what was taken out as it came
+    memmove(http.head, status, status_len);
+    http.head_len = status_len;
+    if ('\n' == c)
+      http.head[http.head_len++] = '\n';
+    return 0;
+  }
+
+  content = App_IncomingCount(cid);
+  if (0 < status_len && '\r' == status[status_len - 1])
+    status_len--;
+  // room for "HTTP/1.1 ", "\r\nContent-Length: 65535\r\n\r\n" and the 0
+  if (status_len > HTTP_HEAD_SIZE - 37)
+    status_len = HTTP_HEAD_SIZE - 37;
+
+  // the status is already in place behind "HTTP/1.1 "
+  memcpy(http.head, "HTTP/1.1 ", 9);
+  http.head_len = (unsigned char)sprintf(&http.head[9 + status_len],
+                                         "\r\nContent-Length: %d\r\n\r\n",
+                                         content) + 9 + status_len;
+
+  return 0;
+}
+
+
+/*****************************************************************************
+*
+*  http_hash
+*
+*  \param  value - header value
+*
+*  \return FNV-1a hash of the value, never 0
+*
+*  \brief  Tells whether a header changed without keeping its text
+*
+*****************************************************************************/
+static unsigned long
+http_hash(const char *value)
+{
+  unsigned long hash = 2166136261UL;
+
+  while (*value)
+  {
+    hash ^= (unsigned char)*value++;
+    hash *= 16777619UL;
+  }
+
+  return (0 == hash) ? 1 : hash;
+}
+#endif
+
@@ -38,6 +38,11 @@
 
 // defines
 #define EXOSITE_HAL_SN_MAXLENGTH             25
+#define EXOSITE_HAL_QUEUE_SIZE               8224     // 32 byte pages
+#define EXOSITE_HAL_PAGE_SIZE                32
+// requests go through the module's HTTP client rather than a raw TCP
+// socket, the headers are set once with AT+HTTPCONF and kept
+//#define EXOSITE_HAL_HTTPCLIENT
 
 // functions for export
 extern int exoHAL_ReadUUID(unsigned char if_nbr, unsigned char * UUID_buf);
@@ -45,13 +50,26 @@ extern void exoHAL_EnableMeta(void);
 extern void exoHAL_EraseMeta(void);
 extern void exoHAL_WriteMetaItem(unsigned char * buffer, unsigned char len, int offset);
 extern void exoHAL_ReadMetaItem(unsigned char * buffer, unsigned char len, int offset);
+extern void exoHAL_WriteQueue(unsigned char * buffer, unsigned char len, unsigned short offset);
+extern void exoHAL_ReadQueue(unsigned char * buffer, unsigned char len, unsigned short offset);
 extern void exoHAL_SocketClose(long socket);
 extern long exoHAL_SocketOpenTCP(unsigned char *server);
+extern int exoHAL_ResolveServer(char *host, unsigned char *ip);
+extern int exoHAL_TimeSyncEnable(unsigned char *ip, unsigned long period);
+extern int exoHAL_TimeGet(unsigned long *seconds, unsigned short *ms);
+extern int exoHAL_SetTime(char *day, char *time);
 extern long exoHAL_ServerConnect(long socket);
 extern long exoHAL_ClientSSLOpen(long socket, char caName[]);
-extern unsigned char exoHAL_SocketSend(long socket, char * buffer, unsigned char len);
+extern unsigned short exoHAL_SocketSend(long socket, char * buffer, unsigned short len);
 extern unsigned char exoHAL_SocketRecv(long socket, char * buffer, unsigned char len);
+extern unsigned char exoHAL_SocketRecvPoll(long socket, char * buffer, unsigned char len);
+extern int exoHAL_SocketIsOpen(long socket);
+extern void exoHAL_SetRecvTimeout(unsigned long timeout);
+extern void exoHAL_SetIdleHook(void (*hook)(void));
 extern void exoHAL_MSDelay(unsigned short delay);
+extern unsigned long exoHAL_MSTimerGet(void);
+extern void exoHAL_GetStats(unsigned long *commands, unsigned long *bytes);
+extern int exoHAL_KeepsHeaders(void);
 
 #endif
 
@@ -0,0 +1,869 @@
+/*****************************************************************************
+*
+*  exosite_hal_posix.c - Exosite adaptation layer for POSIX hosts.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+/*
+ * Stands in for exosite_hal.c so the client can be run and measured on a
+ * Linux host: BSD sockets instead of the GainSpan module, a file instead
+ * of the EEPROM and clock_gettime for the timers. It is not part of the
+ * IAR project. Build it with the rest of exosite/ except exosite_hal.c:
+ *
+ *   cc -I. -c exosite/exosite*.c    (leave out exosite/exosite_hal.c)
+ *
+ * With EXOSITE_HAL_OPENSSL defined, exoHAL_ClientSSLOpen starts TLS with
+ * OpenSSL (link -lssl -lcrypto). The chain is checked against the system
+ * CAs, or the file named by EXOSITE_CA_FILE, and the server name is not,
+ * as the client only knows the server's address. Without it the
+ * connection stays plain TCP, for a local stand-in server.
+ *
+ * Environment:
+ *   EXOSITE_SERVER   - host looked up in place of the one asked for
+ *   EXOSITE_NV_FILE  - meta and sample queue store, "exosite_nv.bin"
+ *   EXOSITE_UUID     - serial number reported, the eth0 MAC otherwise
+ *   EXOSITE_CA_FILE  - PEM file of CAs to trust instead of the system's
+ *   EXOSITE_FRAME_MS - ms each exoHAL_SocketSend waits, as the ESC S / ESC E
+ *                      handshake of a data frame takes on the module
+ */
+#include "exosite.h"
+#include "exosite_hal.h"
+#include "exosite_meta.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#ifdef EXOSITE_HAL_OPENSSL
+#include <openssl/ssl.h>
+#endif
+
+// local variables
+#define EXOHAL_RECV_TIMEOUT 3000
+#define EXOHAL_IDLE_SLICE 100   // ms waited between calls to the idle hook
+#define EXOHAL_NV_FILE "exosite_nv.bin"
+#define EXOHAL_UUID_IFACE "/sys/class/net/eth0/address"
+static int exo_sock = -1;       // the one socket the client drives
+static unsigned long exo_recv_timeout = EXOHAL_RECV_TIMEOUT;
+static void (*exo_idle_hook)(void) = NULL;
+static unsigned long exo_commands = 0;  // socket calls issued for requests
+static unsigned long exo_bytes = 0;     // bytes written to the socket
+#ifdef EXOSITE_HAL_OPENSSL
+static SSL_CTX *exo_ssl_ctx = NULL;
+static SSL *exo_ssl = NULL;
+#endif
+
+// the meta block and the sample queue share the file, as they share the
+// EEPROM on the board
+#define EXOMETA_ADDR 0
+#define EXOQUEUE_ADDR META_SIZE
+
+// local functions
+static void nv_access(unsigned char * buffer, unsigned short len,
+                      long offset, int write);
+static unsigned char socket_recv(long socket, char * buffer, unsigned char len,
+                                 unsigned long timeout, void (*hook)(void));
+
+
+/*****************************************************************************
+*
+*  exoHAL_ReadUUID
+*
+*  \param  Interface Number (1 - WiFi), buffer to return hexadecimal MAC
+*
+*  \return 0 if failure; len of UUID if success;
+*
+*  \brief  Reads EXOSITE_UUID, or the host's MAC address without colons
+*
+*****************************************************************************/
+int
+exoHAL_ReadUUID(unsigned char if_nbr, unsigned char * UUID_buf)
+{
+  char mac[32];
+  const char *uuid = getenv("EXOSITE_UUID");
+  FILE *fp;
+  int i, len = 0;
+
+  (void)if_nbr;
+  if (NULL != uuid)
+  {
+    strncpy((char *)UUID_buf, uuid, EXOSITE_HAL_SN_MAXLENGTH - 1);
+    UUID_buf[EXOSITE_HAL_SN_MAXLENGTH - 1] = 0;
+    return strlen((char *)UUID_buf);
+  }
+
+  fp = fopen(EXOHAL_UUID_IFACE, "r");
+  if (NULL == fp)
+    return 0;
+  if (NULL == fgets(mac, sizeof(mac), fp))
+    mac[0] = 0;
+  fclose(fp);
+
+  // "00:1d:c9:..." to "001DC9...", as the module reports it
+  for (i = 0; mac[i] && len < 12; i++)
+  {
+    if (':' == mac[i] || '\n' == mac[i])
+      continue;
+    UUID_buf[len++] = (mac[i] >= 'a' && mac[i] <= 'f') ? mac[i] - 32 : mac[i];
+  }
+  UUID_buf[len] = 0;
+
+  return (12 == len) ? len : 0;
+}
+
+
+/*****************************************************************************
+*
+* exoHAL_EnableMeta
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Enables meta non-volatile memory, if any
+*
+*****************************************************************************/
+void
+exoHAL_EnableMeta(void)
+{
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_EraseMeta
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Wipes out meta information - replaces with 0's
+*
+*****************************************************************************/
+void
+exoHAL_EraseMeta(void)
+{
+  unsigned char zeros[META_SIZE];
+
+  memset(zeros, 0, META_SIZE);
+  nv_access(zeros, META_SIZE, EXOMETA_ADDR, 1);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_WriteMetaItem
+*
+*  \param  buffer - string buffer containing info to write to meta; len -
+*          size of string in bytes; offset - offset from base of meta
+*          location to store the item
+*
+*  \return None
+*
+*  \brief  Stores information to the NV meta structure
+*
+*****************************************************************************/
+void
+exoHAL_WriteMetaItem(unsigned char * buffer, unsigned char len, int offset)
+{
+  nv_access(buffer, len, EXOMETA_ADDR + offset, 1);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_ReadMetaItem
+*
+*  \param  buffer - buffer we can read meta info into; len - size of the
+*          buffer (max 256 bytes); offset - offset from base of meta to begin
+*          reading from;
+*
+*  \return None
+*
+*  \brief  Reads information from the NV meta structure
+*
+*****************************************************************************/
+void
+exoHAL_ReadMetaItem(unsigned char * buffer, unsigned char len, int offset)
+{
+  nv_access(buffer, len, EXOMETA_ADDR + offset, 0);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_WriteQueue
+*
+*  \param  buffer - data to store; len - size of data in bytes; offset -
+*          offset from the base of the queue region
+*
+*  \return None
+*
+*  \brief  Stores data in the part of the file set aside for the sample
+*          queue
+*
+*****************************************************************************/
+void
+exoHAL_WriteQueue(unsigned char * buffer, unsigned char len, unsigned short offset)
+{
+  nv_access(buffer, len, EXOQUEUE_ADDR + offset, 1);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_ReadQueue
+*
+*  \param  buffer - buffer to read into; len - number of bytes to read;
+*          offset - offset from the base of the queue region
+*
+*  \return None
+*
+*  \brief  Reads data from the part of the file set aside for the sample
+*          queue
+*
+*****************************************************************************/
+void
+exoHAL_ReadQueue(unsigned char * buffer, unsigned char len, unsigned short offset)
+{
+  nv_access(buffer, len, EXOQUEUE_ADDR + offset, 0);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_SocketClose
+*
+*  \param  socket - socket handle
+*
+*  \return None
+*
+*  \brief  Closes a socket
+*
+*****************************************************************************/
+void
+exoHAL_SocketClose(long socket)
+{
+  if (socket == (long)exo_sock && -1 != exo_sock)
+  {
+#ifdef EXOSITE_HAL_OPENSSL
+    if (NULL != exo_ssl)
+    {
+      SSL_shutdown(exo_ssl);
+      SSL_free(exo_ssl);
+      exo_ssl = NULL;
+    }
+#endif
+    exo_commands++;
+    close(exo_sock);
+    exo_sock = -1;
+  }
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_SocketOpenTCP
+*
+*  \param  server - 4 byte address and 2 byte port of the server
+*
+*  \return -1: failure; Other: socket handle
+*
+*  \brief  Opens a TCP socket and connects it to the server
+*
+*****************************************************************************/
+long
+exoHAL_SocketOpenTCP(unsigned char *server)
+{
+  struct sockaddr_in addr;
+  int one = 1;
+
+  if (-1 != exo_sock)
+    return -1;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  memcpy(&addr.sin_addr, server, 4);
+  addr.sin_port = htons((unsigned short)((server[4] << 8) + server[5]));
+
+  exo_sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (-1 == exo_sock)
+    return -1;
+  // each request goes out in one write, don't hold it back for an ACK
+  setsockopt(exo_sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  exo_commands++;
+  if (0 != connect(exo_sock, (struct sockaddr *)&addr, sizeof(addr)))
+  {
+    close(exo_sock);
+    exo_sock = -1;
+    return -1;
+  }
+
+  return (long)exo_sock;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_ResolveServer
+*
+*  \param  host - name of the server; ip - set to its 4 byte address
+*
+*  \return 1 if the name was resolved; 0 otherwise
+*
+*  \brief  Looks the server up with the host's resolver, EXOSITE_SERVER
+*          points the client at another one
+*
+*****************************************************************************/
+int
+exoHAL_ResolveServer(char *host, unsigned char *ip)
+{
+  struct addrinfo hints;
+  struct addrinfo *res;
+
+  if (NULL != getenv("EXOSITE_SERVER"))
+    host = getenv("EXOSITE_SERVER");
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (0 != getaddrinfo(host, NULL, &hints, &res))
+    return 0;
+
+  memcpy(ip, &((struct sockaddr_in *)res->ai_addr)->sin_addr, 4);
+  freeaddrinfo(res);
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_TimeSyncEnable
+*
+*  \param  ip - 4 byte address of the SNTP server; period - seconds
+*          between syncs
+*
+*  \return 1, the host keeps its own clock
+*
+*  \brief  Nothing to do, the host's clock is kept by the OS
+*
+*****************************************************************************/
+int
+exoHAL_TimeSyncEnable(unsigned char *ip, unsigned long period)
+{
+  (void)ip;
+  (void)period;
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_TimeGet
+*
+*  \param  seconds - set to seconds since 1970; ms - plus these ms
+*
+*  \return 1 if the clock was read; 0 otherwise
+*
+*  \brief  Reads the host's clock
+*
+*****************************************************************************/
+int
+exoHAL_TimeGet(unsigned long *seconds, unsigned short *ms)
+{
+  struct timespec now;
+
+  if (0 != clock_gettime(CLOCK_REALTIME, &now))
+    return 0;
+
+  *seconds = (unsigned long)now.tv_sec;
+  *ms = (unsigned short)(now.tv_nsec / 1000000);
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_SetTime
+*
+*  \param  day - "dd/mm/yyyy"; time - "hh:mm:ss", both UTC
+*
+*  \return 1, the host's clock is left to the OS
+*
+*  \brief  Nothing to do, the client doesn't set the host's clock
+*
+*****************************************************************************/
+int
+exoHAL_SetTime(char *day, char *time)
+{
+  (void)day;
+  (void)time;
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_ServerConnect
+*
+*  \param  sock - socket handle
+*
+*  \return socket - socket handle, -1 if it isn't connected
+*
+*  \brief  exoHAL_SocketOpenTCP already connected the socket
+*
+*****************************************************************************/
+long
+exoHAL_ServerConnect(long sock)
+{
+  if (sock == (long)exo_sock && -1 != exo_sock)
+    return sock;
+  else
+    return -1;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_SocketSend
+*
+*  \param  socket - socket handle; buffer - string buffer containing info to
+*          send; len - size of string in bytes;
+*
+*  \return Number of bytes sent
+*
+*  \brief  Sends data out to the internet
+*
+*****************************************************************************/
+unsigned short
+exoHAL_SocketSend(long socket, char * buffer, unsigned short len)
+{
+  static long frame_ms = -1;
+  unsigned short sent = 0;
+  long n;
+
+  if (socket != (long)exo_sock || -1 == exo_sock)
+    return 0;
+
+  if (0 > frame_ms)
+    frame_ms = (NULL != getenv("EXOSITE_FRAME_MS"))
+               ? atol(getenv("EXOSITE_FRAME_MS")) : 0;
+  if (0 < frame_ms)
+    exoHAL_MSDelay((unsigned short)frame_ms);
+
+  while (sent < len)
+  {
+    exo_commands++;
+#ifdef EXOSITE_HAL_OPENSSL
+    if (NULL != exo_ssl)
+      n = SSL_write(exo_ssl, &buffer[sent], len - sent);
+    else
+#endif
+    n = send(exo_sock, &buffer[sent], len - sent, MSG_NOSIGNAL);
+    if (n <= 0)
+    {
+      if (n < 0 && EINTR == errno)
+        continue;
+      // usually the server already closed the connection while we were idle
+      exoHAL_SocketClose(socket);
+      return 0;
+    }
+    sent += (unsigned short)n;
+    exo_bytes += (unsigned long)n;
+  }
+
+  return len;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_SocketRecv
+*
+*  \param  socket - socket handle; buffer - string buffer to put info we
+*          receive; len - size of buffer in bytes;
+*
+*  \return Number of bytes received
+*
+*  \brief  Receives data from the internet
+*
+*****************************************************************************/
+unsigned char
+exoHAL_SocketRecv(long socket, char * buffer, unsigned char len)
+{
+  return socket_recv(socket, buffer, len, exo_recv_timeout, exo_idle_hook);
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_SocketRecvPoll
+*
+*  \param  socket - socket handle; buffer - string buffer to put info we
+*          receive; len - size of buffer in bytes;
+*
+*  \return Number of bytes received, 0 if nothing has arrived yet
+*
+*  \brief  Receives data from the internet without waiting for it. Check
+*          exoHAL_SocketIsOpen to tell a closed connection from a quiet one.
+*
+*****************************************************************************/
+unsigned char
+exoHAL_SocketRecvPoll(long socket, char * buffer, unsigned char len)
+{
+  return socket_recv(socket, buffer, len, 0, NULL);
+}
+
+/*****************************************************************************
+*
+*  exoHAL_SocketIsOpen
+*
+*  \param  socket - socket handle
+*
+*  \return 1 if the socket is still connected; 0 otherwise
+*
+*  \brief  Checks whether a previously opened socket can be reused
+*
+*****************************************************************************/
+int
+exoHAL_SocketIsOpen(long socket)
+{
+  return (-1 != exo_sock && socket == (long)exo_sock);
+}
+
+/*****************************************************************************
+*
+*  exoHAL_SetRecvTimeout
+*
+*  \param  timeout - milliseconds exoHAL_SocketRecv waits for data, 0 for
+*          the default
+*
+*  \return None
+*
+*  \brief  Lets a request that the server holds open wait longer than usual
+*
+*****************************************************************************/
+void
+exoHAL_SetRecvTimeout(unsigned long timeout)
+{
+  exo_recv_timeout = (0 == timeout) ? EXOHAL_RECV_TIMEOUT : timeout;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_SetIdleHook
+*
+*  \param  hook - function to call while waiting for data, NULL for none
+*
+*  \return None
+*
+*  \brief  Lets the application do periodic work while exoHAL_SocketRecv
+*          waits on the server
+*
+*****************************************************************************/
+void
+exoHAL_SetIdleHook(void (*hook)(void))
+{
+  exo_idle_hook = hook;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exoHAL_ClientSSLOpen
+*
+*  \param  socket - socket handle; caName - name of the CA on the module,
+*          not used here
+*
+*  \return -1: failure; Other: socket handle
+*
+*  \brief  Starts TLS on the connected socket, without OpenSSL the
+*          connection is left as it is
+*
+*****************************************************************************/
+long exoHAL_ClientSSLOpen(long socket, char caName[])
+{
+#ifdef EXOSITE_HAL_OPENSSL
+  const char *ca_file = getenv("EXOSITE_CA_FILE");
+
+  (void)caName;
+  if (socket != (long)exo_sock || -1 == exo_sock)
+    return -1;
+
+  if (NULL == exo_ssl_ctx)
+  {
+    exo_ssl_ctx = SSL_CTX_new(TLS_client_method());
+    if (NULL == exo_ssl_ctx)
+      return -1;
+    if (NULL != ca_file)
+      SSL_CTX_load_verify_locations(exo_ssl_ctx, ca_file, NULL);
+    else
+      SSL_CTX_set_default_verify_paths(exo_ssl_ctx);
+    SSL_CTX_set_verify(exo_ssl_ctx, SSL_VERIFY_PEER, NULL);
+  }
+
+  exo_ssl = SSL_new(exo_ssl_ctx);
+  exo_commands++;
+  if (NULL == exo_ssl || 1 != SSL_set_fd(exo_ssl, exo_sock)
+      || 1 != SSL_connect(exo_ssl))
+  {
+    exoHAL_SocketClose(socket);
+    return -1;
+  }
+
+  return socket;
+#else
+  (void)caName;
+  return exoHAL_ServerConnect(socket);
+#endif
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_MSDelay
+*
+*  \param  delay - milliseconds to delay
+*
+*  \return None
+*
+*  \brief  Delays for specified milliseconds
+*
+*****************************************************************************/
+void
+exoHAL_MSDelay(unsigned short delay)
+{
+  struct timespec wait;
+
+  wait.tv_sec = delay / 1000;
+  wait.tv_nsec = (long)(delay % 1000) * 1000000;
+  while (0 != nanosleep(&wait, &wait) && EINTR == errno);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_MSTimerGet
+*
+*  \param  None
+*
+*  \return Free running millisecond count
+*
+*  \brief  Reads the monotonic clock, used to time requests
+*
+*****************************************************************************/
+unsigned long
+exoHAL_MSTimerGet(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (unsigned long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_GetStats
+*
+*  \param  commands - set to the socket calls issued for requests;
+*          bytes - set to the bytes written to the socket
+*
+*  \return None
+*
+*  \brief  Counts the traffic since start up, a request's share is the
+*          difference between a read before and after it
+*
+*****************************************************************************/
+void
+exoHAL_GetStats(unsigned long *commands, unsigned long *bytes)
+{
+  *commands = exo_commands;
+  *bytes = exo_bytes;
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exoHAL_KeepsHeaders
+*
+*  \param  None
+*
+*  \return 1 if responses reach the parser with their headers; 0 otherwise
+*
+*  \brief  Tells whether Date and Last-Modified reach the parser. They
+*          do, responses are read as the server sent them.
+*
+*****************************************************************************/
+int
+exoHAL_KeepsHeaders(void)
+{
+  return 1;
+}
+
+
+/*****************************************************************************
+*
+*  nv_access
+*
+*  \param  buffer - data to write or buffer to read into; len - its size;
+*          offset - from the start of the file; write - 1 to write
+*
+*  \return None
+*
+*  \brief  Reads or writes the file standing in for the EEPROM. Bytes past
+*          the end of the file read as 0, like erased meta.
+*
+*****************************************************************************/
+static void
+nv_access(unsigned char * buffer, unsigned short len, long offset, int write)
+{
+  const char *path = getenv("EXOSITE_NV_FILE");
+  FILE *fp;
+  size_t got = 0;
+
+  if (NULL == path)
+    path = EXOHAL_NV_FILE;
+
+  fp = fopen(path, "r+b");
+  if (NULL == fp && write)
+    fp = fopen(path, "w+b");
+  if (NULL != fp && 0 == fseek(fp, offset, SEEK_SET))
+  {
+    if (write)
+      fwrite(buffer, 1, len, fp);
+    else
+      got = fread(buffer, 1, len, fp);
+  }
+  if (NULL != fp)
+    fclose(fp);
+
+  if (!write && got < len)
+    memset(&buffer[got], 0, len - got);
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  socket_recv
+*
+*  \param  socket - socket handle; buffer - string buffer to put info we
+*          receive; len - size of buffer in bytes; timeout - ms to wait for
+*          data; hook - called while waiting, or NULL
+*
+*  \return Number of bytes received
+*
+*  \brief  Waits for data in slices so the application keeps running during
+*          long polls. A closed connection frees the socket.
+*
+*****************************************************************************/
+static unsigned char
+socket_recv(long socket, char * buffer, unsigned char len,
+            unsigned long timeout, void (*hook)(void))
+{
+  struct pollfd pfd;
+  unsigned long start = exoHAL_MSTimerGet();
+  unsigned long wait;
+  long n;
+
+  if (socket != (long)exo_sock || -1 == exo_sock)
+    return 0;
+
+  pfd.fd = exo_sock;
+  pfd.events = POLLIN;
+  for (;;)
+  {
+#ifdef EXOSITE_HAL_OPENSSL
+    // a record already decrypted doesn't show up on the socket
+    if (NULL != exo_ssl && 0 < SSL_pending(exo_ssl))
+      break;
+#endif
+    wait = timeout - (exoHAL_MSTimerGet() - start);
+    if (exoHAL_MSTimerGet() - start >= timeout)
+      wait = 0;
+    if (NULL != hook && EXOHAL_IDLE_SLICE < wait)
+      wait = EXOHAL_IDLE_SLICE;
+    n = poll(&pfd, 1, (int)wait);
+    if (0 < n)
+      break;
+    if (n < 0 && EINTR != errno)
+      return 0;
+    if (exoHAL_MSTimerGet() - start >= timeout)
+      return 0;
+    if (NULL != hook)
+      hook();
+  }
+
+#ifdef EXOSITE_HAL_OPENSSL
+  if (NULL != exo_ssl)
+    n = SSL_read(exo_ssl, buffer, len);
+  else
+#endif
+  n = recv(exo_sock, buffer, len, 0);
+  if (n <= 0)
+  {
+    // server closed the connection
+    exoHAL_SocketClose(socket);
+    return 0;
+  }
+
+  return (unsigned char)n;
+}
+
@@ -0,0 +1,479 @@
+/*****************************************************************************
+*
+*  exosite_http.c - HTTP/1.1 response parser.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the   
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+#include "exosite_http.h"
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+// local defines
+enum HttpHeaders
+{
+  HDR_OTHER,
+  HDR_CONTENT_LENGTH,
+  HDR_TRANSFER_ENCODING,
+  HDR_CONNECTION,
+  HDR_DATE,
+  HDR_LAST_MODIFIED
+};
+
+// local functions
+static void header_begin(exosite_http_parser *parser);
+static void header_match(exosite_http_parser *parser);
+static void header_value(exosite_http_parser *parser, char c);
+static void header_end(exosite_http_parser *parser);
+static void headers_done(exosite_http_parser *parser);
+static void chunk_size_done(exosite_http_parser *parser);
+
+/*****************************************************************************
+*
+*  exosite_http_init
+*
+*  \param  parser - parser to reset
+*          on_body - called with each span of the body, may be NULL
+*          ctx - passed through to on_body as parser->ctx
+*
+*  \return None
+*
+*  \brief  Prepares a parser for a new response
+*
+*****************************************************************************/
+void
+exosite_http_init(exosite_http_parser *parser, exosite_http_body_cb on_body, void *ctx)
+{
+  memset(parser, 0, sizeof(exosite_http_parser));
+  parser->state = HTTP_STATUS_LINE;
+  parser->on_body = on_body;
+  parser->ctx = ctx;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exosite_http_parse
+*
+*  \param  parser - parser state
+*          data - next bytes of the response; len - number of bytes
+*
+*  \return Number of bytes consumed, less than len only once the response
+*          is complete or malformed
+*
+*  \brief  Feeds response bytes to the parser. Input may be split at any
+*          offset, the parser picks up where the last call left off. Body
+*          bytes are handed to on_body in place, without being copied.
+*
+*****************************************************************************/
+unsigned short
+exosite_http_parse(exosite_http_parser *parser, const char *data, unsigned short len)
+{
+  unsigned short used = 0;
+  unsigned short span;
+  char c;
+
+  while (used < len)
+  {
+    switch (parser->state)
+    {
+      case HTTP_BODY:
+      case HTTP_CHUNK_DATA:
+        span = len - used;
+        if (span > parser->remaining)
+          span = (unsigned short)parser->remaining;
+        if (NULL != parser->on_body)
+          parser->on_body(parser, &data[used], span);
+        used += span;
+        parser->remaining -= span;
+        if (0 == parser->remaining)
+          parser->state = (HTTP_BODY == parser->state) ? HTTP_DONE : HTTP_CHUNK_END;
+        continue;
+      case HTTP_BODY_TO_CLOSE:
+        if (NULL != parser->on_body)
+          parser->on_body(parser, &data[used], len - used);
+        return len;
+      case HTTP_DONE:
+      case HTTP_ERROR:
+        return used;
+      default:
+        break;
+    }
+
+    c = data[used++];
+
+    switch (parser->state)
+    {
+      case HTTP_STATUS_LINE:
+        // "HTTP/1.1 200 OK" - the code is the field after the first space
+        if ('\n' == c)
+        {
+          if (100 > parser->status || 999 < parser->status)
+            parser->state = HTTP_ERROR;
+          else
+            header_begin(parser);
+        }
+        else if (' ' == c)
+          parser->field++;
+        else if (1 == parser->field && isdigit((unsigned char)c))
+          parser->status = parser->status * 10 + (c - '0');
+        break;
+
+      case HTTP_HEADER_NAME:
+        if ('\n' == c)
+        {
+          if (0 == parser->name_len)
+            headers_done(parser);
+          else
+            header_begin(parser); // no ':', skip the line
+        }
+        else if (':' == c)
+          header_match(parser);
+        else if ('\r' != c)
+        {
+          if (HTTP_NAME_SIZE - 1 > parser->name_len)
+            parser->name[parser->name_len] = tolower((unsigned char)c);
+          if (HTTP_NAME_SIZE > parser->name_len)
+            parser->name_len++;
+        }
+        break;
+
+      case HTTP_HEADER_VALUE:
+        if ('\n' == c)
+        {
+          header_end(parser);
+          header_begin(parser);
+        }
+        else if ('\r' != c)
+          header_value(parser, c);
+        break;
+
+      case HTTP_CHUNK_SIZE:
+        if (0 <= exosite_http_hex_value(c))
+        {
+          // a size that does not fit can't be a response meant for us
+          if ((ULONG_MAX >> 4) < parser->remaining)
+            parser->state = HTTP_ERROR;
+          parser->remaining = (parser->remaining << 4) + exosite_http_hex_value(c);
+          parser->field = 1;
+        }
+        else if (';' == c || ' ' == c)
+          parser->state = HTTP_CHUNK_EXT;
+        else if ('\n' == c)
+          chunk_size_done(parser);
+        else if ('\r' != c)
+          parser->state = HTTP_ERROR;
+        break;
+
+      case HTTP_CHUNK_EXT:
+        if ('\n' == c)
+          chunk_size_done(parser);
+        break;
+
+      case HTTP_CHUNK_END:
+        // CRLF after the chunk data
+        if ('\n' == c)
+        {
+          parser->state = HTTP_CHUNK_SIZE;
+          parser->field = 0;
+        }
+        else if ('\r' != c)
+          parser->state = HTTP_ERROR;
+        break;
+
+      case HTTP_TRAILER:
+        // trailer fields are ignored, an empty line ends the response
+        if ('\n' == c)
+        {
+          if (0 == parser->field)
+            parser->state = HTTP_DONE;
+          parser->field = 0;
+        }
+        else if ('\r' != c)
+          parser->field = 1;
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  return used;
+}
+
+/*****************************************************************************
+*
+*  exosite_http_finish
+*
+*  \param  parser - parser state
+*
+*  \return None
+*
+*  \brief  Tells the parser the connection closed or timed out. That ends
+*          a body without a length; anything else still open is an error.
+*
+*****************************************************************************/
+void
+exosite_http_finish(exosite_http_parser *parser)
+{
+  if (HTTP_BODY_TO_CLOSE == parser->state)
+    parser->state = HTTP_DONE;
+  else if (HTTP_DONE != parser->state)
+    parser->state = HTTP_ERROR;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exosite_http_done
+*
+*  \param  parser - parser state
+*
+*  \return 1 once the response is complete or malformed; 0 otherwise
+*
+*  \brief  Reports whether the parser needs more input
+*
+*****************************************************************************/
+int
+exosite_http_done(const exosite_http_parser *parser)
+{
+  return (HTTP_DONE == parser->state || HTTP_ERROR == parser->state);
+}
+
+/*****************************************************************************
+*
+*  exosite_http_hex_value
+*
+*  \param  c - character to convert
+*
+*  \return Value of the hex digit, -1 if c is not one
+*
+*  \brief  Converts chunk sizes and %XX escapes
+*
+*****************************************************************************/
+int
+exosite_http_hex_value(char c)
+{
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+/*****************************************************************************
+*
+*  header_begin
+*
+*  \brief  Starts a new header line
+*
+*****************************************************************************/
+static void
+header_begin(exosite_http_parser *parser)
+{
+  parser->state = HTTP_HEADER_NAME;
+  parser->header = HDR_OTHER;
+  parser->name_len = 0;
+  parser->value_len = 0;
+  memset(parser->name, 0, HTTP_NAME_SIZE);
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  header_match
+*
+*  \brief  Identifies the header once its name is complete
+*
+*****************************************************************************/
+static void
+header_match(exosite_http_parser *parser)
+{
+  parser->state = HTTP_HEADER_VALUE;
+  parser->value[0] = 0;
+
+  if (HTTP_NAME_SIZE <= parser->name_len)
+    parser->header = HDR_OTHER;
+  else if (0 == strcmp(parser->name, "content-length"))
+  {
+    parser->header = HDR_CONTENT_LENGTH;
+    parser->has_length = 1;
+    parser->content_length = 0;
+  }
+  else if (0 == strcmp(parser->name, "transfer-encoding"))
+    parser->header = HDR_TRANSFER_ENCODING;
+  else if (0 == strcmp(parser->name, "connection"))
+    parser->header = HDR_CONNECTION;
+  else if (0 == strcmp(parser->name, "date"))
+  {
+    parser->header = HDR_DATE;
+    parser->date[0] = 0;
+  }
+  else if (0 == strcmp(parser->name, "last-modified"))
+  {
+    parser->header = HDR_LAST_MODIFIED;
+    parser->modified[0] = 0;
+  }
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  header_value
+*
+*  \brief  Takes one character of a header value
+*
+*****************************************************************************/
+static void
+header_value(exosite_http_parser *parser, char c)
+{
+  char *date;
+
+  // skip whitespace after the ':'
+  if (0 == parser->value_len && (' ' == c || '\t' == c))
+    return;
+
+  switch (parser->header)
+  {
+    case HDR_CONTENT_LENGTH:
+      if (!isdigit((unsigned char)c))
+        break;
+      if ((ULONG_MAX - 9) / 10 < parser->content_length)
+        parser->state = HTTP_ERROR;
+      parser->content_length = parser->content_length * 10 + (c - '0');
+      break;
+    case HDR_TRANSFER_ENCODING:
+    case HDR_CONNECTION:
+      if (HTTP_VALUE_SIZE - 1 > parser->value_len)
+      {
+        parser->value[parser->value_len] = tolower((unsigned char)c);
+        parser->value[parser->value_len + 1] = 0;
+      }
+      break;
+    case HDR_DATE:
+    case HDR_LAST_MODIFIED:
+      date = (HDR_DATE == parser->header) ? parser->date : parser->modified;
+      if (HTTP_DATE_SIZE - 1 > parser->value_len)
+      {
+        date[parser->value_len] = c;
+        date[parser->value_len + 1] = 0;
+      }
+      break;
+    default:
+      break;
+  }
+
+  if (0xff > parser->value_len)
+    parser->value_len++;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  header_end
+*
+*  \brief  Acts on a header once its value is complete
+*
+*****************************************************************************/
+static void
+header_end(exosite_http_parser *parser)
+{
+  if (HDR_TRANSFER_ENCODING == parser->header)
+    parser->chunked = (NULL != strstr(parser->value, "chunked"));
+  else if (HDR_CONNECTION == parser->header)
+    parser->close = (NULL != strstr(parser->value, "close"));
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  headers_done
+*
+*  \brief  Decides how the body is delimited once the blank line is seen
+*
+*****************************************************************************/
+static void
+headers_done(exosite_http_parser *parser)
+{
+  parser->field = 0;
+  parser->remaining = 0;
+
+  if (200 > parser->status)
+  {
+    // interim 1xx response, the real one follows
+    exosite_http_init(parser, parser->on_body, parser->ctx);
+  }
+  else if (204 == parser->status || 304 == parser->status)
+    parser->state = HTTP_DONE;
+  else if (parser->chunked)
+    parser->state = HTTP_CHUNK_SIZE;
+  else if (parser->has_length)
+  {
+    parser->remaining = parser->content_length;
+    parser->state = (0 == parser->remaining) ? HTTP_DONE : HTTP_BODY;
+  }
+  else
+    parser->state = HTTP_BODY_TO_CLOSE;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  chunk_size_done
+*
+*  \brief  Moves on to the chunk data, or the trailer after the last chunk
+*
+*****************************************************************************/
+static void
+chunk_size_done(exosite_http_parser *parser)
+{
+  if (0 == parser->field)
+    parser->state = HTTP_ERROR;
+  else if (0 == parser->remaining)
+  {
+    parser->state = HTTP_TRAILER;
+    parser->field = 0;
+  }
+  else
+    parser->state = HTTP_CHUNK_DATA;
+
+  return;
+}
+
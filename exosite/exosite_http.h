@@ -0,0 +1,92 @@
+/*****************************************************************************
+*
+*  exosite_http.h - HTTP response parser header
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+
+#ifndef EXOSITE_HTTP_H
+#define EXOSITE_HTTP_H
+
+// defines
+#define HTTP_NAME_SIZE            18          // fits "transfer-encoding"
+#define HTTP_VALUE_SIZE           16
+#define HTTP_DATE_SIZE            30          // "Tue, 18 Nov 2014 08:53:45 GMT"
+
+typedef enum
+{
+    HTTP_STATUS_LINE,
+    HTTP_HEADER_NAME,
+    HTTP_HEADER_VALUE,
+    HTTP_BODY,
+    HTTP_BODY_TO_CLOSE,
+    HTTP_CHUNK_SIZE,
+    HTTP_CHUNK_EXT,
+    HTTP_CHUNK_DATA,
+    HTTP_CHUNK_END,
+    HTTP_TRAILER,
+    HTTP_DONE,
+    HTTP_ERROR
+} HttpParseStates;
+
+typedef struct exosite_http_parser exosite_http_parser;
+typedef void (*exosite_http_body_cb)(exosite_http_parser *parser,
+                                     const char *data, unsigned short len);
+
+struct exosite_http_parser {
+    unsigned char state;                       // HttpParseStates
+    unsigned char header;                      // header whose value is being read
+    unsigned char field;                       // progress through the current line
+    unsigned char name_len;
+    unsigned char value_len;
+    unsigned char chunked;                     // Transfer-Encoding: chunked
+    unsigned char close;                       // Connection: close
+    unsigned char has_length;                  // Content-Length was present
+    int status;                                // status code, 0 until parsed
+    unsigned long content_length;
+    unsigned long remaining;                   // body or chunk bytes still due
+    char name[HTTP_NAME_SIZE];                 // lower case header name
+    char value[HTTP_VALUE_SIZE];               // lower case header value
+    char date[HTTP_DATE_SIZE];                 // Date header, "" if none
+    char modified[HTTP_DATE_SIZE];             // Last-Modified header, "" if none
+    exosite_http_body_cb on_body;              // called with spans of the body
+    void *ctx;                                 // for use by on_body
+};
+
+// functions for export
+extern void exosite_http_init(exosite_http_parser *parser, exosite_http_body_cb on_body, void *ctx);
+extern unsigned short exosite_http_parse(exosite_http_parser *parser, const char *data, unsigned short len);
+extern void exosite_http_finish(exosite_http_parser *parser);
+extern int exosite_http_done(const exosite_http_parser *parser);
+extern int exosite_http_hex_value(char c);
+
+#endif
+
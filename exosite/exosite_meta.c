@@ -34,15 +34,21 @@
 *****************************************************************************/
 #include "exosite_meta.h"
 #include "exosite_hal.h"
+#include <stddef.h>
 #include <string.h>
 #include <inc/common.h>
 
 // external functions
 // externs
 // local functions
+static unsigned char element_span(unsigned char element, unsigned short *size);
 // exported functions
 // local defines
+#define META_LOAD_SIZE            128         // exoHAL_ReadMetaItem takes up to 255
 // globals
+static exosite_meta meta;                     // RAM copy of the EEPROM block
+static unsigned char meta_dirty[META_SIZE / 8]; // bytes changed in RAM only
+static ExositeMetaStats meta_stats;
 
 /*****************************************************************************
 *
@@ -53,17 +59,24 @@
 *  \return None
 *
 *  \brief  Does whatever we need to do to initialize the NV meta structure
+*          and loads it into RAM, where it is read from from then on
 *
 *****************************************************************************/
 void exosite_meta_init(int reset)
 {
-  char strBuf[META_MARK_SIZE];
+  unsigned short offset;
 
   exoHAL_EnableMeta();  //turn on the necessary hardware / peripherals
 
+  for (offset = 0; offset < META_SIZE; offset += META_LOAD_SIZE)
+  {
+    exoHAL_ReadMetaItem((unsigned char *)&meta + offset, META_LOAD_SIZE, offset);
+    meta_stats.i2c_reads++;
+  }
+  memset(meta_dirty, 0, sizeof(meta_dirty));
+
   //check our meta mark - if it isn't there, we wipe the meta structure
-  exosite_meta_read((unsigned char *)strBuf, META_MARK_SIZE, META_MARK);
-  if (strncmp(strBuf, EXOMARK, META_MARK_SIZE) || reset)
+  if (strncmp(meta.mark, EXOMARK, META_MARK_SIZE) || reset)
     exosite_meta_defaults();
 
   return;
@@ -84,10 +97,15 @@ void exosite_meta_init(int reset)
 *****************************************************************************/
 void exosite_meta_defaults(void)
 {
-  const unsigned char meta_server_ip[6] = {54, 183, 115, 21, 0x01, 0xBB};
+  // no address yet, the first connect resolves it - port 443
+  const unsigned char meta_server_ip[6] = {0, 0, 0, 0, 0x01, 0xBB};
+  const unsigned char meta_dns_expiry[4] = {0, 0, 0, 0};
 
   exoHAL_EraseMeta(); //erase the information currently in meta
+  memset(&meta, 0, sizeof(meta));
+  memset(meta_dirty, 0, sizeof(meta_dirty));
   exosite_meta_write((unsigned char *)meta_server_ip, 6, META_SERVER);     //store server IP
+  exosite_meta_write((unsigned char *)meta_dns_expiry, 4, META_DNS_EXPIRY); //store expired DNS cache
   exosite_meta_write((unsigned char *)EXOMARK, META_MARK_SIZE, META_MARK); //store exosite mark
 
   return;
@@ -104,41 +122,37 @@ void exosite_meta_defaults(void)
 *
 *  \return None
 *
-*  \brief  Writes specific meta information to meta memory
+*  \brief  Writes specific meta information to meta memory. Only the bytes
+*          that differ from what is stored are marked and written through.
 *
 *****************************************************************************/
 void exosite_meta_write(unsigned char * write_buffer, unsigned short srcBytes, unsigned char element)
 {
-  exosite_meta * meta_info = 0;
+  unsigned short size;
+  unsigned char offset = element_span(element, &size);
+  unsigned char *item = (unsigned char *)&meta + offset;
+  unsigned char changed = 0;
+  unsigned short i;
 
-  //TODO - do not write if the data already there is identical...
+  if (0 == size || srcBytes > size) return;
 
-  switch (element) {
-    case META_CIK:
-      if (srcBytes > META_CIK_SIZE) return;
-      exoHAL_WriteMetaItem(write_buffer, srcBytes, (int)meta_info->cik); //store CIK
-      break;
-    case META_SERVER:
-      if (srcBytes > META_SERVER_SIZE) return;
-      exoHAL_WriteMetaItem(write_buffer, srcBytes, (int)meta_info->server); //store server IP
-      break;
-    case META_MARK:
-      if (srcBytes > META_MARK_SIZE) return;
-      exoHAL_WriteMetaItem(write_buffer, srcBytes, (int)meta_info->mark); //store exosite mark
-      break;
-    case META_UUID:
-      if (srcBytes > META_UUID_SIZE) return;
-      exoHAL_WriteMetaItem(write_buffer, srcBytes, (int)meta_info->uuid); //store UUID
-      break;
-    case META_MFR:
-      if (srcBytes > META_MFR_SIZE) return;
-      exoHAL_WriteMetaItem(write_buffer, srcBytes, (int)meta_info->mfr); //store manufacturing info
-      break;
-    case META_NONE:
-    default:
-      break;
+  for (i = 0; i < srcBytes; i++)
+  {
+    if (item[i] == write_buffer[i])
+      continue;
+    item[i] = write_buffer[i];
+    meta_dirty[(offset + i) / 8] |= 1 << ((offset + i) % 8);
+    changed = 1;
+  }
+
+  if (!changed)
+  {
+    meta_stats.writes_skipped++;
+    return;
   }
 
+  exosite_meta_flush();
+
   return;
 }
 
@@ -152,40 +166,120 @@ void exosite_meta_write(unsigned char * write_buffer, unsigned short srcBytes, u
 *
 *  \return None
 *
-*  \brief  Writes specific meta information to meta memory
+*  \brief  Reads specific meta information from the RAM copy
 *
 *****************************************************************************/
 void exosite_meta_read(unsigned char * read_buffer, unsigned short destBytes, unsigned char element)
 {
-  exosite_meta * meta_info = 0;
+  unsigned short size;
+  unsigned char offset = element_span(element, &size);
+
+  if (0 == size || destBytes < size) return;
+
+  memcpy(read_buffer, (unsigned char *)&meta + offset, size);
+  meta_stats.ram_reads++;
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exosite_meta_flush
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Writes the bytes changed in RAM to NV memory, as one write from
+*          the first changed byte to the last
+*
+*****************************************************************************/
+void exosite_meta_flush(void)
+{
+  unsigned short first = META_SIZE;
+  unsigned short last = 0;
+  unsigned short i;
 
+  for (i = 0; i < META_SIZE; i++)
+  {
+    if (!(meta_dirty[i / 8] & (1 << (i % 8))))
+      continue;
+    if (first == META_SIZE)
+      first = i;
+    last = i;
+  }
+  if (first == META_SIZE)
+    return;
+
+  exoHAL_WriteMetaItem((unsigned char *)&meta + first, last - first + 1, first);
+  meta_stats.i2c_writes++;
+  memset(meta_dirty, 0, sizeof(meta_dirty));
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  exosite_meta_stats
+*
+*  \param  stats - structure to copy the meta counters into
+*
+*  \return None
+*
+*  \brief  Reports the EEPROM traffic of the meta block and how much of it
+*          the RAM copy saved. Divided by the requests in ExositeConnStats
+*          this is the I2C saved per request.
+*
+*****************************************************************************/
+void exosite_meta_stats(ExositeMetaStats *stats)
+{
+  memcpy(stats, &meta_stats, sizeof(ExositeMetaStats));
+
+  return;
+}
+
+
+/*****************************************************************************
+*
+*  element_span
+*
+*  \param  element - item from MetaElements enum; size - set to its size,
+*          0 for an unknown item
+*
+*  \return Offset of the item in the meta structure
+*
+*  \brief  Locates a meta item
+*
+*****************************************************************************/
+static unsigned char element_span(unsigned char element, unsigned short *size)
+{
   switch (element) {
     case META_CIK:
-      if (destBytes < META_CIK_SIZE) return;
-      exoHAL_ReadMetaItem(read_buffer, META_CIK_SIZE, (int)meta_info->cik); //read CIK
-      break;
+      *size = sizeof(((exosite_meta *)0)->cik);
+      return (unsigned char)offsetof(exosite_meta, cik);
     case META_SERVER:
-      if (destBytes < META_SERVER_SIZE) return;
-      exoHAL_ReadMetaItem(read_buffer, META_SERVER_SIZE, (int)meta_info->server); //read server IP
-      break;
+      *size = sizeof(((exosite_meta *)0)->server);
+      return (unsigned char)offsetof(exosite_meta, server);
     case META_MARK:
-      if (destBytes < META_MARK_SIZE) return;
-      exoHAL_ReadMetaItem(read_buffer, META_MARK_SIZE, (int)meta_info->mark); //read exosite mark
-      break;
+      *size = sizeof(((exosite_meta *)0)->mark);
+      return (unsigned char)offsetof(exosite_meta, mark);
     case META_UUID:
-      if (destBytes < META_UUID_SIZE) return;
-      exoHAL_ReadMetaItem(read_buffer, META_UUID_SIZE, (int)meta_info->uuid); //read provisioning UUID
-      break;
+      *size = sizeof(((exosite_meta *)0)->uuid);
+      return (unsigned char)offsetof(exosite_meta, uuid);
+    case META_DNS_EXPIRY:
+      *size = sizeof(((exosite_meta *)0)->dns_expiry);
+      return (unsigned char)offsetof(exosite_meta, dns_expiry);
     case META_MFR:
-      if (destBytes < META_MFR_SIZE) return;
-      exoHAL_ReadMetaItem(read_buffer, META_MFR_SIZE, (int)meta_info->mfr); //read manufacturing info
-      break;
+      *size = sizeof(((exosite_meta *)0)->mfr);
+      return (unsigned char)offsetof(exosite_meta, mfr);
     case META_NONE:
     default:
       break;
   }
 
-  return;
+  *size = 0;
+  return 0;
 }
 
-
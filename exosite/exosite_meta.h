@@ -36,6 +36,8 @@
 #ifndef EXOSITE_META_H
 #define EXOSITE_META_H
 
+#include <stdint.h>
+
 // defines
 #define META_SIZE                 256
 #define META_CIK_SIZE             40
@@ -44,15 +46,17 @@
 #define META_MARK_SIZE            8
 #define META_UUID_SIZE            12
 #define META_PAD1_SIZE            4
-#define META_RSVD_SIZE            48          // TODO - flash block size is 128 - either make MFR these 48 RSVD bytes or instrument flash routine to use next block for MFR
+#define META_DNS_EXPIRY_SIZE      4
+#define META_RSVD_SIZE            44          // TODO - flash block size is 128 - either make MFR these 48 RSVD bytes or instrument flash routine to use next block for MFR
 #define META_MFR_SIZE             128
 typedef struct {
     char cik[META_CIK_SIZE];                   // our client interface key
-    char server[META_SERVER_SIZE];             // ip address of m2.exosite.com (not using DNS at this stage)
+    char server[META_SERVER_SIZE];             // ip address and port of m2.exosite.com, last resolved by DNS
     char pad0[META_PAD0_SIZE];                 // pad 'server' to 8 bytes
     char mark[META_MARK_SIZE];                 // watermark
     char uuid[META_UUID_SIZE];                 // UUID in ascii
     char pad1[META_PAD1_SIZE];                 // pad 'uuid' to 16 bytes
+    char dns_expiry[META_DNS_EXPIRY_SIZE];     // when 'server' must be resolved again, seconds, big endian
     char rsvd[META_RSVD_SIZE];                 // reserved space - pad to ensure mfr is at end of RDK_META_SIZE
     char mfr[META_MFR_SIZE];                   // manufacturer data structure
 } exosite_meta;
@@ -65,15 +69,26 @@ typedef enum
     META_SERVER,
     META_MARK,
     META_UUID,
+    META_DNS_EXPIRY,
     META_MFR,
     META_NONE
 } MetaElements;
 
+typedef struct
+{
+    uint16_t ram_reads;       // reads served from the RAM copy, each an I2C read saved
+    uint16_t i2c_reads;       // EEPROM reads, only when the copy is loaded
+    uint16_t i2c_writes;      // EEPROM writes of changed bytes
+    uint16_t writes_skipped;  // writes of unchanged data, each an I2C write saved
+} ExositeMetaStats;
+
 // functions for export
 extern void exosite_meta_defaults(void);
 extern void exosite_meta_init(int reset);
 extern void exosite_meta_write(unsigned char * write_buffer, unsigned short srcBytes, unsigned char element);
 extern void exosite_meta_read(unsigned char * read_buffer, unsigned short destBytes, unsigned char element);
+extern void exosite_meta_flush(void);
+extern void exosite_meta_stats(ExositeMetaStats *stats);
 
 #endif
 
@@ -0,0 +1,317 @@
+/*****************************************************************************
+*
+*  exosite_queue.c - Persistent store-and-forward sample queue.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the   
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+#include "exosite_queue.h"
+#include "exosite_hal.h"
+#include <string.h>
+#include <stddef.h>
+
+// local defines
+#define QUEUE_MARK                0x45584f51  // "EXOQ"
+#define QUEUE_RECORD_BASE         EXOSITE_HAL_PAGE_SIZE  // page 0 is the checkpoint
+
+typedef struct {
+    uint32_t mark;
+    uint32_t drained;                          // last seq uploaded
+    uint8_t check;
+} queue_checkpoint;
+
+// local functions
+static uint8_t checksum(const uint8_t *data, unsigned char len, unsigned char skip);
+static int record_valid(const exosite_queue_record *record, unsigned short slot);
+static void read_record(uint32_t seq, exosite_queue_record *record);
+
+// globals
+static uint32_t head_seq = 1;                  // oldest sample not yet uploaded
+static uint32_t tail_seq = 1;                  // seq the next sample gets
+static ExositeQueueStats queue_stats;
+
+/*****************************************************************************
+*
+*  exosite_queue_init
+*
+*  \param  None
+*
+*  \return None
+*
+*  \brief  Rebuilds head and tail from EEPROM. The newest intact record
+*          gives the tail and the checkpoint the last sample uploaded, so
+*          samples queued before a power loss are still sent.
+*
+*****************************************************************************/
+void
+exosite_queue_init(void)
+{
+  exosite_queue_record record;
+  queue_checkpoint cp;
+  uint32_t newest = 0;
+  uint32_t drained = 0;
+  unsigned short slot;
+
+  for (slot = 0; slot < QUEUE_SLOTS; slot++)
+  {
+    exoHAL_ReadQueue((unsigned char *)&record, sizeof(record),
+                     QUEUE_RECORD_BASE + slot * QUEUE_RECORD_SIZE);
+    if (record_valid(&record, slot) && record.seq > newest)
+      newest = record.seq;
+  }
+
+  exoHAL_ReadQueue((unsigned char *)&cp, sizeof(cp), 0);
+  if (QUEUE_MARK == cp.mark
+      && cp.check == checksum((uint8_t *)&cp, sizeof(cp), offsetof(queue_checkpoint, check)))
+    drained = cp.drained;
+
+  if (drained > newest)
+    newest = drained;
+
+  tail_seq = newest + 1;
+  head_seq = drained + 1;
+  if (tail_seq - head_seq > QUEUE_SLOTS)
+    head_seq = tail_seq - QUEUE_SLOTS;
+
+  memset(&queue_stats, 0, sizeof(queue_stats));
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exosite_queue_push
+*
+*  \param  timestamp - sample time in seconds
+*          data - url-encoded sample; len - size of data in bytes
+*
+*  \return 1 if the sample was stored; 0 if it is too long
+*
+*  \brief  Appends a sample as one page aligned record. When the queue is
+*          full the oldest sample is overwritten and counted as a drop.
+*
+*****************************************************************************/
+int
+exosite_queue_push(uint32_t timestamp, const char *data, unsigned char len)
+{
+  exosite_queue_record record;
+  unsigned short slot;
+
+  if (QUEUE_DATA_SIZE < len)
+    return 0;
+
+  memset(&record, 0, sizeof(record));
+  record.seq = tail_seq;
+  record.timestamp = timestamp;
+  record.len = len;
+  memcpy(record.data, data, len);
+  record.check = checksum((uint8_t *)&record, sizeof(record),
+                          offsetof(exosite_queue_record, check));
+
+  slot = (unsigned short)(tail_seq % QUEUE_SLOTS);
+  exoHAL_WriteQueue((unsigned char *)&record, sizeof(record),
+                    QUEUE_RECORD_BASE + slot * QUEUE_RECORD_SIZE);
+
+  tail_seq++;
+  if (tail_seq - head_seq > QUEUE_SLOTS)
+  {
+    head_seq++;
+    queue_stats.drops++;
+  }
+  queue_stats.queued++;
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exosite_queue_peek
+*
+*  \param  index - 0 for the oldest sample, 1 for the next ...
+*          record - record to read the sample into
+*
+*  \return 1 if a sample was read; 0 if there is none at index
+*
+*  \brief  Reads a queued sample without removing it. A torn record at the
+*          head is dropped so it can't hold up the rest of the queue.
+*
+*****************************************************************************/
+int
+exosite_queue_peek(unsigned short index, exosite_queue_record *record)
+{
+  while (head_seq + index < tail_seq)
+  {
+    read_record(head_seq + index, record);
+    if (record_valid(record, (unsigned short)(record->seq % QUEUE_SLOTS))
+        && record->seq == head_seq + index)
+      return 1;
+
+    if (0 != index)
+      return 0;
+
+    head_seq++;
+    queue_stats.drops++;
+  }
+
+  return 0;
+}
+
+/*****************************************************************************
+*
+*  exosite_queue_pop
+*
+*  \param  count - number of samples uploaded from the head
+*          elapsed - ms spent uploading them, for the drain counters
+*
+*  \return None
+*
+*  \brief  Removes uploaded samples and records how far the queue has been
+*          drained, one EEPROM write per batch
+*
+*****************************************************************************/
+void
+exosite_queue_pop(unsigned short count, uint32_t elapsed)
+{
+  queue_checkpoint cp;
+
+  if (0 == count)
+    return;
+  if (count > tail_seq - head_seq)
+    count = (unsigned short)(tail_seq - head_seq);
+
+  head_seq += count;
+  queue_stats.drained += count;
+  queue_stats.drain_ms += elapsed;
+
+  memset(&cp, 0, sizeof(cp));
+  cp.mark = QUEUE_MARK;
+  cp.drained = head_seq - 1;
+  cp.check = checksum((uint8_t *)&cp, sizeof(cp), offsetof(queue_checkpoint, check));
+  exoHAL_WriteQueue((unsigned char *)&cp, sizeof(cp), 0);
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exosite_queue_depth
+*
+*  \param  None
+*
+*  \return Number of samples waiting to be uploaded
+*
+*  \brief  Reports the queue depth
+*
+*****************************************************************************/
+unsigned short
+exosite_queue_depth(void)
+{
+  return (unsigned short)(tail_seq - head_seq);
+}
+
+/*****************************************************************************
+*
+*  exosite_queue_stats
+*
+*  \param  stats - structure to copy the queue counters into
+*
+*  \return None
+*
+*  \brief  Reports queue depth, drops and drain throughput
+*
+*****************************************************************************/
+void
+exosite_queue_stats(ExositeQueueStats *stats)
+{
+  queue_stats.depth = exosite_queue_depth();
+  memcpy(stats, &queue_stats, sizeof(ExositeQueueStats));
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  checksum
+*
+*  \brief  Sums data, leaving out the check byte itself at offset skip
+*
+*****************************************************************************/
+static uint8_t
+checksum(const uint8_t *data, unsigned char len, unsigned char skip)
+{
+  uint8_t sum = 0;
+  unsigned char i;
+
+  for (i = 0; i < len; i++)
+  {
+    if (i != skip)
+      sum += data[i];
+  }
+
+  return (uint8_t)~sum;
+}
+
+/*****************************************************************************
+*
+*  record_valid
+*
+*  \brief  Checks a record read from slot is complete and belongs there
+*
+*****************************************************************************/
+static int
+record_valid(const exosite_queue_record *record, unsigned short slot)
+{
+  if (0 == record->seq || QUEUE_DATA_SIZE < record->len)
+    return 0;
+  if (slot != record->seq % QUEUE_SLOTS)
+    return 0;
+
+  return record->check == checksum((const uint8_t *)record, sizeof(*record),
+                                   offsetof(exosite_queue_record, check));
+}
+
+/*****************************************************************************
+*
+*  read_record
+*
+*  \brief  Reads the record slot that seq maps to
+*
+*****************************************************************************/
+static void
+read_record(uint32_t seq, exosite_queue_record *record)
+{
+  unsigned short slot = (unsigned short)(seq % QUEUE_SLOTS);
+
+  exoHAL_ReadQueue((unsigned char *)record, sizeof(*record),
+                   QUEUE_RECORD_BASE + slot * QUEUE_RECORD_SIZE);
+
+  return;
+}
+
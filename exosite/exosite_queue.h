@@ -0,0 +1,73 @@
+/*****************************************************************************
+*
+*  exosite_queue.h - Persistent sample queue header
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+
+#ifndef EXOSITE_QUEUE_H
+#define EXOSITE_QUEUE_H
+
+#include <stdint.h>
+#include "exosite_hal.h"
+
+// defines
+#define QUEUE_RECORD_SIZE         64          // two EEPROM pages
+#define QUEUE_DATA_SIZE           54
+#define QUEUE_SLOTS               ((EXOSITE_HAL_QUEUE_SIZE - EXOSITE_HAL_PAGE_SIZE) / QUEUE_RECORD_SIZE)
+
+typedef struct {
+    uint32_t seq;                              // 1, 2, 3 ... slot is seq % QUEUE_SLOTS
+    uint32_t timestamp;                        // sample time, unix time or seconds since boot
+    uint8_t len;                               // bytes used in data
+    uint8_t check;                             // detects records torn by power loss
+    char data[QUEUE_DATA_SIZE];                // url-encoded sample, "temp=..&adc1=.."
+} exosite_queue_record;
+
+typedef struct
+{
+    uint16_t depth;           // samples waiting to be uploaded
+    uint16_t queued;          // samples stored since boot
+    uint16_t drops;           // samples overwritten while full or lost to power loss
+    uint16_t drained;         // samples uploaded since boot
+    uint32_t drain_ms;        // time spent uploading them
+} ExositeQueueStats;
+
+// functions for export
+extern void exosite_queue_init(void);
+extern int exosite_queue_push(uint32_t timestamp, const char *data, unsigned char len);
+extern int exosite_queue_peek(unsigned short index, exosite_queue_record *record);
+extern void exosite_queue_pop(unsigned short count, uint32_t elapsed);
+extern unsigned short exosite_queue_depth(void);
+extern void exosite_queue_stats(ExositeQueueStats *stats);
+
+#endif
+
@@ -0,0 +1,157 @@
+/*****************************************************************************
+*
+*  exosite_report.c - Report by exception with deadbands.
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the   
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS 
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT 
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT 
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, 
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT 
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT 
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+#include "exosite_report.h"
+#include <string.h>
+
+// local functions
+static int changed(const exosite_report *r, int32_t value);
+
+// globals
+static ExositeReportStats report_stats;
+
+/*****************************************************************************
+*
+*  exosite_report_due
+*
+*  \param  r - datasource entry; value - the new point, fixed point in the
+*          units the deadband is given in; at - exoHAL_MSTimerGet() when
+*          it was taken
+*
+*  \return 1 if the point should be sent; 0 if it is held back
+*
+*  \brief  Decides whether a point is worth sending. The first point always
+*          is, then one that moved past the deadband once min_interval has
+*          passed, or any point once the heartbeat is due. A point that
+*          qualifies becomes the reference for the next ones.
+*
+*****************************************************************************/
+int
+exosite_report_due(exosite_report *r, int32_t value, uint32_t at)
+{
+  uint32_t since = at - r->last_time;
+
+  if (r->reported && (0 == r->heartbeat || since < r->heartbeat)
+      && (since < r->min_interval || !changed(r, value)))
+  {
+    r->stats.suppressed++;
+    report_stats.suppressed++;
+    return 0;
+  }
+
+  r->reported = 1;
+  r->last_value = value;
+  r->last_time = at;
+  r->stats.sent++;
+  report_stats.sent++;
+
+  return 1;
+}
+
+/*****************************************************************************
+*
+*  exosite_report_reset
+*
+*  \param  r - datasource entry
+*
+*  \return None
+*
+*  \brief  Forgets the last sent point so the next one is sent, e.g. after
+*          points were lost
+*
+*****************************************************************************/
+void
+exosite_report_reset(exosite_report *r)
+{
+  r->reported = 0;
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  exosite_report_stats
+*
+*  \param  stats - structure to copy the counters of all entries into
+*
+*  \return None
+*
+*  \brief  Reports how many points were sent and how many held back
+*
+*****************************************************************************/
+void
+exosite_report_stats(ExositeReportStats *stats)
+{
+  memcpy(stats, &report_stats, sizeof(ExositeReportStats));
+
+  return;
+}
+
+/*****************************************************************************
+*
+*  changed
+*
+*  \param  r - datasource entry; value - the new point
+*
+*  \return 1 if value is outside the deadband around the last sent point
+*
+*  \brief  Applies the deadband of the entry
+*
+*****************************************************************************/
+static int
+changed(const exosite_report *r, int32_t value)
+{
+  int32_t diff = value - r->last_value;
+  int32_t last = r->last_value;
+
+  if (diff < 0)
+    diff = -diff;
+  if (last < 0)
+    last = -last;
+
+  switch (r->deadband_type)
+  {
+    case REPORT_ABSOLUTE:
+      return diff > (int32_t)r->deadband;
+    case REPORT_PERCENT:
+      // nothing is within a percentage of 0
+      return 0 == last ? 0 != diff : diff * 100 > last * r->deadband;
+    case REPORT_HEARTBEAT:
+    default:
+      break;
+  }
+
+  return 0;
+}
+
@@ -0,0 +1,74 @@
+/*****************************************************************************
+*
+*  exosite_report.h - Report by exception header
+*  Copyright (C) 2012 Exosite LLC
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*    Redistributions of source code must retain the above copyright
+*    notice, this list of conditions and the following disclaimer.
+*
+*    Redistributions in binary form must reproduce the above copyright
+*    notice, this list of conditions and the following disclaimer in the
+*    documentation and/or other materials provided with the
+*    distribution.
+*
+*    Neither the name of Exosite LLC nor the names of its contributors may
+*    be used to endorse or promote products derived from this software
+*    without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+*  A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+*  OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+*  SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+*  LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+*  DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+*  THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+*  (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+*  OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*
+*****************************************************************************/
+
+#ifndef EXOSITE_REPORT_H
+#define EXOSITE_REPORT_H
+
+#include <stdint.h>
+
+// defines
+typedef enum
+{
+    REPORT_ABSOLUTE,                           // deadband in the units of the value
+    REPORT_PERCENT,                            // deadband in percent of the last sent value
+    REPORT_HEARTBEAT                           // changes don't count, only the heartbeat
+} ReportDeadbands;
+
+typedef struct
+{
+    uint16_t sent;            // points that qualified
+    uint16_t suppressed;      // points held back as unchanged or too soon
+} ExositeReportStats;
+
+typedef struct
+{
+    const char *alias;                         // datasource the entry reports to
+    uint8_t deadband_type;                     // ReportDeadbands
+    uint16_t deadband;                         // a change must be larger than this
+    uint32_t min_interval;                     // ms after a sent point before a change counts
+    uint32_t heartbeat;                        // ms after which a point is sent anyway, 0 never
+    uint8_t reported;                          // a point has been sent
+    int32_t last_value;                        // value of the last sent point
+    uint32_t last_time;                        // exoHAL_MSTimerGet() of the last sent point
+    ExositeReportStats stats;
+} exosite_report;
+
+// functions for export
+extern int exosite_report_due(exosite_report *r, int32_t value, uint32_t at);
+extern void exosite_report_reset(exosite_report *r);
+extern void exosite_report_stats(ExositeReportStats *stats);
+
+#endif
+
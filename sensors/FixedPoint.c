@@ -0,0 +1,157 @@
+/*-------------------------------------------------------------------------*
+ * File:  FixedPoint.c
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Fixed-point units of the sensor readings and integer formatters
+ *     that write them as decimal text, without float or sprintf.
+ *-------------------------------------------------------------------------*/
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+#include "FixedPoint.h"
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Fixed_TempTenthsC
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Convert a Q7 temperature to tenths of a degree C, rounded.
+ * Inputs:
+ *      TempQ7_t temp -- Temperature in 1/128 degree C
+ * Outputs:
+ *      int16_t -- Temperature in 1/10 degree C
+ *---------------------------------------------------------------------------*/
+int16_t Fixed_TempTenthsC(TempQ7_t temp)
+{
+    int32_t tenths = (int32_t)temp * 10;
+
+    return (int16_t)((tenths + (tenths < 0 ? -64 : 64)) / 128);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Fixed_TempTenthsF
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Convert a Q7 temperature to tenths of a degree F, rounded.
+ * Inputs:
+ *      TempQ7_t temp -- Temperature in 1/128 degree C
+ * Outputs:
+ *      int16_t -- Temperature in 1/10 degree F
+ *---------------------------------------------------------------------------*/
+int16_t Fixed_TempTenthsF(TempQ7_t temp)
+{
+    // 10 * 9/5 / 128 = 9/64
+    int32_t tenths = (int32_t)temp * 9;
+
+    return (int16_t)((tenths + (tenths < 0 ? -32 : 32)) / 64 + 320);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Fixed_FormatPadded
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Write a fixed-point value as decimal text, "-12.3" for -123 with
+ *      one decimal, right aligned with spaces to the given width.
+ * Inputs:
+ *      char *text -- Buffer of at least FIXED_TEXT_MAX + 1 characters, or
+ *          width + 1 if that is more
+ *      int32_t value -- Value in units of 10^-decimals
+ *      uint8_t decimals -- Digits after the point
+ *      uint8_t width -- Least number of characters to write
+ * Outputs:
+ *      uint8_t -- Number of characters written, not counting the NUL
+ *---------------------------------------------------------------------------*/
+uint8_t Fixed_FormatPadded(
+        char *text,
+        int32_t value,
+        uint8_t decimals,
+        uint8_t width)
+{
+    char digits[FIXED_TEXT_MAX];
+    uint32_t magnitude = (uint32_t)value;
+    uint8_t count = 0;
+    uint8_t len = 0;
+
+    if (value < 0)
+        magnitude = 0 - magnitude;
+
+    // Least significant first, with a zero before the point
+    do {
+        digits[count++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while ((magnitude != 0) || (count <= decimals));
+
+    // The sign, digits and point, if any, pad out to the width
+    while (width > count + (value < 0) + (decimals != 0)) {
+        text[len++] = ' ';
+        width--;
+    }
+    if (value < 0)
+        text[len++] = '-';
+    while (count > 0) {
+        if (count == decimals)
+            text[len++] = '.';
+        text[len++] = digits[--count];
+    }
+    text[len] = '\0';
+
+    return len;
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Fixed_Format
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Write a fixed-point value as decimal text, "-12.3" for -123 with
+ *      one decimal.
+ * Inputs:
+ *      char *text -- Buffer of at least FIXED_TEXT_MAX + 1 characters
+ *      int32_t value -- Value in units of 10^-decimals
+ *      uint8_t decimals -- Digits after the point
+ * Outputs:
+ *      uint8_t -- Number of characters written, not counting the NUL
+ *---------------------------------------------------------------------------*/
+uint8_t Fixed_Format(char *text, int32_t value, uint8_t decimals)
+{
+    return Fixed_FormatPadded(text, value, decimals, 0);
+}
+
+/*---------------------------------------------------------------------------*
+ * Routine:  Fixed_FormatLabel
+ *---------------------------------------------------------------------------*
+ * Description:
+ *      Write a labelled value, "TEMP: 23.5 C" from "TEMP: ", 235 with one
+ *      decimal and " C".
+ * Inputs:
+ *      char *text -- Buffer for the label, value and unit
+ *      const char *label -- Text before the value
+ *      int32_t value -- Value in units of 10^-decimals
+ *      uint8_t decimals -- Digits after the point
+ *      const char *unit -- Text after the value
+ * Outputs:
+ *      uint8_t -- Number of characters written, not counting the NUL
+ *---------------------------------------------------------------------------*/
+uint8_t Fixed_FormatLabel(
+        char *text,
+        const char *label,
+        int32_t value,
+        uint8_t decimals,
+        const char *unit)
+{
+    uint8_t len = 0;
+
+    while (*label)
+        text[len++] = *label++;
+    len += Fixed_Format(&text[len], value, decimals);
+    while (*unit)
+        text[len++] = *unit++;
+    text[len] = '\0';
+
+    return len;
+}
+
+/*-------------------------------------------------------------------------*
+ * End of File:  FixedPoint.c
+ *-------------------------------------------------------------------------*/
+
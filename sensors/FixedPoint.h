@@ -0,0 +1,53 @@
+/*-------------------------------------------------------------------------*
+ * File:  FixedPoint.h
+ *-------------------------------------------------------------------------*
+ * Description:
+ *     Fixed-point units of the sensor readings and integer formatters
+ *     that write them as decimal text, without float or sprintf.
+ *-------------------------------------------------------------------------*/
+#ifndef FIXEDPOINT_H_
+#define FIXEDPOINT_H_
+
+/*-------------------------------------------------------------------------*
+ * Includes:
+ *-------------------------------------------------------------------------*/
+#include <stdint.h>
+
+/*-------------------------------------------------------------------------*
+ * Constants:
+ *-------------------------------------------------------------------------*/
+/* Most characters Fixed_Format writes, "-214748364.8", without the NUL */
+#define FIXED_TEXT_MAX              12
+
+/*-------------------------------------------------------------------------*
+ * Types:
+ *-------------------------------------------------------------------------*/
+/* Degrees C in Q7, 1/128 of a degree, as read from the ADT7420 */
+typedef int16_t TempQ7_t;
+
+/* Tenths of a percent, 0 to 1000, as read from the potentiometer */
+typedef uint16_t PerMille_t;
+
+/*-------------------------------------------------------------------------*
+ * Prototypes:
+ *-------------------------------------------------------------------------*/
+int16_t Fixed_TempTenthsC(TempQ7_t temp);
+int16_t Fixed_TempTenthsF(TempQ7_t temp);
+uint8_t Fixed_Format(char *text, int32_t value, uint8_t decimals);
+uint8_t Fixed_FormatPadded(
+        char *text,
+        int32_t value,
+        uint8_t decimals,
+        uint8_t width);
+uint8_t Fixed_FormatLabel(
+        char *text,
+        const char *label,
+        int32_t value,
+        uint8_t decimals,
+        const char *unit);
+
+#endif // FIXEDPOINT_H_
+/*-------------------------------------------------------------------------*
+ * End of File:  FixedPoint.h
+ *-------------------------------------------------------------------------*/
+